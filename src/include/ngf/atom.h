@@ -0,0 +1,62 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef N_ATOM_H
+#define N_ATOM_H
+
+#include <glib.h>
+
+/** Interned key. Every distinct string maps to exactly one atom for the
+ * lifetime of the process, so atoms can be compared and hashed as integers.
+ * Zero is never a valid atom.
+ */
+typedef guint32 NAtom;
+
+/** Invalid atom, returned when a string has not been interned. */
+#define N_ATOM_NONE 0
+
+/** Intern string. The string is copied if it is not known yet.
+ * @param str String
+ * @return Atom for string or N_ATOM_NONE if str is NULL
+ */
+NAtom       n_atom_intern        (const char *str);
+
+/** Intern static string. The string is not copied and must stay valid
+ * for the lifetime of the process, so plugins (which may be unloaded)
+ * should use n_atom_intern instead.
+ * @param str Static string
+ * @return Atom for string or N_ATOM_NONE if str is NULL
+ */
+NAtom       n_atom_intern_static (const char *str);
+
+/** Lookup atom for string without interning it.
+ * @param str String
+ * @return Atom for string or N_ATOM_NONE if string has never been interned
+ */
+NAtom       n_atom_lookup        (const char *str);
+
+/** Get string for atom.
+ * @param atom Atom
+ * @return Interned string or NULL if atom is N_ATOM_NONE
+ */
+const char* n_atom_to_string     (NAtom atom);
+
+#endif /* N_ATOM_H */
@@ -26,6 +26,7 @@
 typedef struct _NContext NContext;
 
 #include <ngf/value.h>
+#include <ngf/atom.h>
 
 /** Context value change callback function */
 typedef void (*NContextValueChangeFunc) (NContext *context,
@@ -34,6 +35,12 @@ typedef void (*NContextValueChangeFunc) (NContext *context,
                                          const NValue *new_value,
                                          void *userdata);
 
+/** Context batch change callback function. Keys is a list of the changed
+ * key names, valid only for the duration of the callback. */
+typedef void (*NContextBatchChangeFunc) (NContext *context,
+                                         GList *keys,
+                                         void *userdata);
+
 /**
  * Change or add key/value pair to context.
  *
@@ -44,6 +51,26 @@ typedef void (*NContextValueChangeFunc) (NContext *context,
 void          n_context_set_value                (NContext *context, const char *key,
                                                   NValue *value);
 
+/**
+ * Start a batch of value changes. Values set during the batch are visible
+ * right away, but change notifications are held back until the matching
+ * n_context_commit_batch. Batches may be nested, only the outermost commit
+ * notifies.
+ *
+ * @param context NContext structure.
+ */
+void          n_context_begin_batch              (NContext *context);
+
+/**
+ * Commit a batch of value changes. Every value change subscriber is called
+ * once per changed key with the value from before the batch and the final
+ * value, and every batch change subscriber is called once with all the
+ * changed keys. Keys that ended up with their original value are left out.
+ *
+ * @param context NContext structure.
+ */
+void          n_context_commit_batch             (NContext *context);
+
 /**
  * Get value by key from context.
  *
@@ -53,6 +80,25 @@ void          n_context_set_value                (NContext *context, const char
  */
 const NValue* n_context_get_value                (NContext *context, const char *key);
 
+/**
+ * Get value by interned key from context.
+ *
+ * @param context NContext structure.
+ * @param atom Interned key.
+ * @return Value as NValue or NULL if no value associated with key is found.
+ */
+const NValue* n_context_get_value_atom           (NContext *context, NAtom atom);
+
+/**
+ * Get context generation. Generation changes every time a value in the
+ * context is set, so anything derived from the context can be reused for
+ * as long as the generation stays the same.
+ *
+ * @param context NContext structure.
+ * @return Current generation.
+ */
+guint         n_context_get_generation           (NContext *context);
+
 /**
  * Subscribe callback function to key in context structure
  *
@@ -77,4 +123,27 @@ int           n_context_subscribe_value_change   (NContext *context, const char
 void          n_context_unsubscribe_value_change (NContext *context, const char *key,
                                                   NContextValueChangeFunc callback);
 
+/**
+ * Subscribe callback function to batches of value changes. Values set
+ * outside of a batch are delivered as a batch of one key.
+ *
+ * @param context NContext structure.
+ * @param callback Callback function.
+ * @param userdata Userdata.
+ * @return TRUE is successful.
+ * @see NContextBatchChangeFunc
+ */
+int           n_context_subscribe_batch_change   (NContext *context,
+                                                  NContextBatchChangeFunc callback,
+                                                  void *userdata);
+
+/**
+ * Unsubscribe batch change callback
+ *
+ * @param context NContext structure.
+ * @param callback Callback function, @see NContextBatchChangeFunc
+ */
+void          n_context_unsubscribe_batch_change (NContext *context,
+                                                  NContextBatchChangeFunc callback);
+
 #endif /* N_CONTEXT_H */
@@ -40,6 +40,8 @@ typedef enum _NCoreHook
     - Before any transforming, modifications.
     - Example is transform-plugin, which allows only certain properties to 
     go through and discards the rest.
+    - Result may be cached, callbacks must only depend on the request
+    properties and the context.
     */
     N_CORE_HOOK_NEW_REQUEST,
     /** Executed:
@@ -48,6 +50,8 @@ typedef enum _NCoreHook
     - Profile plugins transforms the *.profile keys to their target keys.
     - If somebody would like to have a "theme" based support, then this 
     would be the hook to act on.
+    - Result may be cached, callbacks must only depend on the request
+    properties and the context.
     */
     N_CORE_HOOK_TRANSFORM_PROPERTIES,
     /** Executed:
@@ -57,6 +61,14 @@ typedef enum _NCoreHook
     based on available resources (and for example, vibration status).
     */
     N_CORE_HOOK_FILTER_SINKS,
+    /** Executed:
+    - After the event configuration has been reloaded and some events
+    were added, changed or removed.
+    - Plugins that index the events (e.g. profile plugin) should update
+    their index from the added and removed events.
+    - Requests already playing keep the event they were resolved to.
+    */
+    N_CORE_HOOK_EVENTS_CHANGED,
     N_CORE_HOOK_LAST
 } NCoreHook;
 
@@ -76,6 +88,12 @@ typedef struct _NCoreHookFilterSinksData
     GList    *sinks;
 } NCoreHookFilterSinksData;
 
+typedef struct _NCoreHookEventsChangedData
+{
+    GList    *added;    /* NEvent*, new versions of the changed events */
+    GList    *removed;  /* NEvent*, old versions, valid during the hook */
+} NCoreHookEventsChangedData;
+
 /**
  * Return name of hook as string
  *
@@ -48,6 +48,35 @@ NContext*        n_core_get_context  (NCore *core);
  */
 GList*           n_core_get_requests (NCore *core);
 
+/**
+ * Find active request by id
+ *
+ * @param core Core.
+ * @param id Request id.
+ * @return Request or NULL if no active request has the id.
+ * @see n_request_set_id
+ */
+NRequest*        n_core_lookup_request (NCore *core, unsigned int id);
+
+/**
+ * Get active requests sent by client
+ *
+ * @param core Core.
+ * @param client Client name.
+ * @return Requests in GList type, owned by the core.
+ * @see n_request_set_client
+ */
+GList*           n_core_get_requests_by_client (NCore *core, const char *client);
+
+/**
+ * Get active requests for event
+ *
+ * @param core Core.
+ * @param name Event name.
+ * @return Requests in GList type, owned by the core.
+ */
+GList*           n_core_get_requests_by_name (NCore *core, const char *name);
+
 /**
  * Get list of registered sinks
  *
@@ -91,4 +120,28 @@ int              n_core_connect      (NCore *core, NCoreHook hook, int priority,
  */
 void             n_core_disconnect   (NCore *core, NCoreHook hook, NHookCallback callback, void *userdata);
 
+/**
+ * Mark request property as volatile. Core caches the result of resolving
+ * requests and volatile properties (e.g. identifiers that are unique for
+ * each request) are not taken into account when looking for an earlier
+ * result. Value of a volatile property must not affect event resolution
+ * and hooks must pass it through unchanged.
+ *
+ * @param core Core.
+ * @param key Property key.
+ */
+void             n_core_add_volatile_key (NCore *core, const char *key);
+
+/**
+ * Iterate over the statistics of every callback connected to the core
+ * hooks. Callbacks connected while loading a plugin are owned by that
+ * plugin.
+ *
+ * @param core Core.
+ * @param func Function called for each callback, the hook name is set.
+ * @param userdata Userdata.
+ * @see NHookSlotStats
+ */
+void             n_core_foreach_hook_stats (NCore *core, NHookStatsFunc func, void *userdata);
+
 #endif /* N_CORE_H */
@@ -46,6 +46,40 @@ typedef struct _NHook
 /** Hook callback function */
 typedef void (*NHookCallback) (NHook *hook, void *data, void *userdata);
 
+/** Accounting of a connected callback. Times are in microseconds. */
+typedef struct _NHookSlotStats
+{
+    /** Callback function */
+    NHookCallback callback;
+    /** Name of the plugin that connected the callback, may be NULL */
+    const char   *owner;
+    /** Number of times the callback has run */
+    guint64       count;
+    /** Total time spent in the callback */
+    gint64        total_time;
+    /** Longest single run of the callback */
+    gint64        max_time;
+    /** Time a single run may take before a warning is logged, 0 for none */
+    gint64        budget;
+    /** Number of runs that went over the budget */
+    guint         overruns;
+} NHookSlotStats;
+
+/** Slot statistics function
+ * @param hook Hook.
+ * @param stats Statistics of one connected callback.
+ * @param userdata Userdata given to n_hook_foreach_stats.
+ */
+typedef void (*NHookStatsFunc) (NHook *hook, const NHookSlotStats *stats, void *userdata);
+
+/** Slot observer function, called before and after each callback runs
+ * @param hook Hook.
+ * @param callback Callback function about to run or just finished.
+ * @param done FALSE before the callback runs, TRUE after it returned.
+ * @param userdata Userdata given to n_hook_fire_observed.
+ */
+typedef void (*NHookObserver) (NHook *hook, NHookCallback callback, int done, void *userdata);
+
 /** Initializes hook structure
  * @param hook Hook.
  */
@@ -62,6 +96,18 @@ void n_hook_init       (NHook *hook);
  */
 int  n_hook_connect    (NHook *hook, int priority, NHookCallback callback, void *userdata);
 
+/** Connect callback function to hook on behalf of an owner
+ * @param hook Hook.
+ * @param priority Priority of the callback function.
+ * @param callback Callback function.
+ * @param userdata Userdata.
+ * @param owner Name of the plugin connecting the callback, or NULL.
+ * @param budget Time in microseconds a single run may take, 0 for no budget.
+ * @return TRUE if success.
+ */
+int  n_hook_connect_full (NHook *hook, int priority, NHookCallback callback, void *userdata,
+                          const char *owner, gint64 budget);
+
 /** Disconnects callback function from hook
  * @param hook Hook.
  * @param callback Callback function.
@@ -69,6 +115,13 @@ int  n_hook_connect    (NHook *hook, int priority, NHookCallback callback, void
  */
 void n_hook_disconnect (NHook *hook, NHookCallback callback, void *userdata);
 
+/** Disconnects all callback functions connected on behalf of an owner
+ * @param hook Hook.
+ * @param owner Name of the plugin that connected the callbacks.
+ * @return Number of callbacks disconnected.
+ */
+int  n_hook_disconnect_owner (NHook *hook, const char *owner);
+
 /** Executes callback functions associated with hook
  * @param hook Hook.
  * @param data Data to pass the callback functions as userdata.
@@ -76,4 +129,57 @@ void n_hook_disconnect (NHook *hook, NHookCallback callback, void *userdata);
  */
 int  n_hook_fire       (NHook *hook, void *data);
 
+/** Executes callback functions associated with hook, reporting each
+ * callback to an observer.
+ * @param hook Hook.
+ * @param data Data to pass the callback functions as userdata.
+ * @param observer Function called around each callback.
+ * @param userdata Userdata for the observer.
+ * @return TRUE if success.
+ * @see NHookObserver
+ */
+int  n_hook_fire_observed (NHook *hook, void *data, NHookObserver observer, void *userdata);
+
+/** Executes callback functions associated with hook. Runs that go over
+ * a callback's budget are logged together with the label.
+ * @param hook Hook.
+ * @param data Data to pass the callback functions as userdata.
+ * @param label What the hook is fired for, e.g. the request name, or NULL.
+ * @param observer Function called around each callback, or NULL.
+ * @param userdata Userdata for the observer.
+ * @return TRUE if success.
+ */
+int  n_hook_fire_full  (NHook *hook, void *data, const char *label,
+                        NHookObserver observer, void *userdata);
+
+/** Executes only the callback functions connected on behalf of an owner
+ * @param hook Hook.
+ * @param data Data to pass the callback functions as userdata.
+ * @param owner Name of the plugin that connected the callbacks.
+ * @return TRUE if success.
+ */
+int  n_hook_fire_owner (NHook *hook, void *data, const char *owner);
+
+/** Change the time budget of a connected callback
+ * @param hook Hook.
+ * @param callback Callback function.
+ * @param userdata Userdata the callback was connected with.
+ * @param budget Time in microseconds a single run may take, 0 for no budget.
+ * @return TRUE if the callback was found.
+ */
+int  n_hook_set_budget (NHook *hook, NHookCallback callback, void *userdata, gint64 budget);
+
+/** Iterate over the statistics of all connected callbacks, in the order
+ * they are run.
+ * @param hook Hook.
+ * @param func Function called for each callback.
+ * @param userdata Userdata for the function.
+ */
+void n_hook_foreach_stats (NHook *hook, NHookStatsFunc func, void *userdata);
+
+/** Reset the statistics of all connected callbacks, budgets are kept.
+ * @param hook Hook.
+ */
+void n_hook_reset_stats (NHook *hook);
+
 #endif /* N_HOOK_H */
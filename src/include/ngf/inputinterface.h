@@ -73,6 +73,15 @@ NCore* n_input_interface_get_core      (NInputInterface *iface);
  */
 int    n_input_interface_play_request  (NInputInterface *iface, NRequest *request);
 
+/** Start playback of a batch of new requests. The requests are admitted
+ * together and start playing in the same main loop iteration, once the
+ * sinks of every request in the batch have been synchronized.
+ * @param iface NInputInterface structure
+ * @param requests List of NRequest structures, the list is not taken
+ * @return TRUE if success
+ */
+int    n_input_interface_play_batch    (NInputInterface *iface, GList *requests);
+
 /** Pauses playback of the request
  * @param iface NInputInterface structure
  * @param request NRequest structure
@@ -63,6 +63,35 @@ void n_log_initialize (NLogLevel level);
  */
 void n_log_set_level  (NLogLevel level);
 
+/** Change flight recorder level. Messages of the level and above are
+ * recorded in a ring buffer without formatting them, regardless of the
+ * logging level. Use N_LOG_LEVEL_NONE to disable recording.
+ * @param level Logging level
+ */
+void n_log_set_record_level (NLogLevel level);
+
+/** Get current flight recorder level
+ * @return Logging level
+ */
+NLogLevel n_log_get_record_level ();
+
+/** Write out the messages held in the flight recorder, oldest first,
+ * to the current log target.
+ */
+void n_log_dump_recorder ();
+
+/** Drop all messages held in the flight recorder.
+ */
+void n_log_clear_recorder ();
+
+/** Format the recorded messages whose format string lies between start
+ * and end, so that the memory can go away. Must be called before
+ * unloading code whose format strings may have been recorded.
+ * @param start First address of the memory.
+ * @param end Address right after the memory.
+ */
+void n_log_detach_records (const void *start, const void *end);
+
 /** Select log target
  * @param target Log target
  */
@@ -73,6 +102,13 @@ void n_log_set_target (NLogTarget target);
  */
 NLogTarget n_log_get_target ();
 
+/** Check if messages of the given level would be logged. Use to skip
+ * building expensive log arguments.
+ * @param level Logging level
+ * @return TRUE if messages of the level are logged.
+ */
+int n_log_enabled (NLogLevel level);
+
 /** Log message. Use convenience functions to send actual messages.
  * @param level Logging level
  * @param function Function to which the message is related to
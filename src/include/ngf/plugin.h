@@ -73,6 +73,16 @@ void             n_plugin_register_input (NPlugin *plugin, const NInputInterface
         return p_version;                       \
     }
 
+/** Macro to declare that the plugin can be loaded and its sinks
+ * initialized on a worker thread during startup, once the plugins listed
+ * in p_depends (space separated plugin names, may be empty) are done.
+ * Such plugin may only register interfaces and connect to hooks while
+ * loading. Plugins without the declaration are loaded on the main thread. */
+#define N_PLUGIN_STARTUP_DEPENDS(p_depends)     \
+    const char* n_plugin__get_startup_depends () { \
+        return p_depends;                       \
+    }
+
 /** Plugin loading function. Plugin declaration structure should be initialized here. */
 #define N_PLUGIN_LOAD(p_plugin)                 \
     int n_plugin__load (NPlugin* p_plugin)
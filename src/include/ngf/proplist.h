@@ -26,6 +26,7 @@
 typedef struct _NProplist NProplist;
 
 #include <ngf/value.h>
+#include <ngf/atom.h>
 
 /** Proplist manipulation function definition. Used in n_proplist_foreach
  * @param key Proplist key
@@ -103,13 +104,25 @@ gboolean    n_proplist_has_key     (const NProplist *proplist, const char *key);
  */
 gboolean    n_proplist_match_exact (const NProplist *a, const NProplist *b);
 
-/** Insert or update key/value pair in proplist
+/** Insert or update key/value pair in proplist. Ownership of value is
+ * transferred, the proplist keeps the instance and frees it when the key
+ * is unset or replaced. Proplists created in an arena copy the value and
+ * free it right away.
  * @param proplist Proplist
  * @param key Key
  * @param value Value
  */
 void        n_proplist_set         (NProplist *proplist, const char *key, const NValue *value);
 
+/** Insert or update key/value pair in proplist. The contents of value are
+ * moved into the proplist and the container is freed, value must not be
+ * used afterwards. Cheaper than n_proplist_set for small proplists.
+ * @param proplist Proplist
+ * @param key Key
+ * @param value Value
+ */
+void        n_proplist_set_take    (NProplist *proplist, const char *key, NValue *value);
+
 /** Get value from proplist
  * @param proplist Proplist
  * @param key Key
@@ -202,6 +215,109 @@ void        n_proplist_set_pointer (NProplist *proplist, const char *key, gpoint
  */
 gpointer    n_proplist_get_pointer (const NProplist *proplist, const char *key);
 
+/* atom variants. these avoid hashing the key string on every call and
+   should be used on the hot paths with keys interned beforehand. */
+
+/** Check if the proplist has key
+ * @param proplist Proplist
+ * @param atom Interned key
+ * @return TRUE if proplist has key
+ */
+gboolean    n_proplist_has_atom        (const NProplist *proplist, NAtom atom);
+
+/** Insert or update key/value pair in proplist. Ownership of value is transferred.
+ * @param proplist Proplist
+ * @param atom Interned key
+ * @param value Value
+ */
+void        n_proplist_set_atom        (NProplist *proplist, NAtom atom, const NValue *value);
+
+/** Insert or update key/value pair in proplist. The contents of value are
+ * moved and the container is freed, see n_proplist_set_take.
+ * @param proplist Proplist
+ * @param atom Interned key
+ * @param value Value
+ */
+void        n_proplist_set_take_atom   (NProplist *proplist, NAtom atom, NValue *value);
+
+/** Get value from proplist
+ * @param proplist Proplist
+ * @param atom Interned key
+ * @return Value of the key as NValue or NULL if empty
+ */
+NValue*     n_proplist_get_atom        (const NProplist *proplist, NAtom atom);
+
+/** Remove key from proplist
+ * @param proplist Proplist
+ * @param atom Interned key
+ */
+void        n_proplist_unset_atom      (NProplist *proplist, NAtom atom);
+
+/** Set or update string value in proplist
+ * @param proplist Proplist
+ * @param atom Interned key
+ * @param value Value
+ */
+void        n_proplist_set_string_atom (NProplist *proplist, NAtom atom, const char *value);
+
+/** Set or update string value without copying it. Only proplists created
+ * in an arena keep the pointer, the string must then stay valid until the
+ * arena is cleared. Other proplists copy the value as usual.
+ * @param proplist Proplist
+ * @param atom Interned key
+ * @param value Value
+ */
+void        n_proplist_set_string_borrowed_atom (NProplist *proplist, NAtom atom, const char *value);
+
+/** Get string value from proplist
+ * @param proplist Proplist
+ * @param atom Interned key
+ * @return Value or NULL if key is not found
+ */
+const char* n_proplist_get_string_atom (const NProplist *proplist, NAtom atom);
+
+/** Set or update int value in proplist
+ * @param proplist Proplist
+ * @param atom Interned key
+ * @param value Value
+ */
+void        n_proplist_set_int_atom    (NProplist *proplist, NAtom atom, gint value);
+
+/** Get int value from proplist
+ * @param proplist Proplist
+ * @param atom Interned key
+ * @return Value or 0 if key is not found
+ */
+gint        n_proplist_get_int_atom    (const NProplist *proplist, NAtom atom);
+
+/** Set or update uint value in proplist
+ * @param proplist Proplist
+ * @param atom Interned key
+ * @param value Value
+ */
+void        n_proplist_set_uint_atom   (NProplist *proplist, NAtom atom, guint value);
+
+/** Get uint value from proplist
+ * @param proplist Proplist
+ * @param atom Interned key
+ * @return Value or 0 if key is not found
+ */
+guint       n_proplist_get_uint_atom   (const NProplist *proplist, NAtom atom);
+
+/** Set or update boolean value in proplist
+ * @param proplist Proplist
+ * @param atom Interned key
+ * @param value Value
+ */
+void        n_proplist_set_bool_atom   (NProplist *proplist, NAtom atom, gboolean value);
+
+/** Get boolean value from proplist
+ * @param proplist Proplist
+ * @param atom Interned key
+ * @return Value or FALSE if key is not found
+ */
+gboolean    n_proplist_get_bool_atom   (const NProplist *proplist, NAtom atom);
+
 /** Dump contents of proplist to debug log
  * @param proplist Proplist
  * @see log.h
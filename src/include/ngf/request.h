@@ -50,6 +50,25 @@ void             n_request_free           (NRequest *request);
  */
 unsigned int     n_request_get_id         (NRequest *request);
 
+/** Set request id. Inputs set the id before playing the request, the
+ * request can then be looked up from the core by the id.
+ * @param request Request
+ * @param id Id unique among the active requests, 0 for none
+ */
+void             n_request_set_id         (NRequest *request, unsigned int id);
+
+/** Set name of the client that sent the request
+ * @param request Request
+ * @param client Client name, e.g. the D-Bus sender
+ */
+void             n_request_set_client     (NRequest *request, const char *client);
+
+/** Get name of the client that sent the request
+ * @param request Request
+ * @return Client name or NULL if not set
+ */
+const char*      n_request_get_client     (NRequest *request);
+
 /** Get request name
  * @param request Request
  * @return Name of the request
@@ -88,6 +107,28 @@ void             n_request_set_timeout    (NRequest *request, guint timeout);
 
 guint            n_request_get_timeout    (NRequest *request);
 
+/** Start a transaction on the request properties. The returned proplist
+ * reads through to the current properties, changes made to it are not
+ * visible in the request until committed. Hooks should use this instead of
+ * building a new proplist and replacing the properties.
+ * @param request Request
+ * @return Proplist to edit, owned by the request
+ */
+NProplist*       n_request_edit_properties    (NRequest *request);
+
+/** Apply the values set and unset in the edit to the request properties.
+ * @param request Request
+ * @param edit Proplist returned by n_request_edit_properties
+ */
+void             n_request_commit_properties  (NRequest *request, NProplist *edit);
+
+/** Drop the changes made in the edit, the request properties stay as
+ * they were.
+ * @param request Request
+ * @param edit Proplist returned by n_request_edit_properties
+ */
+void             n_request_discard_properties (NRequest *request, NProplist *edit);
+
 /** Store key/value pair to request
  * @param request Request
  * @param key Key
@@ -102,6 +143,48 @@ void             n_request_store_data     (NRequest *request, const char *key, v
  */
 void*            n_request_get_data       (NRequest *request, const char *key);
 
+/** Allocate memory that lives as long as the request. Intended for the
+ * per-request data of sinks, the memory is released all at once when the
+ * request is done and must not be freed by the caller.
+ * @param request Request
+ * @param size Number of bytes
+ * @return Pointer to the memory, aligned for any pointer sized type
+ */
+void*            n_request_alloc          (NRequest *request, gsize size);
+
+/** Allocate zero-filled memory that lives as long as the request.
+ * @param request Request
+ * @param size Number of bytes
+ * @return Pointer to the memory
+ */
+void*            n_request_alloc0         (NRequest *request, gsize size);
+
+/** Copy a string to memory that lives as long as the request.
+ * @param request Request
+ * @param str String to copy
+ * @return Copy of the string, or NULL if str is NULL
+ */
+char*            n_request_strdup         (NRequest *request, const char *str);
+
+/** Get the properties of a request that is being built, for filling them
+ * in place before the request is played. An empty proplist is created if
+ * the request has none. The proplist lives in the request, strings that
+ * outlive the request can be set to it without copying with
+ * n_proplist_set_string_borrowed_atom.
+ * @param request Request
+ * @return Properties owned by the request
+ */
+NProplist*       n_request_init_properties (NRequest *request);
+
+/** Keep data alive as long as the request. The destroy function is called
+ * when the request is freed, e.g. to drop a reference to the buffer that
+ * borrowed property values point to.
+ * @param request Request
+ * @param data Data to keep
+ * @param destroy Function to release the data
+ */
+void             n_request_keep           (NRequest *request, void *data, GDestroyNotify destroy);
+
 /** Check if the request is paused
  * @param request Request
  * @return TRUE if request is currently paused
@@ -0,0 +1,144 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "arena.h"
+
+#define N_ARENA_ALIGN (2 * sizeof (gpointer))
+
+#define ALIGN_PTR(p) \
+    ((gchar*) (((guintptr) (p) + N_ARENA_ALIGN - 1) & ~((guintptr) N_ARENA_ALIGN - 1)))
+
+struct _NArenaBlock
+{
+    NArenaBlock *next;
+    gsize        size;
+};
+
+static gpointer n_arena_alloc_block (NArena *arena, gsize size);
+
+
+
+void
+n_arena_init (NArena *arena)
+{
+    g_assert (arena != NULL);
+
+    arena->pos    = arena->inline_block;
+    arena->end    = arena->inline_block + N_ARENA_INLINE_SIZE;
+    arena->blocks = NULL;
+    arena->used   = 0;
+}
+
+void
+n_arena_clear (NArena *arena)
+{
+    NArenaBlock *block = NULL;
+    NArenaBlock *next  = NULL;
+
+    if (!arena)
+        return;
+
+    for (block = arena->blocks; block; block = next) {
+        next = block->next;
+        g_free (block);
+    }
+
+    n_arena_init (arena);
+}
+
+static gpointer
+n_arena_alloc_block (NArena *arena, gsize size)
+{
+    NArenaBlock *block      = NULL;
+    gsize        block_size = 0;
+    gchar       *data       = NULL;
+
+    /* the rest of the current block is abandoned. allocations larger than
+       a block get a block of their own. */
+
+    block_size = MAX (N_ARENA_BLOCK_SIZE, size + N_ARENA_ALIGN);
+
+    block       = g_malloc (sizeof (NArenaBlock) + block_size);
+    block->next = arena->blocks;
+    block->size = block_size;
+    arena->blocks = block;
+
+    data = ALIGN_PTR ((gchar*) block + sizeof (NArenaBlock));
+    arena->pos = data + size;
+    arena->end = (gchar*) block + sizeof (NArenaBlock) + block_size;
+
+    return data;
+}
+
+gpointer
+n_arena_alloc (NArena *arena, gsize size)
+{
+    gchar *data = NULL;
+
+    g_assert (arena != NULL);
+
+    if (size == 0)
+        return NULL;
+
+    arena->used += size;
+
+    data = ALIGN_PTR (arena->pos);
+    if (data > arena->end || (gsize) (arena->end - data) < size)
+        return n_arena_alloc_block (arena, size);
+
+    arena->pos = data + size;
+    return data;
+}
+
+gpointer
+n_arena_alloc0 (NArena *arena, gsize size)
+{
+    gpointer data = NULL;
+
+    if ((data = n_arena_alloc (arena, size)) != NULL)
+        memset (data, 0, size);
+
+    return data;
+}
+
+gchar*
+n_arena_strdup (NArena *arena, const char *str)
+{
+    gchar *copy = NULL;
+    gsize  size = 0;
+
+    if (!str)
+        return NULL;
+
+    size = strlen (str) + 1;
+    copy = n_arena_alloc (arena, size);
+    memcpy (copy, str, size);
+
+    return copy;
+}
+
+gsize
+n_arena_used (NArena *arena)
+{
+    return arena ? arena->used : 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef N_ARENA_H
+#define N_ARENA_H
+
+#include <glib.h>
+
+/* size of the first block, kept inline with the owner of the arena so that
+   typical request scoped data fits without touching the heap. */
+#define N_ARENA_INLINE_SIZE 2048
+
+/* size of the blocks added once the inline block is used up. */
+#define N_ARENA_BLOCK_SIZE  4096
+
+typedef struct _NArenaBlock NArenaBlock;
+
+/* bump allocator for data sharing the lifetime of a single owner, e.g. a
+   request. allocations are never freed one by one, everything is released
+   at once with n_arena_clear. the structure is exposed to allow embedding
+   it, the fields are private. */
+typedef struct _NArena
+{
+    gchar       *pos;                       /* next free byte in the current block */
+    gchar       *end;                       /* end of the current block */
+    NArenaBlock *blocks;                    /* blocks from the heap, newest first */
+    gsize        used;                      /* bytes handed out */
+    gchar        inline_block[N_ARENA_INLINE_SIZE];
+} NArena;
+
+void     n_arena_init   (NArena *arena);
+void     n_arena_clear  (NArena *arena);
+gpointer n_arena_alloc  (NArena *arena, gsize size);
+gpointer n_arena_alloc0 (NArena *arena, gsize size);
+gchar*   n_arena_strdup (NArena *arena, const char *str);
+gsize    n_arena_used   (NArena *arena);
+
+#endif /* N_ARENA_H */
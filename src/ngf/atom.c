@@ -0,0 +1,48 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <ngf/atom.h>
+
+/* atoms are backed by glib quarks, which are thread safe and never freed. */
+
+NAtom
+n_atom_intern (const char *str)
+{
+    return (NAtom) g_quark_from_string (str);
+}
+
+NAtom
+n_atom_intern_static (const char *str)
+{
+    return (NAtom) g_quark_from_static_string (str);
+}
+
+NAtom
+n_atom_lookup (const char *str)
+{
+    return (NAtom) g_quark_try_string (str);
+}
+
+const char*
+n_atom_to_string (NAtom atom)
+{
+    return g_quark_to_string ((GQuark) atom);
+}
@@ -0,0 +1,766 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <ngf/log.h>
+#include "config-cache.h"
+#include "core-internal.h"
+#include "event-internal.h"
+
+#define LOG_CAT "config-cache: "
+
+#define CACHE_MAGIC     0x4346474e  /* NGFC */
+#define CACHE_VERSION   7
+#define SOURCE_MISSING  G_MAXUINT64
+#define NULL_MARKER     G_MAXUINT32
+
+/* the cache is only ever read back on the same host, everything is
+   stored in native byte order. */
+
+typedef struct _NConfigCacheHeader
+{
+    guint32 magic;
+    guint32 version;
+    guint32 payload_size;
+    guint32 checksum;
+} NConfigCacheHeader;
+
+typedef struct _NConfigSource
+{
+    gchar   *path;
+    guint64  size;                  /* SOURCE_MISSING if there was no file */
+    gint64   mtime_sec;
+    gint64   mtime_nsec;
+} NConfigSource;
+
+struct _NConfigCache
+{
+    GList *sources;                 /* NConfigSource* in the order added */
+};
+
+typedef struct _NConfigReader
+{
+    const guint8 *data;
+    gsize         size;
+    gsize         offset;
+    gboolean      failed;
+} NConfigReader;
+
+static void         n_config_source_stat      (const char *path, NConfigSource *source);
+static guint32      n_config_cache_checksum   (const guint8 *data, gsize size);
+
+static void         n_config_put_u32          (GString *buf, guint32 value);
+static void         n_config_put_u64          (GString *buf, guint64 value);
+static void         n_config_put_string       (GString *buf, const char *str);
+static void         n_config_put_string_list  (GString *buf, GList *list);
+static void         n_config_put_value_cb     (const char *key, const NValue *value, gpointer userdata);
+static void         n_config_put_proplist     (GString *buf, const NProplist *proplist);
+
+static guint32      n_config_get_u32          (NConfigReader *reader);
+static guint64      n_config_get_u64          (NConfigReader *reader);
+static const char*  n_config_get_string       (NConfigReader *reader);
+static GList*       n_config_get_string_list  (NConfigReader *reader);
+static NProplist*   n_config_get_proplist     (NConfigReader *reader);
+
+static gboolean     n_config_cache_check_sources (NConfigReader *reader, NCore *core);
+static gboolean     n_config_cache_parse      (NCore *core, const guint8 *data, gsize size);
+
+
+
+static void
+n_config_source_stat (const char *path, NConfigSource *source)
+{
+    struct stat st;
+
+    if (stat (path, &st) < 0) {
+        source->size       = SOURCE_MISSING;
+        source->mtime_sec  = 0;
+        source->mtime_nsec = 0;
+        return;
+    }
+
+    source->size       = (guint64) st.st_size;
+    source->mtime_sec  = (gint64) st.st_mtim.tv_sec;
+    source->mtime_nsec = (gint64) st.st_mtim.tv_nsec;
+}
+
+static guint32
+n_config_cache_checksum (const guint8 *data, gsize size)
+{
+    guint32 hash = 2166136261U;
+    gsize   i;
+
+    /* fnv-1a, enough to catch truncated or partially written files. */
+
+    for (i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+static void
+n_config_put_u32 (GString *buf, guint32 value)
+{
+    g_string_append_len (buf, (const gchar*) &value, sizeof (value));
+}
+
+static void
+n_config_put_u64 (GString *buf, guint64 value)
+{
+    g_string_append_len (buf, (const gchar*) &value, sizeof (value));
+}
+
+static void
+n_config_put_string (GString *buf, const char *str)
+{
+    guint32 len;
+
+    if (!str) {
+        n_config_put_u32 (buf, NULL_MARKER);
+        return;
+    }
+
+    /* terminator is stored as well, strings can be used directly from
+       the mapped file. */
+
+    len = (guint32) strlen (str);
+    n_config_put_u32 (buf, len);
+    g_string_append_len (buf, str, len + 1);
+}
+
+static void
+n_config_put_string_list (GString *buf, GList *list)
+{
+    GList *iter = NULL;
+
+    n_config_put_u32 (buf, g_list_length (list));
+    for (iter = g_list_first (list); iter; iter = g_list_next (iter))
+        n_config_put_string (buf, (const char*) iter->data);
+}
+
+static void
+n_config_put_value_cb (const char *key, const NValue *value, gpointer userdata)
+{
+    GString *buf  = (GString*) userdata;
+    int      type = n_value_type (value);
+
+    n_config_put_string (buf, key);
+    n_config_put_u32 (buf, (guint32) type);
+
+    switch (type) {
+        case N_VALUE_TYPE_STRING:
+            n_config_put_string (buf, n_value_get_string (value));
+            break;
+        case N_VALUE_TYPE_INT:
+            n_config_put_u32 (buf, (guint32) n_value_get_int (value));
+            break;
+        case N_VALUE_TYPE_UINT:
+            n_config_put_u32 (buf, n_value_get_uint (value));
+            break;
+        case N_VALUE_TYPE_BOOL:
+            n_config_put_u32 (buf, n_value_get_bool (value) ? 1 : 0);
+            break;
+        default:
+            /* pointers never come from the configuration files. */
+            n_config_put_u32 (buf, 0);
+            break;
+    }
+}
+
+static void
+n_config_put_proplist (GString *buf, const NProplist *proplist)
+{
+    if (!proplist) {
+        n_config_put_u32 (buf, NULL_MARKER);
+        return;
+    }
+
+    n_config_put_u32 (buf, (guint32) n_proplist_size (proplist));
+    n_proplist_foreach (proplist, n_config_put_value_cb, buf);
+}
+
+static guint32
+n_config_get_u32 (NConfigReader *reader)
+{
+    guint32 value = 0;
+
+    if (reader->failed || reader->size - reader->offset < sizeof (value)) {
+        reader->failed = TRUE;
+        return 0;
+    }
+
+    memcpy (&value, reader->data + reader->offset, sizeof (value));
+    reader->offset += sizeof (value);
+
+    return value;
+}
+
+static guint64
+n_config_get_u64 (NConfigReader *reader)
+{
+    guint64 value = 0;
+
+    if (reader->failed || reader->size - reader->offset < sizeof (value)) {
+        reader->failed = TRUE;
+        return 0;
+    }
+
+    memcpy (&value, reader->data + reader->offset, sizeof (value));
+    reader->offset += sizeof (value);
+
+    return value;
+}
+
+static const char*
+n_config_get_string (NConfigReader *reader)
+{
+    const char *str = NULL;
+    guint32     len = 0;
+
+    len = n_config_get_u32 (reader);
+    if (reader->failed || len == NULL_MARKER)
+        return NULL;
+
+    if (reader->size - reader->offset < (gsize) len + 1 ||
+        reader->data[reader->offset + len] != '\0') {
+        reader->failed = TRUE;
+        return NULL;
+    }
+
+    str = (const char*) (reader->data + reader->offset);
+    reader->offset += len + 1;
+
+    return str;
+}
+
+static GList*
+n_config_get_string_list (NConfigReader *reader)
+{
+    GList      *list  = NULL;
+    const char *str   = NULL;
+    guint32     count = 0;
+    guint32     i;
+
+    count = n_config_get_u32 (reader);
+    for (i = 0; i < count && !reader->failed; ++i) {
+        if ((str = n_config_get_string (reader)) != NULL)
+            list = g_list_prepend (list, g_strdup (str));
+    }
+
+    return g_list_reverse (list);
+}
+
+static NProplist*
+n_config_get_proplist (NConfigReader *reader)
+{
+    NProplist  *proplist = NULL;
+    const char *key      = NULL;
+    const char *str      = NULL;
+    guint32     count    = 0;
+    guint32     type     = 0;
+    guint32     value    = 0;
+    guint32     i;
+
+    count = n_config_get_u32 (reader);
+    if (reader->failed || count == NULL_MARKER)
+        return NULL;
+
+    proplist = n_proplist_new ();
+
+    for (i = 0; i < count && !reader->failed; ++i) {
+        key  = n_config_get_string (reader);
+        type = n_config_get_u32 (reader);
+
+        if (type == N_VALUE_TYPE_STRING) {
+            str = n_config_get_string (reader);
+            if (key && str)
+                n_proplist_set_string (proplist, key, str);
+            continue;
+        }
+
+        value = n_config_get_u32 (reader);
+        if (!key || reader->failed)
+            continue;
+
+        switch (type) {
+            case N_VALUE_TYPE_INT:
+                n_proplist_set_int (proplist, key, (gint) value);
+                break;
+            case N_VALUE_TYPE_UINT:
+                n_proplist_set_uint (proplist, key, value);
+                break;
+            case N_VALUE_TYPE_BOOL:
+                n_proplist_set_bool (proplist, key, value ? TRUE : FALSE);
+                break;
+            default:
+                break;
+        }
+    }
+
+    return proplist;
+}
+
+NConfigCache*
+n_config_cache_new ()
+{
+    return g_new0 (NConfigCache, 1);
+}
+
+void
+n_config_cache_free (NConfigCache *cache)
+{
+    GList         *iter   = NULL;
+    NConfigSource *source = NULL;
+
+    if (!cache)
+        return;
+
+    for (iter = g_list_first (cache->sources); iter; iter = g_list_next (iter)) {
+        source = (NConfigSource*) iter->data;
+        g_free (source->path);
+        g_slice_free (NConfigSource, source);
+    }
+
+    g_list_free (cache->sources);
+    g_free (cache);
+}
+
+void
+n_config_cache_add_source (NConfigCache *cache, const char *path)
+{
+    NConfigSource *source = NULL;
+
+    if (!cache || !path)
+        return;
+
+    /* stat before the file is parsed, so that any change made while
+       parsing makes the cache stale on the next start. */
+
+    source = g_slice_new0 (NConfigSource);
+    source->path = g_strdup (path);
+    n_config_source_stat (path, source);
+
+    cache->sources = g_list_prepend (cache->sources, source);
+}
+
+gboolean
+n_config_cache_save (NConfigCache *cache, NCore *core, const char *filename)
+{
+    GString            *buf     = NULL;
+    GList              *iter    = NULL;
+    NConfigSource      *source  = NULL;
+    NEvent             *event   = NULL;
+    GList              *sinks   = NULL;
+    GError             *error   = NULL;
+    gchar              *dirname = NULL;
+    gpointer            key     = NULL;
+    gpointer            value   = NULL;
+    GHashTableIter      hash_iter;
+    NConfigCacheHeader  header;
+    gboolean            result  = FALSE;
+
+    g_assert (cache != NULL);
+    g_assert (core != NULL);
+    g_assert (filename != NULL);
+
+    buf = g_string_sized_new (16384);
+
+    /* reserve space for the header, filled in once the payload is done. */
+
+    memset (&header, 0, sizeof (header));
+    g_string_append_len (buf, (const gchar*) &header, sizeof (header));
+
+    /* sources */
+
+    n_config_put_string (buf, core->conf_path);
+    n_config_put_u32 (buf, g_list_length (cache->sources));
+    for (iter = g_list_last (cache->sources); iter; iter = g_list_previous (iter)) {
+        source = (NConfigSource*) iter->data;
+        n_config_put_string (buf, source->path);
+        n_config_put_u64 (buf, source->size);
+        n_config_put_u64 (buf, (guint64) source->mtime_sec);
+        n_config_put_u64 (buf, (guint64) source->mtime_nsec);
+    }
+
+    /* general configuration */
+
+    n_config_put_string_list (buf, core->required_plugins);
+    n_config_put_string_list (buf, core->optional_plugins);
+    n_config_put_string_list (buf, core->sink_order);
+    n_config_put_u32 (buf, n_request_cache_get_max_entries (core->request_cache));
+    n_config_put_u32 (buf, core->startup_threads);
+    n_config_put_u32 (buf, core->lazy_unload_timeout);
+    n_config_put_u32 (buf, core->trace_requests);
+    n_config_put_string (buf, core->trace_file);
+    n_config_put_u32 (buf, core->hook_budget);
+    n_config_put_u32 (buf, (guint32) core->record_level);
+    n_config_put_u32 (buf, n_request_scheduler_get_max_queued (core->scheduler));
+    n_config_put_u32 (buf, n_request_scheduler_get_queue_timeout (core->scheduler));
+
+    sinks = n_request_scheduler_get_limited_sinks (core->scheduler);
+    n_config_put_u32 (buf, g_list_length (sinks));
+    for (iter = g_list_first (sinks); iter; iter = g_list_next (iter)) {
+        n_config_put_string (buf, (const char*) iter->data);
+        n_config_put_u32 (buf, n_request_scheduler_get_sink_limit (core->scheduler,
+            (const char*) iter->data));
+    }
+    g_list_free (sinks);
+
+    n_config_put_u32 (buf, g_list_length (core->lazy_plugins));
+    for (iter = g_list_first (core->lazy_plugins); iter; iter = g_list_next (iter)) {
+        n_config_put_string (buf, n_lazy_plugin_get_name ((NLazyPlugin*) iter->data));
+        n_config_put_string_list (buf, n_lazy_plugin_get_prefixes ((NLazyPlugin*) iter->data));
+    }
+
+    n_config_put_u32 (buf, g_hash_table_size (core->key_types));
+    g_hash_table_iter_init (&hash_iter, core->key_types);
+    while (g_hash_table_iter_next (&hash_iter, &key, &value)) {
+        n_config_put_string (buf, (const char*) key);
+        n_config_put_u32 (buf, (guint32) GPOINTER_TO_INT (value));
+    }
+
+    /* plugin parameters */
+
+    n_config_put_u32 (buf, g_hash_table_size (core->plugin_params));
+    g_hash_table_iter_init (&hash_iter, core->plugin_params);
+    while (g_hash_table_iter_next (&hash_iter, &key, &value)) {
+        n_config_put_string (buf, (const char*) key);
+        n_config_put_proplist (buf, (const NProplist*) value);
+    }
+
+    /* events, already merged */
+
+    n_config_put_u32 (buf, g_list_length (core->event_list));
+    for (iter = g_list_first (core->event_list); iter; iter = g_list_next (iter)) {
+        event = (NEvent*) iter->data;
+        n_config_put_string (buf, event->name);
+        n_config_put_proplist (buf, event->rules);
+        n_config_put_proplist (buf, event->properties);
+    }
+
+    header.magic        = CACHE_MAGIC;
+    header.version      = CACHE_VERSION;
+    header.payload_size = (guint32) (buf->len - sizeof (header));
+    header.checksum     = n_config_cache_checksum ((const guint8*) buf->str + sizeof (header),
+        header.payload_size);
+    memcpy (buf->str, &header, sizeof (header));
+
+    dirname = g_path_get_dirname (filename);
+    (void) g_mkdir_with_parents (dirname, 0755);
+
+    if (!g_file_set_contents (filename, buf->str, buf->len, &error)) {
+        N_WARNING (LOG_CAT "unable to write configuration cache: %s", error->message);
+        g_error_free (error);
+    }
+    else {
+        N_DEBUG (LOG_CAT "wrote configuration cache '%s' (%u bytes)", filename,
+            (guint) buf->len);
+        result = TRUE;
+    }
+
+    g_free (dirname);
+    g_string_free (buf, TRUE);
+
+    return result;
+}
+
+static gboolean
+n_config_cache_check_sources (NConfigReader *reader, NCore *core)
+{
+    NConfigSource  current;
+    const char    *conf_path   = NULL;
+    const char    *path        = NULL;
+    guint64        size        = 0;
+    gint64         mtime_sec   = 0;
+    gint64         mtime_nsec  = 0;
+    guint32        num_sources = 0;
+    guint32        i;
+
+    conf_path = n_config_get_string (reader);
+    if (!conf_path || !g_str_equal (conf_path, core->conf_path)) {
+        N_DEBUG (LOG_CAT "cache was built for another configuration path");
+        return FALSE;
+    }
+
+    num_sources = n_config_get_u32 (reader);
+    for (i = 0; i < num_sources && !reader->failed; ++i) {
+        path       = n_config_get_string (reader);
+        size       = n_config_get_u64 (reader);
+        mtime_sec  = (gint64) n_config_get_u64 (reader);
+        mtime_nsec = (gint64) n_config_get_u64 (reader);
+
+        if (!path || reader->failed)
+            break;
+
+        n_config_source_stat (path, &current);
+        if (current.size != size || current.mtime_sec != mtime_sec ||
+            current.mtime_nsec != mtime_nsec) {
+            N_DEBUG (LOG_CAT "'%s' has changed, cache is stale", path);
+            return FALSE;
+        }
+    }
+
+    return !reader->failed;
+}
+
+static gboolean
+n_config_cache_parse (NCore *core, const guint8 *data, gsize size)
+{
+    NConfigCacheHeader  header;
+    NConfigReader       reader;
+    GList              *required     = NULL;
+    GList              *optional     = NULL;
+    GList              *sink_order   = NULL;
+    GList              *events       = NULL;
+    GList              *iter         = NULL;
+    GList              *event_list   = NULL;
+    GList              *lazy_plugins = NULL;
+    GList              *prefixes     = NULL;
+    NLazyPlugin        *lazy         = NULL;
+    GHashTable         *key_types    = NULL;
+    GHashTable         *params       = NULL;
+    NEvent             *event        = NULL;
+    const char         *name         = NULL;
+    gpointer            key          = NULL;
+    gpointer            value        = NULL;
+    GHashTableIter      hash_iter;
+    guint32             cache_size   = 0;
+    guint32             threads      = 0;
+    guint32             lazy_timeout = 0;
+    guint32             trace_count  = 0;
+    gchar              *trace_file   = NULL;
+    guint32             hook_budget  = 0;
+    guint32             record_level = 0;
+    guint32             max_queued   = 0;
+    guint32             queue_ms     = 0;
+    guint32             limit        = 0;
+    GHashTable         *sink_limits  = NULL;
+    guint32             count        = 0;
+    guint32             type         = 0;
+    guint32             i;
+
+    if (size < sizeof (header))
+        return FALSE;
+
+    memcpy (&header, data, sizeof (header));
+    if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION ||
+        header.payload_size != size - sizeof (header)) {
+        N_DEBUG (LOG_CAT "cache has unknown format");
+        return FALSE;
+    }
+
+    reader.data   = data + sizeof (header);
+    reader.size   = header.payload_size;
+    reader.offset = 0;
+    reader.failed = FALSE;
+
+    if (n_config_cache_checksum (reader.data, reader.size) != header.checksum) {
+        N_WARNING (LOG_CAT "cache checksum mismatch, ignoring cache");
+        return FALSE;
+    }
+
+    if (!n_config_cache_check_sources (&reader, core))
+        return FALSE;
+
+    /* read everything before touching the core, so that a broken cache
+       leaves it untouched. */
+
+    required   = n_config_get_string_list (&reader);
+    optional   = n_config_get_string_list (&reader);
+    sink_order = n_config_get_string_list (&reader);
+    cache_size = n_config_get_u32 (&reader);
+    threads    = n_config_get_u32 (&reader);
+
+    lazy_timeout = n_config_get_u32 (&reader);
+    trace_count  = n_config_get_u32 (&reader);
+    trace_file   = g_strdup (n_config_get_string (&reader));
+    hook_budget  = n_config_get_u32 (&reader);
+    record_level = n_config_get_u32 (&reader);
+    max_queued   = n_config_get_u32 (&reader);
+    queue_ms     = n_config_get_u32 (&reader);
+
+    sink_limits = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    count = n_config_get_u32 (&reader);
+    for (i = 0; i < count && !reader.failed; ++i) {
+        name  = n_config_get_string (&reader);
+        limit = n_config_get_u32 (&reader);
+        if (name && !reader.failed)
+            g_hash_table_replace (sink_limits, g_strdup (name), GUINT_TO_POINTER (limit));
+    }
+
+    count = n_config_get_u32 (&reader);
+    for (i = 0; i < count && !reader.failed; ++i) {
+        name     = n_config_get_string (&reader);
+        prefixes = n_config_get_string_list (&reader);
+        if (name && !reader.failed) {
+            lazy = n_lazy_plugin_new (core, name);
+            for (iter = g_list_first (prefixes); iter; iter = g_list_next (iter))
+                n_lazy_plugin_add_prefix (lazy, (const char*) iter->data);
+            lazy_plugins = g_list_append (lazy_plugins, lazy);
+        }
+        g_list_foreach (prefixes, (GFunc) g_free, NULL);
+        g_list_free (prefixes);
+    }
+
+    key_types = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    count = n_config_get_u32 (&reader);
+    for (i = 0; i < count && !reader.failed; ++i) {
+        name = n_config_get_string (&reader);
+        type = n_config_get_u32 (&reader);
+        if (name && !reader.failed)
+            g_hash_table_replace (key_types, g_strdup (name), GINT_TO_POINTER ((gint) type));
+    }
+
+    params = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+        (GDestroyNotify) n_proplist_free);
+    count = n_config_get_u32 (&reader);
+    for (i = 0; i < count && !reader.failed; ++i) {
+        name  = n_config_get_string (&reader);
+        value = n_config_get_proplist (&reader);
+        if (name)
+            g_hash_table_replace (params, g_strdup (name), value);
+        else
+            n_proplist_free ((NProplist*) value);
+    }
+
+    count = n_config_get_u32 (&reader);
+    for (i = 0; i < count && !reader.failed; ++i) {
+        event = n_event_new ();
+        event->name       = g_strdup (n_config_get_string (&reader));
+        event->rules      = n_config_get_proplist (&reader);
+        event->properties = n_config_get_proplist (&reader);
+        events = g_list_prepend (events, event);
+    }
+    events = g_list_reverse (events);
+
+    if (reader.failed || reader.offset != reader.size) {
+        N_WARNING (LOG_CAT "cache is truncated, ignoring cache");
+
+        g_list_foreach (required, (GFunc) g_free, NULL);
+        g_list_foreach (optional, (GFunc) g_free, NULL);
+        g_list_foreach (sink_order, (GFunc) g_free, NULL);
+        g_list_foreach (events, (GFunc) n_event_free, NULL);
+        g_list_foreach (lazy_plugins, (GFunc) n_lazy_plugin_free, NULL);
+        g_list_free (required);
+        g_list_free (optional);
+        g_list_free (sink_order);
+        g_list_free (events);
+        g_list_free (lazy_plugins);
+        g_hash_table_destroy (key_types);
+        g_hash_table_destroy (params);
+        g_hash_table_destroy (sink_limits);
+        g_free (trace_file);
+
+        return FALSE;
+    }
+
+    /* commit to core */
+
+    core->required_plugins = g_list_concat (core->required_plugins, required);
+    core->optional_plugins = g_list_concat (core->optional_plugins, optional);
+    core->sink_order       = g_list_concat (core->sink_order, sink_order);
+    n_request_cache_set_max_entries (core->request_cache, cache_size);
+    core->startup_threads = threads;
+    core->lazy_unload_timeout = lazy_timeout;
+    core->trace_requests = trace_count;
+    core->hook_budget    = hook_budget;
+    core->record_level   = (NLogLevel) MIN (record_level, N_LOG_LEVEL_NONE);
+    n_request_scheduler_set_max_queued (core->scheduler, max_queued);
+    n_request_scheduler_set_queue_timeout (core->scheduler, queue_ms);
+
+    g_hash_table_iter_init (&hash_iter, sink_limits);
+    while (g_hash_table_iter_next (&hash_iter, &key, &value))
+        n_request_scheduler_set_sink_limit (core->scheduler, (const char*) key,
+            GPOINTER_TO_UINT (value));
+    g_hash_table_destroy (sink_limits);
+    if (trace_file) {
+        g_free (core->trace_file);
+        core->trace_file = trace_file;
+    }
+    core->lazy_plugins = g_list_concat (core->lazy_plugins, lazy_plugins);
+
+    g_hash_table_iter_init (&hash_iter, key_types);
+    while (g_hash_table_iter_next (&hash_iter, &key, &value))
+        g_hash_table_replace (core->key_types, g_strdup ((const char*) key), value);
+    g_hash_table_destroy (key_types);
+
+    g_hash_table_iter_init (&hash_iter, params);
+    while (g_hash_table_iter_next (&hash_iter, &key, &value)) {
+        g_hash_table_replace (core->plugin_params, g_strdup ((const char*) key), value);
+        g_hash_table_iter_steal (&hash_iter);
+    }
+    g_hash_table_destroy (params);
+
+    for (iter = g_list_first (events); iter; iter = g_list_next (iter)) {
+        event = (NEvent*) iter->data;
+        event_list = (GList*) g_hash_table_lookup (core->event_table, event->name);
+        event_list = g_list_append (event_list, event);
+        g_hash_table_replace (core->event_table, g_strdup (event->name), event_list);
+    }
+    core->event_list = g_list_concat (core->event_list, events);
+
+    N_DEBUG (LOG_CAT "loaded %d events from configuration cache", count);
+
+    return TRUE;
+}
+
+gboolean
+n_config_cache_load (NCore *core, const char *filename)
+{
+    struct stat  st;
+    void        *map    = MAP_FAILED;
+    int          fd     = -1;
+    gboolean     result = FALSE;
+
+    g_assert (core != NULL);
+    g_assert (filename != NULL);
+
+    if ((fd = open (filename, O_RDONLY)) < 0) {
+        N_DEBUG (LOG_CAT "no configuration cache '%s'", filename);
+        return FALSE;
+    }
+
+    if (fstat (fd, &st) < 0 || st.st_size < (off_t) sizeof (NConfigCacheHeader)) {
+        close (fd);
+        return FALSE;
+    }
+
+    map = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+
+    if (map == MAP_FAILED) {
+        N_WARNING (LOG_CAT "unable to map configuration cache '%s'", filename);
+        return FALSE;
+    }
+
+    result = n_config_cache_parse (core, (const guint8*) map, (gsize) st.st_size);
+    munmap (map, (size_t) st.st_size);
+
+    return result;
+}
@@ -0,0 +1,45 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef N_CONFIG_CACHE_H
+#define N_CONFIG_CACHE_H
+
+#include <glib.h>
+
+#include <ngf/core.h>
+
+#define N_CONFIG_CACHE_FILENAME "config.cache"
+
+/* compiled form of ngfd.ini, events.d and plugins.d. the cache records the
+   modification time and size of every source file read while building it,
+   and is only used if none of them has changed since. */
+typedef struct _NConfigCache NConfigCache;
+
+NConfigCache* n_config_cache_new        ();
+void          n_config_cache_free       (NConfigCache *cache);
+void          n_config_cache_add_source (NConfigCache *cache, const char *path);
+gboolean      n_config_cache_save       (NConfigCache *cache, NCore *core, const char *filename);
+
+/* load the configuration to core if cache is valid. events are added to
+   the event table unsorted. */
+gboolean      n_config_cache_load       (NCore *core, const char *filename);
+
+#endif /* N_CONFIG_CACHE_H */
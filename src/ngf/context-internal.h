@@ -27,4 +27,9 @@
 NContext* n_context_new  ();
 void      n_context_free (NContext *context);
 
+/* subscriptions made on the calling thread are recorded to owner until
+   it is set back to NULL. owner must stay valid meanwhile. */
+void      n_context_set_owner         (const char *owner);
+void      n_context_unsubscribe_owner (NContext *context, const char *owner);
+
 #endif /* N_CONTEXT_H */
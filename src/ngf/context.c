@@ -28,66 +28,389 @@
 
 typedef struct _NContextSubscriber
 {
-    gchar    *key;
+    NAtom     key;                  /* N_ATOM_NONE for all keys */
     gpointer  userdata;
     NContextValueChangeFunc callback;
+    NContextBatchChangeFunc batch_callback;
+    gchar    *owner;                /* plugin that subscribed, may be NULL */
+    guint     serial;               /* order of subscription */
+    gboolean  dead;                 /* unsubscribed, removed after notifying */
 } NContextSubscriber;
 
+typedef struct _NContextChange
+{
+    NAtom     key;
+    NValue   *old_value;            /* value before the batch, may be NULL */
+} NContextChange;
+
 struct _NContext
 {
     NProplist  *values;
-    GList      *subscribers;
+    GHashTable *subscribers;        /* NAtom to GList of NContextSubscriber */
+    GList      *all_subscribers;    /* value subscribers for all keys */
+    GList      *batch_subscribers;
+    guint       num_subscribers;
+    guint       next_serial;
+    guint       num_dead;           /* unsubscribed while notifying */
+    guint       notify_depth;       /* notifications in progress */
+    guint       generation;         /* bumped on every value change */
+    guint       batch_depth;
+    GQueue      batch_changes;      /* NContextChange, in order of first set */
+    GHashTable *batch_index;        /* NAtom to NContextChange */
 };
 
+static void n_context_notify_value_change (NContext *context, NAtom atom,
+                                           const NValue *old_value,
+                                           const NValue *new_value);
+static void n_context_notify_batch_change (NContext *context, GList *keys);
+static void n_context_broadcast_change    (NContext *context, NAtom atom,
+                                           const NValue *old_value,
+                                           const NValue *new_value);
+static void n_context_record_change       (NContext *context, NAtom atom,
+                                           const NValue *old_value);
+static void n_context_flush_batch         (NContext *context);
+static void n_context_free_subscribers    (GList *subscribers);
+static NContextSubscriber* n_context_subscriber_new  (NContext *context);
+static void n_context_subscriber_free     (NContextSubscriber *subscriber);
+static void n_context_subscriber_kill     (NContext *context, NContextSubscriber *subscriber);
+static void n_context_kill_owner          (NContext *context, GList *subscribers,
+                                           const char *owner);
+static GList* n_context_purge_list        (GList *subscribers);
+static void n_context_purge               (NContext *context);
+
+/* plugin subscribing on this thread, set by the core while it loads one. */
+static GPrivate n_context_owner = G_PRIVATE_INIT (NULL);
+
+
+
+static void
+n_context_notify_value_change (NContext *context, NAtom atom,
+                               const NValue *old_value, const NValue *new_value)
+{
+    NContextSubscriber *subscriber = NULL;
+    GList              *iter       = NULL;
+    GList              *all        = NULL;
+    const char         *key        = n_atom_to_string (atom);
+
+    /* callbacks may unsubscribe anyone, such entries are only marked dead
+       and removed once no notification is in progress. the subscribers
+       for the key and for all keys are run in the order they subscribed. */
+
+    context->notify_depth++;
+
+    iter = g_hash_table_lookup (context->subscribers, GUINT_TO_POINTER (atom));
+    all  = context->all_subscribers;
+
+    while (iter || all) {
+        if (iter && (!all || ((NContextSubscriber*) iter->data)->serial <
+                             ((NContextSubscriber*) all->data)->serial))
+        {
+            subscriber = (NContextSubscriber*) iter->data;
+            iter = g_list_next (iter);
+        }
+        else {
+            subscriber = (NContextSubscriber*) all->data;
+            all = g_list_next (all);
+        }
+
+        if (!subscriber->dead)
+            subscriber->callback (context, key, old_value, new_value, subscriber->userdata);
+    }
+
+    context->notify_depth--;
+    n_context_purge (context);
+}
+
+static void
+n_context_notify_batch_change (NContext *context, GList *keys)
+{
+    NContextSubscriber *subscriber = NULL;
+    GList              *iter       = NULL;
+
+    context->notify_depth++;
+
+    for (iter = context->batch_subscribers; iter; iter = g_list_next (iter)) {
+        subscriber = (NContextSubscriber*) iter->data;
+        if (!subscriber->dead)
+            subscriber->batch_callback (context, keys, subscriber->userdata);
+    }
+
+    context->notify_depth--;
+    n_context_purge (context);
+}
+
 static void
-n_context_broadcast_change (NContext *context, const char *key,
+n_context_broadcast_change (NContext *context, NAtom atom,
                             const NValue *old_value, const NValue *new_value)
+{
+    gchar *old_str = NULL;
+    gchar *new_str = NULL;
+    GList  keys;
+
+    if (n_log_enabled (N_LOG_LEVEL_DEBUG)) {
+        old_str = n_value_to_string ((NValue*) old_value);
+        new_str = n_value_to_string ((NValue*) new_value);
+
+        N_DEBUG (LOG_CAT "broadcasting value change for '%s': %s -> %s",
+            n_atom_to_string (atom), old_str, new_str);
+
+        g_free (new_str);
+        g_free (old_str);
+    }
+
+    n_context_notify_value_change (context, atom, old_value, new_value);
+
+    if (context->batch_subscribers) {
+        keys.data = (gpointer) n_atom_to_string (atom);
+        keys.next = NULL;
+        keys.prev = NULL;
+        n_context_notify_batch_change (context, &keys);
+    }
+}
+
+static void
+n_context_record_change (NContext *context, NAtom atom,
+                         const NValue *old_value)
+{
+    NContextChange *change = NULL;
+
+    /* only the value from before the batch matters, later sets of the
+       same key just move the new value along. */
+
+    if (g_hash_table_lookup (context->batch_index, GUINT_TO_POINTER (atom)))
+        return;
+
+    change = g_slice_new0 (NContextChange);
+    change->key       = atom;
+    change->old_value = n_value_copy ((NValue*) old_value);
+
+    g_queue_push_tail (&context->batch_changes, change);
+    g_hash_table_insert (context->batch_index, GUINT_TO_POINTER (atom), change);
+}
+
+static void
+n_context_flush_batch (NContext *context)
+{
+    NContextChange *change    = NULL;
+    const NValue   *new_value = NULL;
+    GQueue          changes;
+    GList          *keys      = NULL;
+    GList          *iter      = NULL;
+
+    /* detach the pending changes first, callbacks are free to set values
+       or start a new batch of their own. */
+
+    changes = context->batch_changes;
+    g_queue_init (&context->batch_changes);
+    g_hash_table_remove_all (context->batch_index);
+
+    for (iter = changes.head; iter; iter = g_list_next (iter)) {
+        change    = (NContextChange*) iter->data;
+        new_value = n_proplist_get_atom (context->values, change->key);
+
+        /* keys that were set back to what they were have not changed. */
+
+        if (change->old_value && new_value &&
+            n_value_equals (change->old_value, new_value))
+            continue;
+
+        if (n_log_enabled (N_LOG_LEVEL_DEBUG)) {
+            gchar *old_str = n_value_to_string (change->old_value);
+            gchar *new_str = n_value_to_string ((NValue*) new_value);
+
+            N_DEBUG (LOG_CAT "broadcasting batched change for '%s': %s -> %s",
+                n_atom_to_string (change->key), old_str, new_str);
+
+            g_free (new_str);
+            g_free (old_str);
+        }
+
+        n_context_notify_value_change (context, change->key, change->old_value,
+            new_value);
+        keys = g_list_prepend (keys, (gpointer) n_atom_to_string (change->key));
+    }
+
+    if (keys) {
+        keys = g_list_reverse (keys);
+        n_context_notify_batch_change (context, keys);
+        g_list_free (keys);
+    }
+
+    while ((change = g_queue_pop_head (&changes)) != NULL) {
+        n_value_free (change->old_value);
+        g_slice_free (NContextChange, change);
+    }
+}
+
+static NContextSubscriber*
+n_context_subscriber_new (NContext *context)
+{
+    NContextSubscriber *subscriber = NULL;
+
+    subscriber = g_slice_new0 (NContextSubscriber);
+    subscriber->owner  = g_strdup (g_private_get (&n_context_owner));
+    subscriber->serial = context->next_serial++;
+
+    return subscriber;
+}
+
+static void
+n_context_subscriber_free (NContextSubscriber *subscriber)
+{
+    g_free (subscriber->owner);
+    g_slice_free (NContextSubscriber, subscriber);
+}
+
+static void
+n_context_free_subscribers (GList *subscribers)
+{
+    GList *iter = NULL;
+
+    for (iter = subscribers; iter; iter = g_list_next (iter))
+        n_context_subscriber_free ((NContextSubscriber*) iter->data);
+
+    g_list_free (subscribers);
+}
+
+static void
+n_context_subscriber_kill (NContext *context, NContextSubscriber *subscriber)
+{
+    subscriber->dead = TRUE;
+    context->num_dead++;
+    context->num_subscribers--;
+}
+
+static void
+n_context_kill_owner (NContext *context, GList *subscribers, const char *owner)
 {
     NContextSubscriber *subscriber = NULL;
     GList              *iter       = NULL;
-    gchar              *old_str    = NULL;
-    gchar              *new_str    = NULL;
 
-    old_str = n_value_to_string ((NValue*) old_value);
-    new_str = n_value_to_string ((NValue*) new_value);
+    for (iter = subscribers; iter; iter = g_list_next (iter)) {
+        subscriber = (NContextSubscriber*) iter->data;
 
-    N_DEBUG (LOG_CAT "broadcasting value change for '%s': %s -> %s", key,
-        old_str, new_str);
+        if (!subscriber->dead && subscriber->owner && g_str_equal (subscriber->owner, owner))
+            n_context_subscriber_kill (context, subscriber);
+    }
+}
 
-    g_free (new_str);
-    g_free (old_str);
+static GList*
+n_context_purge_list (GList *subscribers)
+{
+    NContextSubscriber *subscriber = NULL;
+    GList              *iter       = NULL;
+    GList              *next       = NULL;
 
-    for (iter = g_list_first (context->subscribers); iter; iter = g_list_next (iter)) {
+    for (iter = subscribers; iter; iter = next) {
+        next = g_list_next (iter);
         subscriber = (NContextSubscriber*) iter->data;
 
-        if (!subscriber->key || (subscriber->key && g_str_equal (subscriber->key, key))) {
-            subscriber->callback (context, key, old_value, new_value, subscriber->userdata);
+        if (subscriber->dead) {
+            subscribers = g_list_delete_link (subscribers, iter);
+            n_context_subscriber_free (subscriber);
         }
     }
- }
+
+    return subscribers;
+}
+
+static void
+n_context_purge (NContext *context)
+{
+    GList *keys = NULL;
+    GList *iter = NULL;
+    GList *list = NULL;
+
+    if (context->notify_depth > 0 || context->num_dead == 0)
+        return;
+
+    keys = g_hash_table_get_keys (context->subscribers);
+    for (iter = keys; iter; iter = g_list_next (iter)) {
+        list = g_hash_table_lookup (context->subscribers, iter->data);
+        list = n_context_purge_list (list);
+        if (list)
+            g_hash_table_insert (context->subscribers, iter->data, list);
+        else
+            g_hash_table_remove (context->subscribers, iter->data);
+    }
+    g_list_free (keys);
+
+    context->all_subscribers   = n_context_purge_list (context->all_subscribers);
+    context->batch_subscribers = n_context_purge_list (context->batch_subscribers);
+    context->num_dead = 0;
+}
 
 void
 n_context_set_value (NContext *context, const char *key,
                      NValue *value)
 {
     NValue *old_value = NULL;
+    NAtom   atom      = N_ATOM_NONE;
 
     if (!context || !key)
         return;
 
-    old_value = n_value_copy (n_proplist_get (context->values, key));
-    n_proplist_set (context->values, key, value);
-    n_context_broadcast_change (context, key, old_value, value);
+    atom = n_atom_intern (key);
+
+    if (context->batch_depth > 0) {
+        n_context_record_change (context, atom,
+            n_proplist_get_atom (context->values, atom));
+        n_proplist_set_atom (context->values, atom, value);
+        context->generation++;
+        return;
+    }
+
+    old_value = n_value_copy (n_proplist_get_atom (context->values, atom));
+    n_proplist_set_atom (context->values, atom, value);
+    context->generation++;
+
+    n_context_broadcast_change (context, atom, old_value, value);
     n_value_free (old_value);
 }
 
+void
+n_context_begin_batch (NContext *context)
+{
+    if (!context)
+        return;
+
+    context->batch_depth++;
+}
+
+void
+n_context_commit_batch (NContext *context)
+{
+    if (!context || context->batch_depth == 0)
+        return;
+
+    if (--context->batch_depth > 0)
+        return;
+
+    n_context_flush_batch (context);
+}
+
 const NValue*
 n_context_get_value (NContext *context, const char *key)
 {
     if (!context || !key)
         return NULL;
 
-    return (const NValue*) n_proplist_get (context->values, key);
+    return n_context_get_value_atom (context, n_atom_lookup (key));
+}
+
+const NValue*
+n_context_get_value_atom (NContext *context, NAtom atom)
+{
+    if (!context || !atom)
+        return NULL;
+
+    return (const NValue*) n_proplist_get_atom (context->values, atom);
+}
+
+guint
+n_context_get_generation (NContext *context)
+{
+    return context ? context->generation : 0;
 }
 
 int
@@ -96,16 +419,29 @@ n_context_subscribe_value_change (NContext *context, const char *key,
                                   void *userdata)
 {
     NContextSubscriber *subscriber = NULL;
+    GList              *list       = NULL;
 
     if (!context || !callback)
         return FALSE;
 
-    subscriber = g_slice_new0 (NContextSubscriber);
-    subscriber->key      = g_strdup (key);
+    subscriber = n_context_subscriber_new (context);
+    subscriber->key      = n_atom_intern (key);
     subscriber->callback = callback;
     subscriber->userdata = userdata;
 
-    context->subscribers = g_list_append (context->subscribers, subscriber);
+    if (subscriber->key == N_ATOM_NONE) {
+        context->all_subscribers = g_list_append (context->all_subscribers,
+            subscriber);
+    }
+    else {
+        list = g_hash_table_lookup (context->subscribers,
+            GUINT_TO_POINTER (subscriber->key));
+        list = g_list_append (list, subscriber);
+        g_hash_table_insert (context->subscribers,
+            GUINT_TO_POINTER (subscriber->key), list);
+    }
+
+    context->num_subscribers++;
 
     N_DEBUG (LOG_CAT "subscriber added for key '%s'", key ? key : "<all keys>");
 
@@ -118,20 +454,106 @@ n_context_unsubscribe_value_change (NContext *context, const char *key,
 {
     NContextSubscriber *subscriber = NULL;
     GList *iter = NULL;
+    NAtom  atom = N_ATOM_NONE;
 
     if (!context || !key || !callback)
         return;
 
-    for (iter = g_list_first (context->subscribers); iter; iter = g_list_next (iter)) {
+    if ((atom = n_atom_lookup (key)) == N_ATOM_NONE)
+        return;
+
+    iter = g_hash_table_lookup (context->subscribers, GUINT_TO_POINTER (atom));
+    for (; iter; iter = g_list_next (iter)) {
+        subscriber = (NContextSubscriber*) iter->data;
+
+        if (!subscriber->dead && subscriber->callback == callback) {
+            n_context_subscriber_kill (context, subscriber);
+            break;
+        }
+    }
+
+    n_context_purge (context);
+}
+
+int
+n_context_subscribe_batch_change (NContext *context,
+                                  NContextBatchChangeFunc callback,
+                                  void *userdata)
+{
+    NContextSubscriber *subscriber = NULL;
+
+    if (!context || !callback)
+        return FALSE;
+
+    subscriber = n_context_subscriber_new (context);
+    subscriber->batch_callback = callback;
+    subscriber->userdata       = userdata;
+
+    context->batch_subscribers = g_list_append (context->batch_subscribers,
+        subscriber);
+    context->num_subscribers++;
+
+    N_DEBUG (LOG_CAT "batch change subscriber added");
+
+    return TRUE;
+}
+
+void
+n_context_unsubscribe_batch_change (NContext *context,
+                                    NContextBatchChangeFunc callback)
+{
+    NContextSubscriber *subscriber = NULL;
+    GList *iter = NULL;
+
+    if (!context || !callback)
+        return;
+
+    for (iter = context->batch_subscribers; iter; iter = g_list_next (iter)) {
         subscriber = (NContextSubscriber*) iter->data;
 
-        if (g_str_equal (subscriber->key, key) && subscriber->callback == callback) {
-            context->subscribers = g_list_remove (context->subscribers, subscriber);
-            g_free (subscriber->key);
-            g_slice_free (NContextSubscriber, subscriber);
+        if (!subscriber->dead && subscriber->batch_callback == callback) {
+            n_context_subscriber_kill (context, subscriber);
             break;
         }
     }
+
+    n_context_purge (context);
+}
+
+void
+n_context_set_owner (const char *owner)
+{
+    g_private_set (&n_context_owner, (gpointer) owner);
+}
+
+void
+n_context_unsubscribe_owner (NContext *context, const char *owner)
+{
+    GHashTableIter  iter;
+    gpointer        list = NULL;
+    GList          *lists[2];
+    guint           num  = 0;
+    guint           i    = 0;
+
+    if (!context || !owner)
+        return;
+
+    num      = context->num_subscribers;
+    lists[0] = context->all_subscribers;
+    lists[1] = context->batch_subscribers;
+
+    g_hash_table_iter_init (&iter, context->subscribers);
+    while (g_hash_table_iter_next (&iter, NULL, &list))
+        n_context_kill_owner (context, (GList*) list, owner);
+
+    for (i = 0; i < G_N_ELEMENTS (lists); ++i)
+        n_context_kill_owner (context, lists[i], owner);
+
+    if (num != context->num_subscribers)
+        N_DEBUG (LOG_CAT "removed %u subscribers of '%s'",
+            num - context->num_subscribers, owner);
+
+    n_context_purge (context);
 }
 
 NContext*
@@ -140,24 +562,36 @@ n_context_new ()
     NContext *context = NULL;
 
     context = g_new0 (NContext, 1);
-    context->values = n_proplist_new ();
+    context->values      = n_proplist_new ();
+    context->subscribers = g_hash_table_new (g_direct_hash, g_direct_equal);
+    context->batch_index = g_hash_table_new (g_direct_hash, g_direct_equal);
+    g_queue_init (&context->batch_changes);
     return context;
 }
 
 void
 n_context_free (NContext *context)
 {
-    NContextSubscriber *subscriber = NULL;
-    GList *iter = NULL;
+    NContextChange *change = NULL;
+    GHashTableIter  iter;
+    gpointer        list   = NULL;
 
-    for (iter = context->subscribers; iter; iter = g_list_next (iter)) {
-        subscriber = (NContextSubscriber*) iter->data;
-        g_free (subscriber->key);
-        g_slice_free (NContextSubscriber, subscriber);
+    while ((change = g_queue_pop_head (&context->batch_changes)) != NULL) {
+        n_value_free (change->old_value);
+        g_slice_free (NContextChange, change);
     }
 
-    g_list_free (context->subscribers);
-    context->subscribers = NULL;
+    g_hash_table_destroy (context->batch_index);
+
+    g_hash_table_iter_init (&iter, context->subscribers);
+    while (g_hash_table_iter_next (&iter, NULL, &list))
+        n_context_free_subscribers ((GList*) list);
+    g_hash_table_destroy (context->subscribers);
+
+    n_context_free_subscribers (context->all_subscribers);
+    n_context_free_subscribers (context->batch_subscribers);
+    context->all_subscribers   = NULL;
+    context->batch_subscribers = NULL;
 
     n_proplist_free (context->values);
     g_free (context);
@@ -33,6 +33,8 @@ n_core_hook_to_string (NCoreHook hook)
             return "transform_properties";
         case N_CORE_HOOK_FILTER_SINKS:
             return "filter_sinks";
+        case N_CORE_HOOK_EVENTS_CHANGED:
+            return "events_changed";
         default:
             break;
     }
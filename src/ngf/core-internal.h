@@ -33,15 +33,35 @@
 #include "event-internal.h"
 #include "request-internal.h"
 #include "context-internal.h"
+#include "event-matcher.h"
+#include "request-cache.h"
+#include "request-admission.h"
+#include "request-scheduler.h"
+#include "config-cache.h"
+#include "core-startup.h"
+#include "core-lazy.h"
+#include "event-reload.h"
+#include "request-trace.h"
+#include "request-registry.h"
+
+#define N_CORE_DEFAULT_STARTUP_THREADS 4
+
+#define DEFAULT_CONF_FILENAME "ngfd.ini"
+#define EVENT_CONF_PATH       "events.d"
 
 struct _NCore
 {
     gchar            *conf_path;            /* configuration path */
     gchar            *plugin_path;          /* plugin path */
+    gchar            *cache_path;           /* compiled configuration cache path */
+    NConfigCache     *config_cache;         /* sources read, only while parsing configuration */
 
     GList            *required_plugins;     /* plugins to load (required) */
     GList            *optional_plugins;     /* plugins to load (loading may fail, and won't disturb operation) */
     GList            *plugins;              /* NPlugin* */
+    GHashTable       *plugin_params;        /* NProplist* per plugin name, parsed from plugins.d */
+    GList            *lazy_plugins;         /* NLazyPlugin*, optional plugins loaded on demand */
+    guint             lazy_unload_timeout;  /* seconds before an idle lazy plugin is unloaded, 0 to keep */
 
     NSinkInterface  **sinks;                /* sink interfaces registered */
     unsigned int      num_sinks;
@@ -53,26 +73,54 @@ struct _NCore
     NContext         *context;              /* global context for broadcasting and sharing values */
     GHashTable       *event_table;          /* hash table of GList* containing NEvent* for easy lookup */
     GList            *event_list;           /* list of all events */
+    GHashTable       *event_matchers;       /* compiled rules (NEventMatcher*) per event name */
+    NEventReload     *event_reload;         /* reloads changed event files */
 
     GHashTable       *key_types;
-    GList            *requests;             /* active requests */
+    NRequestRegistry *requests;             /* active requests */
+    NRequestCache    *request_cache;        /* resolved requests per context generation */
+    NRequestAdmission *admission;           /* rate limits and coalescing per event */
+    NRequestScheduler *scheduler;           /* concurrency limits per sink */
+    NTraceLog        *trace_log;            /* timelines of recent requests, NULL if not tracing */
+    guint             trace_requests;       /* number of request timelines to keep */
+    gchar            *trace_file;           /* file the timelines are written to */
 
     NHook             hooks[N_CORE_HOOK_LAST];
+    guint             hook_budget;          /* default microseconds per hook callback, 0 for none */
+    NLogLevel         record_level;         /* lowest level kept in the flight recorder */
 
+    guint             startup_threads;      /* worker threads for loading plugins, 0 to load serially */
+    GMutex            lock;                 /* registration from startup worker threads */
+
+    gboolean          init_done;            /* init done hook has been fired */
     gboolean          shutdown_done;        /* shutdown has been run. */
 };
 
-NCore*    n_core_new              (int *argc, char **argv);
-void      n_core_free             (NCore *core);
-int       n_core_initialize       (NCore *core);
-void      n_core_shutdown         (NCore *core);
-
-void      n_core_register_sink    (NCore *core, const NSinkInterfaceDecl *iface);
-void      n_core_register_input   (NCore *core, const NInputInterfaceDecl *iface);
-void      n_core_add_event        (NCore *core, NEvent *event);
-NEvent*   n_core_evaluate_request (NCore *core, NRequest *request);
-
-void      n_core_fire_hook        (NCore *core, NCoreHook hook, void *data);
+NCore*           n_core_new              (int *argc, char **argv);
+void             n_core_free             (NCore *core);
+int              n_core_initialize       (NCore *core);
+void             n_core_shutdown         (NCore *core);
+
+NPlugin*         n_core_load_plugin      (NCore *core, const char *plugin_name);
+void             n_core_unload_plugin    (NCore *core, NPlugin *plugin);
+void             n_core_set_loading_plugin (const char *plugin_name);
+void             n_core_disconnect_owner (NCore *core, const char *owner);
+void             n_core_fire_hook_owner  (NCore *core, NCoreHook hook, void *data, const char *owner);
+
+NSinkInterface*  n_core_register_sink    (NCore *core, const NSinkInterfaceDecl *iface);
+void             n_core_unregister_sink  (NCore *core, NSinkInterface *sink);
+void             n_core_set_sink_priorities (NSinkInterface **sink_list, GList *sink_order);
+NInputInterface* n_core_register_input   (NCore *core, const NInputInterfaceDecl *iface);
+void             n_core_add_event        (NCore *core, NEvent *event);
+gint             n_core_sort_event_cb    (gconstpointer a, gconstpointer b);
+gboolean         n_core_list_event_files (NCore *core, GList **filenames);
+void             n_core_parse_keytypes   (NCore *core, GKeyFile *keyfile);
+NEvent*          n_core_evaluate_request (NCore *core, NRequest *request);
+
+void             n_core_fire_hook        (NCore *core, NCoreHook hook, void *data);
+gboolean         n_core_dump_traces      (NCore *core);
+void             n_core_dump_hook_stats  (NCore *core);
+void             n_core_dump_scheduler   (NCore *core);
 
 #endif /* N_CORE_INTERNAL_H */
 
@@ -0,0 +1,342 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <ngf/log.h>
+#include "core-lazy.h"
+#include "core-internal.h"
+#include "request-internal.h"
+#include "sinkinterface-internal.h"
+#include "inputinterface-internal.h"
+
+#define LOG_CAT "core: "
+
+struct _NLazyPlugin
+{
+    NCore    *core;
+    gchar    *name;
+    GList    *prefixes;             /* gchar*, request keys routed to the plugin */
+    NPlugin  *plugin;               /* NULL when not loaded */
+    GList    *sinks;                /* NSinkInterface*, sinks that initialized */
+    gboolean  failed;               /* failed to load, not retried */
+    gboolean  pinned;               /* registered an input, never unloaded */
+    gboolean  used;                 /* used since the last idle check */
+    guint     idle_source_id;
+};
+
+typedef struct _NLazyMatchData
+{
+    NLazyPlugin *lazy;
+    gboolean     matched;
+} NLazyMatchData;
+
+static gboolean n_lazy_plugin_load        (NLazyPlugin *lazy);
+static gboolean n_lazy_plugin_in_use      (NLazyPlugin *lazy);
+static gboolean n_lazy_plugin_idle_cb     (gpointer userdata);
+static void     n_lazy_plugin_match_cb    (const char *key, const NValue *value, gpointer userdata);
+
+
+
+NLazyPlugin*
+n_lazy_plugin_new (NCore *core, const char *name)
+{
+    NLazyPlugin *lazy = NULL;
+
+    g_assert (name != NULL);
+
+    lazy = g_new0 (NLazyPlugin, 1);
+    lazy->core = core;
+    lazy->name = g_strdup (name);
+
+    return lazy;
+}
+
+void
+n_lazy_plugin_free (NLazyPlugin *lazy)
+{
+    if (!lazy)
+        return;
+
+    n_lazy_plugin_unload (lazy);
+
+    g_list_foreach (lazy->prefixes, (GFunc) g_free, NULL);
+    g_list_free (lazy->prefixes);
+    g_free (lazy->name);
+    g_free (lazy);
+}
+
+void
+n_lazy_plugin_add_prefix (NLazyPlugin *lazy, const char *prefix)
+{
+    g_assert (lazy != NULL);
+    g_assert (prefix != NULL);
+
+    lazy->prefixes = g_list_append (lazy->prefixes, g_strdup (prefix));
+}
+
+const char*
+n_lazy_plugin_get_name (NLazyPlugin *lazy)
+{
+    return lazy ? lazy->name : NULL;
+}
+
+GList*
+n_lazy_plugin_get_prefixes (NLazyPlugin *lazy)
+{
+    return lazy ? lazy->prefixes : NULL;
+}
+
+gboolean
+n_lazy_plugin_is_loaded (NLazyPlugin *lazy)
+{
+    return (lazy && lazy->plugin) ? TRUE : FALSE;
+}
+
+static gboolean
+n_lazy_plugin_load (NLazyPlugin *lazy)
+{
+    NCore             *core   = lazy->core;
+    NSinkInterface   **sink   = NULL;
+    NInputInterface  **input  = NULL;
+    gint64             start  = 0;
+
+    start = g_get_monotonic_time ();
+
+    if (!(lazy->plugin = n_core_load_plugin (core, lazy->name))) {
+        N_INFO (LOG_CAT "optional plugin %s not loaded.", lazy->name);
+        lazy->failed = TRUE;
+        return FALSE;
+    }
+
+    core->plugins = g_list_append (core->plugins, lazy->plugin);
+    n_core_set_sink_priorities (core->sinks, core->sink_order);
+
+    /* hooks and subscriptions made from here on belong to the plugin as
+       well, they are removed when it is unloaded. */
+
+    n_core_set_loading_plugin (lazy->name);
+
+    for (sink = core->sinks; sink && *sink; ++sink) {
+        if ((*sink)->plugin != lazy->plugin)
+            continue;
+
+        if ((*sink)->funcs.initialize && !(*sink)->funcs.initialize (*sink)) {
+            N_ERROR (LOG_CAT "sink '%s' failed to initialize", (*sink)->name);
+            n_core_set_loading_plugin (NULL);
+            n_lazy_plugin_unload (lazy);
+            lazy->failed = TRUE;
+            return FALSE;
+        }
+
+        lazy->sinks = g_list_append (lazy->sinks, *sink);
+    }
+
+    /* inputs can not be told apart from the requests they create, keep
+       such plugin loaded once it is there. */
+
+    for (input = core->inputs; input && *input; ++input) {
+        if ((*input)->plugin != lazy->plugin)
+            continue;
+
+        if ((*input)->funcs.initialize && !(*input)->funcs.initialize (*input))
+            N_WARNING (LOG_CAT "input '%s' failed to initialize", (*input)->name);
+
+        lazy->pinned = TRUE;
+    }
+
+    /* the plugin missed the init done hook fired at startup. */
+
+    if (core->init_done)
+        n_core_fire_hook_owner (core, N_CORE_HOOK_INIT_DONE, NULL, lazy->name);
+
+    n_core_set_loading_plugin (NULL);
+
+    if (core->lazy_unload_timeout > 0 && !lazy->pinned) {
+        lazy->idle_source_id = g_timeout_add_seconds (core->lazy_unload_timeout,
+            n_lazy_plugin_idle_cb, lazy);
+    }
+
+    N_INFO (LOG_CAT "optional plugin '%s' loaded on demand in %.1f ms",
+        lazy->name, (g_get_monotonic_time () - start) / 1000.0);
+
+    return TRUE;
+}
+
+void
+n_lazy_plugin_unload (NLazyPlugin *lazy)
+{
+    NCore           *core = NULL;
+    NSinkInterface  *sink = NULL;
+    guint            i    = 0;
+
+    if (!lazy || !lazy->plugin)
+        return;
+
+    core = lazy->core;
+
+    if (lazy->idle_source_id > 0) {
+        g_source_remove (lazy->idle_source_id);
+        lazy->idle_source_id = 0;
+    }
+
+    /* the array is compacted when a sink is removed, do not advance the
+       index in that case. */
+
+    while (core->sinks && core->sinks[i]) {
+        sink = core->sinks[i];
+        if (sink->plugin != lazy->plugin) {
+            ++i;
+            continue;
+        }
+
+        if (sink->funcs.shutdown && g_list_find (lazy->sinks, sink))
+            sink->funcs.shutdown (sink);
+
+        n_core_unregister_sink (core, sink);
+        g_free (sink);
+    }
+
+    g_list_free (lazy->sinks);
+    lazy->sinks = NULL;
+
+    /* nothing may call into the module once it is closed. */
+
+    n_core_disconnect_owner (core, lazy->name);
+
+    core->plugins = g_list_remove (core->plugins, lazy->plugin);
+    n_core_unload_plugin (core, lazy->plugin);
+
+    lazy->plugin = NULL;
+    lazy->used   = FALSE;
+    lazy->pinned = FALSE;
+}
+
+static gboolean
+n_lazy_plugin_in_use (NLazyPlugin *lazy)
+{
+    NRequest       *request = NULL;
+    NSinkInterface *sink    = NULL;
+    GList          *iter    = NULL;
+    GList          *s       = NULL;
+
+    for (iter = n_core_get_requests (lazy->core); iter; iter = g_list_next (iter)) {
+        request = (NRequest*) iter->data;
+
+        for (s = g_list_first (request->all_sinks); s; s = g_list_next (s)) {
+            sink = (NSinkInterface*) s->data;
+            if (sink->plugin == lazy->plugin)
+                return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static gboolean
+n_lazy_plugin_idle_cb (gpointer userdata)
+{
+    NLazyPlugin *lazy = (NLazyPlugin*) userdata;
+
+    /* plugin is unloaded once it has not been used for a full period,
+       i.e. after one to two unload timeouts of inactivity. */
+
+    if (lazy->used || n_lazy_plugin_in_use (lazy)) {
+        lazy->used = FALSE;
+        return TRUE;
+    }
+
+    N_INFO (LOG_CAT "unloading idle optional plugin '%s'", lazy->name);
+
+    lazy->idle_source_id = 0;
+    n_lazy_plugin_unload (lazy);
+
+    return FALSE;
+}
+
+static void
+n_lazy_plugin_match_cb (const char *key, const NValue *value, gpointer userdata)
+{
+    NLazyMatchData *data = (NLazyMatchData*) userdata;
+    GList          *iter = NULL;
+
+    (void) value;
+
+    if (data->matched)
+        return;
+
+    for (iter = g_list_first (data->lazy->prefixes); iter; iter = g_list_next (iter)) {
+        if (g_str_has_prefix (key, (const char*) iter->data)) {
+            data->matched = TRUE;
+            return;
+        }
+    }
+}
+
+void
+n_core_load_lazy_plugins (NCore *core, NRequest *request)
+{
+    NLazyPlugin    *lazy = NULL;
+    GList          *iter = NULL;
+    NLazyMatchData  data;
+
+    g_assert (core != NULL);
+    g_assert (request != NULL);
+
+    for (iter = g_list_first (core->lazy_plugins); iter; iter = g_list_next (iter)) {
+        lazy = (NLazyPlugin*) iter->data;
+        if (lazy->plugin || lazy->failed || !lazy->prefixes)
+            continue;
+
+        data.lazy    = lazy;
+        data.matched = FALSE;
+        n_proplist_foreach (request->properties, n_lazy_plugin_match_cb, &data);
+
+        if (data.matched) {
+            N_DEBUG (LOG_CAT "request '%s' needs optional plugin '%s'",
+                request->name, lazy->name);
+            (void) n_lazy_plugin_load (lazy);
+        }
+    }
+}
+
+void
+n_core_touch_lazy_plugins (NCore *core, GList *sinks)
+{
+    NLazyPlugin    *lazy = NULL;
+    NSinkInterface *sink = NULL;
+    GList          *iter = NULL;
+    GList          *s    = NULL;
+
+    g_assert (core != NULL);
+
+    for (iter = g_list_first (core->lazy_plugins); iter; iter = g_list_next (iter)) {
+        lazy = (NLazyPlugin*) iter->data;
+        if (!lazy->plugin || lazy->used)
+            continue;
+
+        for (s = g_list_first (sinks); s; s = g_list_next (s)) {
+            sink = (NSinkInterface*) s->data;
+            if (sink->plugin == lazy->plugin) {
+                lazy->used = TRUE;
+                break;
+            }
+        }
+    }
+}
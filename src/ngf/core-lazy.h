@@ -0,0 +1,48 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef N_CORE_LAZY_H
+#define N_CORE_LAZY_H
+
+#include <glib.h>
+
+#include <ngf/core.h>
+#include <ngf/request.h>
+
+#define N_CORE_DEFAULT_LAZY_UNLOAD_TIMEOUT 300
+
+/* optional plugin that is only loaded when a request has properties with
+   one of the declared key prefixes, and unloaded again once it has been
+   idle for the unload timeout of the core. */
+typedef struct _NLazyPlugin NLazyPlugin;
+
+NLazyPlugin* n_lazy_plugin_new          (NCore *core, const char *name);
+void         n_lazy_plugin_free         (NLazyPlugin *lazy);
+void         n_lazy_plugin_add_prefix   (NLazyPlugin *lazy, const char *prefix);
+const char*  n_lazy_plugin_get_name     (NLazyPlugin *lazy);
+GList*       n_lazy_plugin_get_prefixes (NLazyPlugin *lazy);
+gboolean     n_lazy_plugin_is_loaded    (NLazyPlugin *lazy);
+void         n_lazy_plugin_unload       (NLazyPlugin *lazy);
+
+void         n_core_load_lazy_plugins   (NCore *core, NRequest *request);
+void         n_core_touch_lazy_plugins  (NCore *core, GList *sinks);
+
+#endif /* N_CORE_LAZY_H */
@@ -20,6 +20,7 @@
  */
 
 #include "core-player.h"
+#include "proplist-internal.h"
 #include <string.h>
 
 #define LOG_CAT         "core: "
@@ -27,14 +28,45 @@
 #define MAX_TIMEOUT_KEY "core.max_timeout"
 #define POLICY_TIMEOUT_KEY "play.timeout"
 
+static NAtom policy_timeout_atom = N_ATOM_NONE;
+static NAtom priority_atom       = N_ATOM_NONE;
+
+/* requests of a batch wait for each other once their own sinks are
+   synchronized, and are then played from the same idle callback. */
+struct _NRequestBatch
+{
+    guint   members;                /* requests still part of the batch */
+    guint   pending;                /* members not synchronized yet */
+    GList  *ready;                  /* synchronized members, in order */
+    guint   play_source_id;
+};
+
+typedef struct _NCoreTraceHookData
+{
+    NRequestTrace *trace;
+    const char    *name;
+    guint          span;
+} NCoreTraceHookData;
+
 static gboolean n_core_max_timeout_reached_cb         (gpointer userdata);
 static void     n_core_setup_max_timeout              (NRequest *request);
 static void     n_core_clear_max_timeout              (NRequest *request);
+static void     n_core_trace_hook_cb                  (NHook *hook, NHookCallback callback, int done, void *userdata);
+static void     n_core_fire_request_hook              (NRequest *request, NCoreHook hook, void *data);
 static void     n_core_fire_new_request_hook          (NRequest *request);
 static void     n_core_fire_transform_properties_hook (NRequest *request);
 static GList*   n_core_fire_filter_sinks_hook         (NRequest *request, GList *sinks);
 static GList*   n_core_query_capable_sinks            (NRequest *request);
 static void     n_core_merge_request_properties       (NRequest *request, NEvent *event);
+static gboolean n_core_resolve_request                (NCore *core, NRequest *request);
+static gboolean n_core_admit_request                  (NCore *core, NRequest *request);
+static gboolean n_core_schedule_request               (NCore *core, NRequest *request);
+static void     n_core_start_request                  (NCore *core, NRequest *request);
+static gboolean n_core_queue_timeout_cb               (gpointer userdata);
+static void     n_core_run_queue                      (NCore *core);
+static void     n_core_batch_ready                    (NRequest *request);
+static void     n_core_batch_leave                    (NRequest *request);
+static gboolean n_core_batch_play_cb                  (gpointer userdata);
 
 static void     n_core_send_reply               (NRequest *request, NCorePlayerState status);
 static void     n_core_send_error               (NRequest *request, const char *err_msg);
@@ -86,6 +118,47 @@ n_core_clear_max_timeout (NRequest *request)
     }
 }
 
+static void
+n_core_trace_hook_cb (NHook *hook, NHookCallback callback, int done, void *userdata)
+{
+    NCoreTraceHookData *data = (NCoreTraceHookData*) userdata;
+
+    (void) hook;
+
+    if (!done) {
+        data->span = n_request_trace_begin (data->trace, data->name, NULL);
+        n_request_trace_set_callback (data->trace, data->span, (gpointer) callback);
+    }
+    else
+        n_request_trace_end (data->trace, data->span);
+}
+
+static void
+n_core_fire_request_hook (NRequest *request, NCoreHook hook, void *data)
+{
+    NCoreTraceHookData trace_data;
+
+    N_DEBUG (LOG_CAT "firing hook '%s'", n_core_hook_to_string (hook));
+
+    /* the request name goes along for callbacks that overrun their
+       budget. */
+
+    if (!request->trace) {
+        n_hook_fire_full (&request->core->hooks[hook], data, request->name,
+            NULL, NULL);
+        return;
+    }
+
+    /* traced requests get a span for every hook callback. */
+
+    trace_data.trace = request->trace;
+    trace_data.name  = n_core_hook_to_string (hook);
+    trace_data.span  = 0;
+
+    n_hook_fire_full (&request->core->hooks[hook], data, request->name,
+        n_core_trace_hook_cb, &trace_data);
+}
+
 static void
 n_core_fire_new_request_hook (NRequest *request)
 {
@@ -95,7 +168,7 @@ n_core_fire_new_request_hook (NRequest *request)
     NCoreHookNewRequestData new_request;
 
     new_request.request = request;
-    n_core_fire_hook (request->core, N_CORE_HOOK_NEW_REQUEST, &new_request);
+    n_core_fire_request_hook (request, N_CORE_HOOK_NEW_REQUEST, &new_request);
 }
 
 static void
@@ -107,7 +180,7 @@ n_core_fire_transform_properties_hook (NRequest *request)
     NCoreHookTransformPropertiesData transform_data;
 
     transform_data.request = request;
-    n_core_fire_hook (request->core, N_CORE_HOOK_TRANSFORM_PROPERTIES, &transform_data);
+    n_core_fire_request_hook (request, N_CORE_HOOK_TRANSFORM_PROPERTIES, &transform_data);
 }
 
 static GList*
@@ -120,7 +193,7 @@ n_core_fire_filter_sinks_hook (NRequest *request, GList *sinks)
 
     filter_sinks_data.request = request;
     filter_sinks_data.sinks   = sinks;
-    n_core_fire_hook (request->core, N_CORE_HOOK_FILTER_SINKS, &filter_sinks_data);
+    n_core_fire_request_hook (request, N_CORE_HOOK_FILTER_SINKS, &filter_sinks_data);
 
     return filter_sinks_data.sinks;
 }
@@ -135,6 +208,11 @@ n_core_query_capable_sinks (NRequest *request)
     GList           *sinks = NULL;
     NSinkInterface **iter  = NULL;
 
+    /* bring in the optional plugins that handle the request before they
+       are queried. */
+
+    n_core_load_lazy_plugins (core, request);
+
     for (iter = core->sinks; *iter; ++iter) {
         if ((*iter)->funcs.can_handle && !(*iter)->funcs.can_handle (*iter, request))
             continue;
@@ -142,6 +220,8 @@ n_core_query_capable_sinks (NRequest *request)
         sinks = g_list_append (sinks, *iter);
     }
 
+    n_core_touch_lazy_plugins (core, sinks);
+
     return sinks;
 }
 
@@ -151,13 +231,16 @@ n_core_merge_request_properties (NRequest *request, NEvent *event)
     g_assert (request != NULL);
     g_assert (event != NULL);
 
-    NProplist *copy = NULL;
+    NProplist *merged = NULL;
 
-    copy = n_proplist_copy (event->properties);
-    n_proplist_merge (copy, request->properties);
+    /* request values take precedence, the event properties are looked up
+       from below them. the request keeps a reference to the event. */
 
-    n_proplist_free (request->properties);
-    request->properties = copy;
+    merged = n_proplist_new_in_arena (&request->arena);
+    n_proplist_add_layer (merged, request->properties);
+    n_proplist_add_layer (merged, event->properties);
+
+    request->properties = merged;
 }
 
 static void
@@ -214,6 +297,7 @@ n_core_sink_synchronize_done_cb (gpointer userdata)
     NCore          *core      = request->core;
     GList          *iter      = NULL;
     NSinkInterface *sink      = NULL;
+    guint           span      = 0;
 
     /* setup the maximum timeout callback. */
     n_core_setup_max_timeout (request);
@@ -225,24 +309,30 @@ n_core_sink_synchronize_done_cb (gpointer userdata)
     for (iter = g_list_first (request->sinks_prepared); iter; iter = g_list_next (iter)) {
         sink = (NSinkInterface*) iter->data;
 
+        n_request_trace_begin_async (request->trace, "playing", sink->name);
+        span = n_request_trace_begin (request->trace, "play", sink->name);
+
         if (!sink->funcs.play (sink, request)) {
             N_WARNING (LOG_CAT "sink '%s' failed play request '%s'",
                 sink->name, request->name);
 
+            n_request_trace_end (request->trace, span);
             n_core_fail_sink (core, sink, request);
             return FALSE;
         }
 
+        n_request_trace_end (request->trace, span);
+
         if (!sink->funcs.prepare) {
             if (n_core_sink_in_list (request->stop_list, sink))
-                request->stop_list = g_list_append (request->stop_list, sink);
+                request->stop_list = n_request_list_append (request,
+                    request->stop_list, sink);
         }
 
-        request->sinks_playing = g_list_append (request->sinks_playing,
-            sink);
+        request->sinks_playing = n_request_list_append (request,
+            request->sinks_playing, sink);
     }
 
-    g_list_free (request->sinks_prepared);
     request->sinks_prepared = NULL;
 
     return FALSE;
@@ -269,26 +359,38 @@ n_core_prepare_sinks (GList *sinks, NRequest *request)
     NCore          *core = request->core;
     GList          *iter = NULL;
     NSinkInterface *sink = NULL;
+    guint           span = 0;
 
     for (iter = g_list_first (sinks); iter; iter = g_list_next (iter)) {
         sink = (NSinkInterface*) iter->data;
 
+        /* synchronizing lasts from prepare until the sink reports it is
+           ready, which may happen within prepare already. */
+
+        n_request_trace_begin_async (request->trace, "synchronizing", sink->name);
+
         if (!sink->funcs.prepare) {
             N_DEBUG (LOG_CAT "sink has no prepare, synchronizing immediately");
             n_core_synchronize_sink (core, sink, request);
             continue;
         }
 
+        span = n_request_trace_begin (request->trace, "prepare", sink->name);
+
         if (!sink->funcs.prepare (sink, request)) {
             N_WARNING (LOG_CAT "sink '%s' failed to prepare request '%s'",
                 sink->name, request->name);
 
+            n_request_trace_end (request->trace, span);
             n_core_fail_sink (core, sink, request);
             return FALSE;
         }
 
+        n_request_trace_end (request->trace, span);
+
         if (!n_core_sink_in_list (request->stop_list, sink))
-            request->stop_list = g_list_append (request->stop_list, sink);
+            request->stop_list = n_request_list_append (request,
+                request->stop_list, sink);
     }
 
     return TRUE;
@@ -303,7 +405,7 @@ n_translate_fallback (const char *key, const NValue *value, gpointer userdata)
     if (g_str_has_suffix (key, FALLBACK_SUFFIX)) {
         new_key = g_strdup (key);
         new_key[strlen (key) - strlen (FALLBACK_SUFFIX)] = 0;
-        n_proplist_set (props, new_key, n_value_copy (value));
+        n_proplist_set_take (props, new_key, n_value_copy (value));
         g_free (new_key);
     }
 }
@@ -325,6 +427,7 @@ n_core_request_done_cb (gpointer userdata)
     NCore     *core          = request->core;
     NProplist *new_props     = NULL;
     gboolean   has_fallbacks = FALSE;
+    guint      span          = 0;
 
     /* ensure that maximum timeout is removed. */
     n_core_clear_max_timeout (request);
@@ -333,17 +436,36 @@ n_core_request_done_cb (gpointer userdata)
        a stop on each sink and then clear out the request. */
 
     request->stop_source_id = 0;
-    core->requests = g_list_remove (core->requests, request);
+    n_request_registry_remove (core->requests, request);
+    n_core_batch_leave (request);
 
     N_DEBUG (LOG_CAT "stopping all sinks for request '%s'", request->name);
+    span = n_request_trace_begin (request->trace, "stop", NULL);
     n_core_stop_sinks (request->stop_list, request);
+    n_request_trace_end (request->trace, span);
+
+    /* the sinks are free again, start what was waiting for them. */
+
+    n_request_scheduler_release (core->scheduler, request);
+    n_core_run_queue (core);
+
+    /* the other sink lists are in the request arena. */
 
-    g_list_free (request->stop_list);
-    g_list_free (request->sinks_resync);
-    g_list_free (request->sinks_playing);
-    g_list_free (request->sinks_prepared);
-    g_list_free (request->sinks_preparing);
     g_list_free (request->all_sinks);
+    request->all_sinks = NULL;
+
+    /* the timeline is complete, keep it for dumping later. */
+
+    if (request->trace) {
+        n_request_trace_finish (request->trace, request->has_failed);
+        n_trace_log_add (core->trace_log, request->trace);
+        request->trace = NULL;
+    }
+
+    if (request->is_dropped) {
+        n_core_send_error (request, "request dropped.");
+        goto done;
+    }
 
     if (request->has_failed && request->is_fallback) {
         /* if the fallback failed, bail out. */
@@ -376,10 +498,13 @@ n_core_request_done_cb (gpointer userdata)
 
     N_DEBUG (LOG_CAT "request has failed, restarting with fallback.");
 
-    new_props = n_proplist_copy (request->original_properties);
-
     NRequest *new_request = n_request_new ();
-    new_request->name        = g_strdup (request->name);
+    new_props = n_proplist_copy_in_arena (request->original_properties,
+        &new_request->arena);
+
+    new_request->name        = n_arena_strdup (&new_request->arena, request->name);
+    new_request->id          = request->id;
+    new_request->client      = n_arena_strdup (&new_request->arena, request->client);
     new_request->input_iface = request->input_iface;
     new_request->properties  = new_props;
     new_request->is_fallback = TRUE;
@@ -398,34 +523,46 @@ done:
     return FALSE;
 }
 
-int
-n_core_play_request (NCore *core, NRequest *request)
+static gboolean
+n_core_resolve_request (NCore *core, NRequest *request)
 {
-    NProplist *new_props     = NULL;
-
-    g_assert (core != NULL);
-    g_assert (request != NULL);
+    NProplist *new_props  = NULL;
+    guint      generation = 0;
+    guint      span       = 0;
 
-    GList  *all_sinks = NULL;
+    /* resolution only depends on the request and the context, reuse the
+       earlier result if the context has not changed since. fallback
+       requests are rare and transformed differently, resolve them always. */
 
-    /* store the original request properties and default timeout */
+    generation = n_context_get_generation (core->context);
 
-    request->original_properties = n_proplist_copy (request->properties);
-    request->timeout_ms = n_proplist_get_uint (request->properties, POLICY_TIMEOUT_KEY);
-    request->core = core;
+    if (!request->is_fallback &&
+        n_request_cache_lookup (core->request_cache, request, generation)) {
+        N_DEBUG (LOG_CAT "request '%s' resolved to event '%s' (cached)",
+            request->name, request->event->name);
+        return TRUE;
+    }
 
     /* evaluate the request and context to resolve the correct event for
        this specific request. if no event, then there is no default event
        defined and we are done here. */
 
+    span = n_request_trace_begin (request->trace, "evaluate", NULL);
     request->event = n_core_evaluate_request (core, request);
+    n_request_trace_end (request->trace, span);
+
     if (!request->event) {
         N_WARNING (LOG_CAT "unable to resolve event for request '%s'",
             request->name);
         request->no_event = TRUE;
-        goto fail_request;
+        return FALSE;
     }
 
+    /* request keeps the event even if the configuration is reloaded
+       while it is playing. */
+
+    n_event_ref (request->event);
+
     N_DEBUG (LOG_CAT "request '%s' resolved to event '%s'", request->name,
         request->event->name);
 
@@ -439,19 +576,215 @@ n_core_play_request (NCore *core, NRequest *request)
 
     /* check if fallbacks need to be used */
     if (request->is_fallback) {
-        new_props = n_proplist_copy (request->properties);
+        new_props = n_proplist_new_in_arena (&request->arena);
+        n_proplist_add_layer (new_props, request->properties);
         n_proplist_foreach (request->properties,
             n_translate_fallback, new_props);
-        n_proplist_free (request->properties);
         request->properties  = new_props;
     }
 
     n_core_fire_transform_properties_hook (request);
 
+    /* hooks may have changed the context, in that case the result is
+       already stale. */
+
+    if (!request->is_fallback && n_context_get_generation (core->context) == generation)
+        n_request_cache_store (core->request_cache, request, generation);
+
+    return TRUE;
+}
+
+static gboolean
+n_core_admit_request (NCore *core, NRequest *request)
+{
+    GList    *event_list = NULL;
+    NRequest *target     = NULL;
+
+    event_list = (GList*) g_hash_table_lookup (core->event_table, request->name);
+
+    switch (n_request_admission_check (core->admission, event_list,
+                                       core->requests, request, &target)) {
+        case N_ADMISSION_DROP:
+            N_INFO (LOG_CAT "request '%s' from '%s' over the limits, dropped.",
+                request->name, request->client ? request->client : "<unknown>");
+            request->is_dropped     = TRUE;
+            request->has_failed     = TRUE;
+            request->stop_source_id = g_idle_add (n_core_request_done_cb, request);
+            return FALSE;
+
+        case N_ADMISSION_RETRIGGER:
+            /* the request still playing takes the place of the new one,
+               it runs for the full maximum timeout again. the new request
+               completes without touching the sinks. */
+            N_DEBUG (LOG_CAT "request '%s' coalesced into request %u",
+                request->name, target->id);
+            if (target->max_timeout_id > 0) {
+                n_core_clear_max_timeout (target);
+                n_core_setup_max_timeout (target);
+            }
+            request->stop_source_id = g_idle_add (n_core_request_done_cb, request);
+            return FALSE;
+
+        case N_ADMISSION_SUPERSEDE:
+            N_DEBUG (LOG_CAT "request '%s' supersedes request %u",
+                request->name, target->id);
+            n_core_stop_request (core, target, 0);
+            break;
+
+        default:
+            break;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+n_core_queue_timeout_cb (gpointer userdata)
+{
+    NRequest *request = (NRequest*) userdata;
+    NCore    *core    = request->core;
+
+    request->play_source_id = 0;
+
+    N_INFO (LOG_CAT "request '%s' waited too long for the sinks, dropped.",
+        request->name);
+
+    n_request_scheduler_expire (core->scheduler, request);
+    request->is_dropped     = TRUE;
+    request->has_failed     = TRUE;
+    request->stop_source_id = g_idle_add (n_core_request_done_cb, request);
+
+    return FALSE;
+}
+
+static gboolean
+n_core_schedule_request (NCore *core, NRequest *request)
+{
+    NRequest *victim  = NULL;
+    guint     timeout = 0;
+
+    if (!priority_atom)
+        priority_atom = n_atom_intern_static (N_SCHEDULER_PRIORITY_KEY);
+
+    request->priority = n_proplist_get_int_atom (request->properties, priority_atom);
+
+    switch (n_request_scheduler_admit (core->scheduler, request, &victim)) {
+        case N_SCHEDULER_SHED:
+            N_INFO (LOG_CAT "sinks busy and queue full, request '%s' dropped.",
+                request->name);
+            request->is_dropped     = TRUE;
+            request->has_failed     = TRUE;
+            request->stop_source_id = g_idle_add (n_core_request_done_cb, request);
+            return FALSE;
+
+        case N_SCHEDULER_QUEUE:
+            if (victim) {
+                N_INFO (LOG_CAT "queue full, waiting request '%s' dropped for request '%s'.",
+                    victim->name, request->name);
+                victim->is_dropped = TRUE;
+                victim->has_failed = TRUE;
+                n_core_stop_request (core, victim, 0);
+            }
+
+            /* no reply until the request is started, play_source_id is not
+               used before that. */
+            timeout = n_request_scheduler_get_queue_timeout (core->scheduler);
+            if (timeout > 0)
+                request->play_source_id = g_timeout_add (timeout,
+                    n_core_queue_timeout_cb, request);
+
+            /* the rest of a batch does not wait for busy sinks. */
+            n_core_batch_leave (request);
+            return FALSE;
+
+        case N_SCHEDULER_PREEMPT:
+            N_INFO (LOG_CAT "request '%s' preempted by request '%s'",
+                victim->name, request->name);
+            n_core_stop_request (core, victim, 0);
+            break;
+
+        default:
+            break;
+    }
+
+    return TRUE;
+}
+
+static void
+n_core_start_request (NCore *core, NRequest *request)
+{
+    (void) core;
+
+    /* prepare all sinks that can handle the event. if there is no preparation
+       function defined within the sink, then it is synchronized immediately. */
+
+    n_core_prepare_sinks (request->all_sinks, request);
+
+    n_core_send_reply (request, N_CORE_EVENT_PLAYING);
+}
+
+static void
+n_core_run_queue (NCore *core)
+{
+    NRequest *request = NULL;
+
+    while ((request = n_request_scheduler_next (core->scheduler)) != NULL) {
+        if (request->play_source_id > 0) {
+            g_source_remove (request->play_source_id);
+            request->play_source_id = 0;
+        }
+
+        n_core_start_request (core, request);
+    }
+}
+
+int
+n_core_play_request (NCore *core, NRequest *request)
+{
+    g_assert (core != NULL);
+    g_assert (request != NULL);
+
+    GList  *all_sinks = NULL;
+    guint   span      = 0;
+
+    if (core->trace_log && !request->trace)
+        request->trace = n_request_trace_new (request->name, request->id,
+            request->received);
+
+    /* keep the original request properties as they are, the request
+       continues with a layer on top of them. */
+
+    request->original_properties = request->properties;
+    request->properties = n_proplist_new_in_arena (&request->arena);
+    n_proplist_add_layer (request->properties, request->original_properties);
+
+    if (!policy_timeout_atom)
+        policy_timeout_atom = n_atom_intern_static (POLICY_TIMEOUT_KEY);
+
+    request->timeout_ms = n_proplist_get_uint_atom (request->properties, policy_timeout_atom);
+    request->core = core;
+
+    /* limit bursts of the same event before any rules are evaluated.
+       fallbacks replace a request that was admitted already. */
+
+    if (!request->is_fallback && !n_core_admit_request (core, request))
+        return TRUE;
+
+    /* resolve the event and the final properties for the request. */
+
+    span = n_request_trace_begin (request->trace, "resolve", NULL);
+    if (!n_core_resolve_request (core, request)) {
+        n_request_trace_end (request->trace, span);
+        goto fail_request;
+    }
+    n_request_trace_end (request->trace, span);
+
     /* query and filter capable sinks */
 
+    span = n_request_trace_begin (request->trace, "query sinks", NULL);
     all_sinks = n_core_query_capable_sinks (request);
     all_sinks = n_core_fire_filter_sinks_hook (request, all_sinks);
+    n_request_trace_end (request->trace, span);
 
     /* if no sinks left, then nothing to do. */
 
@@ -469,16 +802,16 @@ n_core_play_request (NCore *core, NRequest *request)
     /* setup the sinks for the play data */
 
     request->all_sinks       = all_sinks;
-    request->sinks_preparing = g_list_copy (all_sinks);
+    request->sinks_preparing = n_request_list_copy (request, all_sinks);
     request->master_sink     = (NSinkInterface*) ((g_list_first (all_sinks))->data);
 
-    /* prepare all sinks that can handle the event. if there is no preparation
-       function defined within the sink, then it is synchronized immediately. */
+    /* the request is active from now on, even while it waits for the
+       sinks, so that it can be stopped. */
 
-    core->requests = g_list_append (core->requests, request);
-    n_core_prepare_sinks (all_sinks, request);
+    n_request_registry_add (core->requests, request);
 
-    n_core_send_reply (request, N_CORE_EVENT_PLAYING);
+    if (n_core_schedule_request (core, request))
+        n_core_start_request (core, request);
 
     return TRUE;
 
@@ -489,6 +822,114 @@ fail_request:
     return TRUE;
 }
 
+static gboolean
+n_core_batch_play_cb (gpointer userdata)
+{
+    NRequestBatch *batch   = (NRequestBatch*) userdata;
+    GList         *ready   = NULL;
+    GList         *iter    = NULL;
+    NRequest      *request = NULL;
+
+    /* detach everything first, playing may stop requests of the batch. */
+
+    ready = batch->ready;
+    batch->ready = NULL;
+    batch->play_source_id = 0;
+
+    for (iter = ready; iter; iter = g_list_next (iter)) {
+        request = (NRequest*) iter->data;
+        request->batch = NULL;
+        batch->members--;
+    }
+
+    g_assert (batch->members == 0);
+    g_slice_free (NRequestBatch, batch);
+
+    N_DEBUG (LOG_CAT "playing batch of %u requests", g_list_length (ready));
+
+    for (iter = ready; iter; iter = g_list_next (iter)) {
+        request = (NRequest*) iter->data;
+        if (request->stop_source_id == 0)
+            (void) n_core_sink_synchronize_done_cb (request);
+    }
+
+    g_list_free (ready);
+
+    return FALSE;
+}
+
+static void
+n_core_batch_ready (NRequest *request)
+{
+    NRequestBatch *batch = request->batch;
+
+    batch->ready = g_list_append (batch->ready, request);
+    batch->pending--;
+
+    if (batch->pending == 0 && !batch->play_source_id)
+        batch->play_source_id = g_idle_add (n_core_batch_play_cb, batch);
+}
+
+static void
+n_core_batch_leave (NRequest *request)
+{
+    NRequestBatch *batch = request->batch;
+    GList         *link  = NULL;
+
+    if (!batch)
+        return;
+
+    request->batch = NULL;
+    batch->members--;
+
+    if ((link = g_list_find (batch->ready, request)) != NULL)
+        batch->ready = g_list_delete_link (batch->ready, link);
+    else
+        batch->pending--;
+
+    if (batch->members == 0) {
+        if (batch->play_source_id > 0)
+            g_source_remove (batch->play_source_id);
+        g_slice_free (NRequestBatch, batch);
+        return;
+    }
+
+    /* the rest of the batch may have been waiting only for this one. */
+
+    if (batch->pending == 0 && batch->ready && !batch->play_source_id)
+        batch->play_source_id = g_idle_add (n_core_batch_play_cb, batch);
+}
+
+int
+n_core_play_batch (NCore *core, GList *requests)
+{
+    g_assert (core != NULL);
+
+    NRequestBatch *batch = NULL;
+    GList         *iter  = NULL;
+    guint          count = 0;
+
+    count = g_list_length (requests);
+    if (count == 0)
+        return FALSE;
+
+    /* a single request has nobody to wait for. */
+
+    if (count > 1) {
+        batch = g_slice_new0 (NRequestBatch);
+        batch->members = count;
+        batch->pending = count;
+
+        for (iter = g_list_first (requests); iter; iter = g_list_next (iter))
+            ((NRequest*) iter->data)->batch = batch;
+    }
+
+    for (iter = g_list_first (requests); iter; iter = g_list_next (iter))
+        (void) n_core_play_request (core, (NRequest*) iter->data);
+
+    return TRUE;
+}
+
 int
 n_core_pause_request (NCore *core, NRequest *request)
 {
@@ -499,6 +940,12 @@ n_core_pause_request (NCore *core, NRequest *request)
     NSinkInterface *sink = NULL;
     int all_paused = 1;
 
+    if (n_request_scheduler_is_queued (request)) {
+        N_DEBUG (LOG_CAT "request '%s' is waiting for the sinks, no action.",
+            request->name);
+        return TRUE;
+    }
+
     if (request->is_paused) {
         N_DEBUG (LOG_CAT "request '%s' is already paused, no action.",
             request->name);
@@ -532,6 +979,12 @@ n_core_resume_request (NCore *core, NRequest *request)
     NSinkInterface *sink = NULL;
     int all_resumed = 1;
 
+    if (n_request_scheduler_is_queued (request)) {
+        N_DEBUG (LOG_CAT "request '%s' is waiting for the sinks, no action.",
+            request->name);
+        return TRUE;
+    }
+
     if (!request->is_paused) {
         N_DEBUG (LOG_CAT "request '%s' is not paused, no action.",
             request->name);
@@ -571,6 +1024,11 @@ n_core_stop_request (NCore *core, NRequest *request, guint timeout)
         request->play_source_id = 0;
     }
 
+    /* a waiting request must not be started once the sinks are free. */
+
+    if (n_request_scheduler_is_queued (request))
+        n_request_scheduler_release (core->scheduler, request);
+
     if (timeout > 0)
         request->stop_source_id = g_timeout_add (timeout, n_core_request_done_cb, request);
     else
@@ -596,8 +1054,8 @@ n_core_set_resync_on_master (NCore *core, NSinkInterface *sink,
     if (n_core_sink_in_list (request->sinks_resync, sink))
         return;
 
-    request->sinks_resync = g_list_append (request->sinks_resync,
-        sink);
+    request->sinks_resync = n_request_list_append (request,
+        request->sinks_resync, sink);
 
     N_DEBUG (LOG_CAT "sink '%s' set to resynchronize on master sink '%s'",
         sink->name, request->master_sink->name);
@@ -627,10 +1085,10 @@ n_core_resynchronize_sinks (NCore *core, NSinkInterface *sink,
     /* add the master sink to prepared list, since it only needs play
        to continue. */
 
-    request->sinks_playing  = g_list_remove (request->sinks_playing,
-        request->master_sink);
-    request->sinks_prepared = g_list_append (request->sinks_prepared,
+    request->sinks_playing  = n_request_list_remove (request->sinks_playing,
         request->master_sink);
+    request->sinks_prepared = n_request_list_append (request,
+        request->sinks_prepared, request->master_sink);
 
     /* if resync list is empty, we'll just trigger play on the master
        sink again. */
@@ -643,11 +1101,10 @@ n_core_resynchronize_sinks (NCore *core, NSinkInterface *sink,
         return;
     }
 
-    /* first, we need to copy and clear the resync list. otherwise when the
+    /* first, we need to take and clear the resync list. otherwise when the
        list is prepared, duplicates are added. */
 
-    resync_list = g_list_copy (request->sinks_resync);
-    g_list_free (request->sinks_resync);
+    resync_list = request->sinks_resync;
     request->sinks_resync = NULL;
 
     /* stop all sinks in the resync list. */
@@ -657,12 +1114,8 @@ n_core_resynchronize_sinks (NCore *core, NSinkInterface *sink,
     /* prepare all sinks in the resync list and re-trigger the playback
        for them. */
 
-    request->sinks_preparing = g_list_copy (resync_list);
+    request->sinks_preparing = n_request_list_copy (request, resync_list);
     (void) n_core_prepare_sinks (resync_list, request);
-
-    /* clear the list copy. */
-
-    g_list_free (resync_list);
 }
 
 void
@@ -693,11 +1146,20 @@ n_core_synchronize_sink (NCore *core, NSinkInterface *sink, NRequest *request)
     N_DEBUG (LOG_CAT "sink '%s' synchronized for request '%s'",
         sink->name, request->name);
 
-    request->sinks_preparing = g_list_remove (request->sinks_preparing, sink);
-    request->sinks_prepared  = g_list_append (request->sinks_prepared, sink);
+    n_request_trace_end_async (request->trace, "synchronizing", sink->name);
+
+    request->sinks_preparing = n_request_list_remove (request->sinks_preparing, sink);
+    request->sinks_prepared  = n_request_list_append (request,
+        request->sinks_prepared, sink);
 
     if (!request->sinks_preparing) {
         N_DEBUG (LOG_CAT "all sinks have been synchronized");
+
+        if (request->batch) {
+            n_core_batch_ready (request);
+            return;
+        }
+
         request->play_source_id = g_idle_add (n_core_sink_synchronize_done_cb,
             request);
     }
@@ -721,7 +1183,9 @@ n_core_complete_sink (NCore *core, NSinkInterface *sink, NRequest *request)
     N_DEBUG (LOG_CAT "sink '%s' completed request '%s'",
         sink->name, request->name);
 
-    request->sinks_playing = g_list_remove (request->sinks_playing, sink);
+    n_request_trace_end_async (request->trace, "playing", sink->name);
+
+    request->sinks_playing = n_request_list_remove (request->sinks_playing, sink);
     if (!request->sinks_playing) {
         N_DEBUG (LOG_CAT "all sinks have been completed");
         request->stop_source_id = g_idle_add (n_core_request_done_cb,
@@ -35,6 +35,7 @@ typedef enum _NCorePlayerState
 } NCorePlayerState;
 
 int  n_core_play_request     (NCore *core, NRequest *request);
+int  n_core_play_batch       (NCore *core, GList *requests);
 int  n_core_pause_request    (NCore *core, NRequest *request);
 int  n_core_resume_request   (NCore *core, NRequest *request);
 void n_core_stop_request     (NCore *core, NRequest *request, guint timeout);
@@ -0,0 +1,329 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <ngf/log.h>
+#include "core-startup.h"
+
+#define LOG_CAT "startup: "
+
+typedef enum _NStartupState
+{
+    N_STARTUP_STATE_PENDING = 0,
+    N_STARTUP_STATE_RUNNING,
+    N_STARTUP_STATE_DONE,
+    N_STARTUP_STATE_FAILED,
+    N_STARTUP_STATE_SKIPPED
+} NStartupState;
+
+struct _NStartupTask
+{
+    NStartup       *startup;
+    gchar          *name;
+    guint           flags;
+    NStartupFunc    func;
+    gpointer        userdata;
+    GList          *depends;        /* NStartupTask* that must succeed first */
+
+    NStartupState   state;
+    GThread        *thread;         /* worker thread, if run threaded */
+    gint64          started;        /* monotonic time, microseconds */
+    gint64          finished;
+};
+
+struct _NStartup
+{
+    GList          *tasks;          /* in the order added */
+    guint           num_tasks;
+    guint           num_finished;
+    guint           num_threads;    /* worker threads currently running */
+    guint           max_threads;    /* 0 runs everything on the calling thread */
+    gboolean        aborted;        /* required task failed */
+
+    GMutex          lock;
+    GCond           cond;
+};
+
+static gboolean      n_startup_execute   (NStartupTask *task);
+static void          n_startup_complete  (NStartup *startup, NStartupTask *task, NStartupState state);
+static gpointer      n_startup_thread_cb (gpointer userdata);
+static NStartupTask* n_startup_dispatch  (NStartup *startup, gboolean *progress);
+
+
+
+static gboolean
+n_startup_execute (NStartupTask *task)
+{
+    gboolean result = TRUE;
+
+    task->started = g_get_monotonic_time ();
+    if (task->func)
+        result = task->func (task->userdata);
+    task->finished = g_get_monotonic_time ();
+
+    return result;
+}
+
+static void
+n_startup_complete (NStartup *startup, NStartupTask *task, NStartupState state)
+{
+    /* called with the lock held */
+
+    task->state = state;
+    startup->num_finished++;
+
+    if (state != N_STARTUP_STATE_DONE && (task->flags & N_STARTUP_TASK_REQUIRED)) {
+        N_WARNING (LOG_CAT "required task '%s' %s, stopping startup", task->name,
+            state == N_STARTUP_STATE_FAILED ? "failed" : "was not run");
+        startup->aborted = TRUE;
+    }
+}
+
+static gpointer
+n_startup_thread_cb (gpointer userdata)
+{
+    NStartupTask *task    = (NStartupTask*) userdata;
+    NStartup     *startup = task->startup;
+    gboolean      result  = FALSE;
+
+    result = n_startup_execute (task);
+
+    g_mutex_lock (&startup->lock);
+    startup->num_threads--;
+    n_startup_complete (startup, task, result ? N_STARTUP_STATE_DONE : N_STARTUP_STATE_FAILED);
+    g_cond_signal (&startup->cond);
+    g_mutex_unlock (&startup->lock);
+
+    return NULL;
+}
+
+static NStartupTask*
+n_startup_dispatch (NStartup *startup, gboolean *progress)
+{
+    NStartupTask *task       = NULL;
+    NStartupTask *dependency = NULL;
+    GList        *iter       = NULL;
+    GList        *dep        = NULL;
+    gboolean      ready      = TRUE;
+    gboolean      broken     = FALSE;
+
+    /* called with the lock held. starts every threaded task that is ready
+       and returns the first ready task that must run on this thread. */
+
+    for (iter = g_list_first (startup->tasks); iter; iter = g_list_next (iter)) {
+        task = (NStartupTask*) iter->data;
+        if (task->state != N_STARTUP_STATE_PENDING)
+            continue;
+
+        if (startup->aborted) {
+            n_startup_complete (startup, task, N_STARTUP_STATE_SKIPPED);
+            *progress = TRUE;
+            continue;
+        }
+
+        ready  = TRUE;
+        broken = FALSE;
+        for (dep = g_list_first (task->depends); dep; dep = g_list_next (dep)) {
+            dependency = (NStartupTask*) dep->data;
+            if (dependency->state == N_STARTUP_STATE_FAILED ||
+                dependency->state == N_STARTUP_STATE_SKIPPED)
+                broken = TRUE;
+            else if (dependency->state != N_STARTUP_STATE_DONE)
+                ready = FALSE;
+        }
+
+        if (broken) {
+            N_DEBUG (LOG_CAT "skipping '%s', dependency failed", task->name);
+            n_startup_complete (startup, task, N_STARTUP_STATE_SKIPPED);
+            *progress = TRUE;
+            continue;
+        }
+
+        if (!ready)
+            continue;
+
+        if ((task->flags & N_STARTUP_TASK_THREADED) && startup->max_threads > 0) {
+            if (startup->num_threads >= startup->max_threads)
+                continue;
+
+            task->state  = N_STARTUP_STATE_RUNNING;
+            task->thread = g_thread_try_new (task->name, n_startup_thread_cb, task, NULL);
+            if (task->thread) {
+                startup->num_threads++;
+                *progress = TRUE;
+                continue;
+            }
+
+            /* no thread available, run it here instead. */
+            task->flags &= ~N_STARTUP_TASK_THREADED;
+        }
+
+        task->state = N_STARTUP_STATE_RUNNING;
+        return task;
+    }
+
+    return NULL;
+}
+
+NStartup*
+n_startup_new (guint max_threads)
+{
+    NStartup *startup = NULL;
+
+    startup = g_new0 (NStartup, 1);
+    startup->max_threads = max_threads;
+    g_mutex_init (&startup->lock);
+    g_cond_init (&startup->cond);
+
+    return startup;
+}
+
+void
+n_startup_free (NStartup *startup)
+{
+    GList        *iter = NULL;
+    NStartupTask *task = NULL;
+
+    if (!startup)
+        return;
+
+    for (iter = g_list_first (startup->tasks); iter; iter = g_list_next (iter)) {
+        task = (NStartupTask*) iter->data;
+        g_list_free (task->depends);
+        g_free (task->name);
+        g_slice_free (NStartupTask, task);
+    }
+
+    g_list_free (startup->tasks);
+    g_mutex_clear (&startup->lock);
+    g_cond_clear (&startup->cond);
+    g_free (startup);
+}
+
+NStartupTask*
+n_startup_add_task (NStartup *startup, const char *name, guint flags,
+                    NStartupFunc func, gpointer userdata)
+{
+    NStartupTask *task = NULL;
+
+    g_assert (startup != NULL);
+
+    task = g_slice_new0 (NStartupTask);
+    task->startup  = startup;
+    task->name     = g_strdup (name);
+    task->flags    = flags;
+    task->func     = func;
+    task->userdata = userdata;
+
+    startup->tasks = g_list_append (startup->tasks, task);
+    startup->num_tasks++;
+
+    return task;
+}
+
+void
+n_startup_task_depends_on (NStartupTask *task, NStartupTask *dependency)
+{
+    if (!task || !dependency || task == dependency)
+        return;
+
+    if (!g_list_find (task->depends, dependency))
+        task->depends = g_list_append (task->depends, dependency);
+}
+
+gboolean
+n_startup_run (NStartup *startup)
+{
+    NStartupTask *task     = NULL;
+    GList        *iter     = NULL;
+    gboolean      progress = FALSE;
+    gboolean      result   = FALSE;
+
+    g_assert (startup != NULL);
+
+    g_mutex_lock (&startup->lock);
+
+    while (startup->num_finished < startup->num_tasks) {
+        progress = FALSE;
+
+        if ((task = n_startup_dispatch (startup, &progress)) != NULL) {
+            g_mutex_unlock (&startup->lock);
+            result = n_startup_execute (task);
+            g_mutex_lock (&startup->lock);
+
+            n_startup_complete (startup, task, result ? N_STARTUP_STATE_DONE : N_STARTUP_STATE_FAILED);
+            continue;
+        }
+
+        if (progress)
+            continue;
+
+        if (startup->num_threads == 0) {
+            /* nothing running and nothing can be started, the remaining
+               tasks depend on each other. */
+
+            for (iter = g_list_first (startup->tasks); iter; iter = g_list_next (iter)) {
+                task = (NStartupTask*) iter->data;
+                if (task->state != N_STARTUP_STATE_PENDING)
+                    continue;
+
+                N_WARNING (LOG_CAT "dependency cycle, task '%s' not run", task->name);
+                n_startup_complete (startup, task, N_STARTUP_STATE_SKIPPED);
+            }
+            break;
+        }
+
+        g_cond_wait (&startup->cond, &startup->lock);
+    }
+
+    g_mutex_unlock (&startup->lock);
+
+    for (iter = g_list_first (startup->tasks); iter; iter = g_list_next (iter)) {
+        task = (NStartupTask*) iter->data;
+        if (task->thread) {
+            g_thread_join (task->thread);
+            task->thread = NULL;
+        }
+    }
+
+    return startup->aborted ? FALSE : TRUE;
+}
+
+gboolean
+n_startup_task_succeeded (NStartupTask *task)
+{
+    return (task && task->state == N_STARTUP_STATE_DONE) ? TRUE : FALSE;
+}
+
+gboolean
+n_startup_task_was_threaded (NStartupTask *task)
+{
+    return (task && (task->flags & N_STARTUP_TASK_THREADED) &&
+        task->startup->max_threads > 0) ? TRUE : FALSE;
+}
+
+gint64
+n_startup_task_get_duration (NStartupTask *task)
+{
+    if (!task || task->finished < task->started)
+        return 0;
+
+    return task->finished - task->started;
+}
@@ -0,0 +1,52 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef N_CORE_STARTUP_H
+#define N_CORE_STARTUP_H
+
+#include <glib.h>
+
+/* startup scheduler. tasks run once all the tasks they depend on have
+   succeeded. threaded tasks run on worker threads, the rest run on the
+   calling thread in the order they were added. */
+
+typedef struct _NStartup     NStartup;
+typedef struct _NStartupTask NStartupTask;
+
+typedef gboolean (*NStartupFunc) (gpointer userdata);
+
+enum
+{
+    N_STARTUP_TASK_THREADED = 1 << 0,   /* may run on a worker thread */
+    N_STARTUP_TASK_REQUIRED = 1 << 1    /* failure stops the startup */
+};
+
+NStartup*     n_startup_new               (guint max_threads);
+void          n_startup_free              (NStartup *startup);
+NStartupTask* n_startup_add_task          (NStartup *startup, const char *name, guint flags, NStartupFunc func, gpointer userdata);
+void          n_startup_task_depends_on   (NStartupTask *task, NStartupTask *dependency);
+gboolean      n_startup_run               (NStartup *startup);
+
+gboolean      n_startup_task_succeeded    (NStartupTask *task);
+gboolean      n_startup_task_was_threaded (NStartupTask *task);
+gint64        n_startup_task_get_duration (NStartupTask *task);
+
+#endif /* N_CORE_STARTUP_H */
@@ -30,37 +30,69 @@
 #include "event-internal.h"
 #include "request-internal.h"
 #include "context-internal.h"
+#include "value-internal.h"
 
 #define PATH_LEN 4096
 #define LOG_CAT  "core: "
 
 #define DEFAULT_CONF_PATH     "/usr/share/ngfd"
 #define DEFAULT_PLUGIN_PATH   "/usr/lib/ngf"
-#define DEFAULT_CONF_FILENAME "ngfd.ini"
+#define CACHE_DIRNAME         "ngfd"
 #define PLUGIN_CONF_PATH      "plugins.d"
-#define EVENT_CONF_PATH       "events.d"
 
-typedef struct _NEventMatchResult
+/* plugin being loaded at startup */
+
+typedef struct _NCorePluginEntry
 {
-    NRequest *request;
-    NContext *context;
-    gboolean  has_match;
-    gboolean  skip_rest;
-} NEventMatchResult;
+    NCore        *core;
+    const char   *name;
+    gboolean      required;
+    NPlugin      *plugin;
+    gboolean      threaded;         /* declared startup dependencies */
+    NStartupTask *load_task;
+    GList        *init_tasks;       /* NStartupTask* of the plugin sinks */
+    gint64        open_time;        /* microseconds */
+    gint64        load_time;
+    gint64        init_time;
+} NCorePluginEntry;
+
+/* name of the plugin being loaded by the current thread, hooks connected
+   meanwhile are owned by it. */
+
+static GPrivate n_core_loading_plugin = G_PRIVATE_INIT (NULL);
 
 static gchar*     n_core_get_path               (const char *key, const char *default_path);
+static void       n_core_track_source           (NCore *core, const char *path);
 static NProplist* n_core_load_params            (NCore *core, const char *plugin_name);
-static NPlugin*   n_core_load_plugin            (NCore *core, const char *plugin_name);
-static void       n_core_unload_plugin          (NCore *core, NPlugin *plugin);
+static void       n_core_parse_plugin_params    (NCore *core);
+static NPlugin*   n_core_open_plugin            (NCore *core, const char *plugin_name);
+static int        n_core_start_plugin           (NCore *core, NPlugin *plugin, const char *plugin_name);
+static gboolean   n_core_open_plugin_cb         (gpointer userdata);
+static gboolean   n_core_load_plugin_cb         (gpointer userdata);
+static gboolean   n_core_initialize_sink_cb     (gpointer userdata);
+static void       n_core_add_startup_depends    (GList *entries, NCorePluginEntry *entry, NStartupTask *task, gboolean init);
+static int        n_core_load_plugins           (NCore *core, GList *entries);
+static int        n_core_initialize_sinks       (NCore *core, GList *entries);
+static void       n_core_order_interfaces       (NCore *core, GList *entries);
+static void       n_core_report_startup         (GList *entries, gint64 started);
 static void       n_core_free_event_list_cb     (gpointer in_key, gpointer in_data, gpointer userdata);
-static gint       n_core_sort_event_cb          (gconstpointer a, gconstpointer b);
 static void       n_core_dump_value_cb          (const char *key, const NValue *value, gpointer userdata);
+static void       n_core_dump_hook_stats_cb     (NHook *hook, const NHookSlotStats *stats, void *userdata);
 static void       n_core_parse_events_from_file (NCore *core, const char *filename);
 static int        n_core_parse_events           (NCore *core);
-static void       n_core_parse_keytypes         (NCore *core, GKeyFile *keyfile);
 static void       n_core_parse_sink_order       (NCore *core, GKeyFile *keyfile);
+static void       n_core_parse_cache_size       (NCore *core, GKeyFile *keyfile);
+static void       n_core_parse_startup_threads  (NCore *core, GKeyFile *keyfile);
+static void       n_core_parse_lazy_plugins     (NCore *core, GKeyFile *keyfile);
+static void       n_core_parse_tracing          (NCore *core, GKeyFile *keyfile);
+static void       n_core_parse_hook_budget      (NCore *core, GKeyFile *keyfile);
+static void       n_core_parse_scheduler        (NCore *core, GKeyFile *keyfile);
+static void       n_core_parse_record_level     (NCore *core, GKeyFile *keyfile);
+static gboolean   n_core_is_lazy_plugin         (NCore *core, const char *plugin_name);
 static int        n_core_parse_configuration    (NCore *core);
-static void       n_core_match_event_rule_cb    (const char *key, const NValue *value, gpointer userdata);
+static void       n_core_insert_event           (NCore *core, NEvent *event);
+static void       n_core_prepare_events         (NCore *core);
+static int        n_core_load_configuration     (NCore *core);
 
 
 
@@ -82,6 +114,16 @@ n_core_get_path (const char *key, const char *default_path)
     return g_strdup (path);
 }
 
+static void
+n_core_track_source (NCore *core, const char *path)
+{
+    /* remember the files that the configuration was built from, only
+       while the configuration is being parsed. */
+
+    if (core->config_cache)
+        n_config_cache_add_source (core->config_cache, path);
+}
+
 static NProplist*
 n_core_load_params (NCore *core, const char *plugin_name)
 {
@@ -101,6 +143,8 @@ n_core_load_params (NCore *core, const char *plugin_name)
     full_path = g_build_filename (core->conf_path, PLUGIN_CONF_PATH, filename, NULL);
     keyfile   = g_key_file_new ();
 
+    n_core_track_source (core, full_path);
+
     if (!g_key_file_load_from_file (keyfile, full_path, G_KEY_FILE_NONE, &error)) {
         if (error->code & G_KEY_FILE_ERROR_NOT_FOUND) {
             N_WARNING (LOG_CAT "problem with configuration file '%s': %s",
@@ -142,12 +186,26 @@ done:
     return proplist;
 }
 
-static NPlugin*
-n_core_load_plugin (NCore *core, const char *plugin_name)
+static void
+n_core_parse_plugin_params (NCore *core)
 {
-    g_assert (core != NULL);
-    g_assert (plugin_name != NULL);
+    GList      *lists[2] = { core->required_plugins, core->optional_plugins };
+    GList      *iter     = NULL;
+    const char *name     = NULL;
+    guint       i;
+
+    for (i = 0; i < G_N_ELEMENTS (lists); ++i) {
+        for (iter = g_list_first (lists[i]); iter; iter = g_list_next (iter)) {
+            name = (const char*) iter->data;
+            g_hash_table_replace (core->plugin_params, g_strdup (name),
+                n_core_load_params (core, name));
+        }
+    }
+}
 
+static NPlugin*
+n_core_open_plugin (NCore *core, const char *plugin_name)
+{
     NPlugin *plugin    = NULL;
     gchar   *filename  = NULL;
     gchar   *full_path = NULL;
@@ -155,35 +213,370 @@ n_core_load_plugin (NCore *core, const char *plugin_name)
     filename  = g_strdup_printf ("libngfd_%s.so", plugin_name);
     full_path = g_build_filename (core->plugin_path, filename, NULL);
 
-    if (!(plugin = n_plugin_load (full_path)))
-        goto done;
+    plugin = n_plugin_load (full_path);
+
+    g_free (full_path);
+    g_free (filename);
+
+    return plugin;
+}
+
+static int
+n_core_start_plugin (NCore *core, NPlugin *plugin, const char *plugin_name)
+{
+    int result = FALSE;
 
     plugin->core   = core;
-    plugin->params = n_core_load_params (core, plugin_name);
+    plugin->params = n_proplist_copy (g_hash_table_lookup (core->plugin_params, plugin_name));
 
-    if (!plugin->load (plugin))
-        goto done;
+    n_core_set_loading_plugin (plugin_name);
+    result = plugin->load (plugin);
+    n_core_set_loading_plugin (NULL);
+
+    if (!result)
+        return FALSE;
 
     N_DEBUG (LOG_CAT "loaded plugin '%s'", plugin_name);
 
-    g_free (full_path);
-    g_free (filename);
+    return TRUE;
+}
 
-    return plugin;
+void
+n_core_set_loading_plugin (const char *plugin_name)
+{
+    /* hooks and context subscriptions made meanwhile on this thread are
+       recorded to the plugin, so they can be removed with it. */
 
-done:
-    N_ERROR (LOG_CAT "unable to load plugin '%s'", plugin_name);
+    g_private_set (&n_core_loading_plugin, (gpointer) plugin_name);
+    n_context_set_owner (plugin_name);
+}
+
+NPlugin*
+n_core_load_plugin (NCore *core, const char *plugin_name)
+{
+    g_assert (core != NULL);
+    g_assert (plugin_name != NULL);
 
-    if (plugin)
+    NPlugin *plugin = NULL;
+
+    if (!(plugin = n_core_open_plugin (core, plugin_name)))
+        return NULL;
+
+    if (!n_core_start_plugin (core, plugin, plugin_name)) {
         n_plugin_unload (plugin);
+        return NULL;
+    }
 
-    g_free (full_path);
-    g_free (filename);
+    return plugin;
+}
+
+static gboolean
+n_core_open_plugin_cb (gpointer userdata)
+{
+    NCorePluginEntry *entry = (NCorePluginEntry*) userdata;
+
+    /* only opens the module, safe to run on a worker thread. */
+
+    entry->plugin = n_core_open_plugin (entry->core, entry->name);
+    if (entry->plugin)
+        entry->threaded = entry->plugin->get_startup_depends ? TRUE : FALSE;
+
+    return entry->plugin ? TRUE : FALSE;
+}
+
+static gboolean
+n_core_load_plugin_cb (gpointer userdata)
+{
+    NCorePluginEntry *entry = (NCorePluginEntry*) userdata;
+
+    return n_core_start_plugin (entry->core, entry->plugin, entry->name);
+}
+
+static gboolean
+n_core_initialize_sink_cb (gpointer userdata)
+{
+    NSinkInterface *sink = (NSinkInterface*) userdata;
+
+    if (sink->funcs.initialize && !sink->funcs.initialize (sink)) {
+        N_ERROR (LOG_CAT "sink '%s' failed to initialize", sink->name);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static NCorePluginEntry*
+n_core_find_plugin_entry (GList *entries, const char *name, NPlugin *plugin)
+{
+    NCorePluginEntry *entry = NULL;
+    GList            *iter  = NULL;
+
+    for (iter = g_list_first (entries); iter; iter = g_list_next (iter)) {
+        entry = (NCorePluginEntry*) iter->data;
+
+        if (name && g_str_equal (entry->name, name))
+            return entry;
+
+        if (plugin && entry->plugin == plugin)
+            return entry;
+    }
 
     return NULL;
 }
 
 static void
+n_core_add_startup_depends (GList *entries, NCorePluginEntry *entry,
+                            NStartupTask *task, gboolean init)
+{
+    NCorePluginEntry  *dep_entry = NULL;
+    GList             *iter      = NULL;
+    gchar            **depends   = NULL;
+    gchar            **item      = NULL;
+
+    depends = g_strsplit (entry->plugin->get_startup_depends (), " ", -1);
+
+    for (item = depends; *item; ++item) {
+        if (**item == '\0')
+            continue;
+
+        dep_entry = n_core_find_plugin_entry (entries, *item, NULL);
+        if (!dep_entry) {
+            N_WARNING (LOG_CAT "plugin '%s' depends on '%s', which is not loaded",
+                entry->name, *item);
+            continue;
+        }
+
+        if (!init) {
+            n_startup_task_depends_on (task, dep_entry->load_task);
+            continue;
+        }
+
+        for (iter = g_list_first (dep_entry->init_tasks); iter; iter = g_list_next (iter))
+            n_startup_task_depends_on (task, (NStartupTask*) iter->data);
+    }
+
+    g_strfreev (depends);
+}
+
+static int
+n_core_load_plugins (NCore *core, GList *entries)
+{
+    NCorePluginEntry *entry      = NULL;
+    NStartup         *startup    = NULL;
+    GList            *iter       = NULL;
+    GList            *open_tasks = NULL;
+    GList            *task_iter  = NULL;
+    guint             flags      = 0;
+    int               result     = TRUE;
+
+    /* open all modules in parallel first. the module tells if it can be
+       loaded off the main thread. */
+
+    startup = n_startup_new (core->startup_threads);
+    for (iter = g_list_first (entries); iter; iter = g_list_next (iter)) {
+        entry = (NCorePluginEntry*) iter->data;
+        flags = N_STARTUP_TASK_THREADED | (entry->required ? N_STARTUP_TASK_REQUIRED : 0);
+        open_tasks = g_list_append (open_tasks, n_startup_add_task (startup,
+            entry->name, flags, n_core_open_plugin_cb, entry));
+    }
+
+    (void) n_startup_run (startup);
+
+    for (iter = g_list_first (entries), task_iter = g_list_first (open_tasks);
+         iter && task_iter; iter = g_list_next (iter), task_iter = g_list_next (task_iter))
+    {
+        entry = (NCorePluginEntry*) iter->data;
+        entry->open_time = n_startup_task_get_duration ((NStartupTask*) task_iter->data);
+    }
+
+    g_list_free (open_tasks);
+    n_startup_free (startup);
+
+    /* load the plugins. plugins without declared dependencies are loaded
+       on this thread in the configured order. */
+
+    startup = n_startup_new (core->startup_threads);
+    for (iter = g_list_first (entries); iter; iter = g_list_next (iter)) {
+        entry = (NCorePluginEntry*) iter->data;
+        if (!entry->plugin) {
+            if (entry->required)
+                N_ERROR (LOG_CAT "unable to load plugin '%s'", entry->name);
+            continue;
+        }
+
+        flags = (entry->threaded ? N_STARTUP_TASK_THREADED : 0) |
+                (entry->required ? N_STARTUP_TASK_REQUIRED : 0);
+        entry->load_task = n_startup_add_task (startup, entry->name, flags,
+            n_core_load_plugin_cb, entry);
+    }
+
+    for (iter = g_list_first (entries); iter; iter = g_list_next (iter)) {
+        entry = (NCorePluginEntry*) iter->data;
+        if (entry->load_task && entry->threaded)
+            n_core_add_startup_depends (entries, entry, entry->load_task, FALSE);
+    }
+
+    (void) n_startup_run (startup);
+
+    for (iter = g_list_first (entries); iter; iter = g_list_next (iter)) {
+        entry = (NCorePluginEntry*) iter->data;
+
+        if (n_startup_task_succeeded (entry->load_task)) {
+            entry->load_time = n_startup_task_get_duration (entry->load_task);
+            core->plugins = g_list_append (core->plugins, entry->plugin);
+        }
+        else {
+            if (entry->plugin) {
+                if (entry->required)
+                    N_ERROR (LOG_CAT "unable to load plugin '%s'", entry->name);
+                n_plugin_unload (entry->plugin);
+                entry->plugin = NULL;
+            }
+
+            if (entry->required)
+                result = FALSE;
+            else
+                N_INFO (LOG_CAT "optional plugin %s not loaded.", entry->name);
+        }
+
+        entry->load_task = NULL;
+    }
+
+    n_startup_free (startup);
+
+    return result;
+}
+
+static int
+n_core_initialize_sinks (NCore *core, GList *entries)
+{
+    NCorePluginEntry  *entry   = NULL;
+    NStartup          *startup = NULL;
+    NStartupTask      *task    = NULL;
+    NSinkInterface   **sink    = NULL;
+    GList             *iter    = NULL;
+    GList             *tasks   = NULL;
+    GList             *task_iter = NULL;
+    guint              flags   = 0;
+    int                result  = FALSE;
+
+    startup = n_startup_new (core->startup_threads);
+
+    for (sink = core->sinks; *sink; ++sink) {
+        entry = n_core_find_plugin_entry (entries, NULL, (*sink)->plugin);
+        flags = N_STARTUP_TASK_REQUIRED |
+            ((entry && entry->threaded) ? N_STARTUP_TASK_THREADED : 0);
+
+        task = n_startup_add_task (startup, (*sink)->name, flags,
+            n_core_initialize_sink_cb, *sink);
+
+        tasks = g_list_append (tasks, task);
+        if (entry)
+            entry->init_tasks = g_list_append (entry->init_tasks, task);
+    }
+
+    for (iter = g_list_first (entries); iter; iter = g_list_next (iter)) {
+        entry = (NCorePluginEntry*) iter->data;
+        if (!entry->plugin || !entry->threaded)
+            continue;
+
+        for (task_iter = g_list_first (entry->init_tasks); task_iter; task_iter = g_list_next (task_iter))
+            n_core_add_startup_depends (entries, entry, (NStartupTask*) task_iter->data, TRUE);
+    }
+
+    result = n_startup_run (startup);
+
+    for (iter = g_list_first (entries); iter; iter = g_list_next (iter)) {
+        entry = (NCorePluginEntry*) iter->data;
+
+        for (task_iter = g_list_first (entry->init_tasks); task_iter; task_iter = g_list_next (task_iter))
+            entry->init_time += n_startup_task_get_duration ((NStartupTask*) task_iter->data);
+
+        g_list_free (entry->init_tasks);
+        entry->init_tasks = NULL;
+    }
+
+    g_list_free (tasks);
+    n_startup_free (startup);
+
+    return result;
+}
+
+static void
+n_core_order_interfaces (NCore *core, GList *entries)
+{
+    NCorePluginEntry  *entry  = NULL;
+    NSinkInterface   **sinks  = NULL;
+    NInputInterface  **inputs = NULL;
+    GList             *iter   = NULL;
+    guint              n, i;
+
+    /* plugins loaded on worker threads register their interfaces in any
+       order, keep the order of the configuration. interfaces registered
+       without a plugin go last. */
+
+    if (core->sinks) {
+        sinks = g_new0 (NSinkInterface*, core->num_sinks + 1);
+        n = 0;
+
+        for (iter = g_list_first (entries); iter; iter = g_list_next (iter)) {
+            entry = (NCorePluginEntry*) iter->data;
+            for (i = 0; i < core->num_sinks; ++i) {
+                if (entry->plugin && core->sinks[i]->plugin == entry->plugin)
+                    sinks[n++] = core->sinks[i];
+            }
+        }
+
+        for (i = 0; i < core->num_sinks; ++i) {
+            if (!n_core_find_plugin_entry (entries, NULL, core->sinks[i]->plugin))
+                sinks[n++] = core->sinks[i];
+        }
+
+        g_free (core->sinks);
+        core->sinks = sinks;
+    }
+
+    if (core->inputs) {
+        inputs = g_new0 (NInputInterface*, core->num_inputs + 1);
+        n = 0;
+
+        for (iter = g_list_first (entries); iter; iter = g_list_next (iter)) {
+            entry = (NCorePluginEntry*) iter->data;
+            for (i = 0; i < core->num_inputs; ++i) {
+                if (entry->plugin && core->inputs[i]->plugin == entry->plugin)
+                    inputs[n++] = core->inputs[i];
+            }
+        }
+
+        for (i = 0; i < core->num_inputs; ++i) {
+            if (!n_core_find_plugin_entry (entries, NULL, core->inputs[i]->plugin))
+                inputs[n++] = core->inputs[i];
+        }
+
+        g_free (core->inputs);
+        core->inputs = inputs;
+    }
+}
+
+static void
+n_core_report_startup (GList *entries, gint64 started)
+{
+    NCorePluginEntry *entry = NULL;
+    GList            *iter  = NULL;
+
+    for (iter = g_list_first (entries); iter; iter = g_list_next (iter)) {
+        entry = (NCorePluginEntry*) iter->data;
+
+        N_INFO (LOG_CAT "startup: %-14s open %7.1f ms, load %7.1f ms, init %7.1f ms%s",
+            entry->name, entry->open_time / 1000.0, entry->load_time / 1000.0,
+            entry->init_time / 1000.0, entry->threaded ? " (threaded)" : "");
+    }
+
+    N_INFO (LOG_CAT "startup: plugins ready in %.1f ms",
+        (g_get_monotonic_time () - started) / 1000.0);
+}
+
+void
 n_core_unload_plugin (NCore *core, NPlugin *plugin)
 {
     g_assert (core != NULL);
@@ -197,7 +590,8 @@ n_core_unload_plugin (NCore *core, NPlugin *plugin)
 NCore*
 n_core_new (int *argc, char **argv)
 {
-    NCore *core = NULL;
+    NCore *core       = NULL;
+    gchar *cache_path = NULL;
 
     (void) argc;
     (void) argv;
@@ -210,12 +604,36 @@ n_core_new (int *argc, char **argv)
     core->plugin_path = n_core_get_path ("NGF_PLUGIN_PATH", DEFAULT_PLUGIN_PATH);
     core->context     = n_context_new ();
 
+    /* daemon runs in the user session, keep the compiled configuration
+       in the user cache directory by default. */
+
+    cache_path       = g_build_filename (g_get_user_cache_dir (), CACHE_DIRNAME, NULL);
+    core->cache_path = n_core_get_path ("NGF_CACHE_PATH", cache_path);
+    g_free (cache_path);
+
     core->event_table = g_hash_table_new_full (g_str_hash, g_str_equal,
         g_free, NULL);
 
+    core->event_matchers = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, (GDestroyNotify) n_event_matcher_free);
+
     core->key_types = g_hash_table_new_full (g_str_hash, g_str_equal,
         g_free, NULL);
 
+    core->plugin_params = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, (GDestroyNotify) n_proplist_free);
+
+    core->requests        = n_request_registry_new ();
+    core->request_cache   = n_request_cache_new (N_REQUEST_CACHE_DEFAULT_SIZE);
+    core->admission       = n_request_admission_new ();
+    core->scheduler       = n_request_scheduler_new ();
+    core->startup_threads = N_CORE_DEFAULT_STARTUP_THREADS;
+    core->lazy_unload_timeout = N_CORE_DEFAULT_LAZY_UNLOAD_TIMEOUT;
+    core->trace_file      = g_build_filename (g_get_tmp_dir (), N_CORE_DEFAULT_TRACE_FILE, NULL);
+    core->record_level    = n_log_get_record_level ();
+
+    g_mutex_init (&core->lock);
+
     return core;
 }
 
@@ -231,7 +649,7 @@ n_core_free_event_list_cb (gpointer in_key, gpointer in_data, gpointer userdata)
 
     for (iter = g_list_first (event_list); iter; iter = g_list_next (iter)) {
         event = (NEvent*) iter->data;
-        n_event_free (event);
+        n_event_unref (event);
     }
 
     g_list_free (event_list);
@@ -242,6 +660,8 @@ n_core_free (NCore *core)
 {
     g_assert (core != NULL);
 
+    int hook = 0;
+
     if (!core->shutdown_done)
         n_core_shutdown (core);
 
@@ -250,19 +670,35 @@ n_core_free (NCore *core)
         g_list_free (core->sink_order);
     }
 
-    g_hash_table_destroy (core->key_types);
+    g_list_foreach (core->lazy_plugins, (GFunc) n_lazy_plugin_free, NULL);
+    g_list_free (core->lazy_plugins);
 
+    g_hash_table_destroy (core->key_types);
+    g_hash_table_destroy (core->plugin_params);
+    n_request_cache_free (core->request_cache);
+    n_request_admission_free (core->admission);
+    n_request_scheduler_free (core->scheduler);
+    n_request_registry_free (core->requests);
+    n_trace_log_free (core->trace_log);
+
+    g_hash_table_destroy (core->event_matchers);
     g_list_free          (core->event_list);
     g_hash_table_foreach (core->event_table, n_core_free_event_list_cb, NULL);
     g_hash_table_destroy (core->event_table);
 
+    for (hook = 0; hook < N_CORE_HOOK_LAST; ++hook)
+        g_free (core->hooks[hook].name);
+
     n_context_free (core->context);
+    g_mutex_clear (&core->lock);
+    g_free (core->trace_file);
+    g_free (core->cache_path);
     g_free (core->plugin_path);
     g_free (core->conf_path);
     g_free (core);
 }
 
-static void
+void
 n_core_set_sink_priorities (NSinkInterface **sink_list, GList *sink_order)
 {
     NSinkInterface **sink = NULL;
@@ -299,22 +735,30 @@ n_core_initialize (NCore *core)
     g_assert (core->conf_path != NULL);
     g_assert (core->plugin_path != NULL);
 
-    NSinkInterface  **sink   = NULL;
-    NInputInterface **input  = NULL;
-    NPlugin          *plugin = NULL;
-    GList            *p      = NULL;
+    NInputInterface  **input   = NULL;
+    NCorePluginEntry  *entry   = NULL;
+    GList             *entries = NULL;
+    GList             *p       = NULL;
+    gint64             started = 0;
+    int                result  = FALSE;
+    int                hook    = 0;
+
+    started = g_get_monotonic_time ();
 
     /* setup hooks */
 
-    n_hook_init (&core->hooks[N_CORE_HOOK_INIT_DONE]);
-    n_hook_init (&core->hooks[N_CORE_HOOK_TRANSFORM_PROPERTIES]);
-    n_hook_init (&core->hooks[N_CORE_HOOK_FILTER_SINKS]);
+    for (hook = 0; hook < N_CORE_HOOK_LAST; ++hook) {
+        n_hook_init (&core->hooks[hook]);
+        core->hooks[hook].name = g_strdup (n_core_hook_to_string (hook));
+    }
 
-    /* load the default configuration. */
+    /* load the default configuration, events and plugin parameters. */
 
-    if (!n_core_parse_configuration (core))
+    if (!n_core_load_configuration (core))
         goto failed_init;
 
+    core->trace_log = n_trace_log_new (core->trace_requests);
+
     /* check for required plugins. */
 
     if (!core->required_plugins && !core->optional_plugins) {
@@ -322,30 +766,32 @@ n_core_initialize (NCore *core)
         goto failed_init;
     }
 
-    /* load events from the given event path. */
-
-    if (!n_core_parse_events (core))
-        goto failed_init;
-
-    /* load all plugins */
+    /* load all plugins, first mandatory plugins and then optional
+       plugins. */
 
-    /* first mandatory plugins */
     for (p = g_list_first (core->required_plugins); p; p = g_list_next (p)) {
-        if (!(plugin = n_core_load_plugin (core, (const char*) p->data)))
-            goto failed_init;
-
-        core->plugins = g_list_append (core->plugins, plugin);
+        entry = g_new0 (NCorePluginEntry, 1);
+        entry->core     = core;
+        entry->name     = (const char*) p->data;
+        entry->required = TRUE;
+        entries = g_list_append (entries, entry);
     }
 
-    /* then optional plugins */
     for (p = g_list_first (core->optional_plugins); p; p = g_list_next (p)) {
-        if ((plugin = n_core_load_plugin (core, (const char*) p->data)))
-            core->plugins = g_list_append (core->plugins, plugin);
+        if (n_core_is_lazy_plugin (core, (const char*) p->data))
+            continue;
 
-        if (!plugin)
-            N_INFO (LOG_CAT "optional plugin %s not loaded.", p->data);
+        entry = g_new0 (NCorePluginEntry, 1);
+        entry->core = core;
+        entry->name = (const char*) p->data;
+        entries = g_list_append (entries, entry);
     }
 
+    if (!n_core_load_plugins (core, entries))
+        goto failed_init;
+
+    n_core_order_interfaces (core, entries);
+
     /* setup the sink priorities based on the sink-order */
 
     n_core_set_sink_priorities (core->sinks, core->sink_order);
@@ -357,12 +803,8 @@ n_core_initialize (NCore *core)
         goto failed_init;
     }
 
-    for (sink = core->sinks; *sink; ++sink) {
-        if ((*sink)->funcs.initialize && !(*sink)->funcs.initialize (*sink)) {
-            N_ERROR (LOG_CAT "sink '%s' failed to initialize", (*sink)->name);
-            goto failed_init;
-        }
-    }
+    if (!n_core_initialize_sinks (core, entries))
+        goto failed_init;
 
     /* initialize all inputs. */
 
@@ -378,14 +820,25 @@ n_core_initialize (NCore *core)
         }
     }
 
-    /* fire the init done hook. */
+    n_core_report_startup (entries, started);
+
+    /* pick up changes to the event files from now on. */
+
+    core->event_reload = n_event_reload_new (core);
+    (void) n_event_reload_watch (core->event_reload);
+
+    /* everything is up, fire the init done hook. */
 
     n_core_fire_hook (core, N_CORE_HOOK_INIT_DONE, NULL);
+    core->init_done = TRUE;
 
-    return TRUE;
+    result = TRUE;
 
 failed_init:
-    return FALSE;
+    g_list_foreach (entries, (GFunc) g_free, NULL);
+    g_list_free (entries);
+
+    return result;
 }
 
 static void
@@ -404,6 +857,16 @@ n_core_shutdown (NCore *core)
     NInputInterface **input = NULL;
     NSinkInterface  **sink  = NULL;
 
+    /* stop reloading events, the plugins are about to go. */
+
+    n_event_reload_free (core->event_reload);
+    core->event_reload = NULL;
+
+    /* unload the optional plugins loaded on demand first, they will not
+       be loaded again. */
+
+    g_list_foreach (core->lazy_plugins, (GFunc) n_lazy_plugin_unload, NULL);
+
     /* shutdown all inputs */
 
     if (core->inputs) {
@@ -440,10 +903,17 @@ n_core_shutdown (NCore *core)
         core->optional_plugins = NULL;
     }
 
+    N_DEBUG (LOG_CAT "request cache: %u hits, %u misses",
+        n_request_cache_get_hits (core->request_cache),
+        n_request_cache_get_misses (core->request_cache));
+    N_DEBUG (LOG_CAT "admission: %u dropped, %u coalesced",
+        n_request_admission_get_dropped (core->admission),
+        n_request_admission_get_coalesced (core->admission));
+
     core->shutdown_done = TRUE;
 }
 
-void
+NSinkInterface*
 n_core_register_sink (NCore *core, const NSinkInterfaceDecl *iface)
 {
     g_assert (core != NULL);
@@ -457,6 +927,10 @@ n_core_register_sink (NCore *core, const NSinkInterfaceDecl *iface)
     sink->core  = core;
     sink->funcs = *iface;
 
+    /* plugins may be loaded on startup worker threads. */
+
+    g_mutex_lock (&core->lock);
+
     core->num_sinks++;
     core->sinks = (NSinkInterface**) g_realloc (core->sinks,
         sizeof (NSinkInterface*) * (core->num_sinks + 1));
@@ -464,10 +938,39 @@ n_core_register_sink (NCore *core, const NSinkInterfaceDecl *iface)
     core->sinks[core->num_sinks-1] = sink;
     core->sinks[core->num_sinks]   = NULL;
 
+    g_mutex_unlock (&core->lock);
+
     N_DEBUG (LOG_CAT "sink interface '%s' registered", sink->name);
+
+    return sink;
 }
 
 void
+n_core_unregister_sink (NCore *core, NSinkInterface *sink)
+{
+    guint i;
+
+    g_assert (core != NULL);
+    g_assert (sink != NULL);
+
+    g_mutex_lock (&core->lock);
+
+    for (i = 0; i < core->num_sinks; ++i) {
+        if (core->sinks[i] != sink)
+            continue;
+
+        memmove (&core->sinks[i], &core->sinks[i + 1],
+            sizeof (NSinkInterface*) * (core->num_sinks - i));
+        core->num_sinks--;
+        break;
+    }
+
+    g_mutex_unlock (&core->lock);
+
+    N_DEBUG (LOG_CAT "sink interface '%s' unregistered", sink->name);
+}
+
+NInputInterface*
 n_core_register_input (NCore *core, const NInputInterfaceDecl *iface)
 {
     NInputInterface *input = NULL;
@@ -480,6 +983,8 @@ n_core_register_input (NCore *core, const NInputInterfaceDecl *iface)
     input->core  = core;
     input->funcs = *iface;
 
+    g_mutex_lock (&core->lock);
+
     core->num_inputs++;
     core->inputs = (NInputInterface**) g_realloc (core->inputs,
         sizeof (NInputInterface*) * (core->num_inputs + 1));
@@ -487,10 +992,14 @@ n_core_register_input (NCore *core, const NInputInterfaceDecl *iface)
     core->inputs[core->num_inputs-1] = input;
     core->inputs[core->num_inputs]   = NULL;
 
+    g_mutex_unlock (&core->lock);
+
     N_DEBUG (LOG_CAT "input interface '%s' registered", input->name);
+
+    return input;
 }
 
-static gint
+gint
 n_core_sort_event_cb (gconstpointer a, gconstpointer b)
 {
     const NEvent *ea = (const NEvent*) a;
@@ -507,13 +1016,11 @@ n_core_dump_value_cb (const char *key, const NValue *value, gpointer userdata)
 {
     (void) userdata;
 
-    gchar *value_str = n_value_to_string ((NValue*) value);
-    N_DEBUG (LOG_CAT "+ %s = %s", key, value_str);
-    g_free (value_str);
+    n_value_log_debug (LOG_CAT "+ ", key, value);
 }
 
-void
-n_core_add_event (NCore *core, NEvent *event)
+static void
+n_core_insert_event (NCore *core, NEvent *event)
 {
     g_assert (core != NULL);
     g_assert (event != NULL);
@@ -546,7 +1053,8 @@ n_core_add_event (NCore *core, NEvent *event)
         }
     }
 
-    /* completely new event, add it to the list and sort it. */
+    /* completely new event, add it to the list. the list is sorted by
+       the caller. */
 
     N_DEBUG (LOG_CAT "new event '%s'", event->name);
     if (n_proplist_size (event->rules) > 0)
@@ -558,34 +1066,84 @@ n_core_add_event (NCore *core, NEvent *event)
     n_proplist_foreach (event->properties, n_core_dump_value_cb, NULL);
 
     event_list = g_list_append (event_list, event);
-    event_list = g_list_sort (event_list, n_core_sort_event_cb);
     g_hash_table_replace (core->event_table, g_strdup (event->name), event_list);
 
     core->event_list = g_list_append (core->event_list, event);
 }
 
-static void
-n_core_parse_events_from_file (NCore *core, const char *filename)
+void
+n_core_add_event (NCore *core, NEvent *event)
 {
     g_assert (core != NULL);
-    g_assert (filename != NULL);
+    g_assert (event != NULL);
 
-    GKeyFile  *keyfile    = NULL;
-    GError    *error      = NULL;
-    gchar    **group_list = NULL;
-    gchar    **group      = NULL;
-    NEvent    *event      = NULL;
+    GList *event_list = NULL;
+    gchar *name       = NULL;
 
-    keyfile = g_key_file_new ();
-    if (!g_key_file_load_from_file (keyfile, filename, G_KEY_FILE_NONE, &error)) {
-        N_WARNING (LOG_CAT "failed to load event file: %s", error->message);
-        g_error_free    (error);
-        g_key_file_free (keyfile);
-        return;
-    }
+    name = g_strdup (event->name);
+    n_core_insert_event (core, event);
 
-    /* each unique group is considered as an event, even if split within
-       separate files. */
+    event_list = g_hash_table_lookup (core->event_table, name);
+    event_list = g_list_sort (event_list, n_core_sort_event_cb);
+    g_hash_table_replace (core->event_table, name, event_list);
+
+    /* rules for this event name changed, compiled matcher is no longer
+       valid. */
+
+    g_hash_table_remove (core->event_matchers, name);
+    n_request_cache_clear (core->request_cache);
+    n_request_admission_invalidate (core->admission);
+}
+
+static void
+n_core_prepare_events (NCore *core)
+{
+    GList      *names      = NULL;
+    GList      *iter       = NULL;
+    GList      *event_list = NULL;
+    const char *name       = NULL;
+
+    /* events were added in bulk, sort each list once and compile the
+       rules for all events now instead of on the first request. */
+
+    names = g_hash_table_get_keys (core->event_table);
+    for (iter = g_list_first (names); iter; iter = g_list_next (iter)) {
+        name       = (const char*) iter->data;
+        event_list = (GList*) g_hash_table_lookup (core->event_table, name);
+        event_list = g_list_sort (event_list, n_core_sort_event_cb);
+
+        g_hash_table_replace (core->event_matchers, g_strdup (name),
+            n_event_matcher_new (event_list));
+        g_hash_table_insert (core->event_table, g_strdup (name), event_list);
+    }
+
+    g_list_free (names);
+    n_request_cache_clear (core->request_cache);
+    n_request_admission_invalidate (core->admission);
+}
+
+static void
+n_core_parse_events_from_file (NCore *core, const char *filename)
+{
+    g_assert (core != NULL);
+    g_assert (filename != NULL);
+
+    GKeyFile  *keyfile    = NULL;
+    GError    *error      = NULL;
+    gchar    **group_list = NULL;
+    gchar    **group      = NULL;
+    NEvent    *event      = NULL;
+
+    keyfile = g_key_file_new ();
+    if (!g_key_file_load_from_file (keyfile, filename, G_KEY_FILE_NONE, &error)) {
+        N_WARNING (LOG_CAT "failed to load event file: %s", error->message);
+        g_error_free    (error);
+        g_key_file_free (keyfile);
+        return;
+    }
+
+    /* each unique group is considered as an event, even if split within
+       separate files. */
 
     N_DEBUG (LOG_CAT "processing event file '%s'", filename);
 
@@ -593,24 +1151,26 @@ n_core_parse_events_from_file (NCore *core, const char *filename)
     for (group = group_list; *group; ++group) {
         event = n_event_new_from_group (core, keyfile, *group);
         if (event)
-            n_core_add_event (core, event);
+            n_core_insert_event (core, event);
     }
 
     g_strfreev      (group_list);
     g_key_file_free (keyfile);
 }
 
-static int
-n_core_parse_events (NCore *core)
+gboolean
+n_core_list_event_files (NCore *core, GList **filenames)
 {
     gchar         *path       = NULL;
     DIR           *parent_dir = NULL;
     struct dirent *walk       = NULL;
-    gchar         *filename   = NULL;
 
-    /* find all the events within the given path */
+    /* find all the event files within the given path. files are returned
+       sorted, so that events split to several files are always merged
+       in the same order. */
 
     path = g_build_filename (core->conf_path, EVENT_CONF_PATH, NULL);
+
     parent_dir = opendir (path);
     if (!parent_dir) {
         N_ERROR (LOG_CAT "failed to open event path '%s'", path);
@@ -619,20 +1179,44 @@ n_core_parse_events (NCore *core)
     }
 
     while ((walk = readdir (parent_dir)) != NULL) {
-        if (walk->d_type & DT_REG) {
-            filename = g_build_filename (path, walk->d_name, NULL);
-            n_core_parse_events_from_file (core, filename);
-            g_free (filename);
-        }
+        if (walk->d_type & DT_REG)
+            *filenames = g_list_prepend (*filenames, g_build_filename (path, walk->d_name, NULL));
     }
 
+    *filenames = g_list_sort (*filenames, (GCompareFunc) g_strcmp0);
+
     closedir (parent_dir);
     g_free   (path);
 
     return TRUE;
 }
 
-static void
+static int
+n_core_parse_events (NCore *core)
+{
+    GList *filenames = NULL;
+    GList *iter      = NULL;
+    gchar *path      = NULL;
+
+    path = g_build_filename (core->conf_path, EVENT_CONF_PATH, NULL);
+    n_core_track_source (core, path);
+    g_free (path);
+
+    if (!n_core_list_event_files (core, &filenames))
+        return FALSE;
+
+    for (iter = g_list_first (filenames); iter; iter = g_list_next (iter)) {
+        n_core_track_source (core, (const char*) iter->data);
+        n_core_parse_events_from_file (core, (const char*) iter->data);
+    }
+
+    g_list_foreach (filenames, (GFunc) g_free, NULL);
+    g_list_free (filenames);
+
+    return TRUE;
+}
+
+void
 n_core_parse_keytypes (NCore *core, GKeyFile *keyfile)
 {
     g_assert (core != NULL);
@@ -702,6 +1286,285 @@ n_core_parse_sink_order (NCore *core, GKeyFile *keyfile)
     g_strfreev (sink_list);
 }
 
+static void
+n_core_parse_cache_size (NCore *core, GKeyFile *keyfile)
+{
+    g_assert (core != NULL);
+    g_assert (keyfile != NULL);
+
+    GError *error = NULL;
+    gint    size  = 0;
+
+    size = g_key_file_get_integer (keyfile, "general", "request-cache-size", &error);
+    if (error) {
+        g_error_free (error);
+        return;
+    }
+
+    if (size < 0) {
+        N_WARNING (LOG_CAT "invalid request-cache-size %d, using default.", size);
+        return;
+    }
+
+    N_DEBUG (LOG_CAT "request cache size %d", size);
+    n_request_cache_set_max_entries (core->request_cache, (guint) size);
+}
+
+static void
+n_core_parse_startup_threads (NCore *core, GKeyFile *keyfile)
+{
+    g_assert (core != NULL);
+    g_assert (keyfile != NULL);
+
+    GError *error   = NULL;
+    gint    threads = 0;
+
+    threads = g_key_file_get_integer (keyfile, "general", "startup-threads", &error);
+    if (error) {
+        g_error_free (error);
+        return;
+    }
+
+    if (threads < 0) {
+        N_WARNING (LOG_CAT "invalid startup-threads %d, using default.", threads);
+        return;
+    }
+
+    N_DEBUG (LOG_CAT "startup threads %d", threads);
+    core->startup_threads = (guint) threads;
+}
+
+static gboolean
+n_core_is_lazy_plugin (NCore *core, const char *plugin_name)
+{
+    GList *iter = NULL;
+
+    for (iter = g_list_first (core->lazy_plugins); iter; iter = g_list_next (iter)) {
+        if (g_str_equal (n_lazy_plugin_get_name ((NLazyPlugin*) iter->data), plugin_name))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static void
+n_core_parse_lazy_plugins (NCore *core, GKeyFile *keyfile)
+{
+    g_assert (core != NULL);
+    g_assert (keyfile != NULL);
+
+    NLazyPlugin  *lazy     = NULL;
+    GError       *error    = NULL;
+    gchar       **names    = NULL;
+    gchar       **name     = NULL;
+    gchar       **prefixes = NULL;
+    gchar       **prefix   = NULL;
+    gint          timeout  = 0;
+
+    timeout = g_key_file_get_integer (keyfile, "general", "lazy-unload-timeout", &error);
+    if (error) {
+        g_error_free (error);
+        error = NULL;
+    }
+    else if (timeout < 0) {
+        N_WARNING (LOG_CAT "invalid lazy-unload-timeout %d, using default.", timeout);
+    }
+    else {
+        core->lazy_unload_timeout = (guint) timeout;
+    }
+
+    /* each key is an optional plugin, the value lists the request property
+       prefixes that the plugin handles. */
+
+    if (!(names = g_key_file_get_keys (keyfile, "lazy-plugins", NULL, NULL)))
+        return;
+
+    for (name = names; *name; ++name) {
+        if (!g_list_find_custom (core->optional_plugins, *name, (GCompareFunc) g_strcmp0)) {
+            N_WARNING (LOG_CAT "lazy plugin '%s' is not an optional plugin, ignoring.", *name);
+            continue;
+        }
+
+        prefixes = g_key_file_get_string_list (keyfile, "lazy-plugins", *name, NULL, NULL);
+        if (!prefixes)
+            continue;
+
+        lazy = n_lazy_plugin_new (core, *name);
+        for (prefix = prefixes; *prefix; ++prefix) {
+            g_strstrip (*prefix);
+            if (**prefix != '\0')
+                n_lazy_plugin_add_prefix (lazy, *prefix);
+        }
+
+        N_DEBUG (LOG_CAT "optional plugin '%s' is loaded on demand", *name);
+        core->lazy_plugins = g_list_append (core->lazy_plugins, lazy);
+
+        g_strfreev (prefixes);
+    }
+
+    g_strfreev (names);
+}
+
+static void
+n_core_parse_tracing (NCore *core, GKeyFile *keyfile)
+{
+    g_assert (core != NULL);
+    g_assert (keyfile != NULL);
+
+    GError *error    = NULL;
+    gchar  *filename = NULL;
+    gint    requests = 0;
+
+    requests = g_key_file_get_integer (keyfile, "general", "trace-requests", &error);
+    if (error) {
+        g_error_free (error);
+        error = NULL;
+    }
+    else if (requests < 0) {
+        N_WARNING (LOG_CAT "invalid trace-requests %d, tracing disabled.", requests);
+    }
+    else {
+        N_DEBUG (LOG_CAT "keeping timelines of %d requests", requests);
+        core->trace_requests = (guint) requests;
+    }
+
+    filename = g_key_file_get_string (keyfile, "general", "trace-file", NULL);
+    if (filename && *filename != '\0') {
+        g_free (core->trace_file);
+        core->trace_file = filename;
+    }
+    else
+        g_free (filename);
+}
+
+static void
+n_core_parse_hook_budget (NCore *core, GKeyFile *keyfile)
+{
+    g_assert (core != NULL);
+    g_assert (keyfile != NULL);
+
+    GError *error  = NULL;
+    gint    budget = 0;
+
+    budget = g_key_file_get_integer (keyfile, "general", "hook-budget", &error);
+    if (error) {
+        g_error_free (error);
+        error = NULL;
+    }
+    else if (budget < 0) {
+        N_WARNING (LOG_CAT "invalid hook-budget %d, no budget set.", budget);
+    }
+    else {
+        N_DEBUG (LOG_CAT "hook callbacks have a budget of %d us", budget);
+        core->hook_budget = (guint) budget;
+    }
+}
+
+static void
+n_core_parse_scheduler (NCore *core, GKeyFile *keyfile)
+{
+    g_assert (core != NULL);
+    g_assert (keyfile != NULL);
+
+    GError  *error   = NULL;
+    gchar  **sinks   = NULL;
+    gchar  **sink    = NULL;
+    gint     value   = 0;
+
+    value = g_key_file_get_integer (keyfile, "general", "max-queued", &error);
+    if (error) {
+        g_error_free (error);
+        error = NULL;
+    }
+    else if (value < 0) {
+        N_WARNING (LOG_CAT "invalid max-queued %d, using default.", value);
+    }
+    else {
+        n_request_scheduler_set_max_queued (core->scheduler, (guint) value);
+    }
+
+    value = g_key_file_get_integer (keyfile, "general", "queue-timeout", &error);
+    if (error) {
+        g_error_free (error);
+        error = NULL;
+    }
+    else if (value < 0) {
+        N_WARNING (LOG_CAT "invalid queue-timeout %d, using default.", value);
+    }
+    else {
+        n_request_scheduler_set_queue_timeout (core->scheduler, (guint) value);
+    }
+
+    /* each key is a sink name, the value the number of requests that may
+       play on it at once. */
+
+    if (!(sinks = g_key_file_get_keys (keyfile, "sink-limits", NULL, NULL)))
+        return;
+
+    for (sink = sinks; *sink; ++sink) {
+        value = g_key_file_get_integer (keyfile, "sink-limits", *sink, &error);
+        if (error) {
+            N_WARNING (LOG_CAT "invalid limit for sink '%s': %s", *sink, error->message);
+            g_error_free (error);
+            error = NULL;
+            continue;
+        }
+
+        if (value <= 0) {
+            N_WARNING (LOG_CAT "invalid limit %d for sink '%s', ignoring.", value, *sink);
+            continue;
+        }
+
+        N_DEBUG (LOG_CAT "sink '%s' plays at most %d requests at once", *sink, value);
+        n_request_scheduler_set_sink_limit (core->scheduler, *sink, (guint) value);
+    }
+
+    g_strfreev (sinks);
+}
+
+static void
+n_core_parse_record_level (NCore *core, GKeyFile *keyfile)
+{
+    g_assert (core != NULL);
+    g_assert (keyfile != NULL);
+
+    static const struct {
+        const char *name;
+        NLogLevel   level;
+    } levels[] = {
+        { "enter",   N_LOG_LEVEL_ENTER   },
+        { "debug",   N_LOG_LEVEL_DEBUG   },
+        { "info",    N_LOG_LEVEL_INFO    },
+        { "warning", N_LOG_LEVEL_WARNING },
+        { "error",   N_LOG_LEVEL_ERROR   },
+        { "none",    N_LOG_LEVEL_NONE    }
+    };
+
+    gchar *value = NULL;
+    guint  i;
+
+    if ((value = g_key_file_get_string (keyfile, "general", "record-level", NULL)) == NULL)
+        return;
+
+    g_strstrip (value);
+
+    for (i = 0; i < G_N_ELEMENTS (levels); ++i) {
+        if (g_ascii_strcasecmp (value, levels[i].name) == 0)
+            break;
+    }
+
+    if (i == G_N_ELEMENTS (levels)) {
+        N_WARNING (LOG_CAT "invalid record-level '%s', using default.", value);
+        g_free (value);
+        return;
+    }
+
+    N_DEBUG (LOG_CAT "recording %s messages and above", levels[i].name);
+    core->record_level = levels[i].level;
+
+    g_free (value);
+}
+
 static void
 parse_plugins (gchar **plugins, GList **list)
 {
@@ -727,6 +1590,8 @@ n_core_parse_configuration (NCore *core)
     filename = g_build_filename (core->conf_path, DEFAULT_CONF_FILENAME, NULL);
     keyfile  = g_key_file_new ();
 
+    n_core_track_source (core, filename);
+
     if (!g_key_file_load_from_file (keyfile, filename, G_KEY_FILE_NONE, &error)) {
         N_WARNING (LOG_CAT "failed to load configuration file file: %s", error->message);
         g_error_free    (error);
@@ -757,62 +1622,87 @@ n_core_parse_configuration (NCore *core)
 
     n_core_parse_sink_order (core, keyfile);
 
+    /* size of the resolved request cache, 0 disables caching. */
+
+    n_core_parse_cache_size (core, keyfile);
+
+    /* number of worker threads used at startup, 0 loads everything on
+       the main thread. */
+
+    n_core_parse_startup_threads (core, keyfile);
+
+    /* optional plugins loaded only when a request needs them. */
+
+    n_core_parse_lazy_plugins (core, keyfile);
+
+    /* request timelines kept for dumping, 0 disables tracing. */
+
+    n_core_parse_tracing (core, keyfile);
+
+    /* time a hook callback may take before it is reported. */
+
+    n_core_parse_hook_budget (core, keyfile);
+
+    /* concurrency limits per sink and the queue for requests waiting
+       on a busy sink. */
+
+    n_core_parse_scheduler (core, keyfile);
+
+    /* lowest level kept in the flight recorder, formatted only when
+       dumped. */
+
+    n_core_parse_record_level (core, keyfile);
+
     g_key_file_free (keyfile);
     g_free          (filename);
 
     return TRUE;
 }
 
-static const char*
-n_core_match_and_strip_prefix (const char *value, const char *prefix)
+static int
+n_core_load_configuration (NCore *core)
 {
-    g_assert (value != NULL);
-    g_assert (prefix != NULL);
+    g_assert (core != NULL);
 
-    if (g_str_has_prefix (value, prefix))
-        return (const char*) (value + strlen (prefix));
+    gchar *filename = NULL;
+    int    result   = FALSE;
 
-    return NULL;
-}
+    /* use the compiled configuration if none of the source files has
+       changed since it was written. otherwise parse everything and write
+       a new cache for the next start. */
 
-static void
-n_core_match_event_rule_cb (const char *key, const NValue *value,
-                            gpointer userdata)
-{
-    NEventMatchResult *result      = (NEventMatchResult*) userdata;
-    NRequest          *request     = result->request;
-    NValue            *match_value = NULL;
-    const char        *context_key = NULL;
-    const char        *str         = NULL;
+    filename = g_build_filename (core->cache_path, N_CONFIG_CACHE_FILENAME, NULL);
 
-    if (result->skip_rest)
-        return;
+    if (n_config_cache_load (core, filename)) {
+        N_DEBUG (LOG_CAT "configuration loaded from cache '%s'", filename);
+        result = TRUE;
+        goto done;
+    }
 
-    /* assume positive result */
+    core->config_cache = n_config_cache_new ();
 
-    result->has_match = TRUE;
+    if (!n_core_parse_configuration (core))
+        goto done;
 
-    /* if the key has a context@ prefix, then we will lookup the value from
-       the current context. */
+    if (!n_core_parse_events (core))
+        goto done;
 
-    context_key = n_core_match_and_strip_prefix (key, "context@");
-    match_value = context_key ?
-        (NValue*) n_context_get_value (result->context, context_key) :
-        (NValue*) n_proplist_get (request->properties, key);
+    n_core_parse_plugin_params (core);
+    (void) n_config_cache_save (core->config_cache, core, filename);
 
-    /* if match value has a *, then any value for request will do. */
+    result = TRUE;
 
-    str = n_value_get_string ((NValue*) value);
-    if (str && g_str_equal (str, "*"))
-        return;
+done:
+    if (result) {
+        n_log_set_record_level (core->record_level);
+        n_core_prepare_events (core);
+    }
 
-    /* the moment we find a key and value that does not match, we're done
-       here. */
+    n_config_cache_free (core->config_cache);
+    core->config_cache = NULL;
+    g_free (filename);
 
-    if (!match_value || !n_value_equals (value, match_value)) {
-        result->has_match  = FALSE;
-        result->skip_rest  = TRUE;
-    }
+    return result;
 }
 
 NEvent*
@@ -821,50 +1711,31 @@ n_core_evaluate_request (NCore *core, NRequest *request)
     g_assert (core != NULL);
     g_assert (request != NULL);
 
-    NEvent *event      = NULL;
-    NEvent *found      = NULL;
-    GList  *event_list = NULL;
-    GList  *iter       = NULL;
-
-    NEventMatchResult result;
+    NEventMatcher *matcher    = NULL;
+    NEvent        *found      = NULL;
+    GList         *event_list = NULL;
 
     N_DEBUG (LOG_CAT "evaluating events for request '%s'",
         request->name);
 
-    /* find the list of events that have the same name. */
-
-    event_list = (GList*) g_hash_table_lookup (core->event_table, request->name);
-    if (!event_list)
-        return NULL;
-
-    /* for each event, match the properties. */
-
-    for (iter = g_list_first (event_list); iter; iter = g_list_next (iter)) {
-        event = (NEvent*) iter->data;
+    /* find the compiled rules for events that have the same name. if the
+       events were added after parsing, compile them now. */
 
-        /* default event with no properties, accept. */
+    matcher = (NEventMatcher*) g_hash_table_lookup (core->event_matchers, request->name);
+    if (!matcher) {
+        event_list = (GList*) g_hash_table_lookup (core->event_table, request->name);
+        if (!event_list)
+            return NULL;
 
-        if (n_proplist_size (event->rules) == 0) {
-            found = event;
-            break;
-        }
-
-        result.request    = request;
-        result.context    = core->context;
-        result.has_match  = FALSE;
-        result.skip_rest  = FALSE;
-
-        n_proplist_foreach (event->rules, n_core_match_event_rule_cb, &result);
-
-        if (result.has_match) {
-            found = event;
-            break;
-        }
+        matcher = n_event_matcher_new (event_list);
+        g_hash_table_replace (core->event_matchers, g_strdup (request->name), matcher);
     }
 
+    found = n_event_matcher_match (matcher, request->properties, core->context);
+
     if (found) {
         N_DEBUG (LOG_CAT "evaluated to '%s'", found->name);
-        n_proplist_foreach (event->rules, n_core_dump_value_cb, NULL);
+        n_proplist_foreach (found->rules, n_core_dump_value_cb, NULL);
     }
 
     return found;
@@ -882,7 +1753,34 @@ n_core_get_requests (NCore *core)
     if (!core)
         return NULL;
 
-    return core->requests;
+    return n_request_registry_get_all (core->requests);
+}
+
+NRequest*
+n_core_lookup_request (NCore *core, unsigned int id)
+{
+    if (!core)
+        return NULL;
+
+    return n_request_registry_lookup (core->requests, id);
+}
+
+GList*
+n_core_get_requests_by_client (NCore *core, const char *client)
+{
+    if (!core || !client)
+        return NULL;
+
+    return n_request_registry_get_by_client (core->requests, client);
+}
+
+GList*
+n_core_get_requests_by_name (NCore *core, const char *name)
+{
+    if (!core || !name)
+        return NULL;
+
+    return n_request_registry_get_by_name (core->requests, name);
 }
 
 NSinkInterface**
@@ -910,13 +1808,34 @@ n_core_connect (NCore *core, NCoreHook hook, int priority,
     if (!core || !callback)
         return FALSE;
 
+    const char      *owner  = NULL;
+    const NProplist *params = NULL;
+    gint64           budget = 0;
+
     if (hook >= N_CORE_HOOK_LAST)
         return FALSE;
 
-    N_DEBUG (LOG_CAT "0x%p connected to hook '%s'", callback,
-        n_core_hook_to_string (hook));
+    /* plugins may override the default budget with their own. */
+
+    budget = core->hook_budget;
+    if ((owner = g_private_get (&n_core_loading_plugin)) != NULL) {
+        params = g_hash_table_lookup (core->plugin_params, owner);
+        if (params && n_proplist_has_key (params, "hook-budget"))
+            budget = atoi (n_proplist_get_string (params, "hook-budget"));
+    }
+
+    N_DEBUG (LOG_CAT "0x%p connected to hook '%s' by '%s'", callback,
+        n_core_hook_to_string (hook), owner ? owner : "<unknown>");
+
+    g_mutex_lock (&core->lock);
 
-    n_hook_connect (&core->hooks[hook], priority, callback, userdata);
+    n_hook_connect_full (&core->hooks[hook], priority, callback, userdata,
+        owner, budget);
+
+    if (hook == N_CORE_HOOK_NEW_REQUEST || hook == N_CORE_HOOK_TRANSFORM_PROPERTIES)
+        n_request_cache_clear (core->request_cache);
+
+    g_mutex_unlock (&core->lock);
 
     return TRUE;
 }
@@ -931,7 +1850,52 @@ n_core_disconnect (NCore *core, NCoreHook hook, NHookCallback callback,
     if (hook >= N_CORE_HOOK_LAST)
         return;
 
+    g_mutex_lock (&core->lock);
+
     n_hook_disconnect (&core->hooks[hook], callback, userdata);
+
+    if (hook == N_CORE_HOOK_NEW_REQUEST || hook == N_CORE_HOOK_TRANSFORM_PROPERTIES)
+        n_request_cache_clear (core->request_cache);
+
+    g_mutex_unlock (&core->lock);
+}
+
+void
+n_core_disconnect_owner (NCore *core, const char *owner)
+{
+    int hook    = 0;
+    int removed = 0;
+
+    if (!core || !owner)
+        return;
+
+    g_mutex_lock (&core->lock);
+
+    for (hook = 0; hook < N_CORE_HOOK_LAST; ++hook) {
+        removed = n_hook_disconnect_owner (&core->hooks[hook], owner);
+        if (removed == 0)
+            continue;
+
+        N_DEBUG (LOG_CAT "disconnected %d callbacks of '%s' from hook '%s'",
+            removed, owner, n_core_hook_to_string (hook));
+
+        if (hook == N_CORE_HOOK_NEW_REQUEST || hook == N_CORE_HOOK_TRANSFORM_PROPERTIES)
+            n_request_cache_clear (core->request_cache);
+    }
+
+    g_mutex_unlock (&core->lock);
+
+    n_context_unsubscribe_owner (core->context, owner);
+}
+
+void
+n_core_add_volatile_key (NCore *core, const char *key)
+{
+    if (!core || !key)
+        return;
+
+    N_DEBUG (LOG_CAT "volatile request key '%s'", key);
+    n_request_cache_add_volatile_key (core->request_cache, n_atom_intern (key));
 }
 
 void
@@ -943,3 +1907,81 @@ n_core_fire_hook (NCore *core, NCoreHook hook, void *data)
     N_DEBUG (LOG_CAT "firing hook '%s'", n_core_hook_to_string (hook));
     n_hook_fire (&core->hooks[hook], data);
 }
+
+void
+n_core_fire_hook_owner (NCore *core, NCoreHook hook, void *data, const char *owner)
+{
+    if (!core || hook >= N_CORE_HOOK_LAST)
+        return;
+
+    N_DEBUG (LOG_CAT "firing hook '%s' for '%s'", n_core_hook_to_string (hook),
+        owner ? owner : "<unknown>");
+    n_hook_fire_owner (&core->hooks[hook], data, owner);
+}
+
+void
+n_core_foreach_hook_stats (NCore *core, NHookStatsFunc func, void *userdata)
+{
+    int hook = 0;
+
+    if (!core || !func)
+        return;
+
+    for (hook = 0; hook < N_CORE_HOOK_LAST; ++hook)
+        n_hook_foreach_stats (&core->hooks[hook], func, userdata);
+}
+
+static void
+n_core_dump_hook_stats_cb (NHook *hook, const NHookSlotStats *stats,
+                           void *userdata)
+{
+    (void) userdata;
+
+    N_INFO (LOG_CAT "hook '%s' callback %p of '%s': %" G_GUINT64_FORMAT
+        " calls, %.3f ms total, %.3f ms max, %u over a budget of %.3f ms",
+        hook->name ? hook->name : "<unnamed>", (void*) stats->callback,
+        stats->owner ? stats->owner : "<unknown>", stats->count,
+        stats->total_time / 1000.0, stats->max_time / 1000.0,
+        stats->overruns, stats->budget / 1000.0);
+}
+
+void
+n_core_dump_hook_stats (NCore *core)
+{
+    g_assert (core != NULL);
+
+    n_core_foreach_hook_stats (core, n_core_dump_hook_stats_cb, NULL);
+}
+
+void
+n_core_dump_scheduler (NCore *core)
+{
+    g_assert (core != NULL);
+
+    NSchedulerStats stats;
+
+    n_request_scheduler_get_stats (core->scheduler, &stats);
+
+    N_INFO (LOG_CAT "scheduler: %u waiting (%u max), %u queued, %u started after "
+        "%.3f ms on average (%.3f ms max), %u preempted, %u shed, %u expired",
+        stats.depth, stats.max_depth, stats.queued, stats.waited,
+        stats.waited > 0 ? stats.total_wait / 1000.0 / stats.waited : 0.0,
+        stats.max_wait / 1000.0, stats.preempted, stats.shed, stats.expired);
+
+    N_INFO (LOG_CAT "admission: %u dropped, %u coalesced",
+        n_request_admission_get_dropped (core->admission),
+        n_request_admission_get_coalesced (core->admission));
+}
+
+gboolean
+n_core_dump_traces (NCore *core)
+{
+    g_assert (core != NULL);
+
+    if (!core->trace_log) {
+        N_INFO (LOG_CAT "request tracing is disabled");
+        return FALSE;
+    }
+
+    return n_trace_log_write (core->trace_log, core->trace_file);
+}
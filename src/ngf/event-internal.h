@@ -34,10 +34,14 @@ struct _NEvent
     gchar      *name;               /* event name */
     NProplist  *properties;         /* properties */
     NProplist  *rules;
+    guint       refcount;           /* core and requests using the event */
 };
 
 NEvent* n_event_new            ();
 NEvent* n_event_new_from_group (NCore *core, GKeyFile *keyfile, const char *group);
+NEvent* n_event_copy           (const NEvent *event);
 void    n_event_free           (NEvent *event);
+NEvent* n_event_ref            (NEvent *event);
+void    n_event_unref          (NEvent *event);
 
 #endif /* N_EVENT_INTERNAL_H */
@@ -0,0 +1,233 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ngf/log.h>
+#include "event-matcher.h"
+
+#define LOG_CAT "matcher: "
+
+#define CONTEXT_PREFIX     "context@"
+#define CONTEXT_PREFIX_LEN (sizeof (CONTEXT_PREFIX) - 1)
+#define WILDCARD_VALUE     "*"
+
+/* single rule, with the context prefix already resolved and the compared
+   value stored in the form it will be compared against. */
+
+typedef struct _NEventRule
+{
+    NAtom       key;                /* request or context key */
+    gboolean    from_context;       /* lookup key from context */
+    NValue     *value;              /* expected value */
+    const char *str;                /* expected value, if a string */
+} NEventRule;
+
+/* one candidate event and the rules that must hold for it to match.
+   wildcard rules are dropped at compile time since they always hold. */
+
+typedef struct _NEventEntry
+{
+    NEvent     *event;
+    NEventRule *rules;
+    guint       num_rules;
+} NEventEntry;
+
+struct _NEventMatcher
+{
+    NEventEntry *entries;           /* entries in evaluation order */
+    guint        num_entries;
+};
+
+typedef struct _NEventCompileData
+{
+    NEventRule *rules;
+    guint       num_rules;
+} NEventCompileData;
+
+static void n_event_matcher_compile_rule_cb (const char *key, const NValue *value, gpointer userdata);
+static int  n_event_matcher_compare_rule    (const void *a, const void *b);
+
+
+
+static void
+n_event_matcher_compile_rule_cb (const char *key, const NValue *value,
+                                 gpointer userdata)
+{
+    NEventCompileData *data = (NEventCompileData*) userdata;
+    NEventRule        *rule = NULL;
+    const char        *str  = NULL;
+
+    /* rule with a wildcard matches regardless of the request or context,
+       so there is no need to evaluate it at all. */
+
+    str = n_value_get_string ((NValue*) value);
+    if (str && strcmp (str, WILDCARD_VALUE) == 0)
+        return;
+
+    rule = &data->rules[data->num_rules++];
+
+    if (strncmp (key, CONTEXT_PREFIX, CONTEXT_PREFIX_LEN) == 0) {
+        rule->key          = n_atom_intern (key + CONTEXT_PREFIX_LEN);
+        rule->from_context = TRUE;
+    }
+    else {
+        rule->key          = n_atom_intern (key);
+        rule->from_context = FALSE;
+    }
+
+    rule->value = n_value_copy (value);
+    rule->str   = n_value_get_string (rule->value);
+}
+
+static int
+n_event_matcher_compare_rule (const void *a, const void *b)
+{
+    const NEventRule *ra = (const NEventRule*) a;
+    const NEventRule *rb = (const NEventRule*) b;
+
+    /* request properties are cheaper to check than the context, evaluate
+       them first. otherwise keep the order stable by key. */
+
+    if (ra->from_context != rb->from_context)
+        return ra->from_context ? 1 : -1;
+
+    return (ra->key > rb->key) ? 1 : ((ra->key < rb->key) ? -1 : 0);
+}
+
+NEventMatcher*
+n_event_matcher_new (GList *event_list)
+{
+    NEventMatcher     *matcher = NULL;
+    NEventEntry       *entry   = NULL;
+    NEvent            *event   = NULL;
+    GList             *iter    = NULL;
+    guint              size    = 0;
+    NEventCompileData  data;
+
+    matcher = g_new0 (NEventMatcher, 1);
+    matcher->entries = g_new0 (NEventEntry, g_list_length (event_list));
+
+    /* the event list is already sorted with the most specific events
+       first. */
+
+    for (iter = g_list_first (event_list); iter; iter = g_list_next (iter)) {
+        event = (NEvent*) iter->data;
+        size  = event->rules ? n_proplist_size (event->rules) : 0;
+
+        data.rules     = size > 0 ? g_new0 (NEventRule, size) : NULL;
+        data.num_rules = 0;
+
+        if (size > 0)
+            n_proplist_foreach (event->rules, n_event_matcher_compile_rule_cb, &data);
+
+        if (data.num_rules > 1)
+            qsort (data.rules, data.num_rules, sizeof (NEventRule),
+                n_event_matcher_compare_rule);
+
+        entry = &matcher->entries[matcher->num_entries++];
+        entry->event     = event;
+        entry->rules     = data.rules;
+        entry->num_rules = data.num_rules;
+
+        /* event that always matches (default event or only wildcards),
+           nothing after this one can ever be reached. */
+
+        if (data.num_rules == 0)
+            break;
+    }
+
+    N_DEBUG (LOG_CAT "compiled %d of %d events",
+        matcher->num_entries, g_list_length (event_list));
+
+    return matcher;
+}
+
+void
+n_event_matcher_free (NEventMatcher *matcher)
+{
+    NEventEntry *entry = NULL;
+    guint        i, j;
+
+    if (!matcher)
+        return;
+
+    for (i = 0; i < matcher->num_entries; ++i) {
+        entry = &matcher->entries[i];
+        for (j = 0; j < entry->num_rules; ++j) {
+            n_value_free (entry->rules[j].value);
+        }
+        g_free (entry->rules);
+    }
+
+    g_free (matcher->entries);
+    g_free (matcher);
+}
+
+static inline gboolean
+n_event_matcher_match_rule (const NEventRule *rule, const NProplist *properties,
+                            NContext *context)
+{
+    const NValue *match_value = NULL;
+    const char   *str         = NULL;
+
+    match_value = rule->from_context ?
+        n_context_get_value_atom (context, rule->key) :
+        n_proplist_get_atom (properties, rule->key);
+
+    if (!match_value)
+        return FALSE;
+
+    /* rules parsed from the configuration are always strings, avoid the
+       generic comparison for them. */
+
+    if (rule->str) {
+        str = n_value_get_string ((NValue*) match_value);
+        return (str && strcmp (str, rule->str) == 0) ? TRUE : FALSE;
+    }
+
+    return n_value_equals (rule->value, match_value);
+}
+
+NEvent*
+n_event_matcher_match (NEventMatcher *matcher, const NProplist *properties,
+                       NContext *context)
+{
+    const NEventEntry *entry = NULL;
+    guint              i, j;
+
+    if (!matcher)
+        return NULL;
+
+    for (i = 0; i < matcher->num_entries; ++i) {
+        entry = &matcher->entries[i];
+
+        for (j = 0; j < entry->num_rules; ++j) {
+            if (!n_event_matcher_match_rule (&entry->rules[j], properties, context))
+                break;
+        }
+
+        if (j == entry->num_rules)
+            return entry->event;
+    }
+
+    return NULL;
+}
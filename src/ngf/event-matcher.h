@@ -0,0 +1,40 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef N_EVENT_MATCHER_H
+#define N_EVENT_MATCHER_H
+
+#include <glib.h>
+
+#include <ngf/proplist.h>
+#include <ngf/context.h>
+#include "event-internal.h"
+
+/* compiled form of the rules for all events sharing the same name. */
+typedef struct _NEventMatcher NEventMatcher;
+
+NEventMatcher* n_event_matcher_new   (GList *event_list);
+void           n_event_matcher_free  (NEventMatcher *matcher);
+NEvent*        n_event_matcher_match (NEventMatcher *matcher,
+                                      const NProplist *properties,
+                                      NContext *context);
+
+#endif /* N_EVENT_MATCHER_H */
@@ -0,0 +1,591 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include <ngf/log.h>
+#include "event-reload.h"
+#include "core-internal.h"
+#include "event-internal.h"
+
+#define LOG_CAT "reload: "
+
+/* editors write files in several steps, wait for the changes to settle
+   before reloading. */
+#define RELOAD_DELAY_MS 250
+
+#define INOTIFY_BUFFER_SIZE 4096
+
+struct _NEventReload
+{
+    NCore      *core;
+    gchar      *conf_filename;      /* ngfd.ini */
+    gchar      *events_path;        /* events.d */
+
+    GHashTable *files;              /* GList* of NEvent*, unmerged, per event file */
+    gboolean    indexed;            /* all event files have been parsed */
+
+    int         fd;                 /* inotify */
+    int         conf_wd;
+    int         events_wd;
+    GIOChannel *channel;
+    guint       watch_id;
+
+    GHashTable *pending;            /* changed event files */
+    gboolean    pending_keytypes;   /* ngfd.ini changed */
+    guint       timeout_id;
+};
+
+static GList*   n_event_reload_parse_file    (NEventReload *reload, const char *filename);
+static void     n_event_reload_free_events   (GList *events);
+static void     n_event_reload_add_names     (GHashTable *names, GList *events);
+static void     n_event_reload_index         (NEventReload *reload);
+static gboolean n_event_reload_keytypes      (NEventReload *reload);
+static GList*   n_event_reload_merge         (GList *event_list, NEvent *event);
+static gboolean n_event_reload_proplist_equal (const NProplist *a, const NProplist *b);
+static gboolean n_event_reload_lists_equal   (GList *a, GList *b);
+static void     n_event_reload_apply         (NEventReload *reload, GHashTable *names);
+static gboolean n_event_reload_timeout_cb    (gpointer userdata);
+static gboolean n_event_reload_io_cb         (GIOChannel *source, GIOCondition condition, gpointer userdata);
+static gboolean n_event_reload_watch_events  (NEventReload *reload);
+
+
+
+NEventReload*
+n_event_reload_new (NCore *core)
+{
+    NEventReload *reload = NULL;
+
+    g_assert (core != NULL);
+
+    reload = g_new0 (NEventReload, 1);
+    reload->core          = core;
+    reload->conf_filename = g_build_filename (core->conf_path, DEFAULT_CONF_FILENAME, NULL);
+    reload->events_path   = g_build_filename (core->conf_path, EVENT_CONF_PATH, NULL);
+    reload->fd            = -1;
+    reload->conf_wd       = -1;
+    reload->events_wd     = -1;
+
+    reload->files = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, (GDestroyNotify) n_event_reload_free_events);
+
+    reload->pending = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, NULL);
+
+    return reload;
+}
+
+void
+n_event_reload_free (NEventReload *reload)
+{
+    if (!reload)
+        return;
+
+    if (reload->timeout_id > 0)
+        g_source_remove (reload->timeout_id);
+
+    if (reload->watch_id > 0)
+        g_source_remove (reload->watch_id);
+
+    if (reload->channel)
+        g_io_channel_unref (reload->channel);
+
+    if (reload->fd >= 0)
+        close (reload->fd);
+
+    g_hash_table_destroy (reload->pending);
+    g_hash_table_destroy (reload->files);
+    g_free (reload->events_path);
+    g_free (reload->conf_filename);
+    g_free (reload);
+}
+
+static GList*
+n_event_reload_parse_file (NEventReload *reload, const char *filename)
+{
+    GKeyFile  *keyfile    = NULL;
+    GError    *error      = NULL;
+    gchar    **group_list = NULL;
+    gchar    **group      = NULL;
+    NEvent    *event      = NULL;
+    GList     *events     = NULL;
+
+    keyfile = g_key_file_new ();
+    if (!g_key_file_load_from_file (keyfile, filename, G_KEY_FILE_NONE, &error)) {
+        N_WARNING (LOG_CAT "failed to load event file: %s", error->message);
+        g_error_free    (error);
+        g_key_file_free (keyfile);
+        return NULL;
+    }
+
+    group_list = g_key_file_get_groups (keyfile, NULL);
+    for (group = group_list; *group; ++group) {
+        event = n_event_new_from_group (reload->core, keyfile, *group);
+        if (event)
+            events = g_list_append (events, event);
+    }
+
+    g_strfreev      (group_list);
+    g_key_file_free (keyfile);
+
+    return events;
+}
+
+static void
+n_event_reload_free_events (GList *events)
+{
+    g_list_foreach (events, (GFunc) n_event_unref, NULL);
+    g_list_free (events);
+}
+
+static void
+n_event_reload_add_names (GHashTable *names, GList *events)
+{
+    GList *iter = NULL;
+
+    for (iter = g_list_first (events); iter; iter = g_list_next (iter))
+        g_hash_table_replace (names, g_strdup (((NEvent*) iter->data)->name), NULL);
+}
+
+static void
+n_event_reload_index (NEventReload *reload)
+{
+    GList *filenames = NULL;
+    GList *iter      = NULL;
+
+    g_hash_table_remove_all (reload->files);
+
+    if (n_core_list_event_files (reload->core, &filenames)) {
+        for (iter = g_list_first (filenames); iter; iter = g_list_next (iter)) {
+            g_hash_table_replace (reload->files, iter->data,
+                n_event_reload_parse_file (reload, (const char*) iter->data));
+        }
+    }
+
+    g_list_free (filenames);
+    reload->indexed = TRUE;
+}
+
+static gboolean
+n_event_reload_keytypes (NEventReload *reload)
+{
+    NCore          *core      = reload->core;
+    GKeyFile       *keyfile   = NULL;
+    GHashTable     *old_types = NULL;
+    GHashTableIter  iter;
+    gpointer        key       = NULL;
+    gpointer        value     = NULL;
+    gboolean        changed   = FALSE;
+
+    keyfile = g_key_file_new ();
+    if (!g_key_file_load_from_file (keyfile, reload->conf_filename, G_KEY_FILE_NONE, NULL)) {
+        g_key_file_free (keyfile);
+        return FALSE;
+    }
+
+    old_types = core->key_types;
+    core->key_types = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, NULL);
+
+    n_core_parse_keytypes (core, keyfile);
+    g_key_file_free (keyfile);
+
+    if (g_hash_table_size (old_types) != g_hash_table_size (core->key_types))
+        changed = TRUE;
+
+    g_hash_table_iter_init (&iter, core->key_types);
+    while (!changed && g_hash_table_iter_next (&iter, &key, &value)) {
+        if (g_hash_table_lookup (old_types, key) != value)
+            changed = TRUE;
+    }
+
+    g_hash_table_destroy (old_types);
+
+    return changed;
+}
+
+static GList*
+n_event_reload_merge (GList *event_list, NEvent *event)
+{
+    NEvent *found = NULL;
+    GList  *iter  = NULL;
+
+    /* same as when parsing, groups with the same name and rules are one
+       event. */
+
+    for (iter = g_list_first (event_list); iter; iter = g_list_next (iter)) {
+        found = (NEvent*) iter->data;
+
+        if (n_proplist_match_exact (found->rules, event->rules)) {
+            n_proplist_merge (found->properties, event->properties);
+            n_event_free (event);
+            return event_list;
+        }
+    }
+
+    return g_list_append (event_list, event);
+}
+
+static gboolean
+n_event_reload_proplist_equal (const NProplist *a, const NProplist *b)
+{
+    if (!a || !b)
+        return a == b;
+
+    return n_proplist_match_exact (a, b);
+}
+
+static gboolean
+n_event_reload_lists_equal (GList *a, GList *b)
+{
+    NEvent *ea = NULL;
+    NEvent *eb = NULL;
+
+    if (g_list_length (a) != g_list_length (b))
+        return FALSE;
+
+    for (; a && b; a = g_list_next (a), b = g_list_next (b)) {
+        ea = (NEvent*) a->data;
+        eb = (NEvent*) b->data;
+
+        if (!n_event_reload_proplist_equal (ea->rules, eb->rules) ||
+            !n_event_reload_proplist_equal (ea->properties, eb->properties))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+n_event_reload_apply (NEventReload *reload, GHashTable *names)
+{
+    NCore                      *core      = reload->core;
+    GHashTable                 *merged    = NULL;
+    GList                      *filenames = NULL;
+    GList                      *iter      = NULL;
+    GList                      *e         = NULL;
+    GList                      *old_list  = NULL;
+    GList                      *new_list  = NULL;
+    NEvent                     *event     = NULL;
+    const char                 *name      = NULL;
+    gint                        position  = 0;
+    gint                        index     = 0;
+    GHashTableIter              hash_iter;
+    gpointer                    key       = NULL;
+    NCoreHookEventsChangedData  data;
+
+    /* merge the events of the affected names from all files, in the same
+       order as when parsing. */
+
+    merged = g_hash_table_new (g_str_hash, g_str_equal);
+
+    filenames = g_hash_table_get_keys (reload->files);
+    filenames = g_list_sort (filenames, (GCompareFunc) g_strcmp0);
+
+    for (iter = g_list_first (filenames); iter; iter = g_list_next (iter)) {
+        e = (GList*) g_hash_table_lookup (reload->files, iter->data);
+        for (; e; e = g_list_next (e)) {
+            event = (NEvent*) e->data;
+            if (!g_hash_table_lookup_extended (names, event->name, NULL, NULL))
+                continue;
+
+            new_list = (GList*) g_hash_table_lookup (merged, event->name);
+            new_list = n_event_reload_merge (new_list, n_event_copy (event));
+            g_hash_table_insert (merged, event->name, new_list);
+        }
+    }
+
+    g_list_free (filenames);
+
+    /* replace only the names whose events differ. the swap is done in one
+       go from the main loop, so no request ever sees a partial update. */
+
+    data.added   = NULL;
+    data.removed = NULL;
+
+    g_hash_table_iter_init (&hash_iter, names);
+    while (g_hash_table_iter_next (&hash_iter, &key, NULL)) {
+        name     = (const char*) key;
+        new_list = (GList*) g_hash_table_lookup (merged, name);
+        new_list = g_list_sort (new_list, n_core_sort_event_cb);
+        old_list = (GList*) g_hash_table_lookup (core->event_table, name);
+
+        if (n_event_reload_lists_equal (old_list, new_list)) {
+            n_event_reload_free_events (new_list);
+            continue;
+        }
+
+        N_DEBUG (LOG_CAT "event '%s' changed, %d -> %d definitions", name,
+            g_list_length (old_list), g_list_length (new_list));
+
+        /* the new definitions take the place of the old ones, so each
+           name stays sorted in the event list as well. */
+
+        position = -1;
+        for (e = g_list_first (old_list); e; e = g_list_next (e)) {
+            index = g_list_index (core->event_list, e->data);
+            if (index >= 0 && (position < 0 || index < position))
+                position = index;
+        }
+
+        for (e = g_list_first (old_list); e; e = g_list_next (e)) {
+            core->event_list = g_list_remove (core->event_list, e->data);
+            data.removed = g_list_append (data.removed, e->data);
+        }
+
+        for (e = g_list_first (new_list); e; e = g_list_next (e)) {
+            core->event_list = g_list_insert (core->event_list, e->data, position);
+            if (position >= 0)
+                ++position;
+            data.added = g_list_append (data.added, e->data);
+        }
+
+        if (new_list) {
+            g_hash_table_replace (core->event_table, g_strdup (name), new_list);
+            g_hash_table_replace (core->event_matchers, g_strdup (name),
+                n_event_matcher_new (new_list));
+        }
+        else {
+            g_hash_table_remove (core->event_table, name);
+            g_hash_table_remove (core->event_matchers, name);
+        }
+
+        g_list_free (old_list);
+    }
+
+    g_hash_table_destroy (merged);
+
+    if (!data.added && !data.removed) {
+        N_DEBUG (LOG_CAT "no event changes");
+        return;
+    }
+
+    N_INFO (LOG_CAT "events reloaded, %d added and %d removed definitions",
+        g_list_length (data.added), g_list_length (data.removed));
+
+    n_request_cache_clear (core->request_cache);
+    n_request_admission_invalidate (core->admission);
+    n_core_fire_hook (core, N_CORE_HOOK_EVENTS_CHANGED, &data);
+
+    /* requests still playing keep their own reference. */
+
+    n_event_reload_free_events (data.removed);
+    g_list_free (data.added);
+}
+
+void
+n_event_reload_files (NEventReload *reload, GList *filenames, gboolean keytypes)
+{
+    GHashTable  *names    = NULL;
+    GList       *iter     = NULL;
+    GList       *events   = NULL;
+    const char  *filename = NULL;
+    gboolean     full     = FALSE;
+
+    g_assert (reload != NULL);
+
+    names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    /* key types change how every event property is parsed. */
+
+    if (keytypes && n_event_reload_keytypes (reload)) {
+        N_INFO (LOG_CAT "key types changed, reloading all events");
+        full = TRUE;
+    }
+
+    if (full || !reload->indexed) {
+        /* the parsed files are not known yet (e.g. configuration came from
+           the cache), compare everything once. */
+
+        n_event_reload_index (reload);
+
+        events = g_hash_table_get_keys (reload->core->event_table);
+        for (iter = g_list_first (events); iter; iter = g_list_next (iter))
+            g_hash_table_replace (names, g_strdup ((const char*) iter->data), NULL);
+        g_list_free (events);
+
+        events = g_hash_table_get_values (reload->files);
+        for (iter = g_list_first (events); iter; iter = g_list_next (iter))
+            n_event_reload_add_names (names, (GList*) iter->data);
+        g_list_free (events);
+    }
+    else {
+        for (iter = g_list_first (filenames); iter; iter = g_list_next (iter)) {
+            filename = (const char*) iter->data;
+
+            N_DEBUG (LOG_CAT "event file '%s' changed", filename);
+
+            n_event_reload_add_names (names, (GList*) g_hash_table_lookup (reload->files, filename));
+
+            if (g_file_test (filename, G_FILE_TEST_IS_REGULAR)) {
+                events = n_event_reload_parse_file (reload, filename);
+                n_event_reload_add_names (names, events);
+                g_hash_table_replace (reload->files, g_strdup (filename), events);
+            }
+            else {
+                g_hash_table_remove (reload->files, filename);
+            }
+        }
+    }
+
+    n_event_reload_apply (reload, names);
+    g_hash_table_destroy (names);
+}
+
+static gboolean
+n_event_reload_timeout_cb (gpointer userdata)
+{
+    NEventReload *reload    = (NEventReload*) userdata;
+    GList        *filenames = NULL;
+    gboolean      keytypes  = FALSE;
+
+    reload->timeout_id = 0;
+
+    filenames = g_hash_table_get_keys (reload->pending);
+    keytypes  = reload->pending_keytypes;
+
+    n_event_reload_files (reload, filenames, keytypes);
+
+    g_list_free (filenames);
+    g_hash_table_remove_all (reload->pending);
+    reload->pending_keytypes = FALSE;
+
+    return FALSE;
+}
+
+static gboolean
+n_event_reload_io_cb (GIOChannel *source, GIOCondition condition, gpointer userdata)
+{
+    NEventReload               *reload = (NEventReload*) userdata;
+    const struct inotify_event *event  = NULL;
+    char                        buffer[INOTIFY_BUFFER_SIZE]
+                                    __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+    ssize_t                     len    = 0;
+    char                       *ptr    = NULL;
+
+    (void) source;
+
+    if (condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL)) {
+        N_WARNING (LOG_CAT "inotify failed, event files are no longer watched");
+        reload->watch_id = 0;
+        return FALSE;
+    }
+
+    while ((len = read (reload->fd, buffer, sizeof (buffer))) > 0) {
+        for (ptr = buffer; ptr < buffer + len; ptr += sizeof (struct inotify_event) + event->len) {
+            event = (const struct inotify_event*) ptr;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                /* lost track of the changes, compare everything. */
+                reload->indexed = FALSE;
+                continue;
+            }
+
+            if (event->wd == reload->events_wd && (event->mask & IN_IGNORED)) {
+                /* the directory is gone, watch for it to come back. */
+                N_DEBUG (LOG_CAT "'%s' removed", reload->events_path);
+                reload->events_wd = -1;
+                reload->indexed   = FALSE;
+                continue;
+            }
+
+            if (event->len == 0)
+                continue;
+
+            if (event->wd == reload->conf_wd) {
+                if (g_str_equal (event->name, DEFAULT_CONF_FILENAME))
+                    reload->pending_keytypes = TRUE;
+
+                /* event directory created after startup, files may have
+                   been written to it before the watch was added. */
+
+                if (g_str_equal (event->name, EVENT_CONF_PATH) &&
+                    (event->mask & IN_ISDIR) && reload->events_wd < 0 &&
+                    n_event_reload_watch_events (reload))
+                    reload->indexed = FALSE;
+                continue;
+            }
+
+            /* skip hidden and backup files written by editors. */
+
+            if (event->wd != reload->events_wd || event->name[0] == '.' ||
+                g_str_has_suffix (event->name, "~"))
+                continue;
+
+            g_hash_table_replace (reload->pending,
+                g_build_filename (reload->events_path, event->name, NULL), NULL);
+        }
+    }
+
+    if (reload->timeout_id == 0 && (g_hash_table_size (reload->pending) > 0 ||
+        reload->pending_keytypes || !reload->indexed))
+    {
+        reload->timeout_id = g_timeout_add (RELOAD_DELAY_MS,
+            n_event_reload_timeout_cb, reload);
+    }
+
+    return TRUE;
+}
+
+gboolean
+n_event_reload_watch (NEventReload *reload)
+{
+    g_assert (reload != NULL);
+
+    if (reload->fd >= 0)
+        return TRUE;
+
+    if ((reload->fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC)) < 0) {
+        N_WARNING (LOG_CAT "unable to watch event files: %s", strerror (errno));
+        return FALSE;
+    }
+
+    reload->conf_wd = inotify_add_watch (reload->fd, reload->core->conf_path,
+        IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+
+    (void) n_event_reload_watch_events (reload);
+
+    reload->channel  = g_io_channel_unix_new (reload->fd);
+    reload->watch_id = g_io_add_watch (reload->channel,
+        G_IO_IN | G_IO_ERR | G_IO_HUP | G_IO_NVAL, n_event_reload_io_cb, reload);
+
+    N_DEBUG (LOG_CAT "watching '%s' for changes", reload->events_path);
+
+    return TRUE;
+}
+
+static gboolean
+n_event_reload_watch_events (NEventReload *reload)
+{
+    reload->events_wd = inotify_add_watch (reload->fd, reload->events_path,
+        IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+
+    if (reload->events_wd < 0) {
+        N_DEBUG (LOG_CAT "unable to watch '%s': %s", reload->events_path,
+            strerror (errno));
+        return FALSE;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,39 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef N_EVENT_RELOAD_H
+#define N_EVENT_RELOAD_H
+
+#include <glib.h>
+
+#include <ngf/core.h>
+
+/* reloads the event configuration while the daemon is running. only the
+   changed files are parsed again, and only the events whose definition
+   actually changed are replaced in the core. */
+typedef struct _NEventReload NEventReload;
+
+NEventReload* n_event_reload_new   (NCore *core);
+void          n_event_reload_free  (NEventReload *reload);
+gboolean      n_event_reload_watch (NEventReload *reload);
+void          n_event_reload_files (NEventReload *reload, GList *filenames, gboolean keytypes);
+
+#endif /* N_EVENT_RELOAD_H */
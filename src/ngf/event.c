@@ -36,7 +36,12 @@ static NEvent*    n_event_parse_group       (GKeyFile *keyfile, const char *grou
 NEvent*
 n_event_new ()
 {
-    return g_new0 (NEvent, 1);
+    NEvent *event = NULL;
+
+    event = g_new0 (NEvent, 1);
+    event->refcount = 1;
+
+    return event;
 }
 
 NEvent*
@@ -48,6 +53,43 @@ n_event_new_from_group (NCore *core, GKeyFile *keyfile, const char *group)
     return n_event_parse_group (keyfile, group, core->key_types);
 }
 
+NEvent*
+n_event_copy (const NEvent *event)
+{
+    NEvent *copy = NULL;
+
+    g_assert (event != NULL);
+
+    copy = n_event_new ();
+    copy->name       = g_strdup (event->name);
+    copy->rules      = event->rules ? n_proplist_copy (event->rules) : NULL;
+    copy->properties = event->properties ? n_proplist_copy (event->properties) : NULL;
+
+    return copy;
+}
+
+NEvent*
+n_event_ref (NEvent *event)
+{
+    g_assert (event != NULL);
+
+    event->refcount++;
+    return event;
+}
+
+void
+n_event_unref (NEvent *event)
+{
+    if (!event)
+        return;
+
+    /* events replaced on reload stay around until the last request that
+       resolved to them is done. */
+
+    if (--event->refcount == 0)
+        n_event_free (event);
+}
+
 void
 n_event_free (NEvent *event)
 {
@@ -56,6 +98,11 @@ n_event_free (NEvent *event)
         event->properties = NULL;
     }
 
+    if (event->rules) {
+        n_proplist_free (event->rules);
+        event->rules = NULL;
+    }
+
     g_free (event->name);
     g_free (event);
 }
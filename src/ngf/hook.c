@@ -20,15 +20,19 @@
  */
 
 #include <ngf/hook.h>
+#include <ngf/log.h>
 #include <glib.h>
 #include <string.h>
 
+#define LOG_CAT "hook: "
+
 typedef struct _NHookSlot
 {
     NHook         *hook;
     int            priority;
     NHookCallback  callback;
     void          *userdata;
+    NHookSlotStats stats;
 } NHookSlot;
 
 static void
@@ -37,9 +41,49 @@ n_hook_slot_free (NHookSlot *slot)
     if (!slot)
         return;
 
+    g_free ((gchar*) slot->stats.owner);
     g_slice_free (NHookSlot, slot);
 }
 
+static NHookSlot*
+n_hook_find_slot (NHook *hook, NHookCallback callback, void *userdata)
+{
+    GList *iter = NULL;
+
+    for (iter = g_list_first (hook->slots); iter; iter = g_list_next (iter)) {
+        NHookSlot *slot = (NHookSlot*) iter->data;
+        if (slot->callback == callback && slot->userdata == userdata)
+            return slot;
+    }
+
+    return NULL;
+}
+
+static void
+n_hook_run_slot (NHook *hook, NHookSlot *slot, void *data, const char *label)
+{
+    gint64 started = 0;
+    gint64 elapsed = 0;
+
+    started = g_get_monotonic_time ();
+    slot->callback (hook, data, slot->userdata);
+    elapsed = g_get_monotonic_time () - started;
+
+    slot->stats.count++;
+    slot->stats.total_time += elapsed;
+    if (elapsed > slot->stats.max_time)
+        slot->stats.max_time = elapsed;
+
+    if (slot->stats.budget > 0 && elapsed > slot->stats.budget) {
+        slot->stats.overruns++;
+        N_WARNING (LOG_CAT "hook '%s' callback %p of '%s' took %" G_GINT64_FORMAT
+            " us for '%s', over its budget of %" G_GINT64_FORMAT " us",
+            hook->name ? hook->name : "<unnamed>", (void*) slot->callback,
+            slot->stats.owner ? slot->stats.owner : "<unknown>", elapsed,
+            label ? label : "<none>", slot->stats.budget);
+    }
+}
+
 void
 n_hook_init (NHook *hook)
 {
@@ -62,6 +106,13 @@ n_hook_sort_slot_cb (gconstpointer in_a, gconstpointer in_b)
 int
 n_hook_connect (NHook *hook, int priority, NHookCallback callback,
                 void *userdata)
+{
+    return n_hook_connect_full (hook, priority, callback, userdata, NULL, 0);
+}
+
+int
+n_hook_connect_full (NHook *hook, int priority, NHookCallback callback,
+                     void *userdata, const char *owner, gint64 budget)
 {
     NHookSlot *slot = NULL;
 
@@ -74,6 +125,10 @@ n_hook_connect (NHook *hook, int priority, NHookCallback callback,
     slot->userdata = userdata;
     slot->priority = priority;
 
+    slot->stats.callback = callback;
+    slot->stats.owner    = g_strdup (owner);
+    slot->stats.budget   = budget > 0 ? budget : 0;
+
     hook->slots = g_list_append (hook->slots, slot);
     hook->slots = g_list_sort (hook->slots, n_hook_sort_slot_cb);
 
@@ -83,23 +138,105 @@ n_hook_connect (NHook *hook, int priority, NHookCallback callback,
 void
 n_hook_disconnect (NHook *hook, NHookCallback callback, void *userdata)
 {
-    GList *iter = NULL;
+    NHookSlot *slot = NULL;
 
     if (!hook || !callback)
         return;
 
-    for (iter = g_list_first (hook->slots); iter; iter = g_list_next (iter)) {
-        NHookSlot *slot = (NHookSlot*) iter->data;
-        if (slot->callback == callback && slot->userdata == userdata) {
-            hook->slots = g_list_remove (hook->slots, slot);
+    if ((slot = n_hook_find_slot (hook, callback, userdata)) != NULL) {
+        hook->slots = g_list_remove (hook->slots, slot);
+        n_hook_slot_free (slot);
+    }
+}
+
+int
+n_hook_disconnect_owner (NHook *hook, const char *owner)
+{
+    NHookSlot *slot    = NULL;
+    GList     *iter    = NULL;
+    GList     *next    = NULL;
+    int        removed = 0;
+
+    if (!hook || !owner)
+        return 0;
+
+    for (iter = g_list_first (hook->slots); iter; iter = next) {
+        next = g_list_next (iter);
+        slot = (NHookSlot*) iter->data;
+
+        if (slot->stats.owner && g_str_equal (slot->stats.owner, owner)) {
+            hook->slots = g_list_delete_link (hook->slots, iter);
             n_hook_slot_free (slot);
-            return;
+            ++removed;
         }
     }
+
+    return removed;
+}
+
+int
+n_hook_set_budget (NHook *hook, NHookCallback callback, void *userdata,
+                   gint64 budget)
+{
+    NHookSlot *slot = NULL;
+
+    if (!hook || !callback)
+        return FALSE;
+
+    if ((slot = n_hook_find_slot (hook, callback, userdata)) == NULL)
+        return FALSE;
+
+    slot->stats.budget = budget > 0 ? budget : 0;
+    return TRUE;
+}
+
+void
+n_hook_foreach_stats (NHook *hook, NHookStatsFunc func, void *userdata)
+{
+    GList *iter = NULL;
+
+    if (!hook || !func)
+        return;
+
+    for (iter = g_list_first (hook->slots); iter; iter = g_list_next (iter)) {
+        NHookSlot *slot = (NHookSlot*) iter->data;
+        func (hook, &slot->stats, userdata);
+    }
+}
+
+void
+n_hook_reset_stats (NHook *hook)
+{
+    GList *iter = NULL;
+
+    if (!hook)
+        return;
+
+    for (iter = g_list_first (hook->slots); iter; iter = g_list_next (iter)) {
+        NHookSlot *slot = (NHookSlot*) iter->data;
+        slot->stats.count      = 0;
+        slot->stats.total_time = 0;
+        slot->stats.max_time   = 0;
+        slot->stats.overruns   = 0;
+    }
 }
 
 int
 n_hook_fire (NHook *hook, void *data)
+{
+    return n_hook_fire_full (hook, data, NULL, NULL, NULL);
+}
+
+int
+n_hook_fire_observed (NHook *hook, void *data, NHookObserver observer,
+                      void *userdata)
+{
+    return n_hook_fire_full (hook, data, NULL, observer, userdata);
+}
+
+int
+n_hook_fire_full (NHook *hook, void *data, const char *label,
+                  NHookObserver observer, void *userdata)
 {
     GList *iter = NULL;
 
@@ -108,9 +245,33 @@ n_hook_fire (NHook *hook, void *data)
 
     for (iter = g_list_first (hook->slots); iter; iter = g_list_next (iter)) {
         NHookSlot *slot = (NHookSlot*) iter->data;
-        slot->callback (hook, data, slot->userdata);
+
+        if (observer)
+            observer (hook, slot->callback, FALSE, userdata);
+
+        n_hook_run_slot (hook, slot, data, label);
+
+        if (observer)
+            observer (hook, slot->callback, TRUE, userdata);
     }
 
     return TRUE;
 }
 
+int
+n_hook_fire_owner (NHook *hook, void *data, const char *owner)
+{
+    GList *iter = NULL;
+
+    if (!hook || !owner)
+        return FALSE;
+
+    for (iter = g_list_first (hook->slots); iter; iter = g_list_next (iter)) {
+        NHookSlot *slot = (NHookSlot*) iter->data;
+
+        if (slot->stats.owner && g_str_equal (slot->stats.owner, owner))
+            n_hook_run_slot (hook, slot, data, owner);
+    }
+
+    return TRUE;
+}
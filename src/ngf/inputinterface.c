@@ -43,6 +43,20 @@ n_input_interface_play_request (NInputInterface *iface, NRequest *request)
     return n_core_play_request (iface->core, request);
 }
 
+int
+n_input_interface_play_batch (NInputInterface *iface, GList *requests)
+{
+    GList *iter = NULL;
+
+    if (!iface || !requests)
+        return FALSE;
+
+    for (iter = g_list_first (requests); iter; iter = g_list_next (iter))
+        ((NRequest*) iter->data)->input_iface = iface;
+
+    return n_core_play_batch (iface->core, requests);
+}
+
 int
 n_input_interface_pause_request (NInputInterface *iface, NRequest *request)
 {
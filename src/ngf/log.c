@@ -24,15 +24,87 @@
 #include <syslog.h>
 #include <string.h>
 #include <time.h>
+#include <glib.h>
 
 #include <ngf/log.h>
 
 #define LOG_CAT "log: "
 
+/* flight recorder, a ring of binary log records. messages are recorded
+   with the format string pointer and the raw arguments, strings are
+   copied into the record. formatting is done only when the recorder is
+   dumped. */
+
+#define N_LOG_RECORD_COUNT     512      /* power of two */
+#define N_LOG_RECORD_MAX_ARGS  8
+#define N_LOG_RECORD_DATA_SIZE 128
+#define N_LOG_RECORD_NO_STRING G_MAXUINT16
+#define N_LOG_LINE_SIZE        512
+
+/* records are stamped with the coarse clock, it is a fraction of the cost
+   and stamps are shown with millisecond precision anyway. */
+
+#ifdef CLOCK_MONOTONIC_COARSE
+#define N_LOG_RECORD_CLOCK     CLOCK_MONOTONIC_COARSE
+#else
+#define N_LOG_RECORD_CLOCK     CLOCK_MONOTONIC
+#endif
+
+typedef enum _NLogArgType
+{
+    N_LOG_ARG_INT = 0,
+    N_LOG_ARG_UINT,
+    N_LOG_ARG_DOUBLE,
+    N_LOG_ARG_POINTER,
+    N_LOG_ARG_STRING
+} NLogArgType;
+
+typedef union _NLogArg
+{
+    gint64         i;
+    guint64        u;
+    gdouble        d;
+    gconstpointer  p;
+    guint16        s;               /* offset into record data */
+} NLogArg;
+
+typedef struct _NLogRecord
+{
+    volatile gint    seq;           /* index + 1 once complete, 0 while written */
+    NLogLevel        level;
+    const char      *fmt;           /* NULL if data holds the formatted message */
+    struct timespec  stamp;
+    guint            num_args;
+    NLogArg          args[N_LOG_RECORD_MAX_ARGS];
+    guint            data_used;
+    gchar            data[N_LOG_RECORD_DATA_SIZE];
+} NLogRecord;
+
 static NLogLevel       _log_level       = N_LOG_LEVEL_ENTER;
 static NLogTarget      _log_target      = N_LOG_TARGET_STDOUT;
 static struct timespec _log_clock_start = { 0, 0 };
 
+static NLogLevel       _record_level    = N_LOG_LEVEL_INFO;
+static NLogRecord      _records[N_LOG_RECORD_COUNT];
+static volatile gint   _record_head     = 0;     /* next record index */
+static volatile gint   _record_tail     = 0;     /* first record not dumped */
+static volatile gint   _record_dumping  = 0;
+
+static const char* n_log_parse_spec    (const char *p, guint *num_stars,
+                                        char *length, char *conversion);
+static gboolean    n_log_record_args   (NLogRecord *record, const char *fmt,
+                                        va_list args);
+static void        n_log_record        (NLogLevel category, const char *fmt,
+                                        va_list args);
+static void        n_log_format_record (const NLogRecord *record, char *buf,
+                                        size_t len);
+static void        n_log_output        (NLogLevel category,
+                                        const struct timespec *stamp,
+                                        const char *buf);
+static gboolean    n_log_dump_from     (guint from);
+
+
+
 static int
 n_log_syslog_priority_from_level (NLogLevel category)
 {
@@ -65,6 +137,27 @@ n_log_set_level (NLogLevel level)
     _log_level = level;
 }
 
+void
+n_log_set_record_level (NLogLevel level)
+{
+    _record_level = level;
+}
+
+NLogLevel
+n_log_get_record_level ()
+{
+    return _record_level;
+}
+
+int
+n_log_enabled (NLogLevel level)
+{
+    if (level >= _record_level)
+        return TRUE;
+
+    return level >= _log_level && _log_target != N_LOG_TARGET_NONE;
+}
+
 void
 n_log_set_target (NLogTarget target)
 {
@@ -115,19 +208,27 @@ n_log_level_to_string (NLogLevel category)
 }
 
 static void
-n_log_get_clock_stamp (char *buffer, size_t len)
+n_log_get_clock_stamp (const struct timespec *stamp, char *buffer, size_t len)
 {
     struct timespec res;
     struct timespec ts;
     long ms = 0;
 
-    if (clock_gettime (CLOCK_MONOTONIC, &ts) < 0) {
+    if (stamp)
+        ts = *stamp;
+    else if (clock_gettime (CLOCK_MONOTONIC, &ts) < 0) {
         snprintf (buffer, len, "no_time");
         return;
     }
 
     res.tv_sec  = ts.tv_sec - _log_clock_start.tv_sec;
     res.tv_nsec = ts.tv_nsec - _log_clock_start.tv_nsec;
+    if (res.tv_nsec < 0) {
+        res.tv_sec--;
+        res.tv_nsec += 1000000000L;
+    }
+    if (res.tv_sec < 0)
+        res.tv_sec = res.tv_nsec = 0;
     ms = res.tv_nsec / 1000000;
 
     snprintf (buffer, len, "%lu.%.3lu",  (long) res.tv_sec, ms);
@@ -147,29 +248,430 @@ n_log_initialize (NLogLevel level)
     N_DEBUG (LOG_CAT "clock time reset");
 }
 
+/* parse a conversion specification after the '%', returns the position
+   after it or NULL if the conversion is not supported. */
+
+static const char*
+n_log_parse_spec (const char *p, guint *num_stars, char *length,
+                  char *conversion)
+{
+    *num_stars = 0;
+    *length    = 0;
+
+    while (*p && strchr ("-+ #0'", *p))
+        ++p;
+
+    if (*p == '*') {
+        ++(*num_stars);
+        ++p;
+    }
+    else {
+        while (*p >= '0' && *p <= '9')
+            ++p;
+    }
+
+    if (*p == '.') {
+        ++p;
+        if (*p == '*') {
+            ++(*num_stars);
+            ++p;
+        }
+        else {
+            while (*p >= '0' && *p <= '9')
+                ++p;
+        }
+    }
+
+    /* integers are widened to 64 bits, remember only whether the argument
+       was passed as a long long sized one. */
+
+    if (p[0] == 'l' && p[1] == 'l') {
+        *length = 'q';
+        p += 2;
+    }
+    else if (p[0] == 'h' && p[1] == 'h') {
+        p += 2;
+    }
+    else if (*p == 'l' || *p == 'z' || *p == 't') {
+        *length = sizeof (long) == sizeof (gint64) ? 'q' : 0;
+        ++p;
+    }
+    else if (*p == 'j' || *p == 'q') {
+        *length = 'q';
+        ++p;
+    }
+    else if (*p == 'h' || *p == 'L') {
+        *length = *p;
+        ++p;
+    }
+
+    *conversion = *p;
+    if (!*p || !strchr ("diouxXcspeEfFgGaA", *p))
+        return NULL;
+
+    return p + 1;
+}
+
+static gboolean
+n_log_record_args (NLogRecord *record, const char *fmt, va_list args)
+{
+    const char *p          = fmt;
+    const char *str        = NULL;
+    guint       num_stars  = 0;
+    guint       len        = 0;
+    char        length     = 0;
+    char        conversion = 0;
+
+    record->num_args  = 0;
+    record->data_used = 0;
+
+    while ((p = strchr (p, '%')) != NULL) {
+        if (p[1] == '%') {
+            p += 2;
+            continue;
+        }
+
+        if ((p = n_log_parse_spec (p + 1, &num_stars, &length, &conversion)) == NULL)
+            return FALSE;
+
+        if (record->num_args + num_stars + 1 > N_LOG_RECORD_MAX_ARGS)
+            return FALSE;
+
+        while (num_stars--)
+            record->args[record->num_args++].i = va_arg (args, int);
+
+        switch (conversion) {
+            case 'd':
+            case 'i':
+            case 'c':
+                record->args[record->num_args++].i = length == 'q' ?
+                    va_arg (args, gint64) : va_arg (args, int);
+                break;
+
+            case 'o':
+            case 'u':
+            case 'x':
+            case 'X':
+                record->args[record->num_args++].u = length == 'q' ?
+                    va_arg (args, guint64) : va_arg (args, unsigned int);
+                break;
+
+            case 'p':
+                record->args[record->num_args++].p = va_arg (args, gconstpointer);
+                break;
+
+            case 's':
+                str = va_arg (args, const char*);
+                if (!str) {
+                    record->args[record->num_args++].s = N_LOG_RECORD_NO_STRING;
+                    break;
+                }
+
+                /* strings are copied, truncated to the space left. */
+
+                len = MIN (strlen (str),
+                    N_LOG_RECORD_DATA_SIZE - record->data_used - 1);
+                memcpy (record->data + record->data_used, str, len);
+                record->data[record->data_used + len] = '\0';
+                record->args[record->num_args++].s = record->data_used;
+                record->data_used += len + 1;
+                if (record->data_used >= N_LOG_RECORD_DATA_SIZE)
+                    record->data_used = N_LOG_RECORD_DATA_SIZE - 1;
+                break;
+
+            default:
+                record->args[record->num_args++].d = length == 'L' ?
+                    (gdouble) va_arg (args, long double) : va_arg (args, double);
+                break;
+        }
+    }
+
+    return TRUE;
+}
+
+static void
+n_log_record (NLogLevel category, const char *fmt, va_list args)
+{
+    NLogRecord *record = NULL;
+    guint       index  = 0;
+    va_list     copy;
+
+    /* claim a slot, writers never wait for each other or for a dump. */
+
+    index  = (guint) g_atomic_int_add (&_record_head, 1);
+    record = &_records[index & (N_LOG_RECORD_COUNT - 1)];
+    g_atomic_int_set (&record->seq, 0);
+
+    record->level = category;
+    record->fmt   = fmt;
+    (void) clock_gettime (N_LOG_RECORD_CLOCK, &record->stamp);
+
+    va_copy (copy, args);
+    if (!n_log_record_args (record, fmt, copy)) {
+        /* too many or unsupported arguments, format right away. */
+        record->fmt = NULL;
+        vsnprintf (record->data, N_LOG_RECORD_DATA_SIZE, fmt, args);
+    }
+    va_end (copy);
+
+    g_atomic_int_set (&record->seq, (gint) (index + 1));
+}
+
+static void
+n_log_format_record (const NLogRecord *record, char *buf, size_t len)
+{
+    const char *p          = record->fmt;
+    const char *start      = NULL;
+    const NLogArg *arg     = record->args;
+    char        spec[32];
+    guint       num_stars  = 0;
+    char        length     = 0;
+    char        conversion = 0;
+    size_t      pos        = 0;
+    size_t      spec_len   = 0;
+    int         star[2]    = { 0, 0 };
+    int         n          = 0;
+
+    if (!record->fmt) {
+        snprintf (buf, len, "%s", record->data);
+        return;
+    }
+
+    buf[0] = '\0';
+
+    while (*p && pos < len - 1) {
+        if (*p != '%' || p[1] == '%') {
+            buf[pos++] = *p;
+            p += (*p == '%') ? 2 : 1;
+            continue;
+        }
+
+        start = p;
+        p = n_log_parse_spec (p + 1, &num_stars, &length, &conversion);
+
+        /* rebuild the specification without the length modifier, the
+           arguments are passed in their widened form. */
+
+        spec_len = 0;
+        for (; start < p - 1 && spec_len < sizeof (spec) - 4; ++start) {
+            if (!strchr ("hlLqjzt", *start))
+                spec[spec_len++] = *start;
+        }
+        if (strchr ("diouxX", conversion)) {
+            spec[spec_len++] = 'l';
+            spec[spec_len++] = 'l';
+        }
+        spec[spec_len++] = conversion;
+        spec[spec_len]   = '\0';
+
+        star[0] = num_stars > 0 ? (int) (arg++)->i : 0;
+        star[1] = num_stars > 1 ? (int) (arg++)->i : 0;
+
+#define N_LOG_FORMAT_ARG(value)                                                \
+        (num_stars == 2 ? snprintf (buf + pos, len - pos, spec, star[0], star[1], value) : \
+         num_stars == 1 ? snprintf (buf + pos, len - pos, spec, star[0], value) : \
+                          snprintf (buf + pos, len - pos, spec, value))
+
+        switch (conversion) {
+            case 'd':
+            case 'i':
+                n = N_LOG_FORMAT_ARG ((long long) arg->i);
+                break;
+            case 'c':
+                n = N_LOG_FORMAT_ARG ((int) arg->i);
+                break;
+            case 'o':
+            case 'u':
+            case 'x':
+            case 'X':
+                n = N_LOG_FORMAT_ARG ((unsigned long long) arg->u);
+                break;
+            case 'p':
+                n = N_LOG_FORMAT_ARG (arg->p);
+                break;
+            case 's':
+                n = N_LOG_FORMAT_ARG (arg->s == N_LOG_RECORD_NO_STRING ?
+                    "(null)" : record->data + arg->s);
+                break;
+            default:
+                n = N_LOG_FORMAT_ARG (arg->d);
+                break;
+        }
+
+#undef N_LOG_FORMAT_ARG
+
+        ++arg;
+        if (n < 0)
+            break;
+
+        pos = MIN (pos + (size_t) n, len - 1);
+    }
+
+    buf[pos] = '\0';
+}
+
+static void
+n_log_output (NLogLevel category, const struct timespec *stamp,
+              const char *buf)
+{
+    char clock_stamp[256];
+
+    if (_log_target == N_LOG_TARGET_SYSLOG) {
+        syslog (n_log_syslog_priority_from_level (category), "%s", buf);
+    }
+    else if (_log_target == N_LOG_TARGET_STDOUT) {
+        n_log_get_clock_stamp (stamp, clock_stamp, 256);
+        fprintf (stdout, "[%s] %s: %s\n", clock_stamp, n_log_level_to_string (category), buf);
+    }
+}
+
+static gboolean
+n_log_dump_from (guint from)
+{
+    NLogRecord record;
+    char       buf[N_LOG_LINE_SIZE];
+    guint      head  = 0;
+    guint      index = 0;
+    guint      count = 0;
+
+    if (_log_target == N_LOG_TARGET_NONE)
+        return FALSE;
+
+    /* a failing dump may log an error, which would dump again. */
+
+    if (!g_atomic_int_compare_and_exchange (&_record_dumping, 0, 1))
+        return FALSE;
+
+    head = (guint) g_atomic_int_get (&_record_head);
+    if (head - from > N_LOG_RECORD_COUNT)
+        from = head - N_LOG_RECORD_COUNT;
+
+    snprintf (buf, sizeof (buf), LOG_CAT "---- flight recorder ----");
+    n_log_output (N_LOG_LEVEL_INFO, NULL, buf);
+
+    for (index = from; index != head; ++index) {
+        const NLogRecord *slot = &_records[index & (N_LOG_RECORD_COUNT - 1)];
+
+        /* skip records that are being written or already overwritten. */
+
+        if (g_atomic_int_get (&slot->seq) == 0 ||
+            (guint) g_atomic_int_get (&slot->seq) != index + 1)
+            continue;
+
+        memcpy (&record, slot, sizeof (NLogRecord));
+        if ((guint) g_atomic_int_get (&slot->seq) != index + 1)
+            continue;
+
+        n_log_format_record (&record, buf, sizeof (buf));
+        n_log_output (record.level, &record.stamp, buf);
+        ++count;
+    }
+
+    snprintf (buf, sizeof (buf), LOG_CAT "---- end of flight recorder, %u messages ----",
+        count);
+    n_log_output (N_LOG_LEVEL_INFO, NULL, buf);
+
+    g_atomic_int_set (&_record_tail, (gint) head);
+    g_atomic_int_set (&_record_dumping, 0);
+
+    return TRUE;
+}
+
+void
+n_log_dump_recorder ()
+{
+    guint head = (guint) g_atomic_int_get (&_record_head);
+
+    (void) n_log_dump_from (head > N_LOG_RECORD_COUNT ? head - N_LOG_RECORD_COUNT : 0);
+}
+
+void
+n_log_clear_recorder ()
+{
+    g_atomic_int_set (&_record_tail, g_atomic_int_get (&_record_head));
+    memset (_records, 0, sizeof (_records));
+}
+
+void
+n_log_detach_records (const void *start, const void *end)
+{
+    NLogRecord *record = NULL;
+    char        buf[N_LOG_LINE_SIZE];
+    guint       head   = 0;
+    guint       index  = 0;
+    guint       count  = 0;
+
+    /* a dump in progress may be reading the format strings. */
+
+    while (!g_atomic_int_compare_and_exchange (&_record_dumping, 0, 1))
+        g_thread_yield ();
+
+    head = (guint) g_atomic_int_get (&_record_head);
+
+    for (index = head > N_LOG_RECORD_COUNT ? head - N_LOG_RECORD_COUNT : 0;
+         index != head; ++index)
+    {
+        record = &_records[index & (N_LOG_RECORD_COUNT - 1)];
+
+        if ((guint) g_atomic_int_get (&record->seq) != index + 1 || !record->fmt)
+            continue;
+
+        if ((const char*) record->fmt < (const char*) start ||
+            (const char*) record->fmt >= (const char*) end)
+            continue;
+
+        /* keep the message, formatted, without the format string. */
+
+        n_log_format_record (record, buf, sizeof (buf));
+        g_strlcpy (record->data, buf, N_LOG_RECORD_DATA_SIZE);
+        record->fmt = NULL;
+        ++count;
+    }
+
+    g_atomic_int_set (&_record_dumping, 0);
+
+    if (count > 0)
+        N_DEBUG (LOG_CAT "formatted %u recorded messages of unloaded code", count);
+}
+
 void
 n_log_message (NLogLevel category, const char *function, int line,
                const char *fmt, ...)
 {
-    char clock_stamp[256];
-    char buf[256];
+    char     buf[N_LOG_LINE_SIZE];
+    va_list  fmt_args;
+    gboolean output = FALSE;
 
     (void) function;
     (void) line;
 
-    if (category < _log_level || _log_target == N_LOG_TARGET_NONE)
+    output = category >= _log_level && _log_target != N_LOG_TARGET_NONE;
+
+    if (category >= _record_level) {
+        va_start (fmt_args, fmt);
+        n_log_record (category, fmt, fmt_args);
+        va_end (fmt_args);
+
+        /* messages below the logging level are only recorded, they are
+           formatted when the recorder is dumped. */
+
+        if (!output)
+            return;
+
+        /* errors bring along whatever led up to them. if another dump is
+           running, the error is written out right away below. */
+
+        if (category == N_LOG_LEVEL_ERROR &&
+            n_log_dump_from ((guint) g_atomic_int_get (&_record_tail)))
+            return;
+    }
+
+    if (!output)
         return;
 
-    va_list fmt_args;
     va_start (fmt_args, fmt);
-    vsnprintf (buf, 256, fmt, fmt_args);
+    vsnprintf (buf, sizeof (buf), fmt, fmt_args);
     va_end (fmt_args);
 
-    if (_log_target == N_LOG_TARGET_SYSLOG) {
-        syslog (n_log_syslog_priority_from_level (category), "%s", buf);
-    }
-    else if (_log_target == N_LOG_TARGET_STDOUT) {
-        n_log_get_clock_stamp (clock_stamp, 256);
-        fprintf (stdout, "[%s] %s: %s\n", clock_stamp, n_log_level_to_string (category), buf);
-    }
+    n_log_output (category, NULL, buf);
 }
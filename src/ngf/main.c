@@ -20,6 +20,7 @@
  */
 
 #include <glib.h>
+#include <glib-unix.h>
 #include <getopt.h>
 #include <unistd.h>
 #include <signal.h>
@@ -101,6 +102,20 @@ install_signal_handler ()
     sigaction (SIGUSR1, &act, NULL);
 }
 
+static gboolean
+dump_traces_cb (gpointer userdata)
+{
+    AppData *app = (AppData*) userdata;
+
+    N_DEBUG (LOG_CAT "SIGUSR2");
+    n_log_dump_recorder ();
+    n_core_dump_traces (app->core);
+    n_core_dump_hook_stats (app->core);
+    n_core_dump_scheduler (app->core);
+
+    return TRUE;
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -119,6 +134,12 @@ main (int argc, char *argv[])
     if (!n_core_initialize (app->core))
         return 1;
 
+    /* the flight recorder, request timelines and hook and scheduler
+       statistics are written out on SIGUSR2, from the main loop so that
+       nothing is modified while writing. */
+
+    g_unix_signal_add (SIGUSR2, dump_traces_cb, app);
+
     g_main_loop_run   (app->loop);
     n_core_shutdown   (app->core);
     n_core_free       (app->core);
@@ -43,6 +43,7 @@ struct _NPlugin
     const char* (*get_version) ();
     int         (*load)        (NPlugin *plugin);
     void        (*unload)      (NPlugin *plugin);
+    const char* (*get_startup_depends) ();  /* optional */
 };
 
 NPlugin* n_plugin_load   (const char *plugin_name);
@@ -19,12 +19,76 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
  */
 
+#define _GNU_SOURCE
+#include <link.h>
 #include <ngf/log.h>
 #include <ngf/proplist.h>
 #include "plugin-internal.h"
 
 #define LOG_CAT "plugin: "
 
+typedef struct _NPluginRange
+{
+    const char *symbol;             /* any address within the module */
+    const char *start;
+    const char *end;
+} NPluginRange;
+
+static int
+n_plugin_find_range_cb (struct dl_phdr_info *info, size_t size, void *data)
+{
+    NPluginRange *range = (NPluginRange*) data;
+    const char   *start = NULL;
+    const char   *end   = NULL;
+    const char   *first = NULL;
+    const char   *last  = NULL;
+    gboolean      found = FALSE;
+    int           i     = 0;
+
+    (void) size;
+
+    for (i = 0; i < info->dlpi_phnum; ++i) {
+        if (info->dlpi_phdr[i].p_type != PT_LOAD)
+            continue;
+
+        start = (const char*) (info->dlpi_addr + info->dlpi_phdr[i].p_vaddr);
+        end   = start + info->dlpi_phdr[i].p_memsz;
+
+        if (range->symbol >= start && range->symbol < end)
+            found = TRUE;
+
+        if (!first || start < first)
+            first = start;
+        if (!last || end > last)
+            last = end;
+    }
+
+    if (!found)
+        return 0;
+
+    range->start = first;
+    range->end   = last;
+
+    return 1;
+}
+
+static void
+n_plugin_detach_log_records (NPlugin *plugin)
+{
+    NPluginRange range = { NULL, NULL, NULL };
+
+    /* recorded log messages may point to format strings within the
+       module, the rest of the recorder is kept. */
+
+    range.symbol = (const char*) plugin->get_name;
+    if (range.symbol && dl_iterate_phdr (n_plugin_find_range_cb, &range)) {
+        n_log_detach_records (range.start, range.end);
+        return;
+    }
+
+    n_log_detach_records (NULL, (const void*) G_MAXSIZE);
+}
+
 NPlugin*
 n_plugin_load (const char *filename)
 {
@@ -55,6 +119,12 @@ n_plugin_load (const char *filename)
 
 #undef LOAD_SYMBOL
 
+    /* plugins that can be loaded on a worker thread declare it. */
+
+    if (!g_module_symbol (plugin->module, "n_plugin__get_startup_depends",
+                          (gpointer*) &plugin->get_startup_depends))
+        plugin->get_startup_depends = NULL;
+
     return plugin;
 
 fail_load:
@@ -68,6 +138,7 @@ n_plugin_unload (NPlugin *plugin)
     g_assert (plugin != NULL);
 
     if (plugin->module) {
+        n_plugin_detach_log_records (plugin);
         g_module_close (plugin->module);
         plugin->module = NULL;
     }
@@ -104,7 +175,10 @@ n_plugin_register_sink (NPlugin *plugin, const NSinkInterfaceDecl *decl)
     if (!plugin || !decl)
         return;
 
-    n_core_register_sink (plugin->core, decl);
+    NSinkInterface *sink = NULL;
+
+    if ((sink = n_core_register_sink (plugin->core, decl)) != NULL)
+        sink->plugin = plugin;
 }
 
 void
@@ -113,6 +187,9 @@ n_plugin_register_input (NPlugin *plugin, const NInputInterfaceDecl *decl)
     if (!plugin || !decl)
         return;
 
-    n_core_register_input (plugin->core, decl);
+    NInputInterface *input = NULL;
+
+    if ((input = n_core_register_input (plugin->core, decl)) != NULL)
+        input->plugin = plugin;
 }
 
@@ -0,0 +1,65 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef N_PROPLIST_INTERNAL_H
+#define N_PROPLIST_INTERNAL_H
+
+#include <ngf/proplist.h>
+
+#include "arena.h"
+
+/* proplists keep their values in a sorted array until they grow past the
+   array limit, after which they switch to a hash table. */
+
+#define N_PROPLIST_DEFAULT_ARRAY_LIMIT 32
+
+/* number of read-only layers a proplist can be stacked on. */
+#define N_PROPLIST_MAX_LAYERS 4
+
+/* iterate proplist with the interned keys. */
+typedef void (*NProplistAtomFunc) (NAtom key, const NValue *value, gpointer userdata);
+
+void  n_proplist_foreach_atom    (const NProplist *proplist, NProplistAtomFunc func, gpointer userdata);
+
+/* change the array limit for proplists created or grown after the call.
+   zero forces hash tables for all proplists. */
+void  n_proplist_set_array_limit (guint limit);
+guint n_proplist_get_array_limit ();
+
+/* proplists allocated from an arena. the proplist and its values live
+   until the arena is cleared, n_proplist_free on them does nothing. */
+NProplist* n_proplist_new_in_arena  (NArena *arena);
+NProplist* n_proplist_copy_in_arena (const NProplist *source, NArena *arena);
+
+/* store a copy of value, the caller keeps the ownership of value. */
+void       n_proplist_set_atom_copy (NProplist *proplist, NAtom atom, const NValue *value);
+
+/* stack proplist on top of layer, below the earlier layers. values not set
+   in the proplist are looked up from the layers. layer must stay unchanged
+   and alive as long as proplist. once all the layers are in use, the
+   values of layer are copied instead. */
+void       n_proplist_add_layer     (NProplist *proplist, const NProplist *layer);
+
+/* apply the values set and unset in edit, but not in its layers, to
+   target. */
+void       n_proplist_apply         (NProplist *target, const NProplist *edit);
+
+#endif /* N_PROPLIST_INTERNAL_H */
@@ -19,19 +19,119 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
  */
 
+#include <string.h>
 #include <ngf/log.h>
 #include <ngf/proplist.h>
 
+#include "value-internal.h"
+#include "proplist-internal.h"
+#include "arena.h"
+
 #define LOG_CAT "proplist: "
 
+#define ATOM_TO_KEY(atom) GUINT_TO_POINTER (atom)
+#define KEY_TO_ATOM(key)  ((NAtom) GPOINTER_TO_UINT (key))
+
+#define MIN_SLOTS 8
+
+/* value type marking a key unset in a layered proplist, hiding the value
+   of the layers below. */
+#define TOMBSTONE_TYPE      G_MAXUINT
+#define IS_TOMBSTONE(value) ((value)->type == TOMBSTONE_TYPE)
+
+/* value type marking a slot that holds a value handed over with
+   n_proplist_set. the instance itself is kept, lookups return the same
+   pointer the caller passed in. */
+#define BOXED_TYPE          (G_MAXUINT - 1)
+#define IS_BOXED(value)     ((value)->type == BOXED_TYPE)
+#define SLOT_VALUE(slot)    (IS_BOXED (&(slot)->value) ? \
+                             (NValue*) (slot)->value.value.p : &(slot)->value)
+
+typedef struct _NProplistSlot
+{
+    NAtom  key;
+    NValue value;
+} NProplistSlot;
+
+/* small proplists keep the values inline in a contiguous array sorted by
+   key. once the array limit is exceeded, the values are moved to a hash
+   table and the proplist stays in that mode.
+
+   proplists created in an arena take the slots and the string values from
+   the arena and stay in array mode regardless of the size. nothing is freed
+   until the arena is cleared.
+
+   a proplist may be layered on top of read-only proplists. lookups fall
+   through to the layers in order, writes always go to the proplist itself
+   and unsetting a key visible in a layer leaves a tombstone behind. */
+
 struct _NProplist {
-    GHashTable *values;
+    NProplistSlot   *slots;         /* sorted by key, used while values is NULL */
+    guint            num_slots;
+    guint            max_slots;
+    GHashTable      *values;        /* NAtom -> NValue* */
+    NArena          *arena;         /* storage for slots and strings, or NULL */
+
+    const NProplist *layers[N_PROPLIST_MAX_LAYERS];  /* highest precedence first */
+    guint            num_layers;
 };
 
-static void    n_proplist_free_value    (gpointer data);
-static void    n_proplist_replace_value (gpointer key, gpointer value, gpointer userdata);
+typedef struct _NProplistLayerData
+{
+    const NProplist   *proplist;
+    guint              layer;       /* layers above this one shadow the values */
+    NProplistAtomFunc  func;
+    gpointer           userdata;
+} NProplistLayerData;
 
+typedef struct _NProplistKeyData
+{
+    NProplistFunc func;
+    gpointer      userdata;
+} NProplistKeyData;
 
+typedef struct _NProplistMatchData
+{
+    const NProplist *other;
+    gboolean         match;
+} NProplistMatchData;
+
+static guint array_limit = N_PROPLIST_DEFAULT_ARRAY_LIMIT;
+
+static void     n_proplist_free_value      (gpointer data);
+static void     n_proplist_copy_value      (NProplist *proplist, NValue *dest, const NValue *source);
+static void     n_proplist_clean_value     (NProplist *proplist, NValue *value);
+static gboolean n_proplist_find_slot       (const NProplist *proplist, NAtom key, guint *index);
+static void     n_proplist_reserve         (NProplist *proplist, guint size);
+static void     n_proplist_convert_to_hash (NProplist *proplist);
+static void     n_proplist_store           (NProplist *proplist, NAtom key, const NValue *value);
+static void     n_proplist_store_copy      (NProplist *proplist, NAtom key, const NValue *value);
+static void     n_proplist_merge_all       (NProplist *target, const NProplist *source);
+static void     n_proplist_copy_all        (NProplist *proplist, const NProplist *source);
+static gboolean n_proplist_lookup_own      (const NProplist *proplist, NAtom key, NValue **value);
+static gboolean n_proplist_lookup          (const NProplist *proplist, NAtom key, guint num_layers, NValue **value);
+static void     n_proplist_foreach_own     (const NProplist *proplist, gboolean tombstones, NProplistAtomFunc func, gpointer userdata);
+static void     n_proplist_layer_cb        (NAtom key, const NValue *value, gpointer userdata);
+static void     n_proplist_key_cb          (NAtom key, const NValue *value, gpointer userdata);
+static void     n_proplist_count_cb        (NAtom key, const NValue *value, gpointer userdata);
+static void     n_proplist_match_cb        (NAtom key, const NValue *value, gpointer userdata);
+static void     n_proplist_store_copy_cb   (NAtom key, const NValue *value, gpointer userdata);
+static void     n_proplist_apply_cb        (NAtom key, const NValue *value, gpointer userdata);
+static void     n_proplist_dump_value_cb   (const char *key, const NValue *value, gpointer userdata);
+
+
+
+void
+n_proplist_set_array_limit (guint limit)
+{
+    array_limit = limit;
+}
+
+guint
+n_proplist_get_array_limit ()
+{
+    return array_limit;
+}
 
 static void
 n_proplist_free_value (gpointer data)
@@ -40,26 +140,302 @@ n_proplist_free_value (gpointer data)
 }
 
 static void
-n_proplist_replace_value (gpointer key, gpointer value, gpointer userdata)
+n_proplist_copy_value (NProplist *proplist, NValue *dest, const NValue *source)
 {
-    GHashTable *values = (GHashTable*) userdata;
-    NValue    *v       = (NValue*) value;
+    if (!proplist->arena) {
+        n_value_copy_to (dest, source);
+        return;
+    }
 
-    g_hash_table_replace (values, g_strdup (key), n_value_copy (v));
+    *dest = *source;
+    if (source->type == N_VALUE_TYPE_STRING)
+        dest->value.s = n_arena_strdup (proplist->arena, source->value.s);
+}
+
+static void
+n_proplist_clean_value (NProplist *proplist, NValue *value)
+{
+    if (IS_BOXED (value))
+        n_value_free ((NValue*) value->value.p);
+    else if (!proplist->arena)
+        n_value_clean (value);
+}
+
+static gboolean
+n_proplist_find_slot (const NProplist *proplist, NAtom key, guint *index)
+{
+    guint low  = 0;
+    guint high = proplist->num_slots;
+    guint mid  = 0;
+
+    while (low < high) {
+        mid = (low + high) / 2;
+        if (proplist->slots[mid].key < key)
+            low = mid + 1;
+        else if (proplist->slots[mid].key > key)
+            high = mid;
+        else {
+            *index = mid;
+            return TRUE;
+        }
+    }
+
+    *index = low;
+    return FALSE;
+}
+
+static void
+n_proplist_reserve (NProplist *proplist, guint size)
+{
+    NProplistSlot *slots     = NULL;
+    guint          max_slots = proplist->max_slots > 0 ? proplist->max_slots : MIN_SLOTS;
+
+    if (size <= proplist->max_slots)
+        return;
+
+    while (max_slots < size)
+        max_slots *= 2;
+
+    if (proplist->arena) {
+        slots = n_arena_alloc (proplist->arena, max_slots * sizeof (NProplistSlot));
+        if (proplist->num_slots > 0)
+            memcpy (slots, proplist->slots, proplist->num_slots * sizeof (NProplistSlot));
+        proplist->slots = slots;
+    }
+    else
+        proplist->slots = g_renew (NProplistSlot, proplist->slots, max_slots);
+
+    proplist->max_slots = max_slots;
+}
+
+static void
+n_proplist_convert_to_hash (NProplist *proplist)
+{
+    NValue *value = NULL;
+    guint   i;
+
+    proplist->values = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+        n_proplist_free_value);
+
+    for (i = 0; i < proplist->num_slots; ++i) {
+        if (IS_BOXED (&proplist->slots[i].value))
+            value = (NValue*) proplist->slots[i].value.value.p;
+        else {
+            value  = g_slice_new (NValue);
+            *value = proplist->slots[i].value;
+        }
+        g_hash_table_insert (proplist->values,
+            ATOM_TO_KEY (proplist->slots[i].key), value);
+    }
+
+    g_free (proplist->slots);
+    proplist->slots     = NULL;
+    proplist->num_slots = 0;
+    proplist->max_slots = 0;
+}
+
+static void
+n_proplist_store (NProplist *proplist, NAtom key, const NValue *value)
+{
+    NProplistSlot *slot  = NULL;
+    NValue        *v     = NULL;
+    guint          index = 0;
+
+    /* contents of value are moved to the proplist, the caller is not
+       supposed to clean it afterwards. strings must already come from the
+       arena for proplists in an arena. */
+
+    if (!proplist->values) {
+        if (n_proplist_find_slot (proplist, key, &index)) {
+            n_proplist_clean_value (proplist, &proplist->slots[index].value);
+            proplist->slots[index].value = *value;
+            return;
+        }
+
+        if (proplist->num_slots < array_limit || proplist->arena) {
+            n_proplist_reserve (proplist, proplist->num_slots + 1);
+            slot = &proplist->slots[index];
+            memmove (slot + 1, slot,
+                (proplist->num_slots - index) * sizeof (NProplistSlot));
+            slot->key   = key;
+            slot->value = *value;
+            proplist->num_slots++;
+            return;
+        }
+
+        n_proplist_convert_to_hash (proplist);
+    }
+
+    if (IS_BOXED (value))
+        v = (NValue*) value->value.p;
+    else {
+        v  = g_slice_new (NValue);
+        *v = *value;
+    }
+    g_hash_table_replace (proplist->values, ATOM_TO_KEY (key), v);
+}
+
+static void
+n_proplist_store_copy (NProplist *proplist, NAtom key, const NValue *value)
+{
+    NValue v;
+
+    n_proplist_copy_value (proplist, &v, value);
+    n_proplist_store (proplist, key, &v);
+}
+
+static void
+n_proplist_store_copy_cb (NAtom key, const NValue *value, gpointer userdata)
+{
+    n_proplist_store_copy ((NProplist*) userdata, key, value);
+}
+
+static void
+n_proplist_merge_all (NProplist *target, const NProplist *source)
+{
+    n_proplist_foreach_atom (source, n_proplist_store_copy_cb, target);
+}
+
+static gboolean
+n_proplist_lookup_own (const NProplist *proplist, NAtom key, NValue **value)
+{
+    guint index = 0;
+
+    if (proplist->values)
+        *value = (NValue*) g_hash_table_lookup (proplist->values, ATOM_TO_KEY (key));
+    else if (n_proplist_find_slot (proplist, key, &index))
+        *value = SLOT_VALUE (&proplist->slots[index]);
+    else
+        *value = NULL;
+
+    return *value != NULL ? TRUE : FALSE;
+}
+
+static gboolean
+n_proplist_lookup (const NProplist *proplist, NAtom key, guint num_layers,
+                   NValue **value)
+{
+    guint i;
+
+    /* returns TRUE if the key was found from the proplist or from the
+       given number of the topmost layers, value is NULL if it was unset.
+       a key unset within a layer is only hidden in that layer, the layers
+       below it still count. */
+
+    if (n_proplist_lookup_own (proplist, key, value)) {
+        if (IS_TOMBSTONE (*value))
+            *value = NULL;
+        return TRUE;
+    }
+
+    for (i = 0; i < num_layers; ++i) {
+        if ((*value = n_proplist_get_atom (proplist->layers[i], key)) != NULL)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static void
+n_proplist_foreach_own (const NProplist *proplist, gboolean tombstones,
+                        NProplistAtomFunc func, gpointer userdata)
+{
+    gpointer        key   = NULL;
+    NValue         *value = NULL;
+    GHashTableIter  iter;
+    guint           i;
+
+    if (proplist->values) {
+        g_hash_table_iter_init (&iter, proplist->values);
+        while (g_hash_table_iter_next (&iter, &key, (gpointer) &value)) {
+            if (tombstones || !IS_TOMBSTONE (value))
+                func (KEY_TO_ATOM (key), value, userdata);
+        }
+        return;
+    }
+
+    for (i = 0; i < proplist->num_slots; ++i) {
+        if (tombstones || !IS_TOMBSTONE (&proplist->slots[i].value))
+            func (proplist->slots[i].key, SLOT_VALUE (&proplist->slots[i]), userdata);
+    }
+}
+
+static void
+n_proplist_layer_cb (NAtom key, const NValue *value, gpointer userdata)
+{
+    NProplistLayerData *data   = (NProplistLayerData*) userdata;
+    NValue             *shadow = NULL;
+
+    /* skip the keys that are set or unset above this layer. */
+
+    if (n_proplist_lookup (data->proplist, key, data->layer, &shadow))
+        return;
+
+    data->func (key, value, data->userdata);
+}
+
+static void
+n_proplist_key_cb (NAtom key, const NValue *value, gpointer userdata)
+{
+    NProplistKeyData *data = (NProplistKeyData*) userdata;
+
+    data->func (n_atom_to_string (key), value, data->userdata);
+}
+
+static void
+n_proplist_count_cb (NAtom key, const NValue *value, gpointer userdata)
+{
+    (void) key;
+    (void) value;
+
+    ++(*(int*) userdata);
 }
 
 NProplist*
 n_proplist_new ()
+{
+    return g_slice_new0 (NProplist);
+}
+
+NProplist*
+n_proplist_new_in_arena (NArena *arena)
 {
     NProplist *proplist = NULL;
 
-    proplist = g_slice_new0 (NProplist);
-    proplist->values = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
-        n_proplist_free_value);
+    g_assert (arena != NULL);
+
+    proplist = n_arena_alloc0 (arena, sizeof (NProplist));
+    proplist->arena = arena;
 
     return proplist;
 }
 
+static void
+n_proplist_copy_all (NProplist *proplist, const NProplist *source)
+{
+    guint i;
+
+    if (source->values || source->num_layers > 0) {
+        n_proplist_merge_all (proplist, source);
+        return;
+    }
+
+    /* keys are already sorted, copy the slots as they are. */
+
+    if (source->num_slots > 0) {
+        n_proplist_reserve (proplist, source->num_slots);
+        for (i = 0; i < source->num_slots; ++i) {
+            proplist->slots[i].key = source->slots[i].key;
+            n_proplist_copy_value (proplist, &proplist->slots[i].value,
+                SLOT_VALUE (&source->slots[i]));
+        }
+        proplist->num_slots = source->num_slots;
+
+        if (proplist->num_slots > array_limit && !proplist->arena)
+            n_proplist_convert_to_hash (proplist);
+    }
+}
+
 NProplist*
 n_proplist_copy (const NProplist *source)
 {
@@ -69,7 +445,22 @@ n_proplist_copy (const NProplist *source)
         return NULL;
 
     proplist = n_proplist_new ();
-    g_hash_table_foreach (source->values, n_proplist_replace_value, proplist->values);
+    n_proplist_copy_all (proplist, source);
+
+    return proplist;
+}
+
+NProplist*
+n_proplist_copy_in_arena (const NProplist *source, NArena *arena)
+{
+    NProplist *proplist = NULL;
+
+    if (!source)
+        return NULL;
+
+    proplist = n_proplist_new_in_arena (arena);
+    n_proplist_copy_all (proplist, source);
+
     return proplist;
 }
 
@@ -79,13 +470,13 @@ n_proplist_copy_keys (const NProplist *source, GList *keys)
     NProplist  *proplist = NULL;
     NValue     *value    = NULL;
     GList      *iter     = NULL;
+    NAtom       atom     = N_ATOM_NONE;
 
     proplist = n_proplist_new ();
     for (iter = g_list_first (keys); iter; iter = g_list_next (iter)) {
-        if ((value = n_proplist_get (source, (const char*) iter->data))) {
-            g_hash_table_insert (proplist->values,
-                g_strdup ((const char*) iter->data), n_value_copy (value));
-        }
+        atom = n_atom_lookup ((const char*) iter->data);
+        if ((value = n_proplist_get_atom (source, atom)))
+            n_proplist_store_copy (proplist, atom, value);
     }
 
     return proplist;
@@ -94,11 +485,59 @@ n_proplist_copy_keys (const NProplist *source, GList *keys)
 void
 n_proplist_merge (NProplist *target, const NProplist *source)
 {
+    NProplistSlot *merged = NULL;
+    NProplistSlot *t      = NULL;
+    NProplistSlot *s      = NULL;
+    guint          i      = 0;
+    guint          j      = 0;
+    guint          n      = 0;
+
     if (!target || !source)
         return;
 
-    g_hash_table_foreach (source->values, n_proplist_replace_value,
-        target->values);
+    if (target->values || source->values || source->num_layers > 0) {
+        n_proplist_merge_all (target, source);
+        return;
+    }
+
+    if (source->num_slots == 0)
+        return;
+
+    /* both proplists are sorted, merge them in a single pass. values from
+       source replace the ones in target. */
+
+    t = target->slots;
+    s = source->slots;
+    n = target->num_slots + source->num_slots;
+    merged = target->arena ?
+        n_arena_alloc (target->arena, n * sizeof (NProplistSlot)) :
+        g_new (NProplistSlot, n);
+    n = 0;
+
+    while (i < target->num_slots || j < source->num_slots) {
+        if (j >= source->num_slots || (i < target->num_slots && t[i].key < s[j].key)) {
+            merged[n++] = t[i++];
+            continue;
+        }
+
+        if (i < target->num_slots && t[i].key == s[j].key)
+            n_proplist_clean_value (target, &t[i++].value);
+
+        merged[n].key = s[j].key;
+        n_proplist_copy_value (target, &merged[n].value, SLOT_VALUE (&s[j]));
+        ++n;
+        ++j;
+    }
+
+    if (!target->arena)
+        g_free (target->slots);
+
+    target->slots     = merged;
+    target->num_slots = n;
+    target->max_slots = i + j;
+
+    if (target->num_slots > array_limit && !target->arena)
+        n_proplist_convert_to_hash (target);
 }
 
 void
@@ -106,6 +545,7 @@ n_proplist_merge_keys (NProplist *target, const NProplist *source, GList *keys)
 {
     NValue *value = NULL;
     GList  *iter  = NULL;
+    NAtom   atom  = N_ATOM_NONE;
 
     if (!target || !source)
         return;
@@ -114,67 +554,135 @@ n_proplist_merge_keys (NProplist *target, const NProplist *source, GList *keys)
         n_proplist_merge (target, source);
 
     for (iter = g_list_first (keys); iter; iter = g_list_next (iter)) {
-        if ((value = n_proplist_get (source, (const char*) iter->data))) {
-            g_hash_table_replace (target->values,
-                g_strdup ((const char*) iter->data), n_value_copy (value));
-        }
+        atom = n_atom_lookup ((const char*) iter->data);
+        if ((value = n_proplist_get_atom (source, atom)))
+            n_proplist_store_copy (target, atom, value);
     }
 }
 
 void
 n_proplist_free (NProplist *proplist)
 {
-    if (!proplist)
+    guint i;
+
+    /* proplists in an arena are released along with the arena. */
+
+    if (!proplist || proplist->arena)
         return;
 
-    g_hash_table_destroy (proplist->values);
+    if (proplist->values)
+        g_hash_table_destroy (proplist->values);
+
+    for (i = 0; i < proplist->num_slots; ++i)
+        n_proplist_clean_value (proplist, &proplist->slots[i].value);
+
+    g_free (proplist->slots);
     g_slice_free (NProplist, proplist);
 }
 
 int
 n_proplist_size (const NProplist *proplist)
 {
+    int size = 0;
+
     if (!proplist)
         return 0;
 
-    return g_hash_table_size (proplist->values);
+    if (proplist->num_layers == 0)
+        return proplist->values ? g_hash_table_size (proplist->values) :
+            proplist->num_slots;
+
+    n_proplist_foreach_atom (proplist, n_proplist_count_cb, &size);
+    return size;
 }
 
 void
 n_proplist_foreach (const NProplist *proplist, NProplistFunc func, gpointer userdata)
 {
-    const char     *key   = NULL;
+    gpointer        key   = NULL;
     NValue         *value = NULL;
     GHashTableIter  iter;
+    guint           i;
+
+    NProplistKeyData data;
+
+    if (!proplist || !func)
+        return;
+
+    if (proplist->num_layers > 0) {
+        data.func     = func;
+        data.userdata = userdata;
+        n_proplist_foreach_atom (proplist, n_proplist_key_cb, &data);
+        return;
+    }
+
+    if (proplist->values) {
+        g_hash_table_iter_init (&iter, proplist->values);
+        while (g_hash_table_iter_next (&iter, &key, (gpointer) &value))
+            func (n_atom_to_string (KEY_TO_ATOM (key)), value, userdata);
+        return;
+    }
+
+    for (i = 0; i < proplist->num_slots; ++i)
+        func (n_atom_to_string (proplist->slots[i].key),
+            SLOT_VALUE (&proplist->slots[i]), userdata);
+}
+
+void
+n_proplist_foreach_atom (const NProplist *proplist, NProplistAtomFunc func,
+                         gpointer userdata)
+{
+    NProplistLayerData data;
+    guint              i;
 
     if (!proplist || !func)
         return;
 
-    g_hash_table_iter_init (&iter, proplist->values);
-    while (g_hash_table_iter_next (&iter, (gpointer) &key, (gpointer) &value)) {
-        func (key, value, userdata);
+    n_proplist_foreach_own (proplist, FALSE, func, userdata);
+
+    data.proplist = proplist;
+    data.func     = func;
+    data.userdata = userdata;
+
+    for (i = 0; i < proplist->num_layers; ++i) {
+        data.layer = i;
+        n_proplist_foreach_atom (proplist->layers[i], n_proplist_layer_cb, &data);
     }
 }
 
 gboolean
 n_proplist_is_empty (const NProplist *proplist)
 {
-    return (proplist && g_hash_table_size (proplist->values) == 0) ? TRUE : FALSE;
+    return (proplist && n_proplist_size (proplist) == 0) ? TRUE : FALSE;
 }
 
 gboolean
 n_proplist_has_key (const NProplist *proplist, const char *key)
 {
-    return (proplist && g_hash_table_lookup (proplist->values, key) != NULL) ? TRUE : FALSE;
+    return n_proplist_has_atom (proplist, n_atom_lookup (key));
+}
+
+gboolean
+n_proplist_has_atom (const NProplist *proplist, NAtom atom)
+{
+    return n_proplist_get_atom (proplist, atom) != NULL ? TRUE : FALSE;
+}
+
+static void
+n_proplist_match_cb (NAtom key, const NValue *value, gpointer userdata)
+{
+    NProplistMatchData *data = (NProplistMatchData*) userdata;
+
+    if (data->match && !n_value_equals (value, n_proplist_get_atom (data->other, key)))
+        data->match = FALSE;
 }
 
 gboolean
 n_proplist_match_exact (const NProplist *a, const NProplist *b)
 {
-    const char *key   = NULL;
-    NValue     *value = NULL;
-    NValue     *match = NULL;
-    GHashTableIter iter;
+    NProplistMatchData data;
+    NValue            *match = NULL;
+    guint              i;
 
     if (!a || !b)
         return FALSE;
@@ -184,23 +692,71 @@ n_proplist_match_exact (const NProplist *a, const NProplist *b)
 
     /* check if the keys and values match. */
 
-    g_hash_table_iter_init (&iter, a->values);
-    while (g_hash_table_iter_next (&iter, (gpointer) &key, (gpointer) &value)) {
-        match = (NValue*) g_hash_table_lookup (b->values, key);
-        if (!n_value_equals (value, match))
-            return FALSE;
+    if (!a->values && !b->values && a->num_layers == 0 && b->num_layers == 0) {
+        for (i = 0; i < a->num_slots; ++i) {
+            if (a->slots[i].key != b->slots[i].key)
+                return FALSE;
+            if (!n_value_equals (SLOT_VALUE (&a->slots[i]), SLOT_VALUE (&b->slots[i])))
+                return FALSE;
+        }
+        return TRUE;
+    }
+
+    if (!a->values && a->num_layers == 0) {
+        for (i = 0; i < a->num_slots; ++i) {
+            match = n_proplist_get_atom (b, a->slots[i].key);
+            if (!n_value_equals (SLOT_VALUE (&a->slots[i]), match))
+                return FALSE;
+        }
+        return TRUE;
     }
 
-    return TRUE;
+    data.other = b;
+    data.match = TRUE;
+    n_proplist_foreach_atom (a, n_proplist_match_cb, &data);
+
+    return data.match;
 }
 
 void
 n_proplist_unset (NProplist *proplist, const char *key)
 {
-    if (!proplist || !key)
+    n_proplist_unset_atom (proplist, n_atom_lookup (key));
+}
+
+void
+n_proplist_unset_atom (NProplist *proplist, NAtom atom)
+{
+    NValue tombstone;
+    guint  index = 0;
+    guint  i;
+
+    if (!proplist || !atom)
         return;
 
-    g_hash_table_remove (proplist->values, key);
+    /* the layers are read-only, hide the value instead. */
+
+    for (i = 0; i < proplist->num_layers; ++i) {
+        if (n_proplist_get_atom (proplist->layers[i], atom)) {
+            n_value_init (&tombstone);
+            tombstone.type = TOMBSTONE_TYPE;
+            n_proplist_store (proplist, atom, &tombstone);
+            return;
+        }
+    }
+
+    if (proplist->values) {
+        g_hash_table_remove (proplist->values, ATOM_TO_KEY (atom));
+        return;
+    }
+
+    if (!n_proplist_find_slot (proplist, atom, &index))
+        return;
+
+    n_proplist_clean_value (proplist, &proplist->slots[index].value);
+    memmove (&proplist->slots[index], &proplist->slots[index + 1],
+        (proplist->num_slots - index - 1) * sizeof (NProplistSlot));
+    proplist->num_slots--;
 }
 
 void
@@ -209,7 +765,75 @@ n_proplist_set (NProplist *proplist, const char *key, const NValue *value)
     if (!proplist || !key || !value)
         return;
 
-    g_hash_table_replace (proplist->values, g_strdup (key), (gpointer) value);
+    n_proplist_set_atom (proplist, n_atom_intern (key), value);
+}
+
+void
+n_proplist_set_atom (NProplist *proplist, NAtom atom, const NValue *value)
+{
+    NValue boxed;
+
+    if (!proplist || !atom || !value)
+        return;
+
+    if (proplist->values) {
+        g_hash_table_replace (proplist->values, ATOM_TO_KEY (atom), (gpointer) value);
+        return;
+    }
+
+    /* nothing in an arena is freed one by one, the value is copied. */
+
+    if (proplist->arena) {
+        n_proplist_store_copy (proplist, atom, value);
+        n_value_free ((NValue*) value);
+        return;
+    }
+
+    n_value_init (&boxed);
+    boxed.type    = BOXED_TYPE;
+    boxed.value.p = (gpointer) value;
+    n_proplist_store (proplist, atom, &boxed);
+}
+
+void
+n_proplist_set_take (NProplist *proplist, const char *key, NValue *value)
+{
+    if (!proplist || !key || !value)
+        return;
+
+    n_proplist_set_take_atom (proplist, n_atom_intern (key), value);
+}
+
+void
+n_proplist_set_take_atom (NProplist *proplist, NAtom atom, NValue *value)
+{
+    if (!proplist || !atom || !value)
+        return;
+
+    if (proplist->values) {
+        g_hash_table_replace (proplist->values, ATOM_TO_KEY (atom), value);
+        return;
+    }
+
+    /* value is stored inline, release the container. */
+
+    if (proplist->arena) {
+        n_proplist_store_copy (proplist, atom, value);
+        n_value_free (value);
+        return;
+    }
+
+    n_proplist_store (proplist, atom, value);
+    g_slice_free (NValue, value);
+}
+
+void
+n_proplist_set_atom_copy (NProplist *proplist, NAtom atom, const NValue *value)
+{
+    if (!proplist || !atom || !value)
+        return;
+
+    n_proplist_store_copy (proplist, atom, value);
 }
 
 NValue*
@@ -218,31 +842,138 @@ n_proplist_get (const NProplist *proplist, const char *key)
     if (!proplist || !key)
         return NULL;
 
-    return (NValue*) g_hash_table_lookup (proplist->values, key);
+    /* key that was never interned can not be in any proplist. */
+
+    return n_proplist_get_atom (proplist, n_atom_lookup (key));
+}
+
+NValue*
+n_proplist_get_atom (const NProplist *proplist, NAtom atom)
+{
+    NValue *value = NULL;
+
+    if (!proplist || !atom)
+        return NULL;
+
+    (void) n_proplist_lookup (proplist, atom, proplist->num_layers, &value);
+    return value;
 }
 
 void
-n_proplist_set_string (NProplist *proplist, const char *key, const char *value)
+n_proplist_add_layer (NProplist *proplist, const NProplist *layer)
+{
+    NProplistLayerData data;
+
+    g_assert (proplist != NULL);
+    g_assert (layer != proplist);
+
+    if (!layer)
+        return;
+
+    if (proplist->num_layers < N_PROPLIST_MAX_LAYERS) {
+        proplist->layers[proplist->num_layers++] = layer;
+        return;
+    }
+
+    /* out of layers, copy the values that are not shadowed instead. */
+
+    data.proplist = proplist;
+    data.layer    = proplist->num_layers;
+    data.func     = n_proplist_store_copy_cb;
+    data.userdata = proplist;
+    n_proplist_foreach_atom (layer, n_proplist_layer_cb, &data);
+}
+
+static void
+n_proplist_apply_cb (NAtom key, const NValue *value, gpointer userdata)
 {
-    NValue *v = NULL;
+    NProplist *target = (NProplist*) userdata;
+
+    if (IS_TOMBSTONE (value))
+        n_proplist_unset_atom (target, key);
+    else
+        n_proplist_store_copy (target, key, value);
+}
+
+void
+n_proplist_apply (NProplist *target, const NProplist *edit)
+{
+    if (!target || !edit)
+        return;
 
+    /* only the changes made in edit itself are applied, the layers of
+       edit are what it was editing. */
+
+    n_proplist_foreach_own (edit, TRUE, n_proplist_apply_cb, target);
+}
+
+void
+n_proplist_set_string (NProplist *proplist, const char *key, const char *value)
+{
     if (!proplist || !key || !value)
         return;
 
-    v = n_value_new ();
-    n_value_set_string (v, value);
-    n_proplist_set (proplist, key, v);
+    n_proplist_set_string_atom (proplist, n_atom_intern (key), value);
+}
+
+void
+n_proplist_set_string_atom (NProplist *proplist, NAtom atom, const char *value)
+{
+    NValue v;
+
+    if (!proplist || !atom || !value)
+        return;
+
+    n_value_init (&v);
+
+    if (proplist->arena) {
+        v.type    = N_VALUE_TYPE_STRING;
+        v.value.s = n_arena_strdup (proplist->arena, value);
+    }
+    else
+        n_value_set_string (&v, value);
+
+    n_proplist_store (proplist, atom, &v);
+}
+
+void
+n_proplist_set_string_borrowed_atom (NProplist *proplist, NAtom atom, const char *value)
+{
+    NValue v;
+
+    if (!proplist || !atom || !value)
+        return;
+
+    if (!proplist->arena) {
+        n_proplist_set_string_atom (proplist, atom, value);
+        return;
+    }
+
+    /* the arena is never cleaned value by value, the pointer can be kept
+       as long as the owner of the string outlives the arena. */
+
+    n_value_init (&v);
+    v.type    = N_VALUE_TYPE_STRING;
+    v.value.s = (gchar*) value;
+
+    n_proplist_store (proplist, atom, &v);
 }
 
 const char*
 n_proplist_get_string (const NProplist *proplist, const char *key)
 {
-    NValue *value = NULL;
-
     if (!proplist || !key)
         return NULL;
 
-    value = n_proplist_get ((NProplist*) proplist, key);
+    return n_proplist_get_string_atom (proplist, n_atom_lookup (key));
+}
+
+const char*
+n_proplist_get_string_atom (const NProplist *proplist, NAtom atom)
+{
+    NValue *value = NULL;
+
+    value = n_proplist_get_atom (proplist, atom);
     return (value && n_value_type (value) == N_VALUE_TYPE_STRING) ?
         (const char*) n_value_get_string (value) : NULL;
 }
@@ -256,25 +987,40 @@ n_proplist_dup_string (const NProplist *proplist, const char *key)
 void
 n_proplist_set_int (NProplist *proplist, const char *key, gint value)
 {
-    NValue *v = NULL;
-
     if (!proplist || !key)
         return;
 
-    v = n_value_new ();
-    n_value_set_int (v, value);
-    n_proplist_set (proplist, key, v);
+    n_proplist_set_int_atom (proplist, n_atom_intern (key), value);
+}
+
+void
+n_proplist_set_int_atom (NProplist *proplist, NAtom atom, gint value)
+{
+    NValue v;
+
+    if (!proplist || !atom)
+        return;
+
+    n_value_init (&v);
+    n_value_set_int (&v, value);
+    n_proplist_store (proplist, atom, &v);
 }
 
 gint
 n_proplist_get_int (const NProplist *proplist, const char *key)
 {
-    NValue *value = NULL;
-
     if (!proplist || !key)
         return 0;
 
-    value = n_proplist_get (proplist, key);
+    return n_proplist_get_int_atom (proplist, n_atom_lookup (key));
+}
+
+gint
+n_proplist_get_int_atom (const NProplist *proplist, NAtom atom)
+{
+    NValue *value = NULL;
+
+    value = n_proplist_get_atom (proplist, atom);
     return (value && n_value_type (value) == N_VALUE_TYPE_INT) ?
         n_value_get_int (value) : 0;
 }
@@ -282,25 +1028,40 @@ n_proplist_get_int (const NProplist *proplist, const char *key)
 void
 n_proplist_set_uint (NProplist *proplist, const char *key, guint value)
 {
-    NValue *v = NULL;
-
     if (!proplist || !key)
         return;
 
-    v = n_value_new ();
-    n_value_set_uint (v, value);
-    n_proplist_set (proplist, key, v);
+    n_proplist_set_uint_atom (proplist, n_atom_intern (key), value);
+}
+
+void
+n_proplist_set_uint_atom (NProplist *proplist, NAtom atom, guint value)
+{
+    NValue v;
+
+    if (!proplist || !atom)
+        return;
+
+    n_value_init (&v);
+    n_value_set_uint (&v, value);
+    n_proplist_store (proplist, atom, &v);
 }
 
 guint
 n_proplist_get_uint (const NProplist *proplist, const char *key)
 {
-    NValue *value = NULL;
-
     if (!proplist || !key)
         return 0;
 
-    value = n_proplist_get (proplist, key);
+    return n_proplist_get_uint_atom (proplist, n_atom_lookup (key));
+}
+
+guint
+n_proplist_get_uint_atom (const NProplist *proplist, NAtom atom)
+{
+    NValue *value = NULL;
+
+    value = n_proplist_get_atom (proplist, atom);
     return (value && n_value_type (value) == N_VALUE_TYPE_UINT) ?
         n_value_get_uint (value) : 0;
 }
@@ -308,25 +1069,40 @@ n_proplist_get_uint (const NProplist *proplist, const char *key)
 void
 n_proplist_set_bool (NProplist *proplist, const char *key, gboolean value)
 {
-    NValue *v = NULL;
-
     if (!proplist || !key)
         return;
 
-    v = n_value_new ();
-    n_value_set_bool (v, value);
-    n_proplist_set (proplist, key, v);
+    n_proplist_set_bool_atom (proplist, n_atom_intern (key), value);
+}
+
+void
+n_proplist_set_bool_atom (NProplist *proplist, NAtom atom, gboolean value)
+{
+    NValue v;
+
+    if (!proplist || !atom)
+        return;
+
+    n_value_init (&v);
+    n_value_set_bool (&v, value);
+    n_proplist_store (proplist, atom, &v);
 }
 
 gboolean
 n_proplist_get_bool (const NProplist *proplist, const char *key)
 {
-    NValue *value = NULL;
-
     if (!proplist || !key)
         return FALSE;
 
-    value = n_proplist_get ((NProplist*) proplist, key);
+    return n_proplist_get_bool_atom (proplist, n_atom_lookup (key));
+}
+
+gboolean
+n_proplist_get_bool_atom (const NProplist *proplist, NAtom atom)
+{
+    NValue *value = NULL;
+
+    value = n_proplist_get_atom (proplist, atom);
     return (value && n_value_type (value) == N_VALUE_TYPE_BOOL) ?
         n_value_get_bool (value) : FALSE;
 }
@@ -335,14 +1111,14 @@ n_proplist_get_bool (const NProplist *proplist, const char *key)
 void
 n_proplist_set_pointer (NProplist *proplist, const char *key, gpointer value)
 {
-    NValue *v = NULL;
+    NValue v;
 
     if (!proplist || !key)
         return;
 
-    v = n_value_new ();
-    n_value_set_pointer (v, value);
-    n_proplist_set (proplist, key, v);
+    n_value_init (&v);
+    n_value_set_pointer (&v, value);
+    n_proplist_store (proplist, n_atom_intern (key), &v);
 }
 
 gpointer
@@ -358,20 +1134,19 @@ n_proplist_get_pointer (const NProplist *proplist, const char *key)
         n_value_get_pointer (value) : NULL;
 }
 
-void
-n_proplist_dump (const NProplist *proplist)
+static void
+n_proplist_dump_value_cb (const char *key, const NValue *value, gpointer userdata)
 {
-    GHashTableIter iter;
-    gchar *key = NULL;
-    NValue *value = NULL;
-    gchar *str_value = NULL;
+    (void) userdata;
 
-    g_hash_table_iter_init (&iter, proplist->values);
-    while (g_hash_table_iter_next (&iter, (gpointer) &key, (gpointer) &value)) {
-        str_value = n_value_to_string (value);
-        N_DEBUG (LOG_CAT "%s = %s", key, str_value);
-        g_free (str_value);
-    }
+    n_value_log_debug (LOG_CAT, key, value);
 }
 
+void
+n_proplist_dump (const NProplist *proplist)
+{
+    if (!n_log_enabled (N_LOG_LEVEL_DEBUG))
+        return;
 
+    n_proplist_foreach (proplist, n_proplist_dump_value_cb, NULL);
+}
@@ -0,0 +1,262 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#include <string.h>
+#include <ngf/log.h>
+#include <ngf/proplist.h>
+#include "request-admission.h"
+#include "request-internal.h"
+#include "event-internal.h"
+
+#define LOG_CAT "admission: "
+
+typedef struct _NAdmissionPolicy
+{
+    gboolean            stale;          /* events changed, limits must be read again */
+    gint64              min_interval;   /* ns between admitted requests, 0 for none */
+    guint               max_in_flight;  /* active requests of the event, 0 for any */
+    NAdmissionCoalesce  coalesce;
+
+    gint64              last_admitted;  /* receive time of the last admitted request */
+    guint               admitted;
+    guint               dropped;
+    guint               coalesced;
+} NAdmissionPolicy;
+
+struct _NRequestAdmission
+{
+    GHashTable *policies;               /* event name -> NAdmissionPolicy* */
+    guint       dropped;
+    guint       coalesced;
+};
+
+static void               n_request_admission_policy_free (gpointer data);
+static NAdmissionCoalesce n_request_admission_parse_mode  (const char *name, const char *mode);
+static void               n_request_admission_read        (NAdmissionPolicy *policy, const char *name, GList *event_list);
+static NRequest*          n_request_admission_find        (NRequestRegistry *requests, const char *name, const char *client, guint *in_flight);
+
+
+
+static void
+n_request_admission_policy_free (gpointer data)
+{
+    g_slice_free (NAdmissionPolicy, data);
+}
+
+NRequestAdmission*
+n_request_admission_new ()
+{
+    NRequestAdmission *admission = NULL;
+
+    admission = g_new0 (NRequestAdmission, 1);
+    admission->policies = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, n_request_admission_policy_free);
+
+    return admission;
+}
+
+void
+n_request_admission_free (NRequestAdmission *admission)
+{
+    if (!admission)
+        return;
+
+    g_hash_table_destroy (admission->policies);
+    g_free (admission);
+}
+
+void
+n_request_admission_invalidate (NRequestAdmission *admission)
+{
+    GHashTableIter    iter;
+    NAdmissionPolicy *policy = NULL;
+
+    g_assert (admission != NULL);
+
+    g_hash_table_iter_init (&iter, admission->policies);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &policy))
+        policy->stale = TRUE;
+}
+
+static NAdmissionCoalesce
+n_request_admission_parse_mode (const char *name, const char *mode)
+{
+    if (!mode || strcmp (mode, "none") == 0)
+        return N_ADMISSION_COALESCE_NONE;
+    else if (strcmp (mode, "retrigger") == 0)
+        return N_ADMISSION_COALESCE_RETRIGGER;
+    else if (strcmp (mode, "supersede") == 0)
+        return N_ADMISSION_COALESCE_SUPERSEDE;
+
+    N_WARNING (LOG_CAT "unknown coalesce mode '%s' for event '%s', dropping instead.",
+        mode, name);
+
+    return N_ADMISSION_COALESCE_NONE;
+}
+
+static void
+n_request_admission_read (NAdmissionPolicy *policy, const char *name,
+                          GList *event_list)
+{
+    NEvent    *event         = NULL;
+    NProplist *props         = NULL;
+    gint       min_interval  = 0;
+    gint       max_in_flight = 0;
+
+    policy->stale         = FALSE;
+    policy->min_interval  = 0;
+    policy->max_in_flight = 0;
+    policy->coalesce      = N_ADMISSION_COALESCE_NONE;
+
+    /* the list is sorted by the number of rules, the default variant of
+       the event is the last one. */
+
+    event = (NEvent*) g_list_last (event_list)->data;
+    if (n_proplist_size (event->rules) > 0)
+        return;
+
+    props         = event->properties;
+    min_interval  = n_proplist_get_int (props, N_ADMISSION_MIN_INTERVAL_KEY);
+    max_in_flight = n_proplist_get_int (props, N_ADMISSION_MAX_IN_FLIGHT_KEY);
+
+    if (min_interval > 0)
+        policy->min_interval = (gint64) min_interval * 1000000;
+    if (max_in_flight > 0)
+        policy->max_in_flight = (guint) max_in_flight;
+
+    policy->coalesce = n_request_admission_parse_mode (name,
+        n_proplist_get_string (props, N_ADMISSION_COALESCE_KEY));
+
+    if (policy->min_interval > 0 || policy->max_in_flight > 0)
+        N_DEBUG (LOG_CAT "event '%s': min interval %d ms, max in flight %u, coalesce %d",
+            name, min_interval, policy->max_in_flight, policy->coalesce);
+}
+
+static NRequest*
+n_request_admission_find (NRequestRegistry *requests, const char *name,
+                          const char *client, guint *in_flight)
+{
+    GList    *iter    = NULL;
+    NRequest *request = NULL;
+    NRequest *found   = NULL;
+
+    /* requests already being stopped are on their way out, they do not
+       count and can not absorb new ones. the most recent match wins. */
+
+    *in_flight = 0;
+    for (iter = n_request_registry_get_by_name (requests, name); iter; iter = g_list_next (iter)) {
+        request = (NRequest*) iter->data;
+        if (request->stop_source_id > 0)
+            continue;
+
+        (*in_flight)++;
+        if (!client || g_strcmp0 (request->client, client) == 0)
+            found = request;
+    }
+
+    return found;
+}
+
+NAdmissionResult
+n_request_admission_check (NRequestAdmission *admission, GList *event_list,
+                           NRequestRegistry *requests, NRequest *request,
+                           NRequest **target)
+{
+    NAdmissionPolicy *policy    = NULL;
+    NRequest         *active    = NULL;
+    guint             in_flight = 0;
+    gboolean          too_soon  = FALSE;
+    gboolean          too_many  = FALSE;
+
+    g_assert (admission != NULL);
+    g_assert (request != NULL);
+    g_assert (target != NULL);
+
+    *target = NULL;
+
+    /* requests without an event fail later on, nothing to limit. */
+
+    if (!event_list || !request->name)
+        return N_ADMISSION_ADMIT;
+
+    if ((policy = g_hash_table_lookup (admission->policies, request->name)) == NULL) {
+        policy = g_slice_new0 (NAdmissionPolicy);
+        policy->stale = TRUE;
+        g_hash_table_insert (admission->policies, g_strdup (request->name), policy);
+    }
+
+    if (policy->stale)
+        n_request_admission_read (policy, request->name, event_list);
+
+    if (policy->min_interval == 0 && policy->max_in_flight == 0)
+        return N_ADMISSION_ADMIT;
+
+    active = n_request_admission_find (requests, request->name,
+        policy->coalesce == N_ADMISSION_COALESCE_SUPERSEDE ? request->client : NULL,
+        &in_flight);
+
+    too_soon = policy->min_interval > 0 && policy->admitted > 0 &&
+        request->received - policy->last_admitted < policy->min_interval;
+    too_many = policy->max_in_flight > 0 && in_flight >= policy->max_in_flight;
+
+    if (!too_soon && !too_many) {
+        policy->last_admitted = request->received;
+        policy->admitted++;
+        return N_ADMISSION_ADMIT;
+    }
+
+    if (active && policy->coalesce == N_ADMISSION_COALESCE_RETRIGGER) {
+        policy->coalesced++;
+        admission->coalesced++;
+        *target = active;
+        return N_ADMISSION_RETRIGGER;
+    }
+
+    if (active && policy->coalesce == N_ADMISSION_COALESCE_SUPERSEDE) {
+        policy->last_admitted = request->received;
+        policy->admitted++;
+        policy->coalesced++;
+        admission->coalesced++;
+        *target = active;
+        return N_ADMISSION_SUPERSEDE;
+    }
+
+    policy->dropped++;
+    admission->dropped++;
+
+    N_DEBUG (LOG_CAT "dropped request '%s' (%s), %u dropped so far",
+        request->name, too_many ? "too many in flight" : "too soon", policy->dropped);
+
+    return N_ADMISSION_DROP;
+}
+
+guint
+n_request_admission_get_dropped (NRequestAdmission *admission)
+{
+    return admission ? admission->dropped : 0;
+}
+
+guint
+n_request_admission_get_coalesced (NRequestAdmission *admission)
+{
+    return admission ? admission->coalesced : 0;
+}
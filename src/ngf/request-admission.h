@@ -0,0 +1,71 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifndef N_REQUEST_ADMISSION_H
+#define N_REQUEST_ADMISSION_H
+
+#include <glib.h>
+
+#include <ngf/request.h>
+
+#include "request-registry.h"
+
+#define N_ADMISSION_MIN_INTERVAL_KEY  "core.min_interval"
+#define N_ADMISSION_MAX_IN_FLIGHT_KEY "core.max_in_flight"
+#define N_ADMISSION_COALESCE_KEY      "core.coalesce"
+
+typedef enum _NAdmissionCoalesce
+{
+    N_ADMISSION_COALESCE_NONE = 0,      /* requests over the limits are dropped */
+    N_ADMISSION_COALESCE_RETRIGGER,     /* absorbed by the request already playing */
+    N_ADMISSION_COALESCE_SUPERSEDE      /* replace the previous request of the client */
+} NAdmissionCoalesce;
+
+typedef enum _NAdmissionResult
+{
+    N_ADMISSION_ADMIT = 0,
+    N_ADMISSION_DROP,
+    N_ADMISSION_RETRIGGER,
+    N_ADMISSION_SUPERSEDE
+} NAdmissionResult;
+
+/* admission control for bursts of the same event. the limits are read from
+   the properties of the default (rule-less) variant of each event: minimum
+   interval between admitted requests in milliseconds, maximum number of
+   requests of the event playing at once and what to do with a request over
+   the limits. policies are read on first use and re-read after the events
+   have been changed, counters are kept over reloads. */
+typedef struct _NRequestAdmission NRequestAdmission;
+
+NRequestAdmission* n_request_admission_new           ();
+void               n_request_admission_free          (NRequestAdmission *admission);
+void               n_request_admission_invalidate    (NRequestAdmission *admission);
+
+/* event_list is the list of event variants for the request name. on
+   N_ADMISSION_RETRIGGER and N_ADMISSION_SUPERSEDE target is set to the
+   active request that absorbs or is replaced by the new one. */
+NAdmissionResult   n_request_admission_check         (NRequestAdmission *admission, GList *event_list, NRequestRegistry *requests, NRequest *request, NRequest **target);
+
+guint              n_request_admission_get_dropped   (NRequestAdmission *admission);
+guint              n_request_admission_get_coalesced (NRequestAdmission *admission);
+
+#endif /* N_REQUEST_ADMISSION_H */
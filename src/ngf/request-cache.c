@@ -0,0 +1,468 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <string.h>
+#include <ngf/log.h>
+#include "request-cache.h"
+#include "request-internal.h"
+#include "proplist-internal.h"
+#include "value-internal.h"
+
+#define LOG_CAT "cache: "
+
+typedef struct _NRequestCacheEntry
+{
+    gchar      *name;               /* request name */
+    guint       hash;
+    NProplist  *key;                /* request properties, volatile keys removed */
+    NEvent     *event;              /* resolved event */
+    NProplist  *properties;         /* resolved properties, volatile keys removed */
+    NAtom      *passthrough;        /* volatile keys present in resolved properties */
+    guint       num_passthrough;
+    GList      *link;               /* position in the lru queue */
+} NRequestCacheEntry;
+
+struct _NRequestCache
+{
+    GHashTable *buckets;            /* hash -> GList* of NRequestCacheEntry* */
+    GQueue      lru;                /* most recently used first */
+    guint       max_entries;
+    guint       generation;         /* context generation of the entries */
+
+    NAtom      *volatile_keys;
+    guint       num_volatile_keys;
+
+    guint       hits;
+    guint       misses;
+};
+
+typedef struct _NRequestCacheKeyData
+{
+    NRequestCache *cache;
+    guint          hash;
+    guint          size;
+    gboolean       cacheable;
+} NRequestCacheKeyData;
+
+typedef struct _NRequestCacheMatchData
+{
+    const NProplist *properties;
+    gboolean         matches;
+} NRequestCacheMatchData;
+
+typedef struct _NRequestCacheStripData
+{
+    NRequestCache      *cache;
+    NProplist          *target;
+    NRequestCacheEntry *entry;
+} NRequestCacheStripData;
+
+static gboolean n_request_cache_is_volatile  (NRequestCache *cache, NAtom key);
+static guint    n_request_cache_hash_value   (const NValue *value);
+static void     n_request_cache_key_cb       (NAtom key, const NValue *value, gpointer userdata);
+static void     n_request_cache_strip_cb     (NAtom key, const NValue *value, gpointer userdata);
+static gboolean n_request_cache_compute_key  (NRequestCache *cache, const NProplist *properties, guint *hash, guint *size);
+static gboolean n_request_cache_value_equals (const NValue *a, const NValue *b);
+static void     n_request_cache_match_cb     (NAtom key, const NValue *value, gpointer userdata);
+static gboolean n_request_cache_key_equals   (const NRequestCacheEntry *entry, const char *name, const NProplist *properties, guint size);
+static void     n_request_cache_entry_free   (NRequestCacheEntry *entry);
+static void     n_request_cache_remove       (NRequestCache *cache, NRequestCacheEntry *entry);
+static void     n_request_cache_sync         (NRequestCache *cache, guint generation);
+
+
+
+static gboolean
+n_request_cache_is_volatile (NRequestCache *cache, NAtom key)
+{
+    guint i;
+
+    for (i = 0; i < cache->num_volatile_keys; ++i) {
+        if (cache->volatile_keys[i] == key)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static guint
+n_request_cache_hash_value (const NValue *value)
+{
+    switch (value->type) {
+        case N_VALUE_TYPE_STRING:
+            return value->value.s ? g_str_hash (value->value.s) : 0;
+        case N_VALUE_TYPE_INT:
+            return (guint) value->value.i;
+        case N_VALUE_TYPE_UINT:
+            return value->value.u;
+        case N_VALUE_TYPE_BOOL:
+            return value->value.b ? 1 : 0;
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+static void
+n_request_cache_key_cb (NAtom key, const NValue *value, gpointer userdata)
+{
+    NRequestCacheKeyData *data = (NRequestCacheKeyData*) userdata;
+
+    if (n_request_cache_is_volatile (data->cache, key))
+        return;
+
+    /* pointers may be reused for different data, never trust them to
+       identify the request. */
+
+    if (value->type == N_VALUE_TYPE_POINTER)
+        data->cacheable = FALSE;
+
+    /* combine in an order independent way, proplists in hash mode do
+       not keep their keys ordered. */
+
+    data->hash += (key * 2654435761U) ^ n_request_cache_hash_value (value);
+    data->size++;
+}
+
+static void
+n_request_cache_strip_cb (NAtom key, const NValue *value, gpointer userdata)
+{
+    NRequestCacheStripData *data = (NRequestCacheStripData*) userdata;
+
+    if (n_request_cache_is_volatile (data->cache, key)) {
+        if (data->entry)
+            data->entry->passthrough[data->entry->num_passthrough++] = key;
+        return;
+    }
+
+    n_proplist_set_take_atom (data->target, key, n_value_copy (value));
+}
+
+static gboolean
+n_request_cache_compute_key (NRequestCache *cache, const NProplist *properties,
+                             guint *hash, guint *size)
+{
+    NRequestCacheKeyData data;
+
+    data.cache     = cache;
+    data.hash      = 0;
+    data.size      = 0;
+    data.cacheable = TRUE;
+
+    n_proplist_foreach_atom (properties, n_request_cache_key_cb, &data);
+
+    *hash = data.hash;
+    *size = data.size;
+
+    return data.cacheable;
+}
+
+static gboolean
+n_request_cache_value_equals (const NValue *a, const NValue *b)
+{
+    if (!a || !b || a->type != b->type)
+        return FALSE;
+
+    switch (a->type) {
+        case N_VALUE_TYPE_STRING:
+            return g_strcmp0 (a->value.s, b->value.s) == 0;
+        case N_VALUE_TYPE_INT:
+            return a->value.i == b->value.i;
+        case N_VALUE_TYPE_UINT:
+            return a->value.u == b->value.u;
+        case N_VALUE_TYPE_BOOL:
+            return (a->value.b ? TRUE : FALSE) == (b->value.b ? TRUE : FALSE);
+        default:
+            break;
+    }
+
+    return FALSE;
+}
+
+static void
+n_request_cache_match_cb (NAtom key, const NValue *value, gpointer userdata)
+{
+    NRequestCacheMatchData *data = (NRequestCacheMatchData*) userdata;
+
+    if (!data->matches)
+        return;
+
+    if (!n_request_cache_value_equals (value, n_proplist_get_atom (data->properties, key)))
+        data->matches = FALSE;
+}
+
+static gboolean
+n_request_cache_key_equals (const NRequestCacheEntry *entry, const char *name,
+                            const NProplist *properties, guint size)
+{
+    NRequestCacheMatchData data;
+
+    if (!g_str_equal (entry->name, name))
+        return FALSE;
+
+    if ((guint) n_proplist_size (entry->key) != size)
+        return FALSE;
+
+    /* same number of non-volatile keys on both sides, so it is enough
+       to check that every stored key has the same value in the request. */
+
+    data.properties = properties;
+    data.matches    = TRUE;
+    n_proplist_foreach_atom (entry->key, n_request_cache_match_cb, &data);
+
+    return data.matches;
+}
+
+static void
+n_request_cache_entry_free (NRequestCacheEntry *entry)
+{
+    g_free (entry->name);
+    n_event_unref (entry->event);
+    n_proplist_free (entry->key);
+    n_proplist_free (entry->properties);
+    g_free (entry->passthrough);
+    g_slice_free (NRequestCacheEntry, entry);
+}
+
+static void
+n_request_cache_remove (NRequestCache *cache, NRequestCacheEntry *entry)
+{
+    GList *bucket = NULL;
+
+    bucket = (GList*) g_hash_table_lookup (cache->buckets, GUINT_TO_POINTER (entry->hash));
+    bucket = g_list_remove (bucket, entry);
+
+    if (bucket)
+        g_hash_table_insert (cache->buckets, GUINT_TO_POINTER (entry->hash), bucket);
+    else
+        g_hash_table_remove (cache->buckets, GUINT_TO_POINTER (entry->hash));
+
+    g_queue_delete_link (&cache->lru, entry->link);
+    n_request_cache_entry_free (entry);
+}
+
+static void
+n_request_cache_sync (NRequestCache *cache, guint generation)
+{
+    /* everything resolved against an older context is stale. */
+
+    if (cache->generation == generation)
+        return;
+
+    if (cache->lru.length > 0)
+        N_DEBUG (LOG_CAT "context changed, dropping %d entries", cache->lru.length);
+
+    n_request_cache_clear (cache);
+    cache->generation = generation;
+}
+
+NRequestCache*
+n_request_cache_new (guint max_entries)
+{
+    NRequestCache *cache = NULL;
+
+    cache = g_new0 (NRequestCache, 1);
+    cache->buckets     = g_hash_table_new (g_direct_hash, g_direct_equal);
+    cache->max_entries = max_entries;
+    g_queue_init (&cache->lru);
+
+    return cache;
+}
+
+void
+n_request_cache_free (NRequestCache *cache)
+{
+    if (!cache)
+        return;
+
+    n_request_cache_clear (cache);
+    g_hash_table_destroy (cache->buckets);
+    g_free (cache->volatile_keys);
+    g_free (cache);
+}
+
+void
+n_request_cache_clear (NRequestCache *cache)
+{
+    GHashTableIter  iter;
+    gpointer        bucket = NULL;
+
+    if (!cache)
+        return;
+
+    g_hash_table_iter_init (&iter, cache->buckets);
+    while (g_hash_table_iter_next (&iter, NULL, &bucket))
+        g_list_free ((GList*) bucket);
+    g_hash_table_remove_all (cache->buckets);
+
+    while (cache->lru.length > 0)
+        n_request_cache_entry_free ((NRequestCacheEntry*) g_queue_pop_head (&cache->lru));
+}
+
+void
+n_request_cache_set_max_entries (NRequestCache *cache, guint max_entries)
+{
+    if (!cache)
+        return;
+
+    cache->max_entries = max_entries;
+
+    while (cache->lru.length > max_entries)
+        n_request_cache_remove (cache, (NRequestCacheEntry*) g_queue_peek_tail (&cache->lru));
+}
+
+guint
+n_request_cache_get_max_entries (NRequestCache *cache)
+{
+    return cache ? cache->max_entries : 0;
+}
+
+void
+n_request_cache_add_volatile_key (NRequestCache *cache, NAtom key)
+{
+    if (!cache || key == N_ATOM_NONE || n_request_cache_is_volatile (cache, key))
+        return;
+
+    /* entries were keyed with the old set, start over. */
+
+    n_request_cache_clear (cache);
+
+    cache->volatile_keys = g_renew (NAtom, cache->volatile_keys,
+        cache->num_volatile_keys + 1);
+    cache->volatile_keys[cache->num_volatile_keys++] = key;
+}
+
+gboolean
+n_request_cache_lookup (NRequestCache *cache, NRequest *request, guint generation)
+{
+    NRequestCacheEntry *entry  = NULL;
+    GList              *iter   = NULL;
+    const NValue       *value  = NULL;
+    guint               hash   = 0;
+    guint               size   = 0;
+    guint               i;
+
+    if (!cache || cache->max_entries == 0)
+        return FALSE;
+
+    n_request_cache_sync (cache, generation);
+
+    /* requests that can not be cached are resolved every time, they
+       count as misses. */
+
+    if (!n_request_cache_compute_key (cache, request->original_properties, &hash, &size)) {
+        cache->misses++;
+        return FALSE;
+    }
+
+    iter = (GList*) g_hash_table_lookup (cache->buckets, GUINT_TO_POINTER (hash));
+    for (; iter; iter = g_list_next (iter)) {
+        entry = (NRequestCacheEntry*) iter->data;
+        if (n_request_cache_key_equals (entry, request->name, request->original_properties, size))
+            break;
+    }
+
+    if (!iter) {
+        cache->misses++;
+        return FALSE;
+    }
+
+    cache->hits++;
+
+    /* move to the front of the lru queue */
+
+    g_queue_unlink (&cache->lru, entry->link);
+    g_queue_push_head_link (&cache->lru, entry->link);
+
+    /* hand out the resolved properties with the volatile values of this
+       request put back in. */
+
+    n_proplist_free (request->properties);
+    request->properties = n_proplist_copy_in_arena (entry->properties, &request->arena);
+    request->event      = n_event_ref (entry->event);
+
+    for (i = 0; i < entry->num_passthrough; ++i) {
+        value = n_proplist_get_atom (request->original_properties, entry->passthrough[i]);
+        if (value)
+            n_proplist_set_atom_copy (request->properties, entry->passthrough[i], value);
+    }
+
+    return TRUE;
+}
+
+void
+n_request_cache_store (NRequestCache *cache, NRequest *request, guint generation)
+{
+    NRequestCacheEntry     *entry = NULL;
+    GList                  *bucket = NULL;
+    NRequestCacheStripData  data;
+    guint                   hash  = 0;
+    guint                   size  = 0;
+
+    if (!cache || cache->max_entries == 0 || !request->event)
+        return;
+
+    if (cache->generation != generation)
+        return;
+
+    if (!n_request_cache_compute_key (cache, request->original_properties, &hash, &size))
+        return;
+
+    entry = g_slice_new0 (NRequestCacheEntry);
+    entry->name        = g_strdup (request->name);
+    entry->hash        = hash;
+    entry->key         = n_proplist_new ();
+    entry->event       = n_event_ref (request->event);
+    entry->properties  = n_proplist_new ();
+    entry->passthrough = cache->num_volatile_keys > 0 ?
+        g_new0 (NAtom, cache->num_volatile_keys) : NULL;
+
+    data.cache  = cache;
+    data.target = entry->key;
+    data.entry  = NULL;
+    n_proplist_foreach_atom (request->original_properties, n_request_cache_strip_cb, &data);
+
+    data.target = entry->properties;
+    data.entry  = entry;
+    n_proplist_foreach_atom (request->properties, n_request_cache_strip_cb, &data);
+
+    g_queue_push_head (&cache->lru, entry);
+    entry->link = g_queue_peek_head_link (&cache->lru);
+
+    bucket = (GList*) g_hash_table_lookup (cache->buckets, GUINT_TO_POINTER (hash));
+    g_hash_table_insert (cache->buckets, GUINT_TO_POINTER (hash),
+        g_list_prepend (bucket, entry));
+
+    while (cache->lru.length > cache->max_entries)
+        n_request_cache_remove (cache, (NRequestCacheEntry*) g_queue_peek_tail (&cache->lru));
+}
+
+guint
+n_request_cache_get_hits (NRequestCache *cache)
+{
+    return cache ? cache->hits : 0;
+}
+
+guint
+n_request_cache_get_misses (NRequestCache *cache)
+{
+    return cache ? cache->misses : 0;
+}
@@ -0,0 +1,53 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef N_REQUEST_CACHE_H
+#define N_REQUEST_CACHE_H
+
+#include <glib.h>
+
+#include <ngf/atom.h>
+#include <ngf/request.h>
+
+#define N_REQUEST_CACHE_DEFAULT_SIZE 64
+
+/* bounded cache of resolved requests. resolution (event evaluation and the
+   NEW_REQUEST and TRANSFORM_PROPERTIES hooks) only depends on the request
+   name, the request properties and the context, so the result can be
+   reused for as long as the context generation stays the same. volatile
+   keys (e.g. request identifiers set by the inputs) are ignored when
+   comparing requests and copied over to the cached result on a hit. */
+typedef struct _NRequestCache NRequestCache;
+
+NRequestCache* n_request_cache_new              (guint max_entries);
+void           n_request_cache_free             (NRequestCache *cache);
+void           n_request_cache_clear            (NRequestCache *cache);
+void           n_request_cache_set_max_entries  (NRequestCache *cache, guint max_entries);
+guint          n_request_cache_get_max_entries  (NRequestCache *cache);
+void           n_request_cache_add_volatile_key (NRequestCache *cache, NAtom key);
+
+gboolean       n_request_cache_lookup           (NRequestCache *cache, NRequest *request, guint generation);
+void           n_request_cache_store            (NRequestCache *cache, NRequest *request, guint generation);
+
+guint          n_request_cache_get_hits         (NRequestCache *cache);
+guint          n_request_cache_get_misses       (NRequestCache *cache);
+
+#endif /* N_REQUEST_CACHE_H */
@@ -28,9 +28,21 @@
 #include "core-internal.h"
 #include "event-internal.h"
 #include "inputinterface-internal.h"
+#include "request-trace.h"
+#include "arena.h"
 
 /* typedef struct _NRequest NRequest; */
 
+typedef struct _NRequestBatch NRequestBatch;
+typedef struct _NRequestKeep  NRequestKeep;
+
+struct _NRequestKeep
+{
+    gpointer         data;
+    GDestroyNotify   destroy;
+    NRequestKeep    *next;
+};
+
 struct _NRequest
 {
     gchar           *name;          /* request name */
@@ -38,6 +50,7 @@ struct _NRequest
     NProplist       *original_properties;
 
     guint            id;                    /* unique request identifier */
+    gchar           *client;                /* client that sent the request */
     NEvent          *event;
     NCore           *core;
     NInputInterface *input_iface;
@@ -46,6 +59,7 @@ struct _NRequest
     gboolean         is_fallback;
     gboolean         has_failed;
     gboolean         no_event;
+    gboolean         is_dropped;            /* rejected by admission control */
 
     guint            play_source_id;        /* source id for play */
     guint            stop_source_id;        /* source id for stop */
@@ -60,10 +74,32 @@ struct _NRequest
 
     guint            max_timeout_id;
     guint            timeout_ms;
+
+    gint             priority;              /* scheduling priority class */
+    GList           *held_sinks;            /* slots held on limited sinks */
+    gint64           queued;                /* monotonic time queued, us, 0 when not waiting */
+    GList            queue_link;            /* link in the scheduler queue */
+    NRequestBatch   *batch;                 /* requests played together, until synchronized */
+
+    gint64           received;              /* monotonic time the request was created, ns */
+    NRequestTrace   *trace;                 /* timeline, while tracing is enabled */
+
+    GList            all_link;              /* links in the active request registry */
+    GList            client_link;
+    GList            name_link;
+
+    NRequestKeep    *kept;                  /* data released with the request */
+    NArena           arena;                 /* request scoped allocations */
 };
 
 NRequest* n_request_new          ();
 void      n_request_free         (NRequest *request);
 int       n_request_has_fallback (NRequest *request);
 
+/* list operations for the request scoped sink lists. the links are taken
+   from the request arena, the lists must not be freed with g_list_free. */
+GList*    n_request_list_append  (NRequest *request, GList *list, gpointer data);
+GList*    n_request_list_copy    (NRequest *request, GList *list);
+GList*    n_request_list_remove  (GList *list, gpointer data);
+
 #endif /* N_REQUEST_INTERNAL_H */
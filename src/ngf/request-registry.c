@@ -0,0 +1,207 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "request-registry.h"
+#include "request-internal.h"
+
+struct _NRequestRegistry
+{
+    GQueue      all;                /* all requests, in the order added */
+    GHashTable *by_id;              /* id -> NRequest* */
+    GHashTable *by_client;          /* client -> GQueue* */
+    GHashTable *by_name;            /* event name -> GQueue* */
+};
+
+static void   n_request_registry_queue_free (gpointer data);
+static void   n_request_registry_link       (GHashTable *index, const char *key, GList *link);
+static void   n_request_registry_unlink     (GHashTable *index, const char *key, GList *link);
+static GList* n_request_registry_get_queue  (GHashTable *index, const char *key);
+
+
+
+static void
+n_request_registry_queue_free (gpointer data)
+{
+    /* links are embedded in the requests, only the queue is freed. */
+
+    g_slice_free (GQueue, data);
+}
+
+NRequestRegistry*
+n_request_registry_new ()
+{
+    NRequestRegistry *registry = NULL;
+
+    registry = g_new0 (NRequestRegistry, 1);
+    g_queue_init (&registry->all);
+
+    registry->by_id = g_hash_table_new (g_direct_hash, g_direct_equal);
+    registry->by_client = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, n_request_registry_queue_free);
+    registry->by_name = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, n_request_registry_queue_free);
+
+    return registry;
+}
+
+void
+n_request_registry_free (NRequestRegistry *registry)
+{
+    if (!registry)
+        return;
+
+    g_hash_table_destroy (registry->by_name);
+    g_hash_table_destroy (registry->by_client);
+    g_hash_table_destroy (registry->by_id);
+    g_free (registry);
+}
+
+static void
+n_request_registry_link (GHashTable *index, const char *key, GList *link)
+{
+    GQueue *queue = NULL;
+
+    if ((queue = g_hash_table_lookup (index, key)) == NULL) {
+        queue = g_slice_new0 (GQueue);
+        g_hash_table_insert (index, g_strdup (key), queue);
+    }
+
+    g_queue_push_tail_link (queue, link);
+}
+
+static void
+n_request_registry_unlink (GHashTable *index, const char *key, GList *link)
+{
+    GQueue *queue = NULL;
+
+    if ((queue = g_hash_table_lookup (index, key)) == NULL)
+        return;
+
+    g_queue_unlink (queue, link);
+    if (g_queue_is_empty (queue))
+        g_hash_table_remove (index, key);
+}
+
+static GList*
+n_request_registry_get_queue (GHashTable *index, const char *key)
+{
+    GQueue *queue = NULL;
+
+    if (!key || (queue = g_hash_table_lookup (index, key)) == NULL)
+        return NULL;
+
+    return g_queue_peek_head_link (queue);
+}
+
+void
+n_request_registry_add (NRequestRegistry *registry, NRequest *request)
+{
+    g_assert (registry != NULL);
+    g_assert (request != NULL);
+
+    /* already registered */
+
+    if (request->all_link.data)
+        return;
+
+    request->all_link.data = request;
+    g_queue_push_tail_link (&registry->all, &request->all_link);
+
+    /* ids are unique while the request is active. fallback requests reuse
+       the id of the failed request, which is gone by then. */
+
+    if (request->id > 0)
+        g_hash_table_insert (registry->by_id, GUINT_TO_POINTER (request->id), request);
+
+    if (request->client) {
+        request->client_link.data = request;
+        n_request_registry_link (registry->by_client, request->client,
+            &request->client_link);
+    }
+
+    if (request->name) {
+        request->name_link.data = request;
+        n_request_registry_link (registry->by_name, request->name,
+            &request->name_link);
+    }
+}
+
+void
+n_request_registry_remove (NRequestRegistry *registry, NRequest *request)
+{
+    g_assert (registry != NULL);
+    g_assert (request != NULL);
+
+    if (!request->all_link.data)
+        return;
+
+    g_queue_unlink (&registry->all, &request->all_link);
+    request->all_link.data = NULL;
+
+    if (request->id > 0 &&
+        g_hash_table_lookup (registry->by_id, GUINT_TO_POINTER (request->id)) == request)
+        g_hash_table_remove (registry->by_id, GUINT_TO_POINTER (request->id));
+
+    if (request->client_link.data) {
+        n_request_registry_unlink (registry->by_client, request->client,
+            &request->client_link);
+        request->client_link.data = NULL;
+    }
+
+    if (request->name_link.data) {
+        n_request_registry_unlink (registry->by_name, request->name,
+            &request->name_link);
+        request->name_link.data = NULL;
+    }
+}
+
+guint
+n_request_registry_size (NRequestRegistry *registry)
+{
+    return registry ? g_queue_get_length (&registry->all) : 0;
+}
+
+GList*
+n_request_registry_get_all (NRequestRegistry *registry)
+{
+    return registry ? g_queue_peek_head_link (&registry->all) : NULL;
+}
+
+NRequest*
+n_request_registry_lookup (NRequestRegistry *registry, guint id)
+{
+    if (!registry || id == 0)
+        return NULL;
+
+    return (NRequest*) g_hash_table_lookup (registry->by_id, GUINT_TO_POINTER (id));
+}
+
+GList*
+n_request_registry_get_by_client (NRequestRegistry *registry, const char *client)
+{
+    return registry ? n_request_registry_get_queue (registry->by_client, client) : NULL;
+}
+
+GList*
+n_request_registry_get_by_name (NRequestRegistry *registry, const char *name)
+{
+    return registry ? n_request_registry_get_queue (registry->by_name, name) : NULL;
+}
@@ -0,0 +1,47 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef N_REQUEST_REGISTRY_H
+#define N_REQUEST_REGISTRY_H
+
+#include <glib.h>
+
+#include <ngf/request.h>
+
+/* active requests, indexed by request id, client and event name. the
+   registry links requests through list nodes embedded in the request, so
+   adding and removing a request does not allocate and takes constant
+   time. lists returned are owned by the registry and valid until the
+   next request is added or removed. */
+typedef struct _NRequestRegistry NRequestRegistry;
+
+NRequestRegistry* n_request_registry_new           ();
+void              n_request_registry_free          (NRequestRegistry *registry);
+void              n_request_registry_add           (NRequestRegistry *registry, NRequest *request);
+void              n_request_registry_remove        (NRequestRegistry *registry, NRequest *request);
+guint             n_request_registry_size          (NRequestRegistry *registry);
+
+GList*            n_request_registry_get_all       (NRequestRegistry *registry);
+NRequest*         n_request_registry_lookup        (NRequestRegistry *registry, guint id);
+GList*            n_request_registry_get_by_client (NRequestRegistry *registry, const char *client);
+GList*            n_request_registry_get_by_name   (NRequestRegistry *registry, const char *name);
+
+#endif /* N_REQUEST_REGISTRY_H */
@@ -0,0 +1,448 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#include <ngf/log.h>
+#include "request-scheduler.h"
+#include "request-internal.h"
+#include "sinkinterface-internal.h"
+
+#define LOG_CAT "scheduler: "
+
+typedef struct _NSchedulerSink
+{
+    guint   limit;                  /* requests allowed on the sink at once */
+    GQueue  holders;                /* NRequest* holding a slot */
+} NSchedulerSink;
+
+struct _NRequestScheduler
+{
+    GHashTable      *sinks;         /* sink name -> NSchedulerSink* */
+    GQueue           queue;         /* waiting requests, highest priority first */
+    guint            max_queued;
+    guint            queue_timeout; /* ms a request may wait, 0 for no limit */
+    NSchedulerStats  stats;
+};
+
+static void            n_request_scheduler_sink_free (gpointer data);
+static NSchedulerSink* n_request_scheduler_lookup    (NRequestScheduler *scheduler, NSinkInterface *sink);
+static gboolean        n_request_scheduler_fits      (NRequestScheduler *scheduler, NRequest *request, GList **full);
+static void            n_request_scheduler_attach    (NRequestScheduler *scheduler, NRequest *request);
+static void            n_request_scheduler_detach    (NRequest *request);
+static NRequest*       n_request_scheduler_victim    (GList *full, gint priority);
+static void            n_request_scheduler_enqueue   (NRequestScheduler *scheduler, NRequest *request);
+static NRequest*       n_request_scheduler_evict     (NRequestScheduler *scheduler, gint priority);
+
+
+
+static void
+n_request_scheduler_sink_free (gpointer data)
+{
+    NSchedulerSink *sink = (NSchedulerSink*) data;
+
+    g_queue_clear (&sink->holders);
+    g_slice_free (NSchedulerSink, sink);
+}
+
+NRequestScheduler*
+n_request_scheduler_new ()
+{
+    NRequestScheduler *scheduler = NULL;
+
+    scheduler = g_new0 (NRequestScheduler, 1);
+    scheduler->sinks = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, n_request_scheduler_sink_free);
+    g_queue_init (&scheduler->queue);
+
+    scheduler->max_queued    = N_SCHEDULER_DEFAULT_MAX_QUEUED;
+    scheduler->queue_timeout = N_SCHEDULER_DEFAULT_QUEUE_TIMEOUT;
+
+    return scheduler;
+}
+
+void
+n_request_scheduler_free (NRequestScheduler *scheduler)
+{
+    if (!scheduler)
+        return;
+
+    /* requests are gone by now, the queue links are embedded in them. */
+
+    g_hash_table_destroy (scheduler->sinks);
+    g_free (scheduler);
+}
+
+void
+n_request_scheduler_set_sink_limit (NRequestScheduler *scheduler,
+                                    const char *sink, guint limit)
+{
+    NSchedulerSink *entry = NULL;
+
+    g_assert (scheduler != NULL);
+    g_assert (sink != NULL);
+
+    /* limits are set while parsing the configuration, before any request
+       holds a slot. */
+
+    if (limit == 0) {
+        g_hash_table_remove (scheduler->sinks, sink);
+        return;
+    }
+
+    if ((entry = g_hash_table_lookup (scheduler->sinks, sink)) == NULL) {
+        entry = g_slice_new0 (NSchedulerSink);
+        g_queue_init (&entry->holders);
+        g_hash_table_insert (scheduler->sinks, g_strdup (sink), entry);
+    }
+
+    entry->limit = limit;
+}
+
+guint
+n_request_scheduler_get_sink_limit (NRequestScheduler *scheduler,
+                                    const char *sink)
+{
+    NSchedulerSink *entry = NULL;
+
+    if (!scheduler || !sink)
+        return 0;
+
+    entry = g_hash_table_lookup (scheduler->sinks, sink);
+    return entry ? entry->limit : 0;
+}
+
+GList*
+n_request_scheduler_get_limited_sinks (NRequestScheduler *scheduler)
+{
+    g_assert (scheduler != NULL);
+
+    return g_hash_table_get_keys (scheduler->sinks);
+}
+
+void
+n_request_scheduler_set_max_queued (NRequestScheduler *scheduler, guint max_queued)
+{
+    g_assert (scheduler != NULL);
+    scheduler->max_queued = max_queued;
+}
+
+guint
+n_request_scheduler_get_max_queued (NRequestScheduler *scheduler)
+{
+    g_assert (scheduler != NULL);
+    return scheduler->max_queued;
+}
+
+void
+n_request_scheduler_set_queue_timeout (NRequestScheduler *scheduler, guint timeout_ms)
+{
+    g_assert (scheduler != NULL);
+    scheduler->queue_timeout = timeout_ms;
+}
+
+guint
+n_request_scheduler_get_queue_timeout (NRequestScheduler *scheduler)
+{
+    g_assert (scheduler != NULL);
+    return scheduler->queue_timeout;
+}
+
+static NSchedulerSink*
+n_request_scheduler_lookup (NRequestScheduler *scheduler, NSinkInterface *sink)
+{
+    if (g_hash_table_size (scheduler->sinks) == 0)
+        return NULL;
+
+    return (NSchedulerSink*) g_hash_table_lookup (scheduler->sinks, sink->name);
+}
+
+static gboolean
+n_request_scheduler_fits (NRequestScheduler *scheduler, NRequest *request,
+                          GList **full)
+{
+    GList          *iter  = NULL;
+    NSchedulerSink *entry = NULL;
+    gboolean        fits  = TRUE;
+
+    for (iter = g_list_first (request->all_sinks); iter; iter = g_list_next (iter)) {
+        entry = n_request_scheduler_lookup (scheduler, (NSinkInterface*) iter->data);
+        if (!entry || g_queue_get_length (&entry->holders) < entry->limit)
+            continue;
+
+        fits = FALSE;
+        if (!full)
+            break;
+
+        *full = g_list_prepend (*full, entry);
+    }
+
+    return fits;
+}
+
+static void
+n_request_scheduler_attach (NRequestScheduler *scheduler, NRequest *request)
+{
+    GList          *iter  = NULL;
+    NSchedulerSink *entry = NULL;
+
+    for (iter = g_list_first (request->all_sinks); iter; iter = g_list_next (iter)) {
+        entry = n_request_scheduler_lookup (scheduler, (NSinkInterface*) iter->data);
+        if (!entry)
+            continue;
+
+        g_queue_push_tail (&entry->holders, request);
+        request->held_sinks = n_request_list_append (request, request->held_sinks, entry);
+    }
+}
+
+static void
+n_request_scheduler_detach (NRequest *request)
+{
+    GList          *iter  = NULL;
+    NSchedulerSink *entry = NULL;
+
+    for (iter = g_list_first (request->held_sinks); iter; iter = g_list_next (iter)) {
+        entry = (NSchedulerSink*) iter->data;
+        g_queue_remove (&entry->holders, request);
+    }
+
+    /* the list is in the request arena. */
+    request->held_sinks = NULL;
+}
+
+static NRequest*
+n_request_scheduler_victim (GList *full, gint priority)
+{
+    NSchedulerSink *entry   = NULL;
+    NRequest       *request = NULL;
+    NRequest       *victim  = NULL;
+    GList          *iter    = NULL;
+    GList          *held    = NULL;
+
+    /* the lowest priority request on the first full sink, latest started
+       on ties. it must hold a slot on every full sink, otherwise stopping
+       it would not make room. */
+
+    entry = (NSchedulerSink*) full->data;
+    for (iter = g_queue_peek_head_link (&entry->holders); iter; iter = g_list_next (iter)) {
+        request = (NRequest*) iter->data;
+        if (request->priority >= priority)
+            continue;
+        if (!victim || request->priority <= victim->priority)
+            victim = request;
+    }
+
+    if (!victim)
+        return NULL;
+
+    for (iter = g_list_next (full); iter; iter = g_list_next (iter)) {
+        for (held = victim->held_sinks; held; held = g_list_next (held)) {
+            if (held->data == iter->data)
+                break;
+        }
+
+        if (!held)
+            return NULL;
+    }
+
+    return victim;
+}
+
+static void
+n_request_scheduler_enqueue (NRequestScheduler *scheduler, NRequest *request)
+{
+    GList    *iter     = NULL;
+    NRequest *other    = NULL;
+    gint      position = 0;
+
+    request->queued          = g_get_monotonic_time ();
+    request->queue_link.data = request;
+
+    /* keep the queue ordered by priority, first come first served within
+       the same priority. */
+
+    position = (gint) g_queue_get_length (&scheduler->queue);
+    for (iter = g_queue_peek_tail_link (&scheduler->queue); iter; iter = g_list_previous (iter)) {
+        other = (NRequest*) iter->data;
+        if (other->priority >= request->priority)
+            break;
+        position--;
+    }
+
+    g_queue_push_nth_link (&scheduler->queue, position, &request->queue_link);
+
+    scheduler->stats.queued++;
+    scheduler->stats.depth = g_queue_get_length (&scheduler->queue);
+    if (scheduler->stats.depth > scheduler->stats.max_depth)
+        scheduler->stats.max_depth = scheduler->stats.depth;
+}
+
+static NRequest*
+n_request_scheduler_evict (NRequestScheduler *scheduler, gint priority)
+{
+    NRequest *request = NULL;
+
+    /* the tail is the lowest priority waiting request, the latest one on
+       ties. it only makes room for a request that ranks above it. */
+
+    request = (NRequest*) g_queue_peek_tail (&scheduler->queue);
+    if (!request || request->priority >= priority)
+        return NULL;
+
+    g_queue_unlink (&scheduler->queue, &request->queue_link);
+    request->queued = 0;
+
+    scheduler->stats.shed++;
+    scheduler->stats.depth = g_queue_get_length (&scheduler->queue);
+
+    return request;
+}
+
+NSchedulerDecision
+n_request_scheduler_admit (NRequestScheduler *scheduler, NRequest *request,
+                           NRequest **victim)
+{
+    GList *full = NULL;
+
+    g_assert (scheduler != NULL);
+    g_assert (request != NULL);
+    g_assert (victim != NULL);
+
+    *victim = NULL;
+
+    if (n_request_scheduler_fits (scheduler, request, &full)) {
+        n_request_scheduler_attach (scheduler, request);
+        return N_SCHEDULER_RUN;
+    }
+
+    full    = g_list_reverse (full);
+    *victim = n_request_scheduler_victim (full, request->priority);
+    g_list_free (full);
+
+    if (*victim) {
+        N_DEBUG (LOG_CAT "request '%s' (priority %d) preempts request '%s' (priority %d)",
+            request->name, request->priority, (*victim)->name, (*victim)->priority);
+
+        n_request_scheduler_detach (*victim);
+        n_request_scheduler_attach (scheduler, request);
+        scheduler->stats.preempted++;
+        return N_SCHEDULER_PREEMPT;
+    }
+
+    if (g_queue_get_length (&scheduler->queue) >= scheduler->max_queued) {
+        *victim = n_request_scheduler_evict (scheduler, request->priority);
+        if (!*victim) {
+            scheduler->stats.shed++;
+            return N_SCHEDULER_SHED;
+        }
+
+        N_DEBUG (LOG_CAT "queue full, request '%s' (priority %d) pushes out request '%s' (priority %d)",
+            request->name, request->priority, (*victim)->name, (*victim)->priority);
+    }
+
+    N_DEBUG (LOG_CAT "sinks busy, request '%s' (priority %d) waits, %u waiting",
+        request->name, request->priority, g_queue_get_length (&scheduler->queue) + 1);
+
+    n_request_scheduler_enqueue (scheduler, request);
+    return N_SCHEDULER_QUEUE;
+}
+
+NRequest*
+n_request_scheduler_next (NRequestScheduler *scheduler)
+{
+    GList    *iter    = NULL;
+    NRequest *request = NULL;
+    gint64    waited  = 0;
+
+    g_assert (scheduler != NULL);
+
+    /* the first waiting request that fits, a request blocked on a busy
+       sink does not hold back requests for other sinks. */
+
+    for (iter = g_queue_peek_head_link (&scheduler->queue); iter; iter = g_list_next (iter)) {
+        request = (NRequest*) iter->data;
+        if (n_request_scheduler_fits (scheduler, request, NULL))
+            break;
+    }
+
+    if (!iter)
+        return NULL;
+
+    g_queue_unlink (&scheduler->queue, &request->queue_link);
+    n_request_scheduler_attach (scheduler, request);
+
+    waited = g_get_monotonic_time () - request->queued;
+    request->queued = 0;
+
+    scheduler->stats.depth = g_queue_get_length (&scheduler->queue);
+    scheduler->stats.waited++;
+    scheduler->stats.total_wait += waited;
+    if (waited > scheduler->stats.max_wait)
+        scheduler->stats.max_wait = waited;
+
+    N_DEBUG (LOG_CAT "request '%s' started after waiting %" G_GINT64_FORMAT " us",
+        request->name, waited);
+
+    return request;
+}
+
+void
+n_request_scheduler_release (NRequestScheduler *scheduler, NRequest *request)
+{
+    g_assert (scheduler != NULL);
+    g_assert (request != NULL);
+
+    if (request->queued > 0) {
+        g_queue_unlink (&scheduler->queue, &request->queue_link);
+        request->queued = 0;
+        scheduler->stats.depth = g_queue_get_length (&scheduler->queue);
+    }
+
+    n_request_scheduler_detach (request);
+}
+
+void
+n_request_scheduler_expire (NRequestScheduler *scheduler, NRequest *request)
+{
+    g_assert (scheduler != NULL);
+    g_assert (request != NULL);
+
+    if (request->queued == 0)
+        return;
+
+    n_request_scheduler_release (scheduler, request);
+    scheduler->stats.expired++;
+}
+
+gboolean
+n_request_scheduler_is_queued (NRequest *request)
+{
+    return request && request->queued > 0;
+}
+
+void
+n_request_scheduler_get_stats (NRequestScheduler *scheduler, NSchedulerStats *stats)
+{
+    g_assert (scheduler != NULL);
+    g_assert (stats != NULL);
+
+    *stats = scheduler->stats;
+}
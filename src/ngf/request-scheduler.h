@@ -0,0 +1,86 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifndef N_REQUEST_SCHEDULER_H
+#define N_REQUEST_SCHEDULER_H
+
+#include <glib.h>
+
+#include <ngf/request.h>
+
+#define N_SCHEDULER_PRIORITY_KEY         "core.priority"
+#define N_SCHEDULER_DEFAULT_MAX_QUEUED    8
+#define N_SCHEDULER_DEFAULT_QUEUE_TIMEOUT 1000
+
+typedef enum _NSchedulerDecision
+{
+    N_SCHEDULER_RUN = 0,            /* all limited sinks have room */
+    N_SCHEDULER_PREEMPT,            /* runs in place of a lower priority request */
+    N_SCHEDULER_QUEUE,              /* waits until the sinks have room */
+    N_SCHEDULER_SHED                /* no room, the queue is full and nothing waiting ranks below it */
+} NSchedulerDecision;
+
+typedef struct _NSchedulerStats
+{
+    guint   depth;                  /* requests waiting now */
+    guint   max_depth;              /* most requests waiting at once */
+    guint   queued;                 /* requests that had to wait */
+    guint   waited;                 /* queued requests that were started */
+    gint64  total_wait;             /* microseconds waited by started requests */
+    gint64  max_wait;
+    guint   preempted;
+    guint   shed;                   /* requests dropped or pushed out of a full queue */
+    guint   expired;                /* queued requests that timed out */
+} NSchedulerStats;
+
+/* concurrency limits per sink. each request holds a slot on the limited
+   sinks it plays on. when a sink is full, a request with a higher priority
+   class ("core.priority") preempts the lowest priority request holding
+   the sink, otherwise it waits in a priority ordered queue. sinks without
+   a limit are not tracked. */
+typedef struct _NRequestScheduler NRequestScheduler;
+
+NRequestScheduler* n_request_scheduler_new               ();
+void               n_request_scheduler_free              (NRequestScheduler *scheduler);
+
+void               n_request_scheduler_set_sink_limit    (NRequestScheduler *scheduler, const char *sink, guint limit);
+guint              n_request_scheduler_get_sink_limit    (NRequestScheduler *scheduler, const char *sink);
+GList*             n_request_scheduler_get_limited_sinks (NRequestScheduler *scheduler);
+void               n_request_scheduler_set_max_queued    (NRequestScheduler *scheduler, guint max_queued);
+guint              n_request_scheduler_get_max_queued    (NRequestScheduler *scheduler);
+void               n_request_scheduler_set_queue_timeout (NRequestScheduler *scheduler, guint timeout_ms);
+guint              n_request_scheduler_get_queue_timeout (NRequestScheduler *scheduler);
+
+/* the request sinks must be set. on N_SCHEDULER_PREEMPT victim is set to
+   the request that lost its slots, the caller must stop it. when the queue
+   is full, the lowest priority waiting request is pushed out for a request
+   that ranks above it: on N_SCHEDULER_QUEUE victim may be set to that
+   request, no longer queued, the caller must drop it. */
+NSchedulerDecision n_request_scheduler_admit             (NRequestScheduler *scheduler, NRequest *request, NRequest **victim);
+NRequest*          n_request_scheduler_next              (NRequestScheduler *scheduler);
+void               n_request_scheduler_release           (NRequestScheduler *scheduler, NRequest *request);
+void               n_request_scheduler_expire            (NRequestScheduler *scheduler, NRequest *request);
+gboolean           n_request_scheduler_is_queued         (NRequest *request);
+
+void               n_request_scheduler_get_stats         (NRequestScheduler *scheduler, NSchedulerStats *stats);
+
+#endif /* N_REQUEST_SCHEDULER_H */
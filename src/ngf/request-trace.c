@@ -0,0 +1,413 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#define _GNU_SOURCE
+#include <time.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <string.h>
+#include <ngf/log.h>
+#include "request-trace.h"
+
+#define LOG_CAT "trace: "
+
+typedef struct _NTraceSpan
+{
+    const char *name;               /* interned span name */
+    const char *sink;               /* interned sink name, or NULL */
+    gpointer    callback;           /* hook callback, or NULL */
+    gint64      start;              /* monotonic, ns */
+    gint64      end;
+    gint64      cpu;                /* thread cpu time in ns, -1 for async */
+} NTraceSpan;
+
+struct _NRequestTrace
+{
+    gchar      *name;               /* request name */
+    guint       id;                 /* request id from the input */
+    guint       serial;             /* assigned when added to the log */
+    gint64      received;
+    gint64      finished;
+    gboolean    failed;
+    GArray     *spans;              /* NTraceSpan */
+};
+
+struct _NTraceLog
+{
+    NRequestTrace **traces;
+    guint           size;
+    guint           next;           /* slot for the next trace */
+    guint           serial;
+};
+
+static gint64 n_trace_now_ns          ();
+static gint64 n_trace_cpu_ns          ();
+static guint  n_request_trace_add     (NRequestTrace *trace, const char *name, const char *sink, gboolean async);
+static void   n_trace_append_string   (GString *out, const char *str);
+static void   n_trace_append_event    (GString *out, const char *phase, guint serial, NTraceSpan *span, gint64 ts);
+static void   n_trace_append_callback (GString *out, gpointer callback);
+static void   n_trace_append_trace    (GString *out, NRequestTrace *trace);
+
+
+
+static gint64
+n_trace_now_ns ()
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (gint64) ts.tv_sec * G_GINT64_CONSTANT (1000000000) + ts.tv_nsec;
+}
+
+static gint64
+n_trace_cpu_ns ()
+{
+    struct timespec ts;
+
+    if (clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts) < 0)
+        return 0;
+
+    return (gint64) ts.tv_sec * G_GINT64_CONSTANT (1000000000) + ts.tv_nsec;
+}
+
+NRequestTrace*
+n_request_trace_new (const char *name, guint id, gint64 received)
+{
+    NRequestTrace *trace = NULL;
+
+    trace = g_slice_new0 (NRequestTrace);
+    trace->name     = g_strdup (name);
+    trace->id       = id;
+    trace->received = received > 0 ? received : n_trace_now_ns ();
+    trace->spans    = g_array_sized_new (FALSE, TRUE, sizeof (NTraceSpan), 16);
+
+    return trace;
+}
+
+void
+n_request_trace_free (NRequestTrace *trace)
+{
+    if (!trace)
+        return;
+
+    g_array_free (trace->spans, TRUE);
+    g_free (trace->name);
+    g_slice_free (NRequestTrace, trace);
+}
+
+static guint
+n_request_trace_add (NRequestTrace *trace, const char *name, const char *sink,
+                     gboolean async)
+{
+    NTraceSpan span;
+
+    span.name     = g_intern_string (name);
+    span.sink     = sink ? g_intern_string (sink) : NULL;
+    span.callback = NULL;
+    span.end      = 0;
+    span.cpu      = async ? -1 : n_trace_cpu_ns ();
+    span.start    = n_trace_now_ns ();
+
+    g_array_append_val (trace->spans, span);
+
+    /* span handles start from 1, 0 is returned when not tracing. */
+
+    return trace->spans->len;
+}
+
+guint
+n_request_trace_begin (NRequestTrace *trace, const char *name, const char *sink)
+{
+    if (!trace || !name)
+        return 0;
+
+    return n_request_trace_add (trace, name, sink, FALSE);
+}
+
+guint
+n_request_trace_begin_async (NRequestTrace *trace, const char *name, const char *sink)
+{
+    if (!trace || !name)
+        return 0;
+
+    return n_request_trace_add (trace, name, sink, TRUE);
+}
+
+void
+n_request_trace_end (NRequestTrace *trace, guint span)
+{
+    NTraceSpan *s = NULL;
+
+    if (!trace || span == 0 || span > trace->spans->len)
+        return;
+
+    s = &g_array_index (trace->spans, NTraceSpan, span - 1);
+    if (s->end > 0)
+        return;
+
+    s->end = n_trace_now_ns ();
+    if (s->cpu >= 0)
+        s->cpu = n_trace_cpu_ns () - s->cpu;
+}
+
+void
+n_request_trace_end_async (NRequestTrace *trace, const char *name, const char *sink)
+{
+    NTraceSpan *s = NULL;
+    guint       i;
+
+    if (!trace || !name)
+        return;
+
+    name = g_intern_string (name);
+    sink = sink ? g_intern_string (sink) : NULL;
+
+    /* async spans are ended by name, close the latest open one. */
+
+    for (i = trace->spans->len; i > 0; --i) {
+        s = &g_array_index (trace->spans, NTraceSpan, i - 1);
+        if (s->name == name && s->sink == sink && s->end == 0) {
+            s->end = n_trace_now_ns ();
+            return;
+        }
+    }
+}
+
+void
+n_request_trace_set_callback (NRequestTrace *trace, guint span, gpointer callback)
+{
+    if (!trace || span == 0 || span > trace->spans->len)
+        return;
+
+    g_array_index (trace->spans, NTraceSpan, span - 1).callback = callback;
+}
+
+void
+n_request_trace_finish (NRequestTrace *trace, gboolean failed)
+{
+    NTraceSpan *s = NULL;
+    guint       i;
+
+    if (!trace)
+        return;
+
+    trace->finished = n_trace_now_ns ();
+    trace->failed   = failed;
+
+    /* sinks that never synchronized or completed, cut their spans at the
+       end of the request. */
+
+    for (i = 0; i < trace->spans->len; ++i) {
+        s = &g_array_index (trace->spans, NTraceSpan, i);
+        if (s->end == 0) {
+            s->end = trace->finished;
+            if (s->cpu >= 0)
+                s->cpu = 0;
+        }
+    }
+}
+
+NTraceLog*
+n_trace_log_new (guint size)
+{
+    NTraceLog *log = NULL;
+
+    if (size == 0)
+        return NULL;
+
+    log = g_new0 (NTraceLog, 1);
+    log->size   = size;
+    log->traces = g_new0 (NRequestTrace*, size);
+
+    return log;
+}
+
+void
+n_trace_log_free (NTraceLog *log)
+{
+    guint i;
+
+    if (!log)
+        return;
+
+    for (i = 0; i < log->size; ++i)
+        n_request_trace_free (log->traces[i]);
+
+    g_free (log->traces);
+    g_free (log);
+}
+
+void
+n_trace_log_add (NTraceLog *log, NRequestTrace *trace)
+{
+    if (!log) {
+        n_request_trace_free (trace);
+        return;
+    }
+
+    trace->serial = ++log->serial;
+
+    n_request_trace_free (log->traces[log->next]);
+    log->traces[log->next] = trace;
+    log->next = (log->next + 1) % log->size;
+}
+
+static void
+n_trace_append_string (GString *out, const char *str)
+{
+    const char *p = NULL;
+
+    g_string_append_c (out, '"');
+    for (p = str; p && *p; ++p) {
+        if (*p == '"' || *p == '\\')
+            g_string_append_c (out, '\\');
+
+        if ((guchar) *p < 0x20)
+            g_string_append_printf (out, "\\u%04x", (guint) *p);
+        else
+            g_string_append_c (out, *p);
+    }
+    g_string_append_c (out, '"');
+}
+
+static void
+n_trace_append_event (GString *out, const char *phase, guint serial,
+                      NTraceSpan *span, gint64 ts)
+{
+    gchar *name = NULL;
+
+    /* nestable async events, the calls made for a request share the
+       request serial as id and nest on one track. waiting for a sink
+       overlaps with other calls, each sink waits on a track of its own. */
+
+    g_string_append (out, ",\n{\"ph\":\"");
+    g_string_append (out, phase);
+
+    if (span->sink && span->cpu < 0)
+        g_string_append_printf (out, "\",\"cat\":\"sink\",\"id\":\"%u.%s\"", serial, span->sink);
+    else
+        g_string_append_printf (out, "\",\"cat\":\"request\",\"id\":\"%u\"", serial);
+
+    g_string_append_printf (out, ",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"name\":",
+        (int) getpid (), (int) getpid (), ts / 1000.0);
+
+    if (span->sink) {
+        name = g_strdup_printf ("%s %s", span->sink, span->name);
+        n_trace_append_string (out, name);
+        g_free (name);
+    }
+    else
+        n_trace_append_string (out, span->name);
+}
+
+static void
+n_trace_append_callback (GString *out, gpointer callback)
+{
+    Dl_info info;
+
+    /* static callbacks have no symbol, the module and offset are enough
+       to look them up. */
+
+    if (dladdr (callback, &info) && info.dli_fname) {
+        if (info.dli_sname)
+            g_string_append_printf (out, ",\"callback\":\"%s\"", info.dli_sname);
+        else
+            g_string_append_printf (out, ",\"callback\":\"%s+0x%lx\"",
+                info.dli_fname, (gulong) ((guchar*) callback - (guchar*) info.dli_fbase));
+    }
+    else
+        g_string_append_printf (out, ",\"callback\":\"%p\"", callback);
+}
+
+static void
+n_trace_append_trace (GString *out, NRequestTrace *trace)
+{
+    NTraceSpan *s = NULL;
+    NTraceSpan  root;
+    guint       i;
+
+    memset (&root, 0, sizeof (root));
+    root.name = trace->name;
+
+    n_trace_append_event (out, "b", trace->serial, &root, trace->received);
+    g_string_append_printf (out, ",\"args\":{\"id\":%u}}", trace->id);
+
+    for (i = 0; i < trace->spans->len; ++i) {
+        s = &g_array_index (trace->spans, NTraceSpan, i);
+
+        n_trace_append_event (out, "b", trace->serial, s, s->start);
+        g_string_append (out, "}");
+
+        n_trace_append_event (out, "e", trace->serial, s, s->end);
+        g_string_append (out, ",\"args\":{");
+        if (s->cpu >= 0)
+            g_string_append_printf (out, "\"cpu_us\":%.3f", s->cpu / 1000.0);
+        else
+            g_string_append (out, "\"async\":true");
+        if (s->callback)
+            n_trace_append_callback (out, s->callback);
+        g_string_append (out, "}}");
+    }
+
+    n_trace_append_event (out, "e", trace->serial, &root, trace->finished);
+    g_string_append_printf (out, ",\"args\":{\"failed\":%s}}",
+        trace->failed ? "true" : "false");
+}
+
+gboolean
+n_trace_log_write (NTraceLog *log, const char *filename)
+{
+    NRequestTrace *trace  = NULL;
+    GString       *out    = NULL;
+    GError        *error  = NULL;
+    gboolean       result = FALSE;
+    guint          i;
+
+    if (!log || !filename)
+        return FALSE;
+
+    out = g_string_sized_new (4096);
+    g_string_append (out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    g_string_append_printf (out, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,"
+        "\"args\":{\"name\":\"ngfd\"}}", (int) getpid ());
+
+    /* oldest first */
+
+    for (i = 0; i < log->size; ++i) {
+        trace = log->traces[(log->next + i) % log->size];
+        if (trace)
+            n_trace_append_trace (out, trace);
+    }
+
+    g_string_append (out, "\n]}\n");
+
+    if (!g_file_set_contents (filename, out->str, out->len, &error)) {
+        N_WARNING (LOG_CAT "failed to write '%s': %s", filename, error->message);
+        g_error_free (error);
+    }
+    else {
+        N_INFO (LOG_CAT "wrote request traces to '%s'", filename);
+        result = TRUE;
+    }
+
+    g_string_free (out, TRUE);
+    return result;
+}
@@ -0,0 +1,52 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef N_REQUEST_TRACE_H
+#define N_REQUEST_TRACE_H
+
+#include <glib.h>
+
+#define N_CORE_DEFAULT_TRACE_FILE "ngfd-trace.json"
+
+/* timeline of a single request. spans are recorded with monotonic
+   timestamps and, for the ones covering a single call on the main thread,
+   the thread cpu time spent in the call. async spans cover waiting for a
+   sink, e.g. from prepare until the sink synchronizes. */
+typedef struct _NRequestTrace NRequestTrace;
+
+/* ring buffer of the most recent finished request traces. */
+typedef struct _NTraceLog NTraceLog;
+
+NRequestTrace* n_request_trace_new         (const char *name, guint id, gint64 received);
+void           n_request_trace_free        (NRequestTrace *trace);
+guint          n_request_trace_begin       (NRequestTrace *trace, const char *name, const char *sink);
+guint          n_request_trace_begin_async (NRequestTrace *trace, const char *name, const char *sink);
+void           n_request_trace_end         (NRequestTrace *trace, guint span);
+void           n_request_trace_end_async   (NRequestTrace *trace, const char *name, const char *sink);
+void           n_request_trace_set_callback (NRequestTrace *trace, guint span, gpointer callback);
+void           n_request_trace_finish      (NRequestTrace *trace, gboolean failed);
+
+NTraceLog*     n_trace_log_new             (guint size);
+void           n_trace_log_free            (NTraceLog *log);
+void           n_trace_log_add             (NTraceLog *log, NRequestTrace *trace);
+gboolean       n_trace_log_write           (NTraceLog *log, const char *filename);
+
+#endif /* N_REQUEST_TRACE_H */
@@ -20,6 +20,7 @@
  */
 
 #include "request-internal.h"
+#include "proplist-internal.h"
 
 NRequest*
 n_request_new ()
@@ -27,6 +28,9 @@ n_request_new ()
     NRequest *request = NULL;
 
     request = g_slice_new0 (NRequest);
+    request->received = g_get_monotonic_time () * 1000;
+    n_arena_init (&request->arena);
+
     return request;
 }
 
@@ -37,7 +41,7 @@ n_request_new_with_event (const char *event)
         return NULL;
 
     NRequest *request = n_request_new ();
-    request->name = g_strdup (event);
+    request->name = n_arena_strdup (&request->arena, event);
     return request;
 }
 
@@ -47,9 +51,9 @@ n_request_new_with_event_and_properties (const char *event, const NProplist *pro
     if (!event)
         return NULL;
 
-    NRequest *request = g_slice_new0 (NRequest);
-    request->name       = g_strdup (event);
-    request->properties = n_proplist_copy ((NProplist*) properties);
+    NRequest *request = n_request_new ();
+    request->name       = n_arena_strdup (&request->arena, event);
+    request->properties = n_proplist_copy_in_arena (properties, &request->arena);
 
     return request;
 }
@@ -57,28 +61,154 @@ n_request_new_with_event_and_properties (const char *event, const NProplist *pro
 void
 n_request_free (NRequest *request)
 {
-    if (request->properties) {
-        n_proplist_free (request->properties);
-        request->properties = NULL;
-    }
+    NRequestKeep *keep = NULL;
+
+    /* properties, name and client are either in the arena or replaced
+       by the core with proplists that are. */
+
+    n_proplist_free (request->properties);
+    request->properties = NULL;
+
+    n_proplist_free (request->original_properties);
+    request->original_properties = NULL;
 
-    if (request->original_properties) {
-        n_proplist_free (request->original_properties);
-        request->original_properties = NULL;
+    if (request->event) {
+        n_event_unref (request->event);
+        request->event = NULL;
     }
 
-    g_free (request->name);
-    request->name = NULL;
+    n_request_trace_free (request->trace);
+    request->trace = NULL;
 
+    request->client = NULL;
+    request->name   = NULL;
+
+    /* borrowed values may point to the kept data, release it only after
+       everything else is gone. */
+
+    for (keep = request->kept; keep; keep = keep->next) {
+        if (keep->destroy)
+            keep->destroy (keep->data);
+    }
+    request->kept = NULL;
+
+    n_arena_clear (&request->arena);
     g_slice_free (NRequest, request);
 }
 
+void*
+n_request_alloc (NRequest *request, gsize size)
+{
+    if (!request)
+        return NULL;
+
+    return n_arena_alloc (&request->arena, size);
+}
+
+void*
+n_request_alloc0 (NRequest *request, gsize size)
+{
+    if (!request)
+        return NULL;
+
+    return n_arena_alloc0 (&request->arena, size);
+}
+
+char*
+n_request_strdup (NRequest *request, const char *str)
+{
+    if (!request)
+        return NULL;
+
+    return n_arena_strdup (&request->arena, str);
+}
+
+GList*
+n_request_list_append (NRequest *request, GList *list, gpointer data)
+{
+    GList *link = NULL;
+    GList *last = NULL;
+
+    link = n_arena_alloc0 (&request->arena, sizeof (GList));
+    link->data = data;
+
+    if (!list)
+        return link;
+
+    last       = g_list_last (list);
+    last->next = link;
+    link->prev = last;
+
+    return list;
+}
+
+GList*
+n_request_list_copy (NRequest *request, GList *list)
+{
+    GList *copy = NULL;
+    GList *last = NULL;
+    GList *link = NULL;
+    GList *iter = NULL;
+
+    for (iter = g_list_first (list); iter; iter = g_list_next (iter)) {
+        link = n_arena_alloc0 (&request->arena, sizeof (GList));
+        link->data = iter->data;
+        link->prev = last;
+
+        if (last)
+            last->next = link;
+        else
+            copy = link;
+
+        last = link;
+    }
+
+    return copy;
+}
+
+GList*
+n_request_list_remove (GList *list, gpointer data)
+{
+    GList *link = NULL;
+
+    /* the link stays in the arena. */
+
+    if ((link = g_list_find (list, data)) != NULL)
+        list = g_list_remove_link (list, link);
+
+    return list;
+}
+
 unsigned int
 n_request_get_id (NRequest *request)
 {
     return (request != NULL) ? request->id : 0;
 }
 
+void
+n_request_set_id (NRequest *request, unsigned int id)
+{
+    if (!request)
+        return;
+
+    request->id = id;
+}
+
+void
+n_request_set_client (NRequest *request, const char *client)
+{
+    if (!request)
+        return;
+
+    request->client = n_arena_strdup (&request->arena, client);
+}
+
+const char*
+n_request_get_client (NRequest *request)
+{
+    return (request != NULL) ? (const char*) request->client : NULL;
+}
+
 const char*
 n_request_get_name (NRequest *request)
 {
@@ -92,7 +222,7 @@ n_request_set_properties (NRequest *request, NProplist *properties)
         return;
 
     n_proplist_free (request->properties);
-    request->properties = n_proplist_copy (properties);
+    request->properties = n_proplist_copy_in_arena (properties, &request->arena);
 }
 
 const NProplist*
@@ -101,6 +231,69 @@ n_request_get_properties (NRequest *request)
     return (request != NULL) ? (const NProplist*) request->properties : NULL;
 }
 
+NProplist*
+n_request_edit_properties (NRequest *request)
+{
+    NProplist *edit = NULL;
+
+    if (!request)
+        return NULL;
+
+    if (!request->properties)
+        request->properties = n_proplist_new_in_arena (&request->arena);
+
+    edit = n_proplist_new_in_arena (&request->arena);
+    n_proplist_add_layer (edit, request->properties);
+
+    return edit;
+}
+
+void
+n_request_commit_properties (NRequest *request, NProplist *edit)
+{
+    if (!request || !edit)
+        return;
+
+    n_proplist_apply (request->properties, edit);
+}
+
+void
+n_request_discard_properties (NRequest *request, NProplist *edit)
+{
+    /* the edit lives in the request arena, nothing to release. */
+
+    (void) request;
+    (void) edit;
+}
+
+NProplist*
+n_request_init_properties (NRequest *request)
+{
+    if (!request)
+        return NULL;
+
+    if (!request->properties)
+        request->properties = n_proplist_new_in_arena (&request->arena);
+
+    return request->properties;
+}
+
+void
+n_request_keep (NRequest *request, void *data, GDestroyNotify destroy)
+{
+    NRequestKeep *keep = NULL;
+
+    if (!request)
+        return;
+
+    keep = n_arena_alloc (&request->arena, sizeof (NRequestKeep));
+    keep->data    = data;
+    keep->destroy = destroy;
+    keep->next    = request->kept;
+
+    request->kept = keep;
+}
+
 void
 n_request_store_data (NRequest *request, const char *key, void *data)
 {
@@ -23,6 +23,7 @@
 #define N_SINK_INTERFACE_INTERNAL_H
 
 #include <ngf/sinkinterface.h>
+#include <ngf/plugin.h>
 
 #include "core-internal.h"
 
@@ -35,6 +36,7 @@ struct _NSinkInterface
     NCore              *core;
     void               *userdata;
     int                 priority;       /* priority */
+    NPlugin            *plugin;         /* plugin that registered the sink */
 };
 
 #endif /* N_SINK_INTERFACE_INTERNAL_H */
@@ -0,0 +1,49 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef N_VALUE_INTERNAL_H
+#define N_VALUE_INTERNAL_H
+
+#include <ngf/value.h>
+
+/* exposed to allow storing values inline, e.g. within proplist slots. */
+
+struct _NValue
+{
+    guint type;
+    union {
+        gchar   *s;
+        gint     i;
+        guint    u;
+        gboolean b;
+        gpointer p;
+    } value;
+};
+
+/* copy the contents of source to an uninitialized or cleaned dest. */
+void n_value_copy_to (NValue *dest, const NValue *source);
+
+/* log a key and value as a debug message without formatting the value
+   to a string first, prefix is prepended to the key. */
+void n_value_log_debug (const char *prefix, const char *key,
+                        const NValue *value);
+
+#endif /* N_VALUE_INTERNAL_H */
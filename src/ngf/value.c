@@ -23,17 +23,7 @@
 #include <ngf/log.h>
 #include <ngf/value.h>
 
-struct _NValue
-{
-    guint type;
-    union {
-        gchar   *s;
-        gint     i;
-        guint    u;
-        gboolean b;
-        gpointer p;
-    } value;
-};
+#include "value-internal.h"
 
 NValue*
 n_value_new ()
@@ -110,6 +100,14 @@ n_value_copy (const NValue *value)
     return new_value;
 }
 
+void
+n_value_copy_to (NValue *dest, const NValue *source)
+{
+    *dest = *source;
+    if (source->type == N_VALUE_TYPE_STRING)
+        dest->value.s = g_strdup (source->value.s);
+}
+
 int
 n_value_type (const NValue *value)
 {
@@ -284,3 +282,42 @@ n_value_to_string (const NValue *value)
     return result;
 }
 
+
+void
+n_value_log_debug (const char *prefix, const char *key, const NValue *value)
+{
+    /* same output as n_value_to_string, but the arguments go to the log
+       as they are so nothing is formatted unless the message is shown. */
+
+    if (!value) {
+        N_DEBUG ("%s%s = <null>", prefix, key);
+        return;
+    }
+
+    switch (value->type) {
+        case N_VALUE_TYPE_STRING:
+            N_DEBUG ("%s%s = %s (string)", prefix, key, value->value.s);
+            break;
+
+        case N_VALUE_TYPE_INT:
+            N_DEBUG ("%s%s = %d (int)", prefix, key, value->value.i);
+            break;
+
+        case N_VALUE_TYPE_UINT:
+            N_DEBUG ("%s%s = %u (uint)", prefix, key, value->value.u);
+            break;
+
+        case N_VALUE_TYPE_BOOL:
+            N_DEBUG ("%s%s = %s (bool)", prefix, key,
+                value->value.b ? "TRUE" : "FALSE");
+            break;
+
+        case N_VALUE_TYPE_POINTER:
+            N_DEBUG ("%s%s = 0x%p (pointer)", prefix, key, value->value.p);
+            break;
+
+        default:
+            N_DEBUG ("%s%s = <unknown value>", prefix, key);
+            break;
+    }
+}
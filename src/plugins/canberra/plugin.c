@@ -100,7 +100,7 @@ canberra_sink_prepare (NSinkInterface *iface, NRequest *request)
 {
     N_DEBUG (LOG_CAT "sink prepare");
 
-    CanberraData *data = g_slice_new0 (CanberraData);
+    CanberraData *data = n_request_alloc0 (request, sizeof (CanberraData));
     NProplist *props = props = (NProplist*) n_request_get_properties (request);
 
     data->request    = request;
@@ -230,8 +230,6 @@ canberra_sink_stop (NSinkInterface *iface, NRequest *request)
 
     if (data->complete_cb_id > 0)
         g_source_remove (data->complete_cb_id);
-
-    g_slice_free (CanberraData, data);
 }
 
 N_PLUGIN_LOAD (plugin)
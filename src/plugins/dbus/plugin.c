@@ -46,8 +46,10 @@ N_PLUGIN_DESCRIPTION ("D-Bus interface")
 
 #define NGF_DBUS_STATUS       "Status"
 #define NGF_DBUS_METHOD_PLAY  "Play"
+#define NGF_DBUS_METHOD_PLAY_BATCH "PlayBatch"
 #define NGF_DBUS_METHOD_STOP  "Stop"
 #define NGF_DBUS_METHOD_PAUSE "Pause"
+#define NGF_DBUS_METHOD_DUMP_LOG "DumpLog"
 
 #define NGF_DBUS_PROPERTY_ID   "dbus.event.id"
 #define NGF_DBUS_PROPERTY_NAME "dbus.event.client"
@@ -56,13 +58,16 @@ N_PLUGIN_DESCRIPTION ("D-Bus interface")
 
 #define RINGTONE_STOP_TIMEOUT 200
 
+#define MAX_CLIENT_KEYS       256
+
 static gboolean          msg_parse_variant       (DBusMessageIter *iter,
                                                   NProplist *proplist,
-                                                  const char *key);
+                                                  NAtom key);
+static NAtom             msg_get_key_atom        (const char *key);
 static gboolean          msg_parse_dict          (DBusMessageIter *iter,
                                                   NProplist *proplist);
 static gboolean          msg_get_properties      (DBusMessageIter *iter,
-                                                  NProplist **properties);
+                                                  NProplist *proplist);
 static DBusHandlerResult dbusif_message_function (DBusConnection *connection,
                                                   DBusMessage *msg,
                                                   void *userdata);
@@ -83,13 +88,16 @@ typedef struct _DBusInterfaceData
     DBusConnection  *connection;
     NInputInterface *iface;
     uint32_t event_id;
-    GSList *clients; // Internal cache of all clients currently connected
+    GHashTable *clients; // Internal cache of all clients currently connected
+    NAtom id_atom;
+    NAtom client_atom;
+    guint num_client_keys; // Keys interned on behalf of clients
 } DBusInterfaceData;
 
 static DBusInterfaceData *g_data = NULL;
 
 static gboolean
-msg_parse_variant (DBusMessageIter *iter, NProplist *proplist, const char *key)
+msg_parse_variant (DBusMessageIter *iter, NProplist *proplist, NAtom key)
 {
     DBusMessageIter variant;
 
@@ -101,6 +109,9 @@ msg_parse_variant (DBusMessageIter *iter, NProplist *proplist, const char *key)
     if (!key)
         return FALSE;
 
+    /* string values point into the message, the request keeps a reference
+       to it. */
+
     if (dbus_message_iter_get_arg_type (iter) != DBUS_TYPE_VARIANT)
         return FALSE;
 
@@ -109,22 +120,22 @@ msg_parse_variant (DBusMessageIter *iter, NProplist *proplist, const char *key)
     switch (dbus_message_iter_get_arg_type (&variant)) {
         case DBUS_TYPE_STRING:
             dbus_message_iter_get_basic (&variant, &str_value);
-            n_proplist_set_string (proplist, key, str_value);
+            n_proplist_set_string_borrowed_atom (proplist, key, str_value);
             return TRUE;
 
         case DBUS_TYPE_UINT32:
             dbus_message_iter_get_basic (&variant, &uint_value);
-            n_proplist_set_uint (proplist, key, uint_value);
+            n_proplist_set_uint_atom (proplist, key, uint_value);
             return TRUE;
 
         case DBUS_TYPE_INT32:
             dbus_message_iter_get_basic (&variant, &int_value);
-            n_proplist_set_int (proplist, key, int_value);
+            n_proplist_set_int_atom (proplist, key, int_value);
             return TRUE;
 
         case DBUS_TYPE_BOOLEAN:
             dbus_message_iter_get_basic (&variant, &boolean_value);
-            n_proplist_set_bool (proplist, key, boolean_value ? TRUE : FALSE);
+            n_proplist_set_bool_atom (proplist, key, boolean_value ? TRUE : FALSE);
             return TRUE;
 
         default:
@@ -134,6 +145,27 @@ msg_parse_variant (DBusMessageIter *iter, NProplist *proplist, const char *key)
     return FALSE;
 }
 
+static NAtom
+msg_get_key_atom (const char *key)
+{
+    NAtom atom = N_ATOM_NONE;
+
+    if ((atom = n_atom_lookup (key)) != N_ATOM_NONE)
+        return atom;
+
+    /* atoms are never freed. keys nobody has used yet are interned only
+       up to a limit, otherwise any client could grow the table without
+       bound by sending random keys. */
+
+    if (g_data->num_client_keys >= MAX_CLIENT_KEYS) {
+        N_DEBUG (LOG_CAT "ignoring unknown key '%s'", key);
+        return N_ATOM_NONE;
+    }
+
+    g_data->num_client_keys++;
+    return n_atom_intern (key);
+}
+
 static gboolean
 msg_parse_dict (DBusMessageIter *iter, NProplist *proplist)
 {
@@ -156,31 +188,26 @@ msg_parse_dict (DBusMessageIter *iter, NProplist *proplist)
     dbus_message_iter_next (&dict);
 
     /* Parse the variant contents */
-    if (!msg_parse_variant (&dict, proplist, key))
+    if (!msg_parse_variant (&dict, proplist, msg_get_key_atom (key)))
         return FALSE;
 
     return TRUE;
 }
 
 static gboolean
-msg_get_properties (DBusMessageIter *iter, NProplist **properties)
+msg_get_properties (DBusMessageIter *iter, NProplist *proplist)
 {
-    NProplist       *p = NULL;
-    DBusMessageIter  array;
+    DBusMessageIter array;
 
     if (dbus_message_iter_get_arg_type (iter) != DBUS_TYPE_ARRAY)
         return FALSE;
 
-    p = n_proplist_new ();
-
     dbus_message_iter_recurse (iter, &array);
     while (dbus_message_iter_get_arg_type (&array) != DBUS_TYPE_INVALID) {
-        (void) msg_parse_dict (&array, p);
+        (void) msg_parse_dict (&array, proplist);
         dbus_message_iter_next (&array);
     }
 
-    *properties = p;
-
     return TRUE;
 }
 
@@ -212,52 +239,177 @@ dbusif_reply_error (DBusConnection *connection, DBusMessage *msg, const char *er
     }
 }
 
+static void
+dbusif_message_unref (gpointer data)
+{
+    dbus_message_unref ((DBusMessage*) data);
+}
+
+static NRequest*
+dbusif_new_request (DBusMessage *msg, DBusMessageIter *iter, const char *sender)
+{
+    NRequest   *request    = NULL;
+    NProplist  *properties = NULL;
+    const char *event      = NULL;
+
+    /* iter points to the event name followed by the properties. the
+       properties are parsed straight into the request, borrowing the
+       strings from the message. */
+
+    if (dbus_message_iter_get_arg_type (iter) != DBUS_TYPE_STRING)
+        return NULL;
+
+    dbus_message_iter_get_basic (iter, &event);
+    dbus_message_iter_next (iter);
+
+    request = n_request_new_with_event (event);
+    n_request_keep (request, dbus_message_ref (msg), dbusif_message_unref);
+
+    properties = n_request_init_properties (request);
+    if (!msg_get_properties (iter, properties)) {
+        n_request_free (request);
+        return NULL;
+    }
+
+    n_request_set_client (request, sender);
+    n_proplist_set_string_borrowed_atom (properties, g_data->client_atom, sender);
+
+    return request;
+}
+
+static void
+dbusif_set_request_id (NRequest *request, uint32_t event_id)
+{
+    n_request_set_id (request, event_id);
+    n_proplist_set_uint_atom (n_request_init_properties (request),
+        g_data->id_atom, event_id);
+}
+
 static DBusHandlerResult
 dbusif_play_handler (DBusConnection *connection, DBusMessage *msg,
                      NInputInterface *iface, uint32_t event_id)
 {
-    const char      *event      = NULL;
-    NProplist       *properties = NULL;
     NRequest        *request    = NULL;
     DBusMessageIter  iter;
     const char      *sender     = NULL;
-    GSList          *search     = NULL;
+
+    // We won't launch events without proper sender
+    if ((sender = dbus_message_get_sender (msg)) == NULL)
+        goto fail;
 
     dbus_message_iter_init (msg, &iter);
-    if (dbus_message_iter_get_arg_type (&iter) != DBUS_TYPE_STRING)
+    if ((request = dbusif_new_request (msg, &iter, sender)) == NULL)
         goto fail;
 
-    dbus_message_iter_get_basic (&iter, &event);
-    dbus_message_iter_next (&iter);
+    dbusif_set_request_id (request, event_id);
 
-    if (!msg_get_properties (&iter, &properties))
-        goto fail;
+    N_INFO (LOG_CAT ">> play received for event '%s' with id '%u' (client %s)",
+        n_request_get_name (request), event_id, sender);
+
+    if (!g_hash_table_contains (g_data->clients, sender))
+        g_hash_table_add (g_data->clients, g_strdup (sender));
+
+    // Reply internal event_id immediately
+    dbusif_ack (connection, msg, event_id);
+
+    n_input_interface_play_request (iface, request);
+
+    return DBUS_HANDLER_RESULT_HANDLED;
+
+fail:
+    dbusif_reply_error (connection, msg, "Malformed method call.");
+    return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+static DBusHandlerResult
+dbusif_play_batch_handler (DBusConnection *connection, DBusMessage *msg,
+                           NInputInterface *iface)
+{
+    DBusMessage     *reply      = NULL;
+    const char      *sender     = NULL;
+    NRequest        *request    = NULL;
+    GList           *requests   = NULL;
+    GList           *iter       = NULL;
+    GArray          *ids        = NULL;
+    uint32_t         event_id   = 0;
+    const uint32_t  *values     = NULL;
+    DBusMessageIter  iter_msg;
+    DBusMessageIter  array;
+    DBusMessageIter  entry;
+    DBusMessageIter  reply_iter;
+    DBusMessageIter  reply_array;
 
-    // We won't launch events without proper sender
     if ((sender = dbus_message_get_sender (msg)) == NULL)
         goto fail;
 
-    N_INFO (LOG_CAT ">> play received for event '%s' with id '%u' (client %s)", event, event_id, sender);
+    /* a(sa{sv}), parse everything before anything is started so that a
+       malformed batch does not play partially. */
 
-    for (search = g_data->clients; search; search = g_slist_next(search)) {
-        if (g_str_equal (sender, (const char*)search->data))
-            break;
+    dbus_message_iter_init (msg, &iter_msg);
+    if (dbus_message_iter_get_arg_type (&iter_msg) != DBUS_TYPE_ARRAY)
+        goto fail;
+
+    dbus_message_iter_recurse (&iter_msg, &array);
+    while (dbus_message_iter_get_arg_type (&array) != DBUS_TYPE_INVALID) {
+        if (dbus_message_iter_get_arg_type (&array) != DBUS_TYPE_STRUCT)
+            goto fail;
+
+        dbus_message_iter_recurse (&array, &entry);
+        if ((request = dbusif_new_request (msg, &entry, sender)) == NULL)
+            goto fail;
+
+        requests = g_list_prepend (requests, request);
+        dbus_message_iter_next (&array);
     }
-    if (!search)
-        g_data->clients = g_slist_append (g_data->clients, g_strdup (sender));
 
-    // Reply internal event_id immediately
-    dbusif_ack (connection, msg, event_id);
+    if (!requests)
+        goto fail;
 
-    n_proplist_set_uint (properties, NGF_DBUS_PROPERTY_ID, event_id);
-    n_proplist_set_string (properties, NGF_DBUS_PROPERTY_NAME, sender);
-    request = n_request_new_with_event_and_properties (event, properties);
-    n_input_interface_play_request (iface, request);
-    n_proplist_free (properties);
+    requests = g_list_reverse (requests);
+
+    N_INFO (LOG_CAT ">> play batch of %u events received (client %s)",
+        g_list_length (requests), sender);
+
+    if (!g_hash_table_contains (g_data->clients, sender))
+        g_hash_table_add (g_data->clients, g_strdup (sender));
+
+    ids = g_array_sized_new (FALSE, FALSE, sizeof (dbus_uint32_t),
+        g_list_length (requests));
+    for (iter = g_list_first (requests); iter; iter = g_list_next (iter)) {
+        event_id = ++g_data->event_id;
+        g_array_append_val (ids, event_id);
+        dbusif_set_request_id ((NRequest*) iter->data, event_id);
+
+        N_DEBUG (LOG_CAT "batch event '%s' with id '%u'",
+            n_request_get_name ((NRequest*) iter->data), event_id);
+    }
+
+    /* reply all ids before the requests start sending status. */
+
+    if ((reply = dbus_message_new_method_return (msg)) != NULL) {
+        values = (const uint32_t*) ids->data;
+        dbus_message_iter_init_append (reply, &reply_iter);
+        dbus_message_iter_open_container (&reply_iter, DBUS_TYPE_ARRAY,
+            DBUS_TYPE_UINT32_AS_STRING, &reply_array);
+        dbus_message_iter_append_fixed_array (&reply_array, DBUS_TYPE_UINT32,
+            &values, (int) ids->len);
+        dbus_message_iter_close_container (&reply_iter, &reply_array);
+        dbus_connection_send (connection, reply, NULL);
+        dbus_message_unref (reply);
+    }
+
+    n_input_interface_play_batch (iface, requests);
+
+    g_list_free (requests);
+    g_array_free (ids, TRUE);
 
     return DBUS_HANDLER_RESULT_HANDLED;
 
 fail:
+    for (iter = g_list_first (requests); iter; iter = g_list_next (iter))
+        n_request_free ((NRequest*) iter->data);
+    g_list_free (requests);
+
     dbusif_reply_error (connection, msg, "Malformed method call.");
     return DBUS_HANDLER_RESULT_HANDLED;
 }
@@ -267,31 +419,10 @@ dbusif_lookup_request (NInputInterface *iface, uint32_t event_id)
 {
     g_assert (iface != NULL);
 
-    NCore     *core            = NULL;
-    NRequest  *request         = NULL;
-    GList     *active_requests = NULL;
-    GList     *iter            = NULL;
-    guint      match_id        = 0;
-    NProplist *properties      = NULL;
-
     if (event_id == 0)
         return NULL;
 
-    core = n_input_interface_get_core (iface);
-    active_requests = n_core_get_requests (core);
-
-    for (iter = g_list_first (active_requests); iter; iter = g_list_next (iter)) {
-        request = (NRequest*) iter->data;
-        properties = (NProplist*) n_request_get_properties (request);
-        if (!properties)
-            continue;
-
-        match_id = n_proplist_get_uint (properties, NGF_DBUS_PROPERTY_ID);
-        if (match_id == event_id)
-            return request;
-    }
-
-    return NULL;
+    return n_core_lookup_request (n_input_interface_get_core (iface), event_id);
 }
 
 static void
@@ -321,24 +452,16 @@ dbusif_stop_by_name (NInputInterface *iface, const char *client_name)
 
     NCore     *core            = NULL;
     NRequest  *request         = NULL;
-    GList     *active_requests = NULL;
     GList     *iter            = NULL;
-    const gchar *match_name    = NULL;
-    NProplist *properties      = NULL;
+
+    /* stopping only schedules the request to be removed, the list stays
+       valid while iterating. */
 
     core = n_input_interface_get_core (iface);
-    active_requests = n_core_get_requests (core);
 
-    for (iter = g_list_first (active_requests); iter; iter = g_list_next (iter)) {
+    for (iter = n_core_get_requests_by_client (core, client_name); iter; iter = g_list_next (iter)) {
         request = (NRequest*) iter->data;
-
-        properties = (NProplist*) n_request_get_properties (request);
-        if (!properties)
-            continue;
-
-        match_name = n_proplist_get_string (properties, NGF_DBUS_PROPERTY_NAME);
-        if (match_name && g_str_equal (match_name, client_name))
-            n_input_interface_stop_request (iface, request, 0);
+        n_input_interface_stop_request (iface, request, 0);
     }
 }
 
@@ -438,24 +561,30 @@ fail:
 static void
 dbusif_disconnect_handler (NInputInterface *iface, const gchar *client)
 {
-    GSList          *search    = NULL;
-
     g_assert (iface);
     g_assert (client);
 
-    for (search = g_data->clients; search; search = g_slist_next(search)) {
-        if (g_str_equal (client, (const gchar*)search->data))
-            break;
+    if (g_hash_table_remove (g_data->clients, client)) {
+        N_INFO (LOG_CAT ">> client disconnect (%s)", client);
+        dbusif_stop_by_name (iface, client);
     }
+}
 
-    if (search) {
-        g_data->clients = g_slist_remove_link (g_data->clients, search);
-        g_free (search->data);
-        g_slist_free (search);
+static DBusHandlerResult
+dbusif_dump_log_handler (DBusConnection *connection, DBusMessage *msg)
+{
+    DBusMessage *reply = NULL;
 
-        N_INFO (LOG_CAT ">> client disconnect (%s)", client);
-        dbusif_stop_by_name (iface, client);
+    N_INFO (LOG_CAT ">> flight recorder dump requested");
+    n_log_dump_recorder ();
+
+    reply = dbus_message_new_method_return (msg);
+    if (reply) {
+        dbus_connection_send (connection, reply, NULL);
+        dbus_message_unref (reply);
     }
+
+    return DBUS_HANDLER_RESULT_HANDLED;
 }
 
 static DBusHandlerResult
@@ -521,12 +650,18 @@ dbusif_message_function (DBusConnection *connection, DBusMessage *msg,
     if (g_str_equal (member, NGF_DBUS_METHOD_PLAY))
         return dbusif_play_handler (connection, msg, iface, ++g_data->event_id);
 
+    else if (g_str_equal (member, NGF_DBUS_METHOD_PLAY_BATCH))
+        return dbusif_play_batch_handler (connection, msg, iface);
+
     else if (g_str_equal (member, NGF_DBUS_METHOD_STOP))
         return dbusif_stop_handler (connection, msg, iface);
 
     else if (g_str_equal (member, NGF_DBUS_METHOD_PAUSE))
         return dbusif_pause_handler (connection, msg, iface);
 
+    else if (g_str_equal (member, NGF_DBUS_METHOD_DUMP_LOG))
+        return dbusif_dump_log_handler (connection, msg);
+
     return DBUS_HANDLER_RESULT_HANDLED;
 }
 
@@ -542,6 +677,15 @@ dbusif_initialize (NInputInterface *iface)
 
     g_data = g_new0 (DBusInterfaceData, 1);
     g_data->iface = iface;
+    g_data->id_atom = n_atom_intern (NGF_DBUS_PROPERTY_ID);
+    g_data->client_atom = n_atom_intern (NGF_DBUS_PROPERTY_NAME);
+    g_data->clients = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    /* id and client differ for every request, but do not affect how the
+       request is resolved. */
+
+    n_core_add_volatile_key (n_input_interface_get_core (iface), NGF_DBUS_PROPERTY_ID);
+    n_core_add_volatile_key (n_input_interface_get_core (iface), NGF_DBUS_PROPERTY_NAME);
 
     dbus_error_init (&error);
     g_data->connection = dbus_bus_get (DBUS_BUS_SYSTEM, &error);
@@ -587,6 +731,7 @@ dbusif_shutdown (NInputInterface *iface)
     }
 
     if (g_data) {
+        g_hash_table_destroy (g_data->clients);
         g_free (g_data);
         g_data = NULL;
     }
@@ -613,7 +758,7 @@ dbusif_send_reply (NInputInterface *iface, NRequest *request, int code)
     (void) iface;
 
     props  = n_request_get_properties (request);
-    event_id = n_proplist_get_uint ((NProplist*) props, NGF_DBUS_PROPERTY_ID);
+    event_id = n_proplist_get_uint_atom (props, g_data->id_atom);
     status = code;
 
     if (event_id == 0)
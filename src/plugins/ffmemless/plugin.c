@@ -51,6 +51,7 @@
 N_PLUGIN_NAME(FFM_PLUGIN_NAME)
 N_PLUGIN_DESCRIPTION("Vibra plugin using ff-memless kernel backend")
 N_PLUGIN_VERSION("0.9")
+N_PLUGIN_STARTUP_DEPENDS("")
 
 struct ffm_effect_data {
 	NRequest       *request;
@@ -632,7 +633,7 @@ static int ffm_sink_prepare(NSinkInterface *iface, NRequest *request)
 		data = g_hash_table_lookup(ffm.effects, FFM_DEFAULT_EFFECT);
 
 	/* creating copy of the data as we need to alter it for this event */
-	copy = g_new(struct ffm_effect_data, 1);
+	copy = n_request_alloc0(request, sizeof (struct ffm_effect_data));
 	copy->id = data->id;
 	copy->repeat = data->repeat;
 	copy->iface = iface;
@@ -698,7 +699,6 @@ static void ffm_sink_stop(NSinkInterface *iface, NRequest *request)
 	}
 
 	ffm_play(data, 0);
-	g_free(data);
 }
 
 N_PLUGIN_LOAD(plugin)
@@ -0,0 +1,402 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+
+#include <ngf/log.h>
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "audio-format.h"
+
+#define LOG_CAT "gst: "
+
+#define MAX_CHAIN_LENGTH            2
+#define WAVE_FORMAT_PCM             0x0001
+#define WAVE_FORMAT_IEEE_FLOAT      0x0003
+
+typedef struct _FormatEntry
+{
+    time_t       mtime;
+    off_t        size;
+    AudioFormat  format;
+} FormatEntry;
+
+struct _FormatCache
+{
+    GHashTable       *entries;      /* filename -> FormatEntry* */
+    guint             max_entries;
+    FormatCacheStats  stats;
+};
+
+static const char *format_names[AUDIO_FORMAT_LAST] = {
+    "unknown",
+    "wav",
+    "vorbis",
+    "mp3",
+    "aac"
+};
+
+/* elements between the file source and the converter. the chains stay
+   within the elements that ship with the 0.10 plugin sets, a format whose
+   decoder is not installed is autoplugged. */
+
+static const char *format_elements[AUDIO_FORMAT_LAST][MAX_CHAIN_LENGTH + 1] = {
+    [AUDIO_FORMAT_UNKNOWN] = { NULL },
+    [AUDIO_FORMAT_WAV]     = { "wavparse", NULL },
+    [AUDIO_FORMAT_VORBIS]  = { "oggdemux", "vorbisdec", NULL },
+    [AUDIO_FORMAT_MP3]     = { "id3demux", "mad", NULL },
+    [AUDIO_FORMAT_AAC]     = { "aacparse", "faad", NULL }
+};
+
+static AudioFormat audio_format_sniff_wav    (const guint8 *data, gsize size);
+static AudioFormat audio_format_sniff_ogg    (const guint8 *data, gsize size);
+static gboolean    audio_format_link         (GstElement *src, GstElement *sink);
+static void        audio_format_pad_added_cb (GstElement *element, GstPad *pad, gpointer userdata);
+static void        format_entry_free         (gpointer data);
+
+
+
+static AudioFormat
+audio_format_sniff_wav (const guint8 *data, gsize size)
+{
+    gsize   offset = 12;
+    guint32 chunk_size;
+    guint16 tag;
+
+    /* wavparse hands out the samples as they are, only PCM and float can
+       go to the converter without a decoder. */
+
+    while (offset + 8 <= size) {
+        chunk_size = GST_READ_UINT32_LE (data + offset + 4);
+
+        if (memcmp (data + offset, "fmt ", 4) == 0) {
+            if (offset + 10 > size)
+                break;
+
+            tag = GST_READ_UINT16_LE (data + offset + 8);
+            if (tag == WAVE_FORMAT_PCM || tag == WAVE_FORMAT_IEEE_FLOAT)
+                return AUDIO_FORMAT_WAV;
+
+            break;
+        }
+
+        offset += 8 + (gsize) chunk_size + (chunk_size & 1);
+    }
+
+    return AUDIO_FORMAT_UNKNOWN;
+}
+
+static AudioFormat
+audio_format_sniff_ogg (const guint8 *data, gsize size)
+{
+    gsize offset;
+
+    /* the first page carries the identification header of the codec
+       right after the segment table. */
+
+    if (size < 27)
+        return AUDIO_FORMAT_UNKNOWN;
+
+    offset = 27 + data[26];
+    if (offset + 7 <= size && memcmp (data + offset, "\001vorbis", 7) == 0)
+        return AUDIO_FORMAT_VORBIS;
+
+    return AUDIO_FORMAT_UNKNOWN;
+}
+
+AudioFormat
+audio_format_sniff (const guint8 *data, gsize size)
+{
+    if (!data || size < 4)
+        return AUDIO_FORMAT_UNKNOWN;
+
+    if (size >= 12 && memcmp (data, "RIFF", 4) == 0 && memcmp (data + 8, "WAVE", 4) == 0)
+        return audio_format_sniff_wav (data, size);
+
+    if (memcmp (data, "OggS", 4) == 0)
+        return audio_format_sniff_ogg (data, size);
+
+    /* id3demux strips the tag in front of the frames. */
+
+    if (memcmp (data, "ID3", 3) == 0)
+        return AUDIO_FORMAT_MP3;
+
+    if (data[0] != 0xFF)
+        return AUDIO_FORMAT_UNKNOWN;
+
+    /* ADTS: 12 sync bits, layer 0 and a valid sampling frequency. */
+
+    if ((data[1] & 0xF6) == 0xF0 && ((data[2] >> 2) & 0x0F) < 13)
+        return AUDIO_FORMAT_AAC;
+
+    /* MPEG audio: 11 sync bits, a valid version, layer III and valid
+       bitrate and sampling frequency indices. */
+
+    if ((data[1] & 0xE0) == 0xE0 && (data[1] & 0x18) != 0x08
+        && (data[1] & 0x06) == 0x02 && (data[2] & 0xF0) != 0xF0
+        && (data[2] & 0x0C) != 0x0C)
+        return AUDIO_FORMAT_MP3;
+
+    return AUDIO_FORMAT_UNKNOWN;
+}
+
+AudioFormat
+audio_format_sniff_file (const char *filename)
+{
+    guint8  data[AUDIO_FORMAT_SNIFF_SIZE];
+    ssize_t size = 0;
+    int     fd   = -1;
+
+    if (!filename || (fd = open (filename, O_RDONLY)) < 0)
+        return AUDIO_FORMAT_UNKNOWN;
+
+    size = read (fd, data, sizeof (data));
+    close (fd);
+
+    return size > 0 ? audio_format_sniff (data, (gsize) size) : AUDIO_FORMAT_UNKNOWN;
+}
+
+const char*
+audio_format_get_name (AudioFormat format)
+{
+    if (format < AUDIO_FORMAT_UNKNOWN || format >= AUDIO_FORMAT_LAST)
+        return format_names[AUDIO_FORMAT_UNKNOWN];
+
+    return format_names[format];
+}
+
+gboolean
+audio_format_is_available (AudioFormat format)
+{
+    GstElementFactory  *factory = NULL;
+    const char        **name    = NULL;
+
+    if (format <= AUDIO_FORMAT_UNKNOWN || format >= AUDIO_FORMAT_LAST)
+        return FALSE;
+
+    for (name = format_elements[format]; *name; ++name) {
+        if ((factory = gst_element_factory_find (*name)) == NULL) {
+            N_DEBUG (LOG_CAT "no '%s' element, %s files are autoplugged",
+                *name, format_names[format]);
+            return FALSE;
+        }
+
+        gst_object_unref (factory);
+    }
+
+    return TRUE;
+}
+
+static void
+audio_format_pad_added_cb (GstElement *element, GstPad *pad, gpointer userdata)
+{
+    GstElement *next     = (GstElement*) userdata;
+    GstPad     *sink_pad = NULL;
+
+    (void) element;
+
+    /* only the first stream is played, the rest fail to link and are
+       left unlinked. */
+
+    sink_pad = gst_element_get_static_pad (next, "sink");
+    if (!gst_pad_is_linked (sink_pad))
+        (void) gst_pad_link (pad, sink_pad);
+    gst_object_unref (sink_pad);
+}
+
+static gboolean
+audio_format_link (GstElement *src, GstElement *sink)
+{
+    GstPad *pad = NULL;
+
+    /* elements that read a header first add their source pad once they
+       know what it carries, and remove it again when going back to READY.
+       the handler links the pad every time it appears. */
+
+    if ((pad = gst_element_get_static_pad (src, "src")) == NULL) {
+        g_signal_connect (G_OBJECT (src), "pad-added",
+            G_CALLBACK (audio_format_pad_added_cb), sink);
+        return TRUE;
+    }
+
+    gst_object_unref (pad);
+    return gst_element_link (src, sink);
+}
+
+gboolean
+audio_format_build_chain (AudioFormat format, GstBin *bin, GstElement *source, GstElement *sink)
+{
+    GstElement  *chain[MAX_CHAIN_LENGTH];
+    const char **name  = NULL;
+    GstElement  *prev  = source;
+    guint        count = 0;
+    guint        i;
+
+    if (format <= AUDIO_FORMAT_UNKNOWN || format >= AUDIO_FORMAT_LAST)
+        return FALSE;
+
+    for (name = format_elements[format]; *name; ++name) {
+        if ((chain[count] = gst_element_factory_make (*name, NULL)) == NULL) {
+            N_WARNING (LOG_CAT "failed to create '%s' for %s files", *name,
+                format_names[format]);
+
+            while (count > 0)
+                gst_object_unref (chain[--count]);
+
+            return FALSE;
+        }
+
+        ++count;
+    }
+
+    for (i = 0; i < count; ++i)
+        gst_bin_add (bin, chain[i]);
+
+    for (i = 0; i <= count; ++i) {
+        if (!audio_format_link (prev, i < count ? chain[i] : sink)) {
+            N_WARNING (LOG_CAT "failed to link the %s chain", format_names[format]);
+            return FALSE;
+        }
+
+        prev = i < count ? chain[i] : sink;
+    }
+
+    return TRUE;
+}
+
+static void
+format_entry_free (gpointer data)
+{
+    g_slice_free (FormatEntry, data);
+}
+
+FormatCache*
+format_cache_new (guint max_entries)
+{
+    FormatCache *cache = NULL;
+
+    cache = g_slice_new0 (FormatCache);
+    cache->entries     = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, format_entry_free);
+    cache->max_entries = max_entries;
+
+    return cache;
+}
+
+void
+format_cache_free (FormatCache *cache)
+{
+    if (!cache)
+        return;
+
+    g_hash_table_destroy (cache->entries);
+    g_slice_free (FormatCache, cache);
+}
+
+void
+format_cache_get_stats (FormatCache *cache, FormatCacheStats *stats)
+{
+    if (!cache || !stats)
+        return;
+
+    *stats = cache->stats;
+}
+
+void
+format_cache_log_stats (FormatCache *cache)
+{
+    if (!cache)
+        return;
+
+    N_INFO (LOG_CAT "format cache: %u hits, %u misses, %u failed, %u files",
+        cache->stats.hits, cache->stats.misses, cache->stats.failed,
+        cache->stats.entries);
+}
+
+AudioFormat
+format_cache_lookup (FormatCache *cache, const char *filename)
+{
+    FormatEntry *entry = NULL;
+    struct stat  st;
+
+    if (!filename)
+        return AUDIO_FORMAT_UNKNOWN;
+
+    if (!cache)
+        return audio_format_sniff_file (filename);
+
+    /* a file that can not be stat'ed fails in filesrc as well, the
+       autoplugged pipeline reports the error. */
+
+    if (stat (filename, &st) < 0)
+        return AUDIO_FORMAT_UNKNOWN;
+
+    entry = g_hash_table_lookup (cache->entries, filename);
+    if (entry && entry->mtime == st.st_mtime && entry->size == st.st_size) {
+        cache->stats.hits++;
+        return entry->format;
+    }
+
+    cache->stats.misses++;
+
+    if (!entry) {
+        /* sounds are picked from a handful of files, running over the
+           limit means the clients play arbitrary files. starting over is
+           as good as anything else then. */
+
+        if (g_hash_table_size (cache->entries) >= cache->max_entries)
+            g_hash_table_remove_all (cache->entries);
+
+        entry = g_slice_new0 (FormatEntry);
+        g_hash_table_insert (cache->entries, g_strdup (filename), entry);
+        cache->stats.entries = g_hash_table_size (cache->entries);
+    }
+
+    entry->mtime  = st.st_mtime;
+    entry->size   = st.st_size;
+    entry->format = audio_format_sniff_file (filename);
+
+    N_DEBUG (LOG_CAT "sniffed '%s' as %s", filename, format_names[entry->format]);
+
+    return entry->format;
+}
+
+void
+format_cache_mark_failed (FormatCache *cache, const char *filename)
+{
+    FormatEntry *entry = NULL;
+
+    if (!cache || !filename)
+        return;
+
+    if ((entry = g_hash_table_lookup (cache->entries, filename)) == NULL)
+        return;
+
+    if (entry->format != AUDIO_FORMAT_UNKNOWN) {
+        N_DEBUG (LOG_CAT "%s chain failed for '%s', autoplugging it from now on",
+            format_names[entry->format], filename);
+        entry->format = AUDIO_FORMAT_UNKNOWN;
+        cache->stats.failed++;
+    }
+}
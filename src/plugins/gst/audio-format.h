@@ -0,0 +1,86 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+
+#ifndef AUDIO_FORMAT_H
+#define AUDIO_FORMAT_H
+
+#include <glib.h>
+#include <gst/gst.h>
+
+/* container and codec of a sound file, sniffed from its first bytes.
+   files in a known format are played through a fixed chain of elements
+   instead of having decodebin2 typefind and autoplug them. */
+
+typedef enum _AudioFormat
+{
+    AUDIO_FORMAT_UNKNOWN = 0,   /* anything else, autoplugged */
+    AUDIO_FORMAT_WAV,           /* RIFF WAVE with PCM or float samples */
+    AUDIO_FORMAT_VORBIS,        /* Ogg Vorbis */
+    AUDIO_FORMAT_MP3,           /* MPEG-1/2 layer III, optionally ID3 tagged */
+    AUDIO_FORMAT_AAC,           /* AAC in ADTS framing */
+    AUDIO_FORMAT_LAST
+} AudioFormat;
+
+typedef struct _FormatCache FormatCache;
+
+typedef struct _FormatCacheStats
+{
+    guint  hits;
+    guint  misses;          /* files sniffed, new or modified */
+    guint  failed;          /* formats dropped after the fixed chain failed */
+    guint  entries;
+} FormatCacheStats;
+
+/* the minimum number of bytes audio_format_sniff () needs to recognize
+   every format. */
+#define AUDIO_FORMAT_SNIFF_SIZE 64
+
+AudioFormat  audio_format_sniff          (const guint8 *data, gsize size);
+AudioFormat  audio_format_sniff_file     (const char *filename);
+const char*  audio_format_get_name       (AudioFormat format);
+
+/* TRUE if every element of the fixed chain of the format is installed. */
+gboolean     audio_format_is_available   (AudioFormat format);
+
+/* adds the fixed chain of the format to bin and links it between source
+   and sink. demuxers get linked once their pads appear, also when the
+   pipeline is reused. returns FALSE if an element is missing or does not
+   link, the bin is not usable then. */
+gboolean     audio_format_build_chain    (AudioFormat format, GstBin *bin, GstElement *source, GstElement *sink);
+
+/* formats of the files played, keyed by path and invalidated when the
+   modification time or the size of the file changes. */
+FormatCache* format_cache_new            (guint max_entries);
+void         format_cache_free           (FormatCache *cache);
+void         format_cache_get_stats      (FormatCache *cache, FormatCacheStats *stats);
+void         format_cache_log_stats      (FormatCache *cache);
+
+/* sniffs the file unless it is known already. a NULL cache sniffs every
+   time. */
+AudioFormat  format_cache_lookup         (FormatCache *cache, const char *filename);
+
+/* the fixed chain could not play the file, it is autoplugged until the
+   file changes. */
+void         format_cache_mark_failed    (FormatCache *cache, const char *filename);
+
+#endif /* AUDIO_FORMAT_H */
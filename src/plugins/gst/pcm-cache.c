@@ -0,0 +1,495 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#include <ngf/log.h>
+
+#include <sys/stat.h>
+#include <gst/app/gstappsrc.h>
+
+#include "pcm-cache.h"
+
+#define LOG_CAT "gst: "
+
+struct _PcmTone
+{
+    gint          refcount;
+    gchar        *filename;
+    GstCaps      *caps;
+    GList        *buffers;      /* GstBuffer*, in play order */
+    gsize         size;
+    time_t        file_mtime;   /* file the tone was decoded from */
+    off_t         file_size;
+    GList         lru_link;     /* link in the cache LRU, data is the tone */
+};
+
+struct _PcmCapture
+{
+    gchar        *filename;
+    time_t        file_mtime;
+    off_t         file_size;
+    GstPad       *pad;
+    gulong        probe_id;
+    GstCaps      *caps;
+    GList        *buffers;      /* most recent first while collecting */
+    gsize         size;
+    gsize         max_size;
+    GstClockTime  max_duration;
+    gboolean      overflow;
+};
+
+struct _PcmCache
+{
+    GHashTable   *tones;        /* filename -> PcmTone*, keys owned by the tones */
+    GQueue        lru;          /* most recently used first */
+    gsize         budget;
+    gsize         max_file_size;
+    GstClockTime  max_duration;
+    PcmCacheStats stats;
+};
+
+static void        pcm_cache_evict          (PcmCache *cache, PcmTone *tone);
+static PcmTone*    pcm_cache_find           (PcmCache *cache, const char *filename);
+static PcmCapture* pcm_capture_new          (PcmCache *cache, const char *filename);
+static void        pcm_capture_clear        (PcmCapture *capture);
+static gboolean    pcm_capture_probe_cb     (GstPad *pad, GstBuffer *buffer, gpointer userdata);
+static void        pcm_decode_pad_cb        (GstElement *element, GstPad *pad, gboolean is_last, gpointer userdata);
+
+
+
+PcmCache*
+pcm_cache_new (gsize budget, gsize max_file_size, guint max_duration_ms)
+{
+    PcmCache *cache = NULL;
+
+    cache = g_slice_new0 (PcmCache);
+    cache->tones         = g_hash_table_new (g_str_hash, g_str_equal);
+    cache->budget        = budget;
+    cache->max_file_size = max_file_size;
+    cache->max_duration  = (GstClockTime) max_duration_ms * GST_MSECOND;
+    g_queue_init (&cache->lru);
+
+    return cache;
+}
+
+void
+pcm_cache_free (PcmCache *cache)
+{
+    GList *link = NULL;
+
+    if (!cache)
+        return;
+
+    while ((link = g_queue_peek_tail_link (&cache->lru)) != NULL)
+        pcm_cache_evict (cache, (PcmTone*) link->data);
+
+    g_hash_table_destroy (cache->tones);
+    g_slice_free (PcmCache, cache);
+}
+
+void
+pcm_cache_get_stats (PcmCache *cache, PcmCacheStats *stats)
+{
+    if (!cache || !stats)
+        return;
+
+    *stats = cache->stats;
+}
+
+void
+pcm_cache_log_stats (PcmCache *cache)
+{
+    if (!cache)
+        return;
+
+    N_INFO (LOG_CAT "pcm cache: %u hits, %u misses, %u stored, %u evicted, "
+                    "%u rejected, %u tones in %" G_GSIZE_FORMAT " of %"
+                    G_GSIZE_FORMAT " bytes",
+        cache->stats.hits, cache->stats.misses, cache->stats.stored,
+        cache->stats.evicted, cache->stats.rejected, cache->stats.entries,
+        cache->stats.size, cache->budget);
+}
+
+static void
+pcm_cache_evict (PcmCache *cache, PcmTone *tone)
+{
+    g_queue_unlink (&cache->lru, &tone->lru_link);
+    g_hash_table_remove (cache->tones, tone->filename);
+
+    cache->stats.size -= tone->size;
+    cache->stats.entries--;
+
+    /* pipelines still playing the tone keep their own reference. */
+
+    pcm_tone_unref (tone);
+}
+
+static PcmTone*
+pcm_cache_find (PcmCache *cache, const char *filename)
+{
+    PcmTone     *tone = NULL;
+    struct stat  st;
+
+    if ((tone = g_hash_table_lookup (cache->tones, filename)) == NULL)
+        return NULL;
+
+    /* a tone replaced at the same path is decoded again. */
+
+    if (stat (filename, &st) == 0 && st.st_mtime == tone->file_mtime
+        && st.st_size == tone->file_size)
+        return tone;
+
+    N_DEBUG (LOG_CAT "'%s' has changed, dropping it from the pcm cache", filename);
+    cache->stats.evicted++;
+    pcm_cache_evict (cache, tone);
+
+    return NULL;
+}
+
+PcmTone*
+pcm_cache_lookup (PcmCache *cache, const char *filename)
+{
+    PcmTone *tone = NULL;
+
+    if (!cache || !filename)
+        return NULL;
+
+    if ((tone = pcm_cache_find (cache, filename)) == NULL) {
+        cache->stats.misses++;
+        return NULL;
+    }
+
+    cache->stats.hits++;
+
+    g_queue_unlink (&cache->lru, &tone->lru_link);
+    g_queue_push_head_link (&cache->lru, &tone->lru_link);
+
+    N_DEBUG (LOG_CAT "pcm cache hit for '%s' (%u hits, %u misses)",
+        filename, cache->stats.hits, cache->stats.misses);
+
+    return pcm_tone_ref (tone);
+}
+
+static PcmCapture*
+pcm_capture_new (PcmCache *cache, const char *filename)
+{
+    PcmCapture  *capture = NULL;
+    struct stat  st;
+
+    /* reads only the limits, safe to call from any thread. */
+
+    if (cache->budget == 0 || !filename)
+        return NULL;
+
+    if (stat (filename, &st) < 0 || (gsize) st.st_size > cache->max_file_size)
+        return NULL;
+
+    capture = g_slice_new0 (PcmCapture);
+    capture->filename     = g_strdup (filename);
+    capture->file_mtime   = st.st_mtime;
+    capture->file_size    = st.st_size;
+    capture->max_size     = cache->budget;
+    capture->max_duration = cache->max_duration;
+
+    return capture;
+}
+
+PcmCapture*
+pcm_cache_capture_start (PcmCache *cache, const char *filename, GstPad *pad)
+{
+    PcmCapture *capture = NULL;
+
+    if (!cache || !filename || !pad)
+        return NULL;
+
+    if (pcm_cache_find (cache, filename))
+        return NULL;
+
+    if ((capture = pcm_capture_new (cache, filename)) == NULL)
+        return NULL;
+
+    capture->pad      = gst_object_ref (pad);
+    capture->probe_id = gst_pad_add_buffer_probe (pad,
+        G_CALLBACK (pcm_capture_probe_cb), capture);
+
+    N_DEBUG (LOG_CAT "capturing decoded '%s' for the pcm cache", filename);
+
+    return capture;
+}
+
+static void
+pcm_decode_pad_cb (GstElement *element, GstPad *pad, gboolean is_last,
+                   gpointer userdata)
+{
+    GstElement *convert  = (GstElement*) userdata;
+    GstPad     *sink_pad = NULL;
+
+    (void) element;
+    (void) is_last;
+
+    sink_pad = gst_element_get_static_pad (convert, "sink");
+    if (!gst_pad_is_linked (sink_pad))
+        gst_pad_link (pad, sink_pad);
+    gst_object_unref (sink_pad);
+}
+
+PcmCapture*
+pcm_cache_decode (PcmCache *cache, const char *filename, volatile gint *cancel)
+{
+    PcmCapture *capture  = NULL;
+    GstElement *pipeline = NULL, *source = NULL, *decoder = NULL,
+        *convert = NULL, *sink = NULL;
+    GstBus     *bus      = NULL;
+    GstMessage *msg      = NULL;
+    gboolean    complete = FALSE;
+
+    if (!cache || (capture = pcm_capture_new (cache, filename)) == NULL)
+        return NULL;
+
+    pipeline = gst_pipeline_new (NULL);
+    source = gst_element_factory_make ("filesrc", NULL);
+    decoder = gst_element_factory_make ("decodebin2", NULL);
+    convert = gst_element_factory_make ("audioconvert", NULL);
+    sink = gst_element_factory_make ("fakesink", NULL);
+
+    if (!pipeline || !source || !decoder || !convert || !sink) {
+        N_WARNING (LOG_CAT "failed to create decoder elements.");
+
+        if (pipeline)
+            gst_object_unref (pipeline);
+        if (source)
+            gst_object_unref (source);
+        if (decoder)
+            gst_object_unref (decoder);
+        if (convert)
+            gst_object_unref (convert);
+        if (sink)
+            gst_object_unref (sink);
+
+        pcm_cache_capture_finish (NULL, capture, FALSE);
+        return NULL;
+    }
+
+    gst_bin_add_many (GST_BIN (pipeline), source, decoder, convert, sink, NULL);
+    gst_element_link (source, decoder);
+    gst_element_link (convert, sink);
+
+    /* the converter passes the decoded format through, the appsrc
+       pipeline converts it for the sink when the tone is played. */
+
+    g_object_set (G_OBJECT (source), "location", filename, NULL);
+    g_object_set (G_OBJECT (sink), "sync", FALSE, NULL);
+    g_signal_connect (G_OBJECT (decoder), "new-decoded-pad",
+        G_CALLBACK (pcm_decode_pad_cb), convert);
+
+    capture->pad      = gst_element_get_static_pad (convert, "src");
+    capture->probe_id = gst_pad_add_buffer_probe (capture->pad,
+        G_CALLBACK (pcm_capture_probe_cb), capture);
+
+    gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+    bus = gst_element_get_bus (pipeline);
+    while (!g_atomic_int_get (cancel)) {
+        msg = gst_bus_timed_pop_filtered (bus, 100 * GST_MSECOND,
+            GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+
+        if (!msg)
+            continue;
+
+        complete = GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS;
+        gst_message_unref (msg);
+        break;
+    }
+    gst_object_unref (bus);
+
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+
+    gst_pad_remove_buffer_probe (capture->pad, capture->probe_id);
+    gst_object_unref (capture->pad);
+    capture->pad = NULL;
+
+    gst_object_unref (pipeline);
+
+    /* overflowed captures are still returned so that they are counted as
+       rejected. */
+
+    if (!complete) {
+        pcm_cache_capture_finish (NULL, capture, FALSE);
+        return NULL;
+    }
+
+    return capture;
+}
+
+static void
+pcm_capture_clear (PcmCapture *capture)
+{
+    g_list_foreach (capture->buffers, (GFunc) gst_mini_object_unref, NULL);
+    g_list_free (capture->buffers);
+    capture->buffers = NULL;
+    capture->size    = 0;
+}
+
+static gboolean
+pcm_capture_probe_cb (GstPad *pad, GstBuffer *buffer, gpointer userdata)
+{
+    PcmCapture   *capture = (PcmCapture*) userdata;
+    GstClockTime  end     = GST_CLOCK_TIME_NONE;
+
+    (void) pad;
+
+    /* called in the streaming thread, the capture is not touched from the
+       main thread until the stream is done. */
+
+    if (capture->overflow)
+        return TRUE;
+
+    if (GST_BUFFER_TIMESTAMP_IS_VALID (buffer) && GST_BUFFER_DURATION_IS_VALID (buffer))
+        end = GST_BUFFER_TIMESTAMP (buffer) + GST_BUFFER_DURATION (buffer);
+
+    if (capture->size + GST_BUFFER_SIZE (buffer) > capture->max_size
+        || (GST_CLOCK_TIME_IS_VALID (end) && end > capture->max_duration))
+    {
+        capture->overflow = TRUE;
+        pcm_capture_clear (capture);
+        return TRUE;
+    }
+
+    if (!capture->caps && GST_BUFFER_CAPS (buffer))
+        capture->caps = gst_caps_ref (GST_BUFFER_CAPS (buffer));
+
+    /* the extra reference makes in-place elements downstream work on a
+       copy, the captured data stays as decoded. */
+
+    capture->buffers = g_list_prepend (capture->buffers, gst_buffer_ref (buffer));
+    capture->size   += GST_BUFFER_SIZE (buffer);
+
+    return TRUE;
+}
+
+void
+pcm_cache_capture_finish (PcmCache *cache, PcmCapture *capture, gboolean complete)
+{
+    PcmTone *tone = NULL;
+    GList   *link = NULL;
+
+    if (!capture)
+        return;
+
+    if (capture->pad) {
+        gst_pad_remove_buffer_probe (capture->pad, capture->probe_id);
+        gst_object_unref (capture->pad);
+    }
+
+    /* without a cache the capture is only released. */
+
+    if (cache && capture->overflow) {
+        N_DEBUG (LOG_CAT "'%s' is too large for the pcm cache", capture->filename);
+        cache->stats.rejected++;
+    }
+    else if (cache && complete && capture->buffers && capture->caps
+             && !g_hash_table_lookup (cache->tones, capture->filename))
+    {
+        /* make room for the tone, least recently used first. */
+
+        while (cache->stats.size + capture->size > cache->budget
+               && (link = g_queue_peek_tail_link (&cache->lru)) != NULL)
+        {
+            cache->stats.evicted++;
+            pcm_cache_evict (cache, (PcmTone*) link->data);
+        }
+
+        tone = g_slice_new0 (PcmTone);
+        tone->refcount      = 1;
+        tone->filename      = capture->filename;
+        tone->caps          = capture->caps;
+        tone->buffers       = g_list_reverse (capture->buffers);
+        tone->size          = capture->size;
+        tone->file_mtime    = capture->file_mtime;
+        tone->file_size     = capture->file_size;
+        tone->lru_link.data = tone;
+
+        capture->filename = NULL;
+        capture->caps     = NULL;
+        capture->buffers  = NULL;
+
+        g_hash_table_insert (cache->tones, tone->filename, tone);
+        g_queue_push_head_link (&cache->lru, &tone->lru_link);
+
+        cache->stats.stored++;
+        cache->stats.entries++;
+        cache->stats.size += tone->size;
+
+        N_DEBUG (LOG_CAT "stored '%s' in the pcm cache (%" G_GSIZE_FORMAT
+                         " bytes, %" G_GSIZE_FORMAT " bytes in use)",
+            tone->filename, tone->size, cache->stats.size);
+    }
+
+    pcm_capture_clear (capture);
+
+    if (capture->caps)
+        gst_caps_unref (capture->caps);
+
+    g_free (capture->filename);
+    g_slice_free (PcmCapture, capture);
+}
+
+PcmTone*
+pcm_tone_ref (PcmTone *tone)
+{
+    if (tone)
+        g_atomic_int_inc (&tone->refcount);
+
+    return tone;
+}
+
+void
+pcm_tone_unref (PcmTone *tone)
+{
+    if (!tone || !g_atomic_int_dec_and_test (&tone->refcount))
+        return;
+
+    g_list_foreach (tone->buffers, (GFunc) gst_mini_object_unref, NULL);
+    g_list_free (tone->buffers);
+    gst_caps_unref (tone->caps);
+    g_free (tone->filename);
+    g_slice_free (PcmTone, tone);
+}
+
+GstCaps*
+pcm_tone_get_caps (PcmTone *tone)
+{
+    return tone ? tone->caps : NULL;
+}
+
+void
+pcm_tone_feed (PcmTone *tone, GstElement *appsrc)
+{
+    GList *iter = NULL;
+
+    if (!tone || !appsrc)
+        return;
+
+    for (iter = g_list_first (tone->buffers); iter; iter = g_list_next (iter))
+        gst_app_src_push_buffer (GST_APP_SRC (appsrc), gst_buffer_ref ((GstBuffer*) iter->data));
+
+    gst_app_src_end_of_stream (GST_APP_SRC (appsrc));
+}
@@ -0,0 +1,79 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifndef PCM_CACHE_H
+#define PCM_CACHE_H
+
+#include <glib.h>
+#include <gst/gst.h>
+
+/* decoded PCM of short tones, kept in memory so that playing them again
+   skips the file and the decoder. the buffers are shared read-only with
+   every pipeline playing the tone. */
+
+typedef struct _PcmCache   PcmCache;
+typedef struct _PcmTone    PcmTone;
+typedef struct _PcmCapture PcmCapture;
+
+typedef struct _PcmCacheStats
+{
+    guint  hits;
+    guint  misses;
+    guint  stored;
+    guint  evicted;
+    guint  rejected;        /* captures over the size or duration limit */
+    guint  entries;
+    gsize  size;            /* bytes of PCM held */
+} PcmCacheStats;
+
+PcmCache*   pcm_cache_new            (gsize budget, gsize max_file_size, guint max_duration_ms);
+void        pcm_cache_free           (PcmCache *cache);
+void        pcm_cache_get_stats      (PcmCache *cache, PcmCacheStats *stats);
+void        pcm_cache_log_stats      (PcmCache *cache);
+
+/* returns a reference to the cached tone, or NULL on a miss. a tone
+   whose file has changed since it was decoded is dropped. */
+PcmTone*    pcm_cache_lookup         (PcmCache *cache, const char *filename);
+
+/* starts collecting the decoded buffers flowing through pad. returns NULL
+   if the file is not eligible for caching. */
+PcmCapture* pcm_cache_capture_start  (PcmCache *cache, const char *filename, GstPad *pad);
+
+/* decodes the file with a pipeline of its own and returns the capture to
+   be finished in the main thread, or NULL if the file is not eligible or
+   the decoding failed. blocks until done or until cancel is set, can be
+   called from any thread. */
+PcmCapture* pcm_cache_decode         (PcmCache *cache, const char *filename, volatile gint *cancel);
+
+/* complete is TRUE if the whole file went through the pad. the pad must
+   not be streaming any more when this is called. a NULL cache only
+   releases the capture. */
+void        pcm_cache_capture_finish (PcmCache *cache, PcmCapture *capture, gboolean complete);
+
+PcmTone*    pcm_tone_ref             (PcmTone *tone);
+void        pcm_tone_unref           (PcmTone *tone);
+GstCaps*    pcm_tone_get_caps        (PcmTone *tone);
+
+/* pushes the tone and end of stream to an appsrc. */
+void        pcm_tone_feed            (PcmTone *tone, GstElement *appsrc);
+
+#endif /* PCM_CACHE_H */
@@ -26,8 +26,13 @@
 #include <gst/gst.h>
 #include <gst/controller/gstcontroller.h>
 #include <gst/controller/gstinterpolationcontrolsource.h>
+#include <gst/app/gstappsrc.h>
 #include <gio/gio.h>
 
+#include "pcm-cache.h"
+#include "prefetch.h"
+#include "audio-format.h"
+
 #define GST_KEY               "plugin.gst.data"
 #define LOG_CAT               "gst: "
 #define MAX_TIMEOUT_KEY       "core.max_timeout"
@@ -41,6 +46,24 @@
 #define FADE_OUT_KEY          "sound.fade-out"
 #define FADE_IN_KEY           "sound.fade-in"
 #define SYSTEM_SOUND_PATH     "/usr/share/sounds/"
+#define POOL_SIZE_KEY         "pipeline_pool_size"
+#define DEFAULT_POOL_SIZE     2
+#define PCM_CACHE_SIZE_KEY    "pcm_cache_size"
+#define PCM_MAX_FILE_SIZE_KEY "pcm_cache_max_file_size"
+#define PCM_MAX_DURATION_KEY  "pcm_cache_max_duration"
+#define DEFAULT_PCM_CACHE_SIZE    (1024 * 1024)
+#define DEFAULT_PCM_MAX_FILE_SIZE (64 * 1024)
+#define DEFAULT_PCM_MAX_DURATION  2000
+#define PREFETCH_KEY          "prefetch_sounds"
+#define PROFILE_KEY_PATTERN   ".profile"
+#define FAST_PATH_KEY         "format_fast_path"
+#define FORMAT_CACHE_ENTRIES  128
+
+/* pipelines are pooled by kind. the audio formats are the kinds of the
+   file pipelines, where AUDIO_FORMAT_UNKNOWN is autoplugged, and the
+   tones from the pcm cache come last. */
+#define PIPELINE_CACHED       AUDIO_FORMAT_LAST
+#define PIPELINE_KINDS        (AUDIO_FORMAT_LAST + 1)
 
 typedef struct _FadeEffect
 {
@@ -75,6 +98,14 @@ typedef struct _StreamData
     gboolean paused;
     guint bus_watch_id;
     gboolean sound_enabled;
+    gboolean pipeline_failed;
+    guint kind;
+    gboolean prerolled;
+    gboolean autoplug;
+    PcmTone *tone;
+    gboolean tone_fed;
+    gboolean looping;
+    PcmCapture *capture;
 
     FadeEffect *fade_out;
     FadeEffect *fade_in;
@@ -83,6 +114,7 @@ typedef struct _StreamData
 N_PLUGIN_NAME        ("gst")
 N_PLUGIN_VERSION     ("0.1")
 N_PLUGIN_DESCRIPTION ("GStreamer plugin")
+N_PLUGIN_STARTUP_DEPENDS ("")
 
 static gboolean is_custom_sound_filename (const char *filename);
 static gchar* strip_prefix (const gchar *str, const gchar *prefix);
@@ -95,19 +127,76 @@ static int set_structure_string (GstStructure *s, const char *key, const char *v
 static void proplist_to_structure_cb (const char *key, const NValue *value, gpointer userdata);
 static GstStructure* create_stream_properties (NProplist *props);
 static gboolean restart_stream_cb (gpointer userdata);
+static gboolean autoplug_stream_cb (gpointer userdata);
+static gboolean seek_loop (StreamData *stream, gboolean flush);
 static gboolean bus_cb (GstBus *bus, GstMessage *msg, gpointer userdata);
 static void new_decoded_pad_cb (GstElement *element, GstPad *pad, gboolean is_last, gpointer userdata);
+static void need_data_cb (GstAppSrc *src, guint length, gpointer userdata);
+static gboolean seek_data_cb (GstAppSrc *src, guint64 offset, gpointer userdata);
+static GstElement* create_pipeline (guint kind);
+static GstElement* acquire_pipeline (guint kind);
+static void release_pipeline (GstElement *pipeline, guint kind, gboolean reuse);
+static gboolean evict_pipeline (guint kind);
+static gboolean fill_pipeline_pool_cb (gpointer userdata);
+static void free_pipeline_pool ();
+static guint select_pipeline_kind (StreamData *stream);
 static int make_pipeline (StreamData *stream);
 static void free_pipeline (StreamData *stream);
 static int convert_number (const char *str, gint *result);
-static FadeEffect* parse_volume_fade (const char *str);
+static FadeEffect* parse_volume_fade (NRequest *request, const char *str);
 static void set_fade_effect (GstInterpolationControlSource *source, FadeEffect *effect);
 static void update_fade_effect (FadeEffect *effect, gdouble elapsed, gdouble volume);
-static void free_fade_effect (FadeEffect *effect);
+static gsize get_size_param (const NProplist *params, const char *key, gsize default_value);
+static void add_sound_file (GHashTable *seen, GList **files, const char *filename);
+static void collect_profile_tone_cb (const char *key, const NValue *value, gpointer userdata);
+static GList* collect_sound_files (NCore *core, NContext *context);
 
 static gboolean system_sounds_enabled = TRUE;
 static guint system_sounds_level = 0;
 
+/* idle pipelines ready to be reused, one pool per kind and at most
+   pipeline_pool_size of them in all. the pipelines are kept in READY
+   so that the sink holds on to the pulseaudio connection, or in NULL
+   if the connection could not be opened. pipeline_pool_order holds the
+   kind + 1 of every idle pipeline, least recently released first. */
+static GQueue pipeline_pool[PIPELINE_KINDS];
+static GQueue pipeline_pool_order = G_QUEUE_INIT;
+static guint pipeline_pool_size = DEFAULT_POOL_SIZE;
+static guint pipeline_pool_fill_id = 0;
+static guint pipeline_pool_fill_kind = AUDIO_FORMAT_UNKNOWN;
+static gboolean pipeline_pool_filled = FALSE;
+
+/* files in a known format skip decodebin2 and play through a fixed
+   chain, if the elements of the chain are installed. */
+static gboolean fast_path_enabled = TRUE;
+static gboolean format_available[AUDIO_FORMAT_LAST];
+static FormatCache *format_cache = NULL;
+
+/* decoded short tones, played through appsrc pipelines */
+static PcmCache *pcm_cache = NULL;
+
+/* warm up of the event sounds after init */
+static NCore *gst_core = NULL;
+static gboolean prefetch_enabled = TRUE;
+static Prefetch *prefetch = NULL;
+
+typedef struct _CollectData
+{
+    NContext   *context;
+    GHashTable *seen;
+    GList      *files;
+} CollectData;
+
+/* interned keys, looked up for every request */
+static NAtom sound_filename_atom   = N_ATOM_NONE;
+static NAtom sound_repeat_atom     = N_ATOM_NONE;
+static NAtom sound_volume_atom     = N_ATOM_NONE;
+static NAtom sound_enabled_atom    = N_ATOM_NONE;
+static NAtom fade_only_custom_atom = N_ATOM_NONE;
+static NAtom fade_out_atom         = N_ATOM_NONE;
+static NAtom fade_in_atom          = N_ATOM_NONE;
+static NAtom max_timeout_atom      = N_ATOM_NONE;
+
 static gboolean
 is_custom_sound_filename (const char *filename)
 {
@@ -262,7 +351,7 @@ create_stream_properties (NProplist *props)
     /* set the stream filename based on the sound file we're
        about to play. */
 
-    source = n_proplist_get_string (props, SOUND_FILENAME_KEY);
+    source = n_proplist_get_string_atom (props, sound_filename_atom);
     g_assert (source != NULL);
 
     set_structure_string (s, "media.filename", source);
@@ -392,6 +481,46 @@ restart_stream_cb (gpointer userdata)
     return FALSE;
 }
 
+static gboolean
+autoplug_stream_cb (gpointer userdata)
+{
+    StreamData *stream = (StreamData*) userdata;
+
+    stream->restart_source_id = 0;
+
+    free_pipeline (stream);
+
+    N_DEBUG (LOG_CAT "re-creating pipeline with decodebin2.");
+    if (!make_pipeline (stream)) {
+        n_sink_interface_fail (stream->iface, stream->request);
+        return FALSE;
+    }
+
+    /* the first stream is not synchronized yet, a restarted one has been
+       playing already. */
+
+    gst_element_set_state (stream->pipeline,
+        stream->first_play ? GST_STATE_PAUSED : GST_STATE_PLAYING);
+
+    return FALSE;
+}
+
+static gboolean
+seek_loop (StreamData *stream, gboolean flush)
+{
+    GstSeekFlags flags = GST_SEEK_FLAG_SEGMENT;
+
+    /* a segment seek posts SEGMENT_DONE instead of EOS at the end. the
+       next round is queued from there without flushing, so the sink plays
+       the rounds back to back. */
+
+    if (flush)
+        flags = (GstSeekFlags) (flags | GST_SEEK_FLAG_FLUSH);
+
+    return gst_element_seek (stream->pipeline, 1.0, GST_FORMAT_TIME, flags,
+        GST_SEEK_TYPE_SET, 0, GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE);
+}
+
 static gboolean
 bus_cb (GstBus *bus, GstMessage *msg, gpointer userdata)
 {
@@ -405,6 +534,20 @@ bus_cb (GstBus *bus, GstMessage *msg, gpointer userdata)
             gst_message_parse_error (msg, &error, NULL);
             N_WARNING (LOG_CAT "error: %s", error->message);
             g_error_free (error);
+            stream->pipeline_failed = TRUE;
+
+            /* the sniffed format did not suit the fixed chain after all,
+               the file gets autoplugged from now on. */
+            if (!stream->prerolled && stream->kind != AUDIO_FORMAT_UNKNOWN
+                && stream->kind != PIPELINE_CACHED)
+            {
+                format_cache_mark_failed (format_cache, stream->filename);
+                stream->autoplug = TRUE;
+                stream->bus_watch_id = 0;
+                stream->restart_source_id = g_idle_add (autoplug_stream_cb, stream);
+                return FALSE;
+            }
+
             n_sink_interface_fail (stream->iface, stream->request);
             return FALSE;
         }
@@ -417,6 +560,16 @@ bus_cb (GstBus *bus, GstMessage *msg, gpointer userdata)
             gst_message_parse_state_changed (msg, &old_state, &new_state, &pending_state);
 
             if (old_state == GST_STATE_READY && new_state == GST_STATE_PAUSED) {
+                stream->prerolled = TRUE;
+
+                /* repeating streams loop inside the pipeline. if the
+                   stream can not seek, it is restarted at the end. */
+                if (stream->repeat_enabled && !stream->looping) {
+                    stream->looping = seek_loop (stream, TRUE);
+                    if (!stream->looping)
+                        N_DEBUG (LOG_CAT "segment seek failed, restarting on eos");
+                }
+
                 N_DEBUG (LOG_CAT "synchronize");
                 n_sink_interface_synchronize (stream->iface, stream->request);
             }
@@ -424,10 +577,36 @@ bus_cb (GstBus *bus, GstMessage *msg, gpointer userdata)
             break;
         }
 
+        case GST_MESSAGE_SEGMENT_DONE: {
+            if (GST_ELEMENT (GST_MESSAGE_SRC (msg)) != stream->pipeline)
+                break;
+
+            /* the fades run on the running time, which keeps increasing
+               over the rounds, nothing needs to be reset here. */
+
+            if (!seek_loop (stream, FALSE)) {
+                N_WARNING (LOG_CAT "unable to loop, restarting the stream");
+                stream->looping = FALSE;
+                n_sink_interface_resynchronize (stream->iface, stream->request);
+                stream->restart_source_id = g_idle_add (restart_stream_cb, stream);
+                return FALSE;
+            }
+
+            N_DEBUG (LOG_CAT "looping pipeline.");
+            n_sink_interface_resynchronize (stream->iface, stream->request);
+            break;
+        }
+
         case GST_MESSAGE_EOS: {
             if (GST_ELEMENT (GST_MESSAGE_SRC (msg)) != stream->pipeline)
                 break;
 
+            /* the whole file has been decoded, keep it for the next time. */
+            if (stream->capture) {
+                pcm_cache_capture_finish (pcm_cache, stream->capture, TRUE);
+                stream->capture = NULL;
+            }
+
             if (stream->repeat_enabled) {
                 N_DEBUG (LOG_CAT "rewinding pipeline.");
                 n_sink_interface_resynchronize (stream->iface, stream->request);
@@ -476,62 +655,118 @@ new_decoded_pad_cb (GstElement *element, GstPad *pad, gboolean is_last,
     gst_caps_unref (caps);
 }
 
-static int
-make_pipeline (StreamData *stream)
+static gboolean
+seek_data_cb (GstAppSrc *src, guint64 offset, gpointer userdata)
+{
+    StreamData *stream = (StreamData*) userdata;
+
+    (void) src;
+
+    /* only the loop seeks back to the beginning. the stream lock of the
+       source keeps this from running along with need-data. */
+
+    if (offset != 0)
+        return FALSE;
+
+    stream->tone_fed = FALSE;
+    return TRUE;
+}
+
+static void
+need_data_cb (GstAppSrc *src, guint length, gpointer userdata)
+{
+    StreamData *stream = (StreamData*) userdata;
+
+    (void) length;
+
+    /* the whole tone is queued at once, followed by end of stream. */
+
+    if (!stream->tone_fed) {
+        stream->tone_fed = TRUE;
+        pcm_tone_feed (stream->tone, GST_ELEMENT (src));
+    }
+}
+
+static GstElement*
+create_pipeline (guint kind)
 {
     GstElement *pipeline = NULL, *source = NULL, *decoder = NULL,
-        *audioconv = NULL, *volume = NULL, *sink = NULL;
-    GstBus *bus = NULL;
+        *audioconv = NULL, *loop = NULL, *volume = NULL, *sink = NULL;
+    gboolean cached = (kind == PIPELINE_CACHED);
+    gboolean autoplug = (kind == AUDIO_FORMAT_UNKNOWN);
 
     pipeline = gst_pipeline_new (NULL);
-    source = gst_element_factory_make ("filesrc", NULL);
-    decoder = gst_element_factory_make ("decodebin2", NULL);
-    audioconv = gst_element_factory_make ("audioconvert", NULL);
-    volume = gst_element_factory_make ("volume", NULL);
-    sink = gst_element_factory_make ("pulsesink", NULL);
-
-    if (!pipeline || !source || !decoder || !audioconv || !volume || !sink) {
+    source = gst_element_factory_make (cached ? "appsrc" : "filesrc", "source");
+    decoder = autoplug ? gst_element_factory_make ("decodebin2", NULL) : NULL;
+    audioconv = gst_element_factory_make ("audioconvert", "convert");
+    loop = gst_element_factory_make ("identity", NULL);
+    volume = gst_element_factory_make ("volume", "volume");
+    sink = gst_element_factory_make ("pulsesink", "sink");
+
+    if (!pipeline || !source || (autoplug && !decoder) || !audioconv || !loop || !volume || !sink) {
         N_WARNING (LOG_CAT "failed to create required elements.");
         goto failed;
     }
 
-    gst_bin_add_many (GST_BIN (pipeline), source, decoder, audioconv, volume, sink, NULL);
-    
-    if (!gst_element_link (source, decoder)) {
-        N_WARNING (LOG_CAT "failed to link source to decoder");
-        goto failed_pipeline;
-    }
+    /* looping restarts the timestamps from zero on every round. the
+       identity turns the rounds into a single segment so that the volume
+       controller sees the time keep running and the fades carry over. */
+
+    g_object_set (G_OBJECT (loop), "single-segment", TRUE, NULL);
 
-    if (!gst_element_link_many (audioconv, volume, sink, NULL)) {
+    gst_bin_add_many (GST_BIN (pipeline), source, audioconv, loop, volume, sink, NULL);
+    if (decoder)
+        gst_bin_add (GST_BIN (pipeline), decoder);
+
+    if (!gst_element_link_many (audioconv, loop, volume, sink, NULL)) {
         N_WARNING (LOG_CAT "failed to link converter, volume or sink");
         goto failed_pipeline;
     }
 
-    g_signal_connect (G_OBJECT (decoder), "new-decoded-pad",
-        G_CALLBACK (new_decoded_pad_cb), audioconv);
+    if (cached) {
+        /* cached tones are already decoded, appsrc feeds the converter. */
 
-    g_object_set (G_OBJECT (source), "location", stream->filename, NULL);
+        g_object_set (G_OBJECT (source), "format", GST_FORMAT_TIME, NULL);
+        gst_app_src_set_stream_type (GST_APP_SRC (source), GST_APP_STREAM_TYPE_SEEKABLE);
 
-    bus = gst_element_get_bus (pipeline);
-    stream->bus_watch_id = gst_bus_add_watch (bus, bus_cb, stream);
-    gst_object_unref (bus);
+        if (!gst_element_link (source, audioconv)) {
+            N_WARNING (LOG_CAT "failed to link source to converter");
+            goto failed_pipeline;
+        }
 
-    set_stream_properties (sink, stream->properties);
+        return pipeline;
+    }
 
-    stream->pipeline = pipeline;
-    stream->volume = volume;
+    if (!autoplug) {
+        /* the format is known, the parser and decoder for it are linked
+           in directly without typefinding. */
 
-    (void) create_volume (stream);
+        if (!audio_format_build_chain ((AudioFormat) kind, GST_BIN (pipeline), source, audioconv))
+            goto failed_pipeline;
 
-    return TRUE;
+        return pipeline;
+    }
 
-failed:
-    free_volume (stream);
+    if (!gst_element_link (source, decoder)) {
+        N_WARNING (LOG_CAT "failed to link source to decoder");
+        goto failed_pipeline;
+    }
+
+    /* decodebin2 drops its pads when going back to READY, the handler
+       links the new ones whenever the pipeline is reused. */
+
+    g_signal_connect (G_OBJECT (decoder), "new-decoded-pad",
+        G_CALLBACK (new_decoded_pad_cb), audioconv);
+
+    return pipeline;
 
+failed:
     if (sink)
         gst_object_unref (sink);
     if (volume)
         gst_object_unref (volume);
+    if (loop)
+        gst_object_unref (loop);
     if (audioconv)
         gst_object_unref (audioconv);
     if (decoder)
@@ -543,25 +778,297 @@ failed_pipeline:
     if (pipeline)
         gst_object_unref (pipeline);
 
-    return FALSE;
+    return NULL;
+}
+
+static GstElement*
+acquire_pipeline (guint kind)
+{
+    GQueue     *pool     = &pipeline_pool[kind];
+    GstElement *pipeline = NULL;
+
+    if ((pipeline = g_queue_pop_head (pool)) != NULL) {
+        g_queue_remove (&pipeline_pool_order, GUINT_TO_POINTER (kind + 1));
+        N_DEBUG (LOG_CAT "reusing pooled pipeline (%u left)",
+            g_queue_get_length (pool));
+        return pipeline;
+    }
+
+    N_DEBUG (LOG_CAT "pipeline pool empty, creating a new pipeline");
+    return create_pipeline (kind);
 }
 
 static void
-free_pipeline (StreamData *stream)
+release_pipeline (GstElement *pipeline, guint kind, gboolean reuse)
 {
-    if (stream->pipeline) {
+    static GstAppSrcCallbacks no_callbacks;
+
+    GQueue     *pool   = &pipeline_pool[kind];
+    GstElement *source = NULL;
+    GstElement *volume = NULL;
+    GstBus     *bus    = NULL;
+
+    /* every idle pipeline holds a pulse connection, the limit is for
+       all the kinds together. a full pool makes room by dropping the
+       oldest idle pipeline of another kind. */
+
+    if (reuse && pipeline_pool_size > 0 &&
+        g_queue_get_length (&pipeline_pool_order) >= pipeline_pool_size)
+        reuse = evict_pipeline (kind);
+
+    if (!reuse) {
         N_DEBUG (LOG_CAT "freeing pipeline");
-        gst_element_set_state (stream->pipeline, GST_STATE_NULL);
-        gst_object_unref (stream->pipeline);
-        stream->pipeline = NULL;
+        gst_element_set_state (pipeline, GST_STATE_NULL);
+        gst_object_unref (pipeline);
+        return;
     }
 
+    /* READY closes the file and the pulse stream but keeps the context
+       connected. */
+
+    if (gst_element_set_state (pipeline, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE)
+        gst_element_set_state (pipeline, GST_STATE_NULL);
+
+    /* drop the messages posted by the previous stream, the bus watch of
+       the next one must not see them. */
+
+    bus = gst_element_get_bus (pipeline);
+    gst_bus_set_flushing (bus, TRUE);
+    gst_bus_set_flushing (bus, FALSE);
+    gst_object_unref (bus);
+
+    /* the appsrc callbacks point to the previous stream. */
+
+    if (kind == PIPELINE_CACHED && (source = gst_bin_get_by_name (GST_BIN (pipeline), "source")) != NULL) {
+        gst_app_src_set_callbacks (GST_APP_SRC (source), &no_callbacks, NULL, NULL);
+        gst_object_unref (source);
+    }
+
+    /* the fade controller is gone, reset the level it left behind. */
+
+    if ((volume = gst_bin_get_by_name (GST_BIN (pipeline), "volume")) != NULL) {
+        g_object_set (G_OBJECT (volume), "volume", 1.0, NULL);
+        gst_object_unref (volume);
+    }
+
+    N_DEBUG (LOG_CAT "returning pipeline to the pool");
+    g_queue_push_tail (pool, pipeline);
+    g_queue_push_tail (&pipeline_pool_order, GUINT_TO_POINTER (kind + 1));
+}
+
+static gboolean
+evict_pipeline (guint kind)
+{
+    GstElement *pipeline = NULL;
+    GList      *iter     = NULL;
+    guint       victim;
+
+    for (iter = pipeline_pool_order.head; iter; iter = g_list_next (iter)) {
+        if (GPOINTER_TO_UINT (iter->data) != kind + 1)
+            break;
+    }
+
+    /* everything idle is of the same kind already. */
+
+    if (!iter)
+        return FALSE;
+
+    victim = GPOINTER_TO_UINT (iter->data) - 1;
+    g_queue_delete_link (&pipeline_pool_order, iter);
+
+    N_DEBUG (LOG_CAT "evicting an idle %s pipeline",
+        victim == PIPELINE_CACHED ? "cached" : audio_format_get_name (victim));
+
+    pipeline = g_queue_pop_head (&pipeline_pool[victim]);
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (pipeline);
+
+    return TRUE;
+}
+
+static gboolean
+fill_pipeline_pool_cb (gpointer userdata)
+{
+    GQueue     *pool     = NULL;
+    GstElement *pipeline = NULL;
+
+    (void) userdata;
+
+    pipeline_pool_fill_id = 0;
+
+    pool = &pipeline_pool[pipeline_pool_fill_kind];
+
+    while (g_queue_get_length (&pipeline_pool_order) < pipeline_pool_size) {
+        if ((pipeline = create_pipeline (pipeline_pool_fill_kind)) == NULL)
+            break;
+
+        release_pipeline (pipeline, pipeline_pool_fill_kind, TRUE);
+    }
+
+    N_DEBUG (LOG_CAT "pipeline pool filled with %u %s pipelines",
+        g_queue_get_length (pool), audio_format_get_name (pipeline_pool_fill_kind));
+
+    return FALSE;
+}
+
+static void
+free_pipeline_pool ()
+{
+    GstElement *pipeline = NULL;
+    guint       kind;
+
+    if (pipeline_pool_fill_id > 0) {
+        g_source_remove (pipeline_pool_fill_id);
+        pipeline_pool_fill_id = 0;
+    }
+
+    for (kind = 0; kind < PIPELINE_KINDS; ++kind) {
+        while ((pipeline = g_queue_pop_head (&pipeline_pool[kind])) != NULL) {
+            gst_element_set_state (pipeline, GST_STATE_NULL);
+            gst_object_unref (pipeline);
+        }
+    }
+
+    g_queue_clear (&pipeline_pool_order);
+    pipeline_pool_filled = FALSE;
+}
+
+static guint
+select_pipeline_kind (StreamData *stream)
+{
+    AudioFormat format;
+
+    if (stream->tone)
+        return PIPELINE_CACHED;
+
+    if (!fast_path_enabled || stream->autoplug)
+        return AUDIO_FORMAT_UNKNOWN;
+
+    /* the format is sniffed once per file and kept until the file
+       changes. */
+
+    format = format_cache_lookup (format_cache, stream->filename);
+    return format_available[format] ? (guint) format : AUDIO_FORMAT_UNKNOWN;
+}
+
+static int
+make_pipeline (StreamData *stream)
+{
+    static GstAppSrcCallbacks callbacks = {
+        .need_data = need_data_cb,
+        .seek_data = seek_data_cb
+    };
+
+    GstElement *pipeline = NULL, *source = NULL, *convert = NULL,
+        *volume = NULL, *sink = NULL;
+    GstPad *pad = NULL;
+    GstBus *bus = NULL;
+
+    stream->kind = select_pipeline_kind (stream);
+    pipeline = acquire_pipeline (stream->kind);
+
+    /* the idle pipelines are built after the first play, for the kind
+       it needed. the format is known by then and nothing is sniffed
+       while the daemon starts. */
+
+    if (pipeline && !pipeline_pool_filled && pipeline_pool_size > 0) {
+        pipeline_pool_filled = TRUE;
+        pipeline_pool_fill_kind = stream->kind;
+        pipeline_pool_fill_id = g_idle_add (fill_pipeline_pool_cb, NULL);
+    }
+
+    if (!pipeline && stream->kind != AUDIO_FORMAT_UNKNOWN && stream->kind != PIPELINE_CACHED) {
+        /* the chain does not build, it will not build the next time
+           either. */
+        N_WARNING (LOG_CAT "disabling the %s chain", audio_format_get_name (stream->kind));
+        format_available[stream->kind] = FALSE;
+        stream->kind = AUDIO_FORMAT_UNKNOWN;
+        pipeline = acquire_pipeline (stream->kind);
+    }
+
+    if (!pipeline)
+        return FALSE;
+
+    /* only the input and the stream properties change between streams,
+       both can be set while the pipeline is in READY or NULL. */
+
+    source = gst_bin_get_by_name (GST_BIN (pipeline), "source");
+    convert = gst_bin_get_by_name (GST_BIN (pipeline), "convert");
+    volume = gst_bin_get_by_name (GST_BIN (pipeline), "volume");
+    sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+    if (stream->tone) {
+        stream->tone_fed = FALSE;
+        gst_app_src_set_caps (GST_APP_SRC (source), pcm_tone_get_caps (stream->tone));
+        gst_app_src_set_callbacks (GST_APP_SRC (source), &callbacks, stream, NULL);
+    }
+    else {
+        g_object_set (G_OBJECT (source), "location", stream->filename, NULL);
+
+        /* collect the decoded output the first time the file is played,
+           the cache decides if it is short enough to keep. looping
+           streams flush and start over, they are not captured. */
+
+        if (stream->first_play && !stream->repeat_enabled) {
+            pad = gst_element_get_static_pad (convert, "src");
+            stream->capture = pcm_cache_capture_start (pcm_cache, stream->filename, pad);
+            gst_object_unref (pad);
+        }
+    }
+
+    set_stream_properties (sink, stream->properties);
+
+    bus = gst_element_get_bus (pipeline);
+    stream->bus_watch_id = gst_bus_add_watch (bus, bus_cb, stream);
+    gst_object_unref (bus);
+
+    /* the pipeline holds the elements, the references are not needed. */
+
+    stream->pipeline = pipeline;
+    stream->volume = volume;
+    stream->pipeline_failed = FALSE;
+    stream->prerolled = FALSE;
+    stream->looping = FALSE;
+
+    gst_object_unref (source);
+    gst_object_unref (convert);
+    gst_object_unref (volume);
+    gst_object_unref (sink);
+
+    (void) create_volume (stream);
+
+    return TRUE;
+}
+
+static void
+free_pipeline (StreamData *stream)
+{
     if (stream->bus_watch_id > 0) {
         g_source_remove (stream->bus_watch_id);
         stream->bus_watch_id = 0;
     }
 
     free_volume (stream);
+
+    if (!stream->pipeline)
+        return;
+
+    /* stop streaming before the capture probe and the appsrc callbacks
+       lose the stream. */
+
+    if (gst_element_set_state (stream->pipeline, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE)
+        gst_element_set_state (stream->pipeline, GST_STATE_NULL);
+
+    if (stream->capture) {
+        pcm_cache_capture_finish (pcm_cache, stream->capture, FALSE);
+        stream->capture = NULL;
+    }
+
+    /* a pipeline that ran into an error is not trusted to be reused. */
+
+    release_pipeline (stream->pipeline, stream->kind, !stream->pipeline_failed);
+    stream->pipeline = NULL;
+    stream->volume = NULL;
 }
 
 static void
@@ -592,6 +1099,83 @@ system_sound_level_changed (NContext *context,
     }
 }
 
+static void
+add_sound_file (GHashTable *seen, GList **files, const char *filename)
+{
+    gchar *copy = NULL;
+
+    if (!filename || !g_path_is_absolute (filename))
+        return;
+
+    if (g_hash_table_lookup (seen, filename))
+        return;
+
+    copy = g_strdup (filename);
+    g_hash_table_insert (seen, copy, copy);
+    *files = g_list_prepend (*files, copy);
+}
+
+static void
+collect_profile_tone_cb (const char *key, const NValue *value, gpointer userdata)
+{
+    CollectData  *data        = (CollectData*) userdata;
+    const char   *str         = NULL;
+    gchar       **mapping     = NULL;
+    gchar       **profile_key = NULL;
+    gchar        *context_key = NULL;
+    const NValue *tone        = NULL;
+
+    /* profile mappings look like "sms.alert.tone@general => sound.filename",
+       the tone itself is in the context. */
+
+    if (g_strstr_len (key, 32, PROFILE_KEY_PATTERN) == NULL)
+        return;
+
+    if ((str = n_value_get_string ((NValue*) value)) == NULL)
+        return;
+
+    mapping = g_strsplit (str, "=>", 2);
+    if (mapping[0] && mapping[1]
+        && g_str_equal (g_strstrip (mapping[1]), SOUND_FILENAME_KEY))
+    {
+        profile_key = g_strsplit (g_strstrip (mapping[0]), "@", 2);
+        context_key = g_strdup_printf ("profile.%s.%s",
+            profile_key[1] ? profile_key[1] : "current", profile_key[0]);
+
+        tone = n_context_get_value (data->context, context_key);
+        if (tone && n_value_type (tone) == N_VALUE_TYPE_STRING)
+            add_sound_file (data->seen, &data->files, n_value_get_string ((NValue*) tone));
+
+        g_free (context_key);
+        g_strfreev (profile_key);
+    }
+
+    g_strfreev (mapping);
+}
+
+static GList*
+collect_sound_files (NCore *core, NContext *context)
+{
+    CollectData      data;
+    const NProplist *props = NULL;
+    GList           *iter  = NULL;
+
+    data.context = context;
+    data.seen    = g_hash_table_new (g_str_hash, g_str_equal);
+    data.files   = NULL;
+
+    for (iter = g_list_first (n_core_get_events (core)); iter; iter = g_list_next (iter)) {
+        props = n_event_get_properties ((NEvent*) iter->data);
+        add_sound_file (data.seen, &data.files,
+            n_proplist_get_string_atom (props, sound_filename_atom));
+        n_proplist_foreach ((NProplist*) props, collect_profile_tone_cb, &data);
+    }
+
+    g_hash_table_destroy (data.seen);
+
+    return g_list_reverse (data.files);
+}
+
 static void
 init_done_cb (NHook *hook, void *data, void *userdata)
 {
@@ -600,6 +1184,19 @@ init_done_cb (NHook *hook, void *data, void *userdata)
 
     NContext *context = (NContext*) userdata;
     NValue *v = NULL;
+    GList *files = NULL;
+
+    files = collect_sound_files (gst_core, context);
+
+    /* read and decode the sounds the events refer to before the first
+       event needs them. */
+    if (prefetch_enabled && !prefetch) {
+        prefetch = prefetch_start (pcm_cache, files);
+        files = NULL;
+    }
+
+    g_list_foreach (files, (GFunc) g_free, NULL);
+    g_list_free (files);
 
     /* query the initial system sound level value */
     v = (NValue*) n_context_get_value (context, "profile.current.system.sound.level");
@@ -620,11 +1217,24 @@ gst_sink_initialize (NSinkInterface *iface)
 {
     (void) iface;
 
+    guint format;
+
     N_DEBUG (LOG_CAT "initializing GStreamer");
 
     gst_init_check (NULL, NULL, NULL);
     gst_controller_init (NULL, NULL);
 
+    /* look the chains up in the registry once, not for every stream. */
+
+    for (format = AUDIO_FORMAT_UNKNOWN + 1; format < AUDIO_FORMAT_LAST; ++format) {
+        format_available[format] = fast_path_enabled
+            && audio_format_is_available ((AudioFormat) format);
+
+        if (format_available[format])
+            N_DEBUG (LOG_CAT "playing %s files through a fixed chain",
+                audio_format_get_name ((AudioFormat) format));
+    }
+
     return TRUE;
 }
 
@@ -632,6 +1242,19 @@ static void
 gst_sink_shutdown (NSinkInterface *iface)
 {
     (void) iface;
+
+    free_pipeline_pool ();
+
+    prefetch_stop (prefetch);
+    prefetch = NULL;
+
+    pcm_cache_log_stats (pcm_cache);
+    pcm_cache_free (pcm_cache);
+    pcm_cache = NULL;
+
+    format_cache_log_stats (format_cache);
+    format_cache_free (format_cache);
+    format_cache = NULL;
 }
 
 static int
@@ -642,7 +1265,7 @@ gst_sink_can_handle (NSinkInterface *iface, NRequest *request)
     NProplist *props = NULL;
 
     props = (NProplist*) n_request_get_properties (request);
-    if (n_proplist_has_key (props, SOUND_FILENAME_KEY)) {
+    if (n_proplist_has_atom (props, sound_filename_atom)) {
         N_DEBUG (LOG_CAT "request has a sound.filename, we can handle this.");
         return TRUE;
     }
@@ -676,7 +1299,7 @@ convert_number (const char *str, gint *result)
 }
 
 static FadeEffect*
-parse_volume_fade (const char *str)
+parse_volume_fade (NRequest *request, const char *str)
 {
 #define VALID_NUMBER(in_f) \
     (valid = (valid == 0) ? 0 : (in_f))
@@ -701,7 +1324,7 @@ parse_volume_fade (const char *str)
         VALID_NUMBER (convert_number (split[3], &end));
 
         if (valid) {
-            effect = g_slice_new (FadeEffect);
+            effect = n_request_alloc (request, sizeof (FadeEffect));
             effect->enabled  = TRUE;
             effect->elapsed  = 0;
             effect->position = position;
@@ -793,12 +1416,17 @@ update_fade_effect (FadeEffect *effect, gdouble elapsed, gdouble volume)
     return;
 }
 
-static void
-free_fade_effect (FadeEffect *effect)
+static gsize
+get_size_param (const NProplist *params, const char *key, gsize default_value)
 {
-    if (effect) {
-        g_slice_free (FadeEffect, effect);
-    }
+    const char *str = NULL;
+    gint64      value;
+
+    if ((str = n_proplist_get_string (params, key)) == NULL)
+        return default_value;
+
+    value = g_ascii_strtoll (str, NULL, 10);
+    return value > 0 ? (gsize) value : 0;
 }
 
 static gboolean
@@ -830,36 +1458,36 @@ gst_sink_prepare (NSinkInterface *iface, NRequest *request)
 
     props = (NProplist*) n_request_get_properties (request);
 
-    stream = g_slice_new0 (StreamData);
+    stream = n_request_alloc0 (request, sizeof (StreamData));
     stream->request = request;
     stream->iface = iface;
-    stream->filename = n_proplist_get_string (props, SOUND_FILENAME_KEY);
-    stream->repeat_enabled = n_proplist_get_bool (props, SOUND_REPEAT_KEY);
+    stream->filename = n_proplist_get_string_atom (props, sound_filename_atom);
+    stream->repeat_enabled = n_proplist_get_bool_atom (props, sound_repeat_atom);
     stream->properties = create_stream_properties (props);
     stream->first_play = TRUE;
 
-    enabled = n_proplist_get_string (props, SOUND_ENABLED_KEY);
+    enabled = n_proplist_get_string_atom (props, sound_enabled_atom);
     stream->sound_enabled = (enabled && g_str_equal(enabled, SOUND_OFF)) ? FALSE : TRUE;
 
-    stream->volume_limit = parse_volume_limit (n_proplist_get_string (props, SOUND_VOLUME_KEY),
+    stream->volume_limit = parse_volume_limit (n_proplist_get_string_atom (props, sound_volume_atom),
         &stream->volume_min, &stream->volume_max);
     
-    stream->volume_fixed = parse_fixed_volume (n_proplist_get_string (props, SOUND_VOLUME_KEY),
+    stream->volume_fixed = parse_fixed_volume (n_proplist_get_string_atom (props, sound_volume_atom),
         &stream->volume_set);
 
-    fade_only_custom = n_proplist_get_bool (props, FADE_ONLY_CUSTOM_KEY);
+    fade_only_custom = n_proplist_get_bool_atom (props, fade_only_custom_atom);
     custom_sound = is_custom_sound_filename (stream->filename);
 
     if (!fade_only_custom || (fade_only_custom && custom_sound)) {
         /* parse the volume fading keys and setup fades for the stream
            if available */
 
-        stream->fade_out = parse_volume_fade (
-            n_proplist_get_string (props, FADE_OUT_KEY));
-        stream->fade_in = parse_volume_fade (
-            n_proplist_get_string (props, FADE_IN_KEY));
+        stream->fade_out = parse_volume_fade (request,
+            n_proplist_get_string_atom (props, fade_out_atom));
+        stream->fade_in = parse_volume_fade (request,
+            n_proplist_get_string_atom (props, fade_in_atom));
 
-        timeout_ms = n_proplist_get_int (props, MAX_TIMEOUT_KEY);
+        timeout_ms = n_proplist_get_int_atom (props, max_timeout_atom);
         timeout_ms = timeout_ms < 0 ? 0 : timeout_ms;
 
         n_request_set_timeout (request, (guint) timeout_ms);
@@ -876,6 +1504,8 @@ gst_sink_prepare (NSinkInterface *iface, NRequest *request)
         return TRUE;
     }
 
+    stream->tone = pcm_cache_lookup (pcm_cache, stream->filename);
+
     if (!make_pipeline (stream))
         return FALSE;
 
@@ -947,20 +1577,26 @@ gst_sink_stop (NSinkInterface *iface, NRequest *request)
 
     free_pipeline (stream);
     free_stream_properties (stream->properties);
+    stream->properties = NULL;
 
-    free_fade_effect (stream->fade_out);
-    stream->fade_out = NULL;
+    pcm_tone_unref (stream->tone);
+    stream->tone = NULL;
 
-    free_fade_effect (stream->fade_in);
-    stream->fade_in = NULL;
+    /* the stream data and fade effects are released with the request. */
 
-    g_slice_free (StreamData, stream);
+    stream->fade_out = NULL;
+    stream->fade_in  = NULL;
 }
 
 N_PLUGIN_LOAD (plugin)
 {
-    NCore    *core    = NULL;
-    NContext *context = NULL;
+    NCore           *core      = NULL;
+    NContext        *context   = NULL;
+    const NProplist *params    = NULL;
+    const char      *pool_size = NULL;
+    const char      *str       = NULL;
+    gsize            cache_size, max_file_size;
+    guint            max_duration;
 
     static const NSinkInterfaceDecl decl = {
         .name       = "gst",
@@ -975,8 +1611,44 @@ N_PLUGIN_LOAD (plugin)
 
     n_plugin_register_sink (plugin, &decl);
 
+    sound_filename_atom   = n_atom_intern (SOUND_FILENAME_KEY);
+    sound_repeat_atom     = n_atom_intern (SOUND_REPEAT_KEY);
+    sound_volume_atom     = n_atom_intern (SOUND_VOLUME_KEY);
+    sound_enabled_atom    = n_atom_intern (SOUND_ENABLED_KEY);
+    fade_only_custom_atom = n_atom_intern (FADE_ONLY_CUSTOM_KEY);
+    fade_out_atom         = n_atom_intern (FADE_OUT_KEY);
+    fade_in_atom          = n_atom_intern (FADE_IN_KEY);
+    max_timeout_atom      = n_atom_intern (MAX_TIMEOUT_KEY);
+
+    params = n_plugin_get_params (plugin);
+
+    pool_size = n_proplist_get_string (params, POOL_SIZE_KEY);
+    if (pool_size)
+        pipeline_pool_size = (guint) CLAMP (atoi (pool_size), 0, 16);
+
+    N_DEBUG (LOG_CAT "keeping up to %u idle pipelines", pipeline_pool_size);
+
+    cache_size = get_size_param (params, PCM_CACHE_SIZE_KEY, DEFAULT_PCM_CACHE_SIZE);
+    max_file_size = get_size_param (params, PCM_MAX_FILE_SIZE_KEY, DEFAULT_PCM_MAX_FILE_SIZE);
+    max_duration = (guint) get_size_param (params, PCM_MAX_DURATION_KEY, DEFAULT_PCM_MAX_DURATION);
+
+    pcm_cache = pcm_cache_new (cache_size, max_file_size, max_duration);
+
+    if ((str = n_proplist_get_string (params, PREFETCH_KEY)) != NULL)
+        prefetch_enabled = g_ascii_strcasecmp (str, "false") != 0;
+
+    if ((str = n_proplist_get_string (params, FAST_PATH_KEY)) != NULL)
+        fast_path_enabled = g_ascii_strcasecmp (str, "false") != 0;
+
+    format_cache = format_cache_new (FORMAT_CACHE_ENTRIES);
+
+    N_DEBUG (LOG_CAT "pcm cache of %" G_GSIZE_FORMAT " bytes for files up to %"
+                     G_GSIZE_FORMAT " bytes and %u ms", cache_size, max_file_size,
+        max_duration);
+
     core = n_plugin_get_core (plugin);
     context = n_core_get_context (core);
+    gst_core = core;
 
     if (!n_core_connect (core, N_CORE_HOOK_INIT_DONE, 0,
                          init_done_cb, context))
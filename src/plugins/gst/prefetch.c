@@ -0,0 +1,207 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#include <ngf/log.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "prefetch.h"
+
+#define LOG_CAT "gst: "
+
+#define IOPRIO_CLASS_IDLE   3
+#define IOPRIO_CLASS_SHIFT  13
+#define IOPRIO_WHO_PROCESS  1
+
+struct _Prefetch
+{
+    PcmCache       *cache;
+    GList          *filenames;
+    GThread        *thread;
+    volatile gint   cancel;
+    GList          *captures;   /* decoded by the thread, stored in the main thread */
+    GMutex          lock;       /* protects done_id */
+    guint           done_id;
+};
+
+static void     prefetch_set_idle_priority ();
+static void     prefetch_readahead         (const char *filename);
+static gpointer prefetch_thread_cb         (gpointer userdata);
+static gboolean prefetch_done_cb           (gpointer userdata);
+static void     prefetch_free_captures     (Prefetch *prefetch, PcmCache *cache);
+
+
+
+static void
+prefetch_set_idle_priority ()
+{
+#ifdef SYS_ioprio_set
+    /* who 0 is the calling thread, the rest of the daemon keeps its
+       priority. */
+
+    if (syscall (SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+            IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) < 0)
+        N_DEBUG (LOG_CAT "unable to set idle I/O priority for prefetch");
+#endif
+}
+
+static void
+prefetch_readahead (const char *filename)
+{
+    int fd = -1;
+
+    if ((fd = open (filename, O_RDONLY)) < 0) {
+        N_DEBUG (LOG_CAT "prefetch skipped '%s', unable to open", filename);
+        return;
+    }
+
+    (void) posix_fadvise (fd, 0, 0, POSIX_FADV_WILLNEED);
+    close (fd);
+}
+
+static gpointer
+prefetch_thread_cb (gpointer userdata)
+{
+    Prefetch   *prefetch = (Prefetch*) userdata;
+    PcmCapture *capture  = NULL;
+    GSource    *source   = NULL;
+    GList      *iter     = NULL;
+    guint       count    = 0;
+
+    prefetch_set_idle_priority ();
+
+    /* all the files first, decoding only touches the short ones. */
+
+    for (iter = g_list_first (prefetch->filenames); iter; iter = g_list_next (iter)) {
+        if (g_atomic_int_get (&prefetch->cancel))
+            break;
+        prefetch_readahead ((const char*) iter->data);
+    }
+
+    for (iter = g_list_first (prefetch->filenames); iter; iter = g_list_next (iter)) {
+        if (g_atomic_int_get (&prefetch->cancel))
+            break;
+
+        capture = pcm_cache_decode (prefetch->cache, (const char*) iter->data,
+            &prefetch->cancel);
+        if (capture) {
+            prefetch->captures = g_list_prepend (prefetch->captures, capture);
+            count++;
+        }
+    }
+
+    N_DEBUG (LOG_CAT "prefetched %u sounds, %u decoded",
+        g_list_length (prefetch->filenames), count);
+
+    /* the completion may be dispatched before g_source_attach returns,
+       the callback waits for the id to be stored. */
+
+    g_mutex_lock (&prefetch->lock);
+    source = g_idle_source_new ();
+    g_source_set_callback (source, prefetch_done_cb, prefetch, NULL);
+    prefetch->done_id = g_source_attach (source, NULL);
+    g_source_unref (source);
+    g_mutex_unlock (&prefetch->lock);
+
+    return NULL;
+}
+
+static void
+prefetch_free_captures (Prefetch *prefetch, PcmCache *cache)
+{
+    GList *iter = NULL;
+
+    for (iter = g_list_first (prefetch->captures); iter; iter = g_list_next (iter))
+        pcm_cache_capture_finish (cache, (PcmCapture*) iter->data, TRUE);
+
+    g_list_free (prefetch->captures);
+    prefetch->captures = NULL;
+}
+
+static gboolean
+prefetch_done_cb (gpointer userdata)
+{
+    Prefetch *prefetch = (Prefetch*) userdata;
+
+    /* the thread is about to exit after queueing this. */
+
+    g_mutex_lock (&prefetch->lock);
+    prefetch->done_id = 0;
+    g_mutex_unlock (&prefetch->lock);
+
+    g_thread_join (prefetch->thread);
+    prefetch->thread = NULL;
+
+    prefetch_free_captures (prefetch, prefetch->cache);
+    pcm_cache_log_stats (prefetch->cache);
+
+    return FALSE;
+}
+
+Prefetch*
+prefetch_start (PcmCache *cache, GList *filenames)
+{
+    Prefetch *prefetch = NULL;
+
+    prefetch = g_slice_new0 (Prefetch);
+    prefetch->cache     = cache;
+    prefetch->filenames = filenames;
+    g_mutex_init (&prefetch->lock);
+    prefetch->thread    = g_thread_try_new ("prefetch", prefetch_thread_cb, prefetch, NULL);
+
+    if (!prefetch->thread)
+        N_WARNING (LOG_CAT "unable to start the prefetch thread");
+
+    return prefetch;
+}
+
+void
+prefetch_stop (Prefetch *prefetch)
+{
+    if (!prefetch)
+        return;
+
+    if (prefetch->thread) {
+        g_atomic_int_set (&prefetch->cancel, 1);
+        g_thread_join (prefetch->thread);
+        prefetch->thread = NULL;
+    }
+
+    /* the thread is gone, the completion is either pending or has run
+       already. */
+
+    g_mutex_lock (&prefetch->lock);
+    if (prefetch->done_id > 0) {
+        g_source_remove (prefetch->done_id);
+        prefetch->done_id = 0;
+    }
+    g_mutex_unlock (&prefetch->lock);
+
+    prefetch_free_captures (prefetch, NULL);
+
+    g_list_foreach (prefetch->filenames, (GFunc) g_free, NULL);
+    g_list_free (prefetch->filenames);
+    g_mutex_clear (&prefetch->lock);
+    g_slice_free (Prefetch, prefetch);
+}
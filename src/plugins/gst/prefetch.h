@@ -0,0 +1,43 @@
+/*
+ * ngfd - Non-graphic feedback daemon
+ *
+ * Copyright (C) 2010 Nokia Corporation.
+ * Contact: Xun Chen <xun.chen@nokia.com>
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <glib.h>
+
+#include "pcm-cache.h"
+
+/* warms up the sounds the events may play. a background thread at idle
+   I/O priority reads the files into the page cache and decodes the short
+   ones into the pcm cache, so that the first play after boot does not pay
+   for the cold cache and the decoder startup. */
+
+typedef struct _Prefetch Prefetch;
+
+/* takes the list of filenames and the strings in it. */
+Prefetch* prefetch_start (PcmCache *cache, GList *filenames);
+
+/* cancels the work not done yet and waits for the thread. */
+void      prefetch_stop  (Prefetch *prefetch);
+
+#endif /* PREFETCH_H */
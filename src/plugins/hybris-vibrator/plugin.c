@@ -68,7 +68,7 @@ hybris_vibrator_sink_prepare (NSinkInterface *iface, NRequest *request)
 {
     N_DEBUG (LOG_CAT "sink prepare");
 
-    HybrisVibratorData *data = g_slice_new0 (HybrisVibratorData);
+    HybrisVibratorData *data = n_request_alloc0 (request, sizeof (HybrisVibratorData));
 
     data->request    = request;
     data->iface      = iface;
@@ -150,8 +150,6 @@ hybris_vibrator_sink_stop (NSinkInterface *iface, NRequest *request)
         g_source_remove (data->timeout_id);
         data->timeout_id = 0;
     }
-
-    g_slice_free (HybrisVibratorData, data);
 }
 
 N_PLUGIN_LOAD (plugin)
@@ -325,7 +325,7 @@ static int
 immvibe_sink_prepare (NSinkInterface *iface, NRequest *request)
 {
     const NProplist *props = n_request_get_properties (request);
-    ImmvibeData *data = g_slice_new0 (ImmvibeData);
+    ImmvibeData *data = n_request_alloc0 (request, sizeof (ImmvibeData));
 
     char *filename;
     const char *sound_filename, *immvibe_filename, *lookup_key,
@@ -347,7 +347,6 @@ immvibe_sink_prepare (NSinkInterface *iface, NRequest *request)
     if (custom_file && !allow_custom &&
         !g_file_test (custom_file, G_FILE_TEST_EXISTS) && !n_request_is_fallback (request))
     {
-        g_slice_free (ImmvibeData, data);
         return FALSE;
     }
 
@@ -495,8 +494,8 @@ immvibe_sink_stop (NSinkInterface *iface, NRequest *request)
         data->idle_complete_id = 0;
     }
 
-    g_free       (data->pattern);
-    g_slice_free (ImmvibeData, data);
+    g_free (data->pattern);
+    data->pattern = NULL;
 
     n_request_store_data (request, IMMVIBE_KEY, NULL);
 }
@@ -143,7 +143,7 @@ mce_sink_prepare (NSinkInterface *iface, NRequest *request)
     (void) iface;
     (void) request;
     
-    MceData *data = g_slice_new0 (MceData);
+    MceData *data = n_request_alloc0 (request, sizeof (MceData));
 
     data->request    = request;
     data->iface      = iface;
@@ -180,11 +180,9 @@ mce_sink_play (NSinkInterface *iface, NRequest *request)
 
     pattern = n_proplist_get_string (props, "mce.led_pattern");
     if (pattern != NULL) {
-        data->pattern = g_strdup (pattern);
-        if (!toggle_pattern (pattern, TRUE)) {
-            g_free (data->pattern);
+        data->pattern = n_request_strdup (request, pattern);
+        if (!toggle_pattern (pattern, TRUE))
             data->pattern = NULL;
-        }
     }
 
     /* Call n_sink_interface_complete() after 100ms. */
@@ -215,11 +213,8 @@ mce_sink_stop (NSinkInterface *iface, NRequest *request)
         /* Unless specified otherwise, we'll let MCE clear the pattern */
         if (n_proplist_get_bool (props, "mce.clear_pattern"))
             toggle_pattern (data->pattern, FALSE);
-        g_free (data->pattern);
         data->pattern = NULL;
     }
-
-    g_slice_free (MceData, data);
 }
 
 N_PLUGIN_LOAD (plugin)
@@ -56,6 +56,7 @@ typedef struct _ProfileEntry
     gchar  *key;
     gchar  *profile;
     gchar  *target;
+    guint   refs;           /* event properties using the entry */
 } ProfileEntry;
 
 typedef struct _SoundLevelEntry
@@ -68,6 +69,7 @@ typedef struct _SoundLevelEntry
 static DBusConnection *session_bus = NULL;
 static GList      *sound_levels            = NULL; /* contains SoundLevelEntry entries */
 static GList      *request_keys            = NULL;
+static GHashTable *request_key_refs        = NULL; /* key to number of event properties using it */
 static GHashTable *profile_entries         = NULL;
 static gchar      *file_search_path        = NULL;
 
@@ -76,12 +78,18 @@ static void          transform_properties_cb      (NHook *hook,
                                                    void *userdata);
 static ProfileEntry* parse_profile_entry          (const char *value);
 static void          free_entry                   (ProfileEntry *entry);
-static GList*        append_unique_key            (GList *keys,
-                                                   const char *key);
+static void          ref_request_key              (const char *key);
+static void          unref_request_key            (const char *key);
 static void          find_entries_within_event_cb (const char *key,
                                                    const NValue *value,
                                                    gpointer userdata);
 static void          find_profile_entries         (NCore *core);
+static void          forget_entries_within_event_cb (const char *key,
+                                                   const NValue *value,
+                                                   gpointer userdata);
+static void          events_changed_cb            (NHook *hook,
+                                                   void *data,
+                                                   void *userdata);
 static void          value_changed_cb             (const char *profile,
                                                    const char *key,
                                                    const char *value,
@@ -150,7 +158,7 @@ transform_properties_cb (NHook *hook, void *data, void *userdata)
         if (value) {
             N_DEBUG (LOG_CAT "+ transforming profile key '%s' to target '%s'",
                 entry->key, entry->target);
-            n_proplist_set (new_props, entry->target, n_value_copy (value));
+            n_proplist_set_take (new_props, entry->target, n_value_copy (value));
         }
 
         g_free (context_key);
@@ -214,22 +222,46 @@ free_entry (ProfileEntry *entry)
     g_free (entry);
 }
 
-static GList*
-append_unique_key (GList *keys, const char *key)
+static void
+ref_request_key (const char *key)
 {
     g_assert (key != NULL);
 
-    GList *result = NULL;
-    GList *iter   = NULL;
+    guint refs = GPOINTER_TO_UINT (g_hash_table_lookup (request_key_refs, key));
 
-    for (iter = g_list_first (keys); iter; iter = g_list_next (iter)) {
-        if (g_str_equal ((gchar*) iter->data, key))
-            return keys;
+    if (refs == 0) {
+        N_DEBUG (LOG_CAT "new unique transform key '%s'", key);
+        request_keys = g_list_append (request_keys, g_strdup (key));
     }
 
-    N_DEBUG (LOG_CAT "new unique transform key '%s'", key);
-    result = g_list_append (keys, g_strdup (key));
-    return result;
+    g_hash_table_replace (request_key_refs, g_strdup (key),
+        GUINT_TO_POINTER (refs + 1));
+}
+
+static void
+unref_request_key (const char *key)
+{
+    g_assert (key != NULL);
+
+    GList *iter = NULL;
+    guint  refs = GPOINTER_TO_UINT (g_hash_table_lookup (request_key_refs, key));
+
+    if (refs > 1) {
+        g_hash_table_replace (request_key_refs, g_strdup (key),
+            GUINT_TO_POINTER (refs - 1));
+        return;
+    }
+
+    g_hash_table_remove (request_key_refs, key);
+
+    for (iter = g_list_first (request_keys); iter; iter = g_list_next (iter)) {
+        if (g_str_equal ((gchar*) iter->data, key)) {
+            N_DEBUG (LOG_CAT "transform key '%s' no longer used", key);
+            g_free (iter->data);
+            request_keys = g_list_delete_link (request_keys, iter);
+            break;
+        }
+    }
 }
 
 static void
@@ -257,16 +289,77 @@ find_entries_within_event_cb (const char *key, const NValue *value,
 
     match = (ProfileEntry*) g_hash_table_lookup (profile_entries, value_str);
     if (!match) {
+        entry->refs = 1;
         g_hash_table_insert (profile_entries, g_strdup (value_str), entry);
         N_DEBUG (LOG_CAT "new profile entry with key '%s', profile '%s' and target '%s'",
             entry->key, entry->profile, entry->target);
-
-        if (g_str_has_suffix (key, PROFILE_KEY_PATTERN))
-            request_keys = append_unique_key (request_keys, key);
     }
     else {
+        match->refs++;
         free_entry (entry);
     }
+
+    if (g_str_has_suffix (key, PROFILE_KEY_PATTERN))
+        ref_request_key (key);
+}
+
+static void
+forget_entries_within_event_cb (const char *key, const NValue *value,
+                                gpointer userdata)
+{
+    (void) userdata;
+
+    ProfileEntry *match     = NULL;
+    const char   *value_str = NULL;
+
+    if (g_strstr_len (key, 32, PROFILE_KEY_PATTERN) == NULL)
+        return;
+
+    value_str = n_value_get_string ((NValue*) value);
+    if (!value_str)
+        return;
+
+    match = (ProfileEntry*) g_hash_table_lookup (profile_entries, value_str);
+    if (!match)
+        return;
+
+    if (g_str_has_suffix (key, PROFILE_KEY_PATTERN))
+        unref_request_key (key);
+
+    if (--match->refs == 0) {
+        N_DEBUG (LOG_CAT "profile entry '%s' no longer used", value_str);
+        g_hash_table_remove (profile_entries, value_str);
+    }
+}
+
+static void
+events_changed_cb (NHook *hook, void *data, void *userdata)
+{
+    (void) hook;
+    (void) userdata;
+
+    NCoreHookEventsChangedData *changed = (NCoreHookEventsChangedData*) data;
+    GList                      *iter    = NULL;
+    NEvent                     *event   = NULL;
+
+    /* update the entries from the changed events only, the rest of the
+       events are the same. */
+
+    for (iter = g_list_first (changed->removed); iter; iter = g_list_next (iter)) {
+        event = (NEvent*) iter->data;
+        n_proplist_foreach ((NProplist*) n_event_get_properties (event),
+            forget_entries_within_event_cb, NULL);
+    }
+
+    for (iter = g_list_first (changed->added); iter; iter = g_list_next (iter)) {
+        event = (NEvent*) iter->data;
+
+        N_DEBUG (LOG_CAT "searching profile entries from event '%s'",
+            n_event_get_name (event));
+
+        n_proplist_foreach ((NProplist*) n_event_get_properties (event),
+            find_entries_within_event_cb, NULL);
+    }
 }
 
 static void
@@ -409,6 +502,10 @@ value_changed_cb (const char *profile,
     NContext   *context   = n_core_get_context (core);
     const char *current   = NULL;
 
+    /* the profile and current values change together, let subscribers
+       see both at once. */
+
+    n_context_begin_batch (context);
     update_context_value (context, profile, key, value);
 
     /* update current profile value if necessary */
@@ -417,6 +514,8 @@ value_changed_cb (const char *profile,
         CURRENT_PROFILE_KEY));
     if (current && g_str_equal (current, profile))
         update_context_value (context, NULL, key, value);
+
+    n_context_commit_batch (context);
 }
 
 static void
@@ -468,6 +567,10 @@ query_current_values (NCore *core)
     profileval_t  *v           = NULL;
     gboolean       is_current  = FALSE;
 
+    /* every profile key is set here, notify subscribers only once. */
+
+    n_context_begin_batch (context);
+
     profiles = profile_get_profiles ();
     current  = n_value_get_string ((NValue*) n_context_get_value (context,
         "profile.current_profile"));
@@ -494,6 +597,8 @@ query_current_values (NCore *core)
     profile_free_values (values);
 
     profile_free_profiles (profiles);
+
+    n_context_commit_batch (context);
 }
 
 static void
@@ -582,6 +687,8 @@ N_PLUGIN_LOAD (plugin)
 
     profile_entries = g_hash_table_new_full (g_str_hash, g_str_equal,
         g_free, (GDestroyNotify) free_entry);
+    request_key_refs = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, NULL);
 
     /* find all profile key entries within events. */
 
@@ -593,6 +700,11 @@ N_PLUGIN_LOAD (plugin)
     (void) n_core_connect (core, N_CORE_HOOK_TRANSFORM_PROPERTIES,
         0, transform_properties_cb, core);
 
+    /* keep the entries up to date when event files are reloaded. */
+
+    (void) n_core_connect (core, N_CORE_HOOK_EVENTS_CHANGED,
+        0, events_changed_cb, core);
+
     /* query the system sound volume levels and file search
        path. */
 
@@ -634,6 +746,7 @@ N_PLUGIN_UNLOAD (plugin)
     g_free               (file_search_path);
     g_list_free_full     (sound_levels, sound_levels_free_cb);
     g_hash_table_destroy (profile_entries);
+    g_hash_table_destroy (request_key_refs);
     g_list_foreach       (request_keys, (GFunc) g_free, NULL);
     g_list_free          (request_keys);
 
@@ -56,6 +56,17 @@ static const char* query_lookup_key (NRequest *request)
     return n_proplist_get_string (props, "immvibe.lookup_from_key");
 }
 
+static void
+drop_key_cb (const char *key, const NValue *value, gpointer userdata)
+{
+    NProplist *edit = (NProplist*) userdata;
+
+    (void) value;
+
+    if (!g_list_find_custom (transform_allowed_keys, key, (GCompareFunc) strcmp))
+        n_proplist_unset (edit, key);
+}
+
 static void
 new_request_cb (NHook *hook, void *data, void *userdata)
 {
@@ -63,7 +74,7 @@ new_request_cb (NHook *hook, void *data, void *userdata)
     (void) data;
     (void) userdata;
 
-    NProplist *props = NULL, *new_props = NULL;
+    NProplist *props = NULL, *edit = NULL;
     const char *key = NULL, *map_key = NULL, *target = NULL;
     GList *iter = NULL;
     NValue *value = NULL;
@@ -94,9 +105,26 @@ new_request_cb (NHook *hook, void *data, void *userdata)
         return;
     }
 
-    new_props = n_proplist_new ();
+    /* the request properties are edited in place, props keeps showing the
+       values from before the transform. */
+
+    edit = n_request_edit_properties (transform->request);
     allow_custom = query_allow_custom_filenames (transform->request);
 
+    /* remove everything first, a mapped value may land on a key that is
+       itself handled later in the list. */
+
+    n_proplist_foreach (props, drop_key_cb, edit);
+
+    for (iter = g_list_first (transform_allowed_keys); iter; iter = g_list_next (iter)) {
+        key     = (const char*) iter->data;
+        map_key = g_hash_table_lookup (transform_key_map, key);
+        target  = map_key ? map_key : key;
+
+        if (map_key || (g_str_has_suffix (target, FILENAME_SUFFIX) && !allow_custom))
+            n_proplist_unset (edit, key);
+    }
+
     for (iter = g_list_first (transform_allowed_keys); iter; iter = g_list_next (iter)) {
         key     = (const char*) iter->data;
         value   = n_proplist_get (props, key);
@@ -105,31 +133,30 @@ new_request_cb (NHook *hook, void *data, void *userdata)
 
         if (value && map_key) {
             tmp = g_strdup_printf ("%s.original", target);
-            n_proplist_set (new_props, tmp, n_value_copy (value));
+            n_proplist_set_take (edit, tmp, n_value_copy (value));
             N_DEBUG (LOG_CAT "storing value before transform for key '%s'", tmp);
             g_free (tmp);
         }
 
         if (g_str_has_suffix (target, FILENAME_SUFFIX) && !allow_custom) {
-            N_DEBUG (LOG_CAT "+ rejecting key '%s', no custom allowed.", target);            
+            N_DEBUG (LOG_CAT "+ rejecting key '%s', no custom allowed.", target);
             continue;
         }
 
         if (map_key) {
             N_DEBUG (LOG_CAT "+ transforming key '%s' to '%s'", key, map_key);
-            n_proplist_set (new_props, map_key, n_value_copy (value));
+            if (value)
+                n_proplist_set_take (edit, map_key, n_value_copy (value));
         }
         else {
             N_DEBUG (LOG_CAT "+ allowing value '%s'", key);
-            n_proplist_set (new_props, key, n_value_copy (value));
         }
     }
 
     if (!allow_custom && overwrite_audio)
-        n_proplist_set (new_props, "sound.filename", n_value_copy (context_audio));
+        n_proplist_set_take (edit, "sound.filename", n_value_copy (context_audio));
 
-    n_request_set_properties (transform->request, new_props);
-    n_proplist_free (new_props);
+    n_request_commit_properties (transform->request, edit);
 }
 
 static int
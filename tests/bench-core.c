@@ -0,0 +1,579 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <glib.h>
+
+#include "src/include/ngf/log.h"
+#include "src/include/ngf/proplist.h"
+#include "src/include/ngf/sinkinterface.h"
+#include "src/include/ngf/inputinterface.h"
+#include "src/ngf/core-internal.h"
+
+#define DEFAULT_REQUESTS    20000
+#define DEFAULT_CONCURRENCY 8
+#define DEFAULT_MIX         "sms=60,email=25,ringtone=10,alarm=5"
+
+/* lifecycle stages measured for every request:
+   submit -> sink prepare -> sink play -> sink complete -> reply to input */
+
+enum
+{
+    STAGE_RESOLVE = 0,
+    STAGE_SYNCHRONIZE,
+    STAGE_PLAY,
+    STAGE_COMPLETE,
+    STAGE_TOTAL,
+    STAGE_LAST
+};
+
+static const char *stage_names[STAGE_LAST] = {
+    "resolve",
+    "synchronize",
+    "play",
+    "complete",
+    "total"
+};
+
+typedef struct _BenchRequest
+{
+    NSinkInterface *sink;
+    gint64          submitted;
+    gint64          prepared;
+    gint64          played;
+    gint64          completed;
+} BenchRequest;
+
+typedef struct _BenchEvent
+{
+    gchar  *name;
+    guint   weight;
+} BenchEvent;
+
+typedef struct _Bench
+{
+    GMainLoop       *loop;
+    NCore           *core;
+    NInputInterface *input;
+
+    GArray          *mix;           /* BenchEvent */
+    guint            total_weight;
+    GRand           *rand;
+
+    guint            requests;      /* requests to run */
+    guint            concurrency;   /* maximum requests in flight */
+    guint            rate;          /* requests per second, 0 for back to back */
+
+    guint            submitted;
+    guint            finished;
+    guint            failed;
+    guint            in_flight;
+    gint64           started;
+    guint            rate_source_id;
+
+    BenchRequest    *data;          /* one per request, in submit order */
+    GHashTable      *active;        /* NRequest* -> BenchRequest* */
+    gint64          *samples[STAGE_LAST];
+} Bench;
+
+static Bench bench;
+
+/* allocation counting. the glibc allocator entry points are wrapped so that
+   every allocation made by the core, glib included, is seen here. not
+   available with other C libraries or when built with a sanitizer that
+   replaces the allocator itself. */
+
+static volatile gint alloc_count = 0;
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#define HAVE_ALLOC_COUNT 1
+
+extern void* __libc_malloc  (size_t size);
+extern void* __libc_calloc  (size_t nmemb, size_t size);
+extern void* __libc_realloc (void *ptr, size_t size);
+
+void*
+malloc (size_t size)
+{
+    g_atomic_int_inc (&alloc_count);
+    return __libc_malloc (size);
+}
+
+void*
+calloc (size_t nmemb, size_t size)
+{
+    g_atomic_int_inc (&alloc_count);
+    return __libc_calloc (nmemb, size);
+}
+
+void*
+realloc (void *ptr, size_t size)
+{
+    g_atomic_int_inc (&alloc_count);
+    return __libc_realloc (ptr, size);
+}
+#endif
+
+static gint64
+now_ns ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (gint64) ts.tv_sec * G_GINT64_CONSTANT (1000000000) + ts.tv_nsec;
+}
+
+static void submit_next ();
+
+/* synthetic sink, behaves like the fake sink plugin except that playback
+   completes on the next main loop iteration instead of after a timeout. */
+
+static gboolean
+sink_complete_cb (gpointer userdata)
+{
+    NRequest     *request = (NRequest*) userdata;
+    BenchRequest *data    = g_hash_table_lookup (bench.active, request);
+
+    data->completed = now_ns ();
+    n_sink_interface_complete (data->sink, request);
+
+    return FALSE;
+}
+
+static int
+sink_prepare (NSinkInterface *iface, NRequest *request)
+{
+    BenchRequest *data = g_hash_table_lookup (bench.active, request);
+
+    data->prepared = now_ns ();
+    n_sink_interface_synchronize (iface, request);
+
+    return TRUE;
+}
+
+static int
+sink_play (NSinkInterface *iface, NRequest *request)
+{
+    BenchRequest *data = g_hash_table_lookup (bench.active, request);
+
+    data->sink   = iface;
+    data->played = now_ns ();
+    g_idle_add (sink_complete_cb, request);
+
+    return TRUE;
+}
+
+static int
+sink_pause (NSinkInterface *iface, NRequest *request)
+{
+    (void) iface;
+    (void) request;
+    return TRUE;
+}
+
+static void
+sink_stop (NSinkInterface *iface, NRequest *request)
+{
+    (void) iface;
+    (void) request;
+}
+
+/* synthetic input, records the request when the core is done with it. */
+
+static void
+record (BenchRequest *data, gint64 done)
+{
+    guint i = bench.finished;
+
+    bench.samples[STAGE_RESOLVE][i]     = data->prepared - data->submitted;
+    bench.samples[STAGE_SYNCHRONIZE][i] = data->played - data->prepared;
+    bench.samples[STAGE_PLAY][i]        = data->completed - data->played;
+    bench.samples[STAGE_COMPLETE][i]    = done - data->completed;
+    bench.samples[STAGE_TOTAL][i]       = done - data->submitted;
+}
+
+static void
+request_done (NRequest *request, gboolean failed)
+{
+    BenchRequest *data = g_hash_table_lookup (bench.active, request);
+
+    if (failed || !data->completed)
+        bench.failed++;
+    else {
+        record (data, now_ns ());
+        bench.finished++;
+    }
+
+    g_hash_table_remove (bench.active, request);
+    bench.in_flight--;
+
+    if (bench.finished + bench.failed == bench.requests) {
+        g_main_loop_quit (bench.loop);
+        return;
+    }
+
+    if (bench.rate == 0)
+        submit_next ();
+}
+
+static void
+input_send_error (NInputInterface *iface, NRequest *request, const char *err_msg)
+{
+    (void) iface;
+    (void) err_msg;
+    request_done (request, TRUE);
+}
+
+static void
+input_send_reply (NInputInterface *iface, NRequest *request, int ret_code)
+{
+    (void) iface;
+
+    if (ret_code == N_CORE_EVENT_COMPLETED)
+        request_done (request, FALSE);
+}
+
+static const char*
+pick_event ()
+{
+    BenchEvent *event = NULL;
+    guint       value = 0;
+    guint       i;
+
+    value = g_rand_int_range (bench.rand, 0, bench.total_weight);
+    for (i = 0; i < bench.mix->len; ++i) {
+        event = &g_array_index (bench.mix, BenchEvent, i);
+        if (value < event->weight)
+            break;
+        value -= event->weight;
+    }
+
+    return event->name;
+}
+
+static void
+submit_next ()
+{
+    NProplist    *props   = NULL;
+    NRequest     *request = NULL;
+    BenchRequest *data    = NULL;
+
+    if (bench.submitted >= bench.requests || bench.in_flight >= bench.concurrency)
+        return;
+
+    /* properties as they arrive from the dbus input. */
+
+    props = n_proplist_new ();
+    n_proplist_set_string (props, "dbus.event.client", ":1.42");
+    n_proplist_set_bool   (props, "media.audio", TRUE);
+    n_proplist_set_bool   (props, "media.vibra", TRUE);
+    n_proplist_set_bool   (props, "media.leds", TRUE);
+    n_proplist_set_uint   (props, "play.mode", 1);
+
+    request = n_request_new_with_event_and_properties (pick_event (), props);
+    n_proplist_free (props);
+
+    /* the timing data is kept outside of the request, pointer properties
+       would make the request uncacheable. */
+
+    data = &bench.data[bench.submitted];
+    g_hash_table_insert (bench.active, request, data);
+
+    bench.submitted++;
+    bench.in_flight++;
+
+    data->submitted = now_ns ();
+    n_input_interface_play_request (bench.input, request);
+}
+
+static gboolean
+rate_cb (gpointer userdata)
+{
+    guint due = 0;
+
+    (void) userdata;
+
+    /* submit everything that should have been submitted by now, a single
+       late wakeup does not lower the offered rate. */
+
+    due = (guint) ((now_ns () - bench.started) * bench.rate / G_GINT64_CONSTANT (1000000000)) + 1;
+    while (bench.submitted < due && bench.submitted < bench.requests &&
+           bench.in_flight < bench.concurrency)
+        submit_next ();
+
+    if (bench.submitted >= bench.requests) {
+        bench.rate_source_id = 0;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static NEvent*
+create_event (const char *name, const char *rule_key, const char *rule_value,
+              const char *filename)
+{
+    NEvent *event = n_event_new ();
+
+    event->name       = g_strdup (name);
+    event->rules      = n_proplist_new ();
+    event->properties = n_proplist_new ();
+
+    if (rule_key)
+        n_proplist_set_string (event->rules, rule_key, rule_value);
+
+    n_proplist_set_string (event->properties, "sound.filename", filename);
+    n_proplist_set_bool   (event->properties, "sound.repeat", FALSE);
+    n_proplist_set_string (event->properties, "sound.stream.event.id", name);
+    n_proplist_set_string (event->properties, "sound.stream.media.role", "alarm");
+    n_proplist_set_string (event->properties, "vibra.pattern", "PatternIncomingMessage");
+    n_proplist_set_string (event->properties, "led.pattern", "PatternCommunication");
+    n_proplist_set_bool   (event->properties, "mce.backlight_on", TRUE);
+    n_proplist_set_uint   (event->properties, "core.max_timeout", 30000);
+
+    return event;
+}
+
+static void
+add_events ()
+{
+    BenchEvent *event = NULL;
+    NValue     *value = NULL;
+    gchar      *file  = NULL;
+    guint       i;
+
+    /* every event has a default and a profile specific variant, so each
+       lookup evaluates a context rule as well. */
+
+    for (i = 0; i < bench.mix->len; ++i) {
+        event = &g_array_index (bench.mix, BenchEvent, i);
+
+        file = g_strdup_printf ("/usr/share/sounds/%s.wav", event->name);
+        n_core_add_event (bench.core, create_event (event->name, NULL, NULL, file));
+        n_core_add_event (bench.core, create_event (event->name,
+            "context@profile.current_profile", "meeting", file));
+        g_free (file);
+    }
+
+    value = n_value_new ();
+    n_value_set_string (value, "general");
+    n_context_set_value (bench.core->context, "profile.current_profile", value);
+}
+
+static gboolean
+parse_mix (const char *str)
+{
+    gchar     **items = NULL;
+    gchar     **item  = NULL;
+    gchar     **pair  = NULL;
+    BenchEvent  event;
+
+    items = g_strsplit (str, ",", -1);
+    for (item = items; *item; ++item) {
+        pair = g_strsplit (*item, "=", 2);
+        event.name   = g_strdup (g_strstrip (pair[0]));
+        event.weight = pair[1] ? (guint) atoi (pair[1]) : 1;
+        g_strfreev (pair);
+
+        if (event.name[0] == '\0' || event.weight == 0) {
+            g_free (event.name);
+            continue;
+        }
+
+        g_array_append_val (bench.mix, event);
+        bench.total_weight += event.weight;
+    }
+    g_strfreev (items);
+
+    return bench.total_weight > 0;
+}
+
+static int
+compare_samples (const void *a, const void *b)
+{
+    gint64 sa = *(const gint64*) a;
+    gint64 sb = *(const gint64*) b;
+
+    return (sa > sb) ? 1 : ((sa < sb) ? -1 : 0);
+}
+
+static double
+percentile (const gint64 *samples, guint count, double p)
+{
+    guint index = (guint) (p * (count - 1) + 0.5);
+    return samples[index] / 1000.0;
+}
+
+static void
+report (gint64 elapsed, gint allocs)
+{
+    guint stage;
+
+    printf ("core benchmark, %u requests, %u in flight, %s\n", bench.requests,
+        bench.concurrency, bench.rate ? "rate limited" : "back to back");
+
+    if (bench.rate)
+        printf ("offered    : %u requests/s\n", bench.rate);
+
+    printf ("throughput : %.0f requests/s (%.2f ms)\n",
+        bench.finished * 1000000000.0 / elapsed, elapsed / 1000000.0);
+    printf ("failed     : %u\n", bench.failed);
+
+#ifdef HAVE_ALLOC_COUNT
+    printf ("allocs     : %.1f per request\n",
+        bench.finished ? (double) allocs / bench.finished : 0.0);
+#else
+    (void) allocs;
+    printf ("allocs     : not available\n");
+#endif
+
+    if (bench.finished == 0)
+        return;
+
+    printf ("\n%-12s %10s %10s %10s %10s (us)\n", "stage", "p50", "p99", "p999", "max");
+    for (stage = 0; stage < STAGE_LAST; ++stage) {
+        qsort (bench.samples[stage], bench.finished, sizeof (gint64), compare_samples);
+        printf ("%-12s %10.1f %10.1f %10.1f %10.1f\n", stage_names[stage],
+            percentile (bench.samples[stage], bench.finished, 0.50),
+            percentile (bench.samples[stage], bench.finished, 0.99),
+            percentile (bench.samples[stage], bench.finished, 0.999),
+            bench.samples[stage][bench.finished - 1] / 1000.0);
+    }
+}
+
+static void
+usage (const char *name)
+{
+    printf ("usage: %s [options]\n"
+            "  -n, --requests=N     requests to run (default %d)\n"
+            "  -c, --concurrency=N  maximum requests in flight (default %d)\n"
+            "  -r, --rate=N         requests per second, 0 for back to back (default 0)\n"
+            "  -m, --mix=MIX        event mix as name=weight,... (default %s)\n",
+            name, DEFAULT_REQUESTS, DEFAULT_CONCURRENCY, DEFAULT_MIX);
+}
+
+static gboolean
+parse_cmdline (int argc, char **argv)
+{
+    const char *mix = DEFAULT_MIX;
+    int         opt, opt_index;
+
+    static struct option long_opts[] = {
+        { "requests",    1, 0, 'n' },
+        { "concurrency", 1, 0, 'c' },
+        { "rate",        1, 0, 'r' },
+        { "mix",         1, 0, 'm' },
+        { "help",        0, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    bench.requests    = DEFAULT_REQUESTS;
+    bench.concurrency = DEFAULT_CONCURRENCY;
+    bench.rate        = 0;
+
+    while ((opt = getopt_long (argc, argv, "n:c:r:m:h", long_opts, &opt_index)) != -1) {
+        switch (opt) {
+            case 'n': bench.requests    = (guint) atoi (optarg); break;
+            case 'c': bench.concurrency = (guint) atoi (optarg); break;
+            case 'r': bench.rate        = (guint) atoi (optarg); break;
+            case 'm': mix               = optarg;                break;
+            default:
+                usage (argv[0]);
+                return FALSE;
+        }
+    }
+
+    if (bench.requests == 0 || bench.concurrency == 0) {
+        usage (argv[0]);
+        return FALSE;
+    }
+
+    if (!parse_mix (mix)) {
+        fprintf (stderr, "invalid event mix '%s'\n", mix);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+int
+main (int argc, char *argv[])
+{
+    static const NSinkInterfaceDecl sink_decl = {
+        .name       = "bench",
+        .initialize = NULL,
+        .shutdown   = NULL,
+        .can_handle = NULL,
+        .prepare    = sink_prepare,
+        .play       = sink_play,
+        .pause      = sink_pause,
+        .stop       = sink_stop
+    };
+
+    static const NInputInterfaceDecl input_decl = {
+        .name       = "bench",
+        .initialize = NULL,
+        .shutdown   = NULL,
+        .send_error = input_send_error,
+        .send_reply = input_send_reply
+    };
+
+    gint64 elapsed = 0;
+    gint   allocs  = 0;
+    guint  stage;
+
+    /* count what the code allocates, not what the slice allocator
+       happens to have cached. */
+
+    g_setenv ("G_SLICE", "always-malloc", TRUE);
+
+    bench.mix = g_array_new (FALSE, FALSE, sizeof (BenchEvent));
+    if (!parse_cmdline (argc, argv))
+        return EXIT_FAILURE;
+
+    n_log_initialize (N_LOG_LEVEL_WARNING);
+
+    bench.loop  = g_main_loop_new (NULL, FALSE);
+    bench.rand  = g_rand_new_with_seed (42);
+    bench.core  = n_core_new (NULL, NULL);
+    bench.input = n_core_register_input (bench.core, &input_decl);
+    n_core_register_sink (bench.core, &sink_decl);
+    add_events ();
+
+    bench.data   = g_new0 (BenchRequest, bench.requests);
+    bench.active = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (stage = 0; stage < STAGE_LAST; ++stage)
+        bench.samples[stage] = g_new0 (gint64, bench.requests);
+
+    bench.started = now_ns ();
+    alloc_count   = 0;
+
+    if (bench.rate > 0)
+        bench.rate_source_id = g_timeout_add (1, rate_cb, NULL);
+    else {
+        while (bench.in_flight < bench.concurrency && bench.submitted < bench.requests)
+            submit_next ();
+    }
+
+    g_main_loop_run (bench.loop);
+
+    allocs  = g_atomic_int_get (&alloc_count);
+    elapsed = now_ns () - bench.started;
+
+    report (elapsed, allocs);
+
+    for (stage = 0; stage < STAGE_LAST; ++stage)
+        g_free (bench.samples[stage]);
+    g_hash_table_destroy (bench.active);
+    g_free (bench.data);
+
+    n_core_free (bench.core);
+    for (stage = 0; stage < bench.mix->len; ++stage)
+        g_free (g_array_index (bench.mix, BenchEvent, stage).name);
+
+    g_array_free (bench.mix, TRUE);
+    g_rand_free (bench.rand);
+    g_main_loop_unref (bench.loop);
+
+    return bench.failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
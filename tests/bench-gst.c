@@ -0,0 +1,292 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "src/include/ngf/log.h"
+#include "src/plugins/gst/audio-format.h"
+
+#define DEFAULT_ITERATIONS 50
+#define PREROLL_TIMEOUT    (5 * GST_SECOND)
+
+/* preroll time of the gst sink pipelines, autoplugged with decodebin2
+   against the fixed chain of the sniffed format. the converter is
+   followed by a fakesink, the audio output is not part of the numbers.
+
+   cold   : create the pipeline and take it from NULL to PAUSED
+   pooled : take a reused pipeline from READY to PAUSED, as the sink does
+            with the pipelines from its pool */
+
+enum
+{
+    MODE_AUTOPLUG = 0,
+    MODE_FIXED,
+    MODE_LAST
+};
+
+static const char *mode_names[MODE_LAST] = {
+    "decodebin2",
+    "fixed"
+};
+
+typedef struct _Samples
+{
+    gdouble total;
+    gdouble max;
+    guint   count;
+    guint   failed;
+} Samples;
+
+static gint64
+now_us ()
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (gint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+static void
+samples_add (Samples *samples, gint64 elapsed_us)
+{
+    gdouble ms = elapsed_us / 1000.0;
+
+    samples->total += ms;
+    samples->count++;
+    if (ms > samples->max)
+        samples->max = ms;
+}
+
+static void
+new_decoded_pad_cb (GstElement *element, GstPad *pad, gboolean is_last,
+                    gpointer userdata)
+{
+    GstElement *convert  = (GstElement*) userdata;
+    GstPad     *sink_pad = NULL;
+
+    (void) element;
+    (void) is_last;
+
+    sink_pad = gst_element_get_static_pad (convert, "sink");
+    if (!gst_pad_is_linked (sink_pad))
+        (void) gst_pad_link (pad, sink_pad);
+    gst_object_unref (sink_pad);
+}
+
+static GstElement*
+create_pipeline (const char *filename, AudioFormat format, guint mode)
+{
+    GstElement *pipeline = NULL, *source = NULL, *decoder = NULL,
+        *convert = NULL, *sink = NULL;
+
+    pipeline = gst_pipeline_new (NULL);
+    source = gst_element_factory_make ("filesrc", NULL);
+    convert = gst_element_factory_make ("audioconvert", NULL);
+    sink = gst_element_factory_make ("fakesink", NULL);
+
+    if (!pipeline || !source || !convert || !sink)
+        g_error ("failed to create filesrc, audioconvert or fakesink");
+
+    g_object_set (G_OBJECT (source), "location", filename, NULL);
+    gst_bin_add_many (GST_BIN (pipeline), source, convert, sink, NULL);
+
+    if (!gst_element_link (convert, sink))
+        goto failed;
+
+    if (mode == MODE_FIXED) {
+        if (!audio_format_build_chain (format, GST_BIN (pipeline), source, convert))
+            goto failed;
+
+        return pipeline;
+    }
+
+    if ((decoder = gst_element_factory_make ("decodebin2", NULL)) == NULL)
+        goto failed;
+
+    gst_bin_add (GST_BIN (pipeline), decoder);
+    if (!gst_element_link (source, decoder))
+        goto failed;
+
+    g_signal_connect (G_OBJECT (decoder), "new-decoded-pad",
+        G_CALLBACK (new_decoded_pad_cb), convert);
+
+    return pipeline;
+
+failed:
+    gst_object_unref (pipeline);
+    return NULL;
+}
+
+static gboolean
+preroll (GstElement *pipeline)
+{
+    if (gst_element_set_state (pipeline, GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE)
+        return FALSE;
+
+    return gst_element_get_state (pipeline, NULL, NULL, PREROLL_TIMEOUT)
+        == GST_STATE_CHANGE_SUCCESS;
+}
+
+static void
+run_cold (const char *filename, AudioFormat format, guint mode,
+          guint iterations, Samples *samples)
+{
+    GstElement *pipeline = NULL;
+    gint64      start;
+    guint       i;
+
+    for (i = 0; i < iterations; ++i) {
+        start = now_us ();
+
+        if ((pipeline = create_pipeline (filename, format, mode)) == NULL) {
+            samples->failed++;
+            continue;
+        }
+
+        if (preroll (pipeline))
+            samples_add (samples, now_us () - start);
+        else
+            samples->failed++;
+
+        gst_element_set_state (pipeline, GST_STATE_NULL);
+        gst_object_unref (pipeline);
+    }
+}
+
+static void
+run_pooled (const char *filename, AudioFormat format, guint mode,
+            guint iterations, Samples *samples)
+{
+    GstElement *pipeline = NULL;
+    gint64      start;
+    guint       i;
+
+    if ((pipeline = create_pipeline (filename, format, mode)) == NULL) {
+        samples->failed += iterations;
+        return;
+    }
+
+    gst_element_set_state (pipeline, GST_STATE_READY);
+
+    for (i = 0; i < iterations; ++i) {
+        start = now_us ();
+
+        if (preroll (pipeline))
+            samples_add (samples, now_us () - start);
+        else
+            samples->failed++;
+
+        gst_element_set_state (pipeline, GST_STATE_READY);
+    }
+
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (pipeline);
+}
+
+static void
+print_samples (const char *name, const char *mode, const char *run,
+               const Samples *samples)
+{
+    if (samples->count == 0) {
+        printf ("%-28s %-10s %-7s %10s %10s %7u\n", name, mode, run,
+            "-", "-", samples->failed);
+        return;
+    }
+
+    printf ("%-28s %-10s %-7s %10.2f %10.2f %7u\n", name, mode, run,
+        samples->total / samples->count, samples->max, samples->failed);
+}
+
+static void
+bench_file (const char *filename, guint iterations)
+{
+    AudioFormat  format;
+    Samples      cold;
+    Samples      pooled;
+    gchar       *name = NULL;
+    guint        mode;
+
+    format = audio_format_sniff_file (filename);
+    name = g_path_get_basename (filename);
+
+    for (mode = 0; mode < MODE_LAST; ++mode) {
+        if (mode == MODE_FIXED && !audio_format_is_available (format)) {
+            printf ("%-28s %-10s no fixed chain for '%s'\n", name,
+                mode_names[mode], audio_format_get_name (format));
+            continue;
+        }
+
+        memset (&cold, 0, sizeof (cold));
+        memset (&pooled, 0, sizeof (pooled));
+
+        /* warm up, loads the plugins and the file */
+        run_cold (filename, format, mode, 1, &cold);
+        memset (&cold, 0, sizeof (cold));
+
+        run_cold (filename, format, mode, iterations, &cold);
+        run_pooled (filename, format, mode, iterations, &pooled);
+
+        print_samples (name, mode_names[mode], "cold", &cold);
+        print_samples (name, mode_names[mode], "pooled", &pooled);
+    }
+
+    g_free (name);
+}
+
+static void
+usage (const char *name)
+{
+    printf ("usage: %s [options] file...\n"
+            "  -n, --iterations=N   prerolls per file and pipeline (%d)\n"
+            "  -h, --help           show this help\n",
+        name, DEFAULT_ITERATIONS);
+}
+
+int
+main (int argc, char *argv[])
+{
+    static struct option long_opts[] = {
+        { "iterations", 1, 0, 'n' },
+        { "help",       0, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    guint iterations = DEFAULT_ITERATIONS;
+    int   opt;
+    int   i;
+
+    gst_init (&argc, &argv);
+
+    while ((opt = getopt_long (argc, argv, "n:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                iterations = (guint) atoi (optarg);
+                break;
+            case 'h':
+                usage (argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage (argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (optind >= argc || iterations == 0) {
+        usage (argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    n_log_set_level (N_LOG_LEVEL_WARNING);
+
+    printf ("gst preroll benchmark, %u iterations\n\n", iterations);
+    printf ("%-28s %-10s %-7s %10s %10s %7s\n", "file", "pipeline", "run",
+        "avg (ms)", "max (ms)", "failed");
+
+    for (i = optind; i < argc; ++i)
+        bench_file (argv[i], iterations);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <glib.h>
+
+#include "src/include/ngf/log.h"
+#include "src/include/ngf/proplist.h"
+#include "src/ngf/proplist-internal.h"
+
+#define DEFAULT_ITERATIONS 100000
+
+static const char *event_keys[] = {
+    "sound.filename",
+    "sound.repeat",
+    "sound.volume",
+    "sound.stream.event.id",
+    "sound.stream.media.role",
+    "sound.stream.module-stream-restore.id",
+    "vibra.pattern",
+    "vibra.repeat",
+    "led.pattern",
+    "mce.backlight_on",
+    "play.timeout",
+    "core.max_timeout",
+    NULL
+};
+
+static const char *request_keys[] = {
+    "dbus.event.client",
+    "media.audio",
+    "media.vibra",
+    "media.leds",
+    "media.backlight",
+    "sound.volume",
+    NULL
+};
+
+static double
+timespec_to_ms (const struct timespec *ts)
+{
+    return ts->tv_sec * 1000.0 + ts->tv_nsec / 1000000.0;
+}
+
+static NProplist*
+create_event_properties ()
+{
+    NProplist   *props = n_proplist_new ();
+    const char **key   = NULL;
+
+    for (key = event_keys; *key; ++key)
+        n_proplist_set_string (props, *key, *key);
+
+    return props;
+}
+
+static double
+run (guint array_limit, guint iterations)
+{
+    NProplist   *event    = NULL;
+    NProplist   *request  = NULL;
+    NProplist   *merged   = NULL;
+    NProplist   *original = NULL;
+    const char **key      = NULL;
+    struct timespec start, end;
+    guint i;
+
+    n_proplist_set_array_limit (array_limit);
+    event = create_event_properties ();
+
+    clock_gettime (CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < iterations; ++i) {
+        /* what a single request does to properties on its way through the
+           core: parse, copy, merge with event and look keys up. */
+
+        request = n_proplist_new ();
+        for (key = request_keys; *key; ++key)
+            n_proplist_set_bool (request, *key, TRUE);
+        n_proplist_set_uint (request, "dbus.event.id", i + 1);
+
+        original = n_proplist_copy (request);
+        merged = n_proplist_copy (event);
+        n_proplist_merge (merged, request);
+
+        for (key = event_keys; *key; ++key)
+            (void) n_proplist_get (merged, *key);
+
+        if (!n_proplist_match_exact (original, request))
+            g_error ("copy does not match");
+
+        n_proplist_free (merged);
+        n_proplist_free (original);
+        n_proplist_free (request);
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &end);
+
+    n_proplist_free (event);
+    return timespec_to_ms (&end) - timespec_to_ms (&start);
+}
+
+int
+main (int argc, char *argv[])
+{
+    guint  iterations = DEFAULT_ITERATIONS;
+    double array_ms   = 0.0;
+    double hash_ms    = 0.0;
+
+    if (argc > 1)
+        iterations = (guint) atoi (argv[1]);
+
+    if (iterations == 0)
+        iterations = DEFAULT_ITERATIONS;
+
+    n_log_set_level (N_LOG_LEVEL_WARNING);
+
+    /* warm up, interns the keys */
+    (void) run (N_PROPLIST_DEFAULT_ARRAY_LIMIT, 100);
+
+    hash_ms  = run (0, iterations);
+    array_ms = run (N_PROPLIST_DEFAULT_ARRAY_LIMIT, iterations);
+
+    printf ("proplist benchmark, %u iterations\n", iterations);
+    printf ("hash table : %8.2f ms (%.0f ns/iteration)\n", hash_ms,
+        hash_ms * 1000000.0 / iterations);
+    printf ("array      : %8.2f ms (%.0f ns/iteration)\n", array_ms,
+        array_ms * 1000000.0 / iterations);
+
+    return EXIT_SUCCESS;
+}
@@ -60,37 +60,37 @@ START_TEST (test_subscribe_unsubscribe_value_change)
     /* subscribe */
     result = n_context_subscribe_value_change (NULL, key, n_context_callback, NULL);
     fail_unless (result == FALSE);
-    item = g_list_length (context->subscribers);
+    item = context->num_subscribers;
     fail_unless (item == 0);
     result = n_context_subscribe_value_change (context, key, NULL, NULL);
     fail_unless (result == FALSE);
-    item = g_list_length (context->subscribers);
+    item = context->num_subscribers;
     fail_unless (item == 0);
     /* proper subscribtion */
     result = n_context_subscribe_value_change (context, key, n_context_callback, NULL);
     fail_unless (result == TRUE);
-    item = g_list_length (context->subscribers);
+    item = context->num_subscribers;
     fail_unless (item == 1);
 
     /* unsubscribe */
     n_context_unsubscribe_value_change (NULL, key, n_context_callback);
-    item = g_list_length (context->subscribers);
+    item = context->num_subscribers;
     fail_unless (item == 1);
     n_context_unsubscribe_value_change (context, NULL, n_context_callback);
-    item = g_list_length (context->subscribers);
+    item = context->num_subscribers;
     fail_unless (item == 1);
     n_context_unsubscribe_value_change (context, key, NULL);
-    item = g_list_length (context->subscribers);
+    item = context->num_subscribers;
     fail_unless (item == 1);
     /* proper unsubscribtion */
     n_context_unsubscribe_value_change (context, key, n_context_callback);
-    item = g_list_length (context->subscribers);
+    item = context->num_subscribers;
     fail_unless (item == 0);
 
     /* subscribe callback to key=NULL */
     result = n_context_subscribe_value_change (context, NULL, n_context_callback, NULL);
     fail_unless (result == TRUE);
-    item = g_list_length (context->subscribers);
+    item = context->num_subscribers;
     fail_unless (item == 1);
     /*
      * TODO: unsubscribe callback when key=NULL
@@ -101,6 +101,173 @@ START_TEST (test_subscribe_unsubscribe_value_change)
 }
 END_TEST
 
+static int  num_value_changes = 0;
+static int  num_batches       = 0;
+static int  num_batch_keys    = 0;
+
+static void
+count_value_cb (NContext *context, const char *key, const NValue *old_value,
+                const NValue *new_value, void *userdata)
+{
+    (void) context;
+    (void) key;
+    (void) new_value;
+    (void) userdata;
+
+    /* batched changes report the value from before the batch */
+    if (g_str_equal (key, "a"))
+        fail_unless (old_value == NULL);
+
+    ++num_value_changes;
+}
+
+static void
+count_batch_cb (NContext *context, GList *keys, void *userdata)
+{
+    (void) context;
+    (void) userdata;
+
+    ++num_batches;
+    num_batch_keys += g_list_length (keys);
+}
+
+START_TEST (test_batch)
+{
+    NContext *context = NULL;
+    NValue   *value   = NULL;
+    guint     generation = 0;
+
+    context = n_context_new ();
+    n_context_subscribe_value_change (context, "a", count_value_cb, NULL);
+    n_context_subscribe_value_change (context, NULL, count_value_cb, NULL);
+    n_context_subscribe_batch_change (context, count_batch_cb, NULL);
+
+    value = n_value_new ();
+    n_value_set_int (value, 5);
+    n_context_set_value (context, "b", value);
+
+    /* single set outside a batch is a batch of one */
+    fail_unless (num_value_changes == 1);
+    fail_unless (num_batches == 1 && num_batch_keys == 1);
+    num_value_changes = num_batches = num_batch_keys = 0;
+
+    generation = n_context_get_generation (context);
+    n_context_begin_batch (context);
+    n_context_begin_batch (context);
+
+    value = n_value_new ();
+    n_value_set_int (value, 1);
+    n_context_set_value (context, "a", value);
+    value = n_value_new ();
+    n_value_set_int (value, 2);
+    n_context_set_value (context, "a", value);
+    value = n_value_new ();
+    n_value_set_int (value, 5);
+    n_context_set_value (context, "b", value);
+    value = n_value_new ();
+    n_value_set_int (value, 3);
+    n_context_set_value (context, "c", value);
+
+    /* values are visible right away, notifications are held back */
+    fail_unless (n_value_get_int ((NValue*) n_context_get_value (context, "a")) == 2);
+    fail_unless (n_context_get_generation (context) != generation);
+    n_context_commit_batch (context);
+    fail_unless (num_value_changes == 0 && num_batches == 0);
+
+    /* "a" twice, "b" unchanged, "c": a and c for the all keys subscriber
+       plus a for the keyed one */
+    n_context_commit_batch (context);
+    fail_unless (num_value_changes == 3);
+    fail_unless (num_batches == 1);
+    fail_unless (num_batch_keys == 2);
+
+    /* unbalanced commit is ignored */
+    n_context_commit_batch (context);
+    fail_unless (num_batches == 1);
+
+    n_context_unsubscribe_batch_change (context, count_batch_cb);
+    fail_unless (context->num_subscribers == 2);
+    n_context_unsubscribe_value_change (context, "a", count_value_cb);
+    fail_unless (context->num_subscribers == 1);
+    fail_unless (g_hash_table_size (context->subscribers) == 0);
+
+    n_context_free (context);
+}
+END_TEST
+
+static GString *notify_order = NULL;
+
+static void
+order_first_cb (NContext *context, const char *key, const NValue *old_value,
+                const NValue *new_value, void *userdata)
+{
+    (void) context;
+    (void) key;
+    (void) old_value;
+    (void) new_value;
+    (void) userdata;
+
+    g_string_append (notify_order, "1");
+}
+
+static void
+order_second_cb (NContext *context, const char *key, const NValue *old_value,
+                 const NValue *new_value, void *userdata)
+{
+    (void) key;
+    (void) old_value;
+    (void) new_value;
+    (void) userdata;
+
+    /* removes the subscriber that would run next */
+    g_string_append (notify_order, "2");
+    n_context_unsubscribe_value_change (context, "a", order_first_cb);
+}
+
+static void
+order_third_cb (NContext *context, const char *key, const NValue *old_value,
+                const NValue *new_value, void *userdata)
+{
+    (void) context;
+    (void) key;
+    (void) old_value;
+    (void) new_value;
+    (void) userdata;
+
+    g_string_append (notify_order, "3");
+}
+
+START_TEST (test_notify_order)
+{
+    NContext *context = n_context_new ();
+    NValue   *value   = NULL;
+
+    notify_order = g_string_new (NULL);
+
+    /* subscribers are notified in subscription order, whether they
+       subscribed to the key or to all keys */
+    n_context_subscribe_value_change (context, NULL, order_third_cb, NULL);
+    n_context_subscribe_value_change (context, "a", order_second_cb, NULL);
+    n_context_subscribe_value_change (context, "a", order_first_cb, NULL);
+
+    value = n_value_new ();
+    n_value_set_int (value, 1);
+    n_context_set_value (context, "a", value);
+    fail_unless (g_str_equal (notify_order->str, "32"));
+    fail_unless (context->num_subscribers == 2);
+    fail_unless (context->num_dead == 0);
+
+    g_string_truncate (notify_order, 0);
+    value = n_value_new ();
+    n_value_set_int (value, 2);
+    n_context_set_value (context, "a", value);
+    fail_unless (g_str_equal (notify_order->str, "32"));
+
+    g_string_free (notify_order, TRUE);
+    n_context_free (context);
+}
+END_TEST
+
 int
 main (int argc, char *argv[])
 {
@@ -122,6 +289,14 @@ main (int argc, char *argv[])
     tcase_add_test (tc, test_subscribe_unsubscribe_value_change);
     suite_add_tcase (s, tc);
 
+    tc = tcase_create ("batched value changes");
+    tcase_add_test (tc, test_batch);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("notify order");
+    tcase_add_test (tc, test_notify_order);
+    suite_add_tcase (s, tc);
+
     sr = srunner_create (s);
     srunner_run_all (sr, CK_NORMAL);
     num_failed = srunner_ntests_failed (sr);
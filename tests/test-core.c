@@ -1,4 +1,8 @@
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <check.h>
 
 #include "ngf/core.h"
@@ -44,17 +48,63 @@ START_TEST (test_get_requests)
 {
     NCore *core = NULL;
     fail_unless (n_core_get_requests (core) == NULL);
+    fail_unless (n_core_lookup_request (core, 1) == NULL);
     core = n_core_new (NULL, NULL);
     fail_unless (core != NULL);
     fail_unless (n_core_get_requests (core) == NULL);
-    NRequest *request = n_request_new ();
-    GList *list = NULL;
-    list = g_list_append (list, request);
-    core->requests = list;
+
+    NRequest *sms = n_request_new_with_event ("sms");
+    n_request_set_id (sms, 1);
+    n_request_set_client (sms, ":1.1");
+    NRequest *ringtone = n_request_new_with_event ("ringtone");
+    n_request_set_id (ringtone, 2);
+    n_request_set_client (ringtone, ":1.2");
+    NRequest *other_sms = n_request_new_with_event ("sms");
+    n_request_set_id (other_sms, 3);
+    n_request_set_client (other_sms, ":1.1");
+
+    n_request_registry_add (core->requests, sms);
+    n_request_registry_add (core->requests, ringtone);
+    n_request_registry_add (core->requests, other_sms);
+    n_request_registry_add (core->requests, sms);
+
+    /* all requests in the order they were added */
     GList *received_list = n_core_get_requests (core);
-    fail_unless (received_list != NULL);
-    fail_unless (received_list == list);
+    fail_unless (g_list_length (received_list) == 3);
+    fail_unless (received_list->data == sms);
+    fail_unless (g_list_last (received_list)->data == other_sms);
+
+    fail_unless (n_core_lookup_request (core, 2) == ringtone);
+    fail_unless (n_core_lookup_request (core, 4) == NULL);
+    fail_unless (n_core_lookup_request (core, 0) == NULL);
+
+    GList *by_client = n_core_get_requests_by_client (core, ":1.1");
+    fail_unless (g_list_length (by_client) == 2);
+    fail_unless (by_client->data == sms && by_client->next->data == other_sms);
+    fail_unless (n_core_get_requests_by_client (core, ":1.3") == NULL);
+
+    GList *by_name = n_core_get_requests_by_name (core, "ringtone");
+    fail_unless (g_list_length (by_name) == 1 && by_name->data == ringtone);
+
+    /* removing keeps the other indexes intact */
+    n_request_registry_remove (core->requests, sms);
+    n_request_registry_remove (core->requests, sms);
+    fail_unless (n_request_registry_size (core->requests) == 2);
+    fail_unless (n_core_lookup_request (core, 1) == NULL);
+    by_client = n_core_get_requests_by_client (core, ":1.1");
+    fail_unless (g_list_length (by_client) == 1 && by_client->data == other_sms);
+    by_name = n_core_get_requests_by_name (core, "sms");
+    fail_unless (g_list_length (by_name) == 1 && by_name->data == other_sms);
+
+    n_request_registry_remove (core->requests, other_sms);
+    n_request_registry_remove (core->requests, ringtone);
+    fail_unless (n_core_get_requests (core) == NULL);
+    fail_unless (n_core_get_requests_by_client (core, ":1.1") == NULL);
+    fail_unless (n_core_get_requests_by_name (core, "ringtone") == NULL);
 
+    n_request_free (sms);
+    n_request_free (ringtone);
+    n_request_free (other_sms);
     n_core_free (core);
     core = NULL;
 }
@@ -90,6 +140,569 @@ START_TEST (test_add_get_events)
 }
 END_TEST
 
+static NEvent*
+create_event (const char *name, const char *key, const char *value,
+              const char *key2, const char *value2)
+{
+    NEvent *event = n_event_new ();
+    event->name = g_strdup (name);
+    event->rules = n_proplist_new ();
+    event->properties = n_proplist_new ();
+    if (key)
+        n_proplist_set_string (event->rules, key, value);
+    if (key2)
+        n_proplist_set_string (event->rules, key2, value2);
+    return event;
+}
+
+static void
+set_context_string (NCore *core, const char *key, const char *str)
+{
+    NValue *value = n_value_new ();
+    n_value_set_string (value, str);
+    n_context_set_value (core->context, key, value);
+}
+
+START_TEST (test_evaluate_request)
+{
+    NCore *core = NULL;
+    core = n_core_new (NULL, NULL);
+    fail_unless (core != NULL);
+
+    NEvent *silent = create_event ("sms", "type", "alert",
+        "context@profile.current", "silent");
+    NEvent *alert = create_event ("sms", "type", "alert", NULL, NULL);
+    NEvent *fallback = create_event ("sms", NULL, NULL, NULL, NULL);
+    NEvent *any = create_event ("ring", "tone", "*", NULL, NULL);
+
+    n_core_add_event (core, fallback);
+    n_core_add_event (core, alert);
+    n_core_add_event (core, silent);
+    n_core_add_event (core, any);
+
+    NRequest *request = n_request_new_with_event ("sms");
+    NProplist *props = n_proplist_new ();
+    n_proplist_set_string (props, "type", "alert");
+    n_request_set_properties (request, props);
+
+    /* context rule does not match, less specific event is selected */
+    set_context_string (core, "profile.current", "general");
+    fail_unless (n_core_evaluate_request (core, request) == alert);
+
+    /* context change is noticed without recompiling */
+    set_context_string (core, "profile.current", "silent");
+    fail_unless (n_core_evaluate_request (core, request) == silent);
+
+    /* no matching rules, default event */
+    n_proplist_set_string (props, "type", "other");
+    n_request_set_properties (request, props);
+    fail_unless (n_core_evaluate_request (core, request) == fallback);
+
+    /* event added after compiling the rules is taken into account */
+    NEvent *other = create_event ("sms", "type", "other", NULL, NULL);
+    n_core_add_event (core, other);
+    fail_unless (n_core_evaluate_request (core, request) == other);
+
+    /* wildcard matches even if the key is not set */
+    NRequest *ring = n_request_new_with_event ("ring");
+    fail_unless (n_core_evaluate_request (core, ring) == any);
+
+    /* unknown event */
+    NRequest *unknown = n_request_new_with_event ("unknown");
+    fail_unless (n_core_evaluate_request (core, unknown) == NULL);
+
+    n_proplist_free (props);
+    n_request_free (request);
+    n_request_free (ring);
+    n_request_free (unknown);
+    n_core_free (core);
+    core = NULL;
+}
+END_TEST
+
+static NRequest*
+create_request (const char *name, const char *type, guint id)
+{
+    NRequest *request = n_request_new_with_event (name);
+    request->properties = n_proplist_new ();
+    n_proplist_set_string (request->properties, "type", type);
+    n_proplist_set_uint (request->properties, "dbus.event.id", id);
+    request->original_properties = n_proplist_copy (request->properties);
+    return request;
+}
+
+START_TEST (test_request_cache)
+{
+    NCore *core = NULL;
+    core = n_core_new (NULL, NULL);
+    fail_unless (core != NULL);
+
+    NEvent *alert = create_event ("sms", "type", "alert", NULL, NULL);
+    n_core_add_event (core, alert);
+    n_core_add_volatile_key (core, "dbus.event.id");
+
+    NRequestCache *cache = core->request_cache;
+    guint generation = n_context_get_generation (core->context);
+
+    /* first request is resolved and stored */
+    NRequest *first = create_request ("sms", "alert", 1);
+    fail_unless (n_request_cache_lookup (cache, first, generation) == FALSE);
+    fail_unless (n_request_cache_get_misses (cache) == 1);
+    first->event = n_event_ref (alert);
+    n_proplist_set_string (first->properties, "sound.filename", "alert.wav");
+    n_request_cache_store (cache, first, generation);
+
+    /* same request with a different id is served from the cache, with
+       its own id */
+    NRequest *second = create_request ("sms", "alert", 2);
+    fail_unless (n_request_cache_lookup (cache, second, generation) == TRUE);
+    fail_unless (n_request_cache_get_hits (cache) == 1);
+    fail_unless (second->event == alert);
+    fail_unless (g_strcmp0 (n_proplist_get_string (second->properties, "sound.filename"), "alert.wav") == 0);
+    fail_unless (n_proplist_get_uint (second->properties, "dbus.event.id") == 2);
+
+    /* different properties */
+    NRequest *other = create_request ("sms", "other", 3);
+    fail_unless (n_request_cache_lookup (cache, other, generation) == FALSE);
+
+    /* context change invalidates the results */
+    set_context_string (core, "profile.current", "silent");
+    fail_unless (n_context_get_generation (core->context) != generation);
+    generation = n_context_get_generation (core->context);
+    NRequest *third = create_request ("sms", "alert", 4);
+    fail_unless (n_request_cache_lookup (cache, third, generation) == FALSE);
+    fail_unless (n_request_cache_get_misses (cache) == 3);
+
+    /* requests with pointer values are never cached, they count as
+       misses */
+    NRequest *uncacheable = create_request ("sms", "alert", 5);
+    n_proplist_set_pointer (uncacheable->original_properties, "pointer", uncacheable);
+    fail_unless (n_request_cache_lookup (cache, uncacheable, generation) == FALSE);
+    fail_unless (n_request_cache_get_misses (cache) == 4);
+    n_request_free (uncacheable);
+
+    /* disabled cache */
+    third->event = n_event_ref (alert);
+    n_request_cache_set_max_entries (cache, 0);
+    n_request_cache_store (cache, third, generation);
+    fail_unless (n_request_cache_lookup (cache, second, generation) == FALSE);
+    fail_unless (n_request_cache_get_misses (cache) == 4);
+
+    n_request_free (first);
+    n_request_free (second);
+    n_request_free (other);
+    n_request_free (third);
+    n_core_free (core);
+    core = NULL;
+}
+END_TEST
+
+static void
+write_file (const char *path, const char *content)
+{
+    FILE *fp = fopen (path, "w");
+    fail_unless (fp != NULL);
+    fputs (content, fp);
+    fclose (fp);
+}
+
+static NCore*
+create_core_with_conf_path (const char *path)
+{
+    NCore *core = n_core_new (NULL, NULL);
+    g_free (core->conf_path);
+    core->conf_path = g_strdup (path);
+    return core;
+}
+
+START_TEST (test_config_cache)
+{
+    gchar tmpdir[] = "/tmp/ngfd-test-XXXXXX";
+    fail_unless (mkdtemp (tmpdir) != NULL);
+    gchar *source = g_build_filename (tmpdir, "ngfd.ini", NULL);
+    gchar *missing = g_build_filename (tmpdir, "missing.ini", NULL);
+    gchar *filename = g_build_filename (tmpdir, "config.cache", NULL);
+    write_file (source, "[general]\n");
+
+    /* build the configuration by hand and store it */
+    NCore *core = create_core_with_conf_path (tmpdir);
+    core->required_plugins = g_list_append (NULL, g_strdup ("dbus"));
+    core->sink_order = g_list_append (NULL, g_strdup ("gst"));
+    g_hash_table_replace (core->key_types, g_strdup ("sound.repeat"),
+        GINT_TO_POINTER (N_VALUE_TYPE_BOOL));
+    NProplist *params = n_proplist_new ();
+    n_proplist_set_string (params, "allow", "*");
+    g_hash_table_replace (core->plugin_params, g_strdup ("dbus"), params);
+    n_request_scheduler_set_sink_limit (core->scheduler, "gst", 3);
+    n_request_scheduler_set_queue_timeout (core->scheduler, 500);
+    core->record_level = N_LOG_LEVEL_DEBUG;
+    NEvent *event = create_event ("sms", "type", "alert", NULL, NULL);
+    n_proplist_set_string (event->properties, "sound.filename", "alert.wav");
+    n_proplist_set_bool (event->properties, "sound.repeat", TRUE);
+    n_core_add_event (core, event);
+
+    NConfigCache *cache = n_config_cache_new ();
+    n_config_cache_add_source (cache, source);
+    n_config_cache_add_source (cache, missing);
+    fail_unless (n_config_cache_save (cache, core, filename) == TRUE);
+    n_config_cache_free (cache);
+    n_core_free (core);
+
+    /* load it back */
+    core = create_core_with_conf_path (tmpdir);
+    fail_unless (n_config_cache_load (core, filename) == TRUE);
+    fail_unless (g_list_length (core->required_plugins) == 1);
+    fail_unless (g_strcmp0 (core->required_plugins->data, "dbus") == 0);
+    fail_unless (g_strcmp0 (core->sink_order->data, "gst") == 0);
+    fail_unless (GPOINTER_TO_INT (g_hash_table_lookup (core->key_types, "sound.repeat")) == N_VALUE_TYPE_BOOL);
+    params = g_hash_table_lookup (core->plugin_params, "dbus");
+    fail_unless (g_strcmp0 (n_proplist_get_string (params, "allow"), "*") == 0);
+    fail_unless (n_request_scheduler_get_sink_limit (core->scheduler, "gst") == 3);
+    fail_unless (n_request_scheduler_get_queue_timeout (core->scheduler) == 500);
+    fail_unless (core->record_level == N_LOG_LEVEL_DEBUG);
+    fail_unless (g_list_length (core->event_list) == 1);
+    event = (NEvent*) core->event_list->data;
+    fail_unless (g_strcmp0 (event->name, "sms") == 0);
+    fail_unless (g_strcmp0 (n_proplist_get_string (event->rules, "type"), "alert") == 0);
+    fail_unless (g_strcmp0 (n_proplist_get_string (event->properties, "sound.filename"), "alert.wav") == 0);
+    fail_unless (n_proplist_get_bool (event->properties, "sound.repeat") == TRUE);
+    fail_unless (g_hash_table_lookup (core->event_table, "sms") != NULL);
+    n_core_free (core);
+
+    /* cache for another configuration path is not used */
+    core = create_core_with_conf_path ("/nonexistent");
+    fail_unless (n_config_cache_load (core, filename) == FALSE);
+    fail_unless (core->event_list == NULL);
+    n_core_free (core);
+
+    /* source that did not exist appears */
+    write_file (missing, "[general]\n");
+    core = create_core_with_conf_path (tmpdir);
+    fail_unless (n_config_cache_load (core, filename) == FALSE);
+    fail_unless (core->required_plugins == NULL);
+    n_core_free (core);
+    unlink (missing);
+
+    /* changed source */
+    write_file (source, "[general]\nplugins = gst\n");
+    core = create_core_with_conf_path (tmpdir);
+    fail_unless (n_config_cache_load (core, filename) == FALSE);
+    n_core_free (core);
+
+    unlink (filename);
+    unlink (source);
+    rmdir (tmpdir);
+    g_free (filename);
+    g_free (missing);
+    g_free (source);
+}
+END_TEST
+
+static guint events_added = 0;
+static guint events_removed = 0;
+
+static void
+events_changed_cb (NHook *hook, void *data, void *userdata)
+{
+    (void) hook;
+    (void) userdata;
+
+    NCoreHookEventsChangedData *changed = (NCoreHookEventsChangedData*) data;
+    events_added   += g_list_length (changed->added);
+    events_removed += g_list_length (changed->removed);
+}
+
+START_TEST (test_event_reload)
+{
+    gchar tmpdir[] = "/tmp/ngfd-test-XXXXXX";
+    fail_unless (mkdtemp (tmpdir) != NULL);
+    gchar *events_path = g_build_filename (tmpdir, "events.d", NULL);
+    fail_unless (mkdir (events_path, 0700) == 0);
+    gchar *sms_file = g_build_filename (events_path, "sms.ini", NULL);
+    gchar *email_file = g_build_filename (events_path, "email.ini", NULL);
+    write_file (sms_file, "[sms]\nsound.filename = sms.wav\n");
+    write_file (email_file, "[email]\nsound.filename = email.wav\n");
+
+    NCore *core = create_core_with_conf_path (tmpdir);
+    n_core_connect (core, N_CORE_HOOK_EVENTS_CHANGED, 0, events_changed_cb, NULL);
+    NEventReload *reload = n_event_reload_new (core);
+
+    /* nothing known yet, everything is added */
+    n_event_reload_files (reload, NULL, FALSE);
+    fail_unless (events_added == 2 && events_removed == 0);
+    fail_unless (g_list_length (core->event_list) == 2);
+
+    GList *sms_list = g_hash_table_lookup (core->event_table, "sms");
+    GList *email_list = g_hash_table_lookup (core->event_table, "email");
+    fail_unless (sms_list != NULL && email_list != NULL);
+    NEvent *old_sms = n_event_ref ((NEvent*) sms_list->data);
+    NEvent *email = (NEvent*) email_list->data;
+
+    /* unchanged file does not replace anything */
+    events_added = 0;
+    GList *changed = g_list_append (NULL, email_file);
+    n_event_reload_files (reload, changed, FALSE);
+    fail_unless (events_added == 0 && events_removed == 0);
+    email_list = g_hash_table_lookup (core->event_table, "email");
+    fail_unless (email_list->data == email);
+
+    /* changed file replaces only its events, the old event stays valid
+       for whoever still holds it */
+    write_file (sms_file, "[sms]\nsound.filename = new.wav\n\n[sms => type=alert]\nsound.filename = alert.wav\n");
+    g_list_free (changed);
+    changed = g_list_append (NULL, sms_file);
+    n_event_reload_files (reload, changed, FALSE);
+    fail_unless (events_added == 2 && events_removed == 1);
+    fail_unless (g_list_length (core->event_list) == 3);
+    sms_list = g_hash_table_lookup (core->event_table, "sms");
+    fail_unless (g_list_length (sms_list) == 2);
+    fail_unless (g_list_find (core->event_list, old_sms) == NULL);
+
+    /* the new definitions take the place of the old one, most specific
+       first */
+    GList *first = g_list_find (core->event_list, sms_list->data);
+    fail_unless (first != NULL && first->next != NULL);
+    fail_unless (first->next->data == sms_list->next->data);
+    fail_unless (n_proplist_size (((NEvent*) first->data)->rules) == 1);
+    fail_unless (g_strcmp0 (n_proplist_get_string (old_sms->properties, "sound.filename"), "sms.wav") == 0);
+    email_list = g_hash_table_lookup (core->event_table, "email");
+    fail_unless (email_list->data == email);
+    n_event_unref (old_sms);
+
+    /* new rules are evaluated after the reload */
+    NRequest *request = n_request_new_with_event ("sms");
+    request->properties = n_proplist_new ();
+    n_proplist_set_string (request->properties, "type", "alert");
+    NEvent *found = n_core_evaluate_request (core, request);
+    fail_unless (found != NULL);
+    fail_unless (g_strcmp0 (n_proplist_get_string (found->properties, "sound.filename"), "alert.wav") == 0);
+    n_request_free (request);
+
+    /* removed file removes its events */
+    events_added = events_removed = 0;
+    unlink (sms_file);
+    n_event_reload_files (reload, changed, FALSE);
+    fail_unless (events_added == 0 && events_removed == 2);
+    fail_unless (g_hash_table_lookup (core->event_table, "sms") == NULL);
+    fail_unless (g_list_length (core->event_list) == 1);
+
+    g_list_free (changed);
+    n_event_reload_free (reload);
+    n_core_free (core);
+
+    unlink (email_file);
+    rmdir (events_path);
+    rmdir (tmpdir);
+    g_free (email_file);
+    g_free (sms_file);
+    g_free (events_path);
+}
+END_TEST
+
+static gboolean trace_request_done = FALSE;
+
+static int
+trace_sink_prepare (NSinkInterface *iface, NRequest *request)
+{
+    n_sink_interface_synchronize (iface, request);
+    return TRUE;
+}
+
+static gboolean
+trace_sink_complete_cb (gpointer userdata)
+{
+    NRequest *request = (NRequest*) userdata;
+    n_sink_interface_complete (request->core->sinks[0], request);
+    return FALSE;
+}
+
+static int
+trace_sink_play (NSinkInterface *iface, NRequest *request)
+{
+    (void) iface;
+    g_idle_add (trace_sink_complete_cb, request);
+    return TRUE;
+}
+
+static void
+trace_sink_stop (NSinkInterface *iface, NRequest *request)
+{
+    (void) iface;
+    (void) request;
+}
+
+static void
+trace_send_reply (NInputInterface *iface, NRequest *request, int ret_code)
+{
+    (void) iface;
+    (void) request;
+
+    if (ret_code == N_CORE_EVENT_COMPLETED)
+        trace_request_done = TRUE;
+}
+
+static void
+trace_hook_cb (NHook *hook, void *data, void *userdata)
+{
+    (void) hook;
+    (void) data;
+    (void) userdata;
+}
+
+START_TEST (test_request_trace)
+{
+    static const NSinkInterfaceDecl sink_decl = {
+        .name    = "trace",
+        .prepare = trace_sink_prepare,
+        .play    = trace_sink_play,
+        .stop    = trace_sink_stop
+    };
+
+    static const NInputInterfaceDecl input_decl = {
+        .name       = "trace",
+        .send_reply = trace_send_reply
+    };
+
+    gchar tmpdir[] = "/tmp/ngfd-test-XXXXXX";
+    fail_unless (mkdtemp (tmpdir) != NULL);
+
+    NCore *core = n_core_new (NULL, NULL);
+    g_free (core->trace_file);
+    core->trace_file = g_build_filename (tmpdir, "trace.json", NULL);
+
+    /* nothing to write while tracing is disabled */
+    fail_unless (n_core_dump_traces (core) == FALSE);
+    core->trace_log = n_trace_log_new (2);
+
+    NEvent *event = create_event ("sms", NULL, NULL, NULL, NULL);
+    n_core_add_event (core, event);
+    n_core_register_sink (core, &sink_decl);
+    NInputInterface *input = n_core_register_input (core, &input_decl);
+    n_core_connect (core, N_CORE_HOOK_TRANSFORM_PROPERTIES, 0, trace_hook_cb, NULL);
+
+    /* more requests than the log keeps, only the latest two are written.
+       requests differ so that each one is resolved again. */
+    guint i;
+    for (i = 0; i < 3; ++i) {
+        NRequest *request = n_request_new_with_event ("sms");
+        request->properties  = n_proplist_new ();
+        request->input_iface = input;
+        request->id          = i + 1;
+        n_proplist_set_uint (request->properties, "test.index", i);
+        fail_unless (request->received > 0);
+
+        trace_request_done = FALSE;
+        n_core_play_request (core, request);
+        while (!trace_request_done)
+            g_main_context_iteration (NULL, TRUE);
+    }
+
+    fail_unless (n_core_dump_traces (core) == TRUE);
+
+    gchar *contents = NULL;
+    fail_unless (g_file_get_contents (core->trace_file, &contents, NULL, NULL));
+    fail_unless (strstr (contents, "\"traceEvents\"") != NULL);
+    fail_unless (strstr (contents, "\"args\":{\"id\":1}") == NULL);
+    fail_unless (strstr (contents, "\"args\":{\"id\":2}") != NULL);
+    fail_unless (strstr (contents, "\"args\":{\"id\":3}") != NULL);
+    fail_unless (strstr (contents, "\"name\":\"evaluate\"") != NULL);
+    fail_unless (strstr (contents, "\"name\":\"trace prepare\"") != NULL);
+    fail_unless (strstr (contents, "\"name\":\"trace synchronizing\"") != NULL);
+    fail_unless (strstr (contents, "\"name\":\"trace playing\"") != NULL);
+    fail_unless (strstr (contents, "\"name\":\"transform_properties\"") != NULL);
+    fail_unless (strstr (contents, "\"callback\":") != NULL);
+    fail_unless (strstr (contents, "\"failed\":false") != NULL);
+    g_free (contents);
+
+    unlink (core->trace_file);
+    rmdir (tmpdir);
+    n_core_free (core);
+}
+END_TEST
+
+static GString *startup_order = NULL;
+static GMutex   startup_lock;
+
+static gboolean
+startup_task_cb (gpointer userdata)
+{
+    const char *name = (const char*) userdata;
+
+    g_mutex_lock (&startup_lock);
+    g_string_append (startup_order, name);
+    g_mutex_unlock (&startup_lock);
+
+    /* task named with an upper case letter fails */
+    return g_ascii_islower (name[0]) ? TRUE : FALSE;
+}
+
+START_TEST (test_startup)
+{
+    NStartup     *startup = NULL;
+    NStartupTask *a = NULL, *b = NULL, *c = NULL, *d = NULL;
+
+    g_mutex_init (&startup_lock);
+    startup_order = g_string_new (NULL);
+
+    /* tasks run after their dependencies */
+    startup = n_startup_new (2);
+    c = n_startup_add_task (startup, "c", 0, startup_task_cb, "c");
+    a = n_startup_add_task (startup, "a", N_STARTUP_TASK_THREADED, startup_task_cb, "a");
+    b = n_startup_add_task (startup, "b", 0, startup_task_cb, "b");
+    d = n_startup_add_task (startup, "d", N_STARTUP_TASK_THREADED, startup_task_cb, "d");
+    n_startup_task_depends_on (c, a);
+    n_startup_task_depends_on (d, c);
+
+    fail_unless (n_startup_run (startup) == TRUE);
+    fail_unless (strlen (startup_order->str) == 4);
+    fail_unless (strchr (startup_order->str, 'a') < strchr (startup_order->str, 'c'));
+    fail_unless (strchr (startup_order->str, 'c') < strchr (startup_order->str, 'd'));
+    fail_unless (n_startup_task_succeeded (a) && n_startup_task_succeeded (b));
+    fail_unless (n_startup_task_succeeded (c) && n_startup_task_succeeded (d));
+    fail_unless (n_startup_task_was_threaded (a) == TRUE);
+    fail_unless (n_startup_task_was_threaded (b) == FALSE);
+    fail_unless (n_startup_task_get_duration (a) >= 0);
+    n_startup_free (startup);
+
+    /* optional task fails, the task depending on it is skipped */
+    g_string_truncate (startup_order, 0);
+    startup = n_startup_new (2);
+    a = n_startup_add_task (startup, "A", N_STARTUP_TASK_THREADED, startup_task_cb, "A");
+    b = n_startup_add_task (startup, "b", 0, startup_task_cb, "b");
+    n_startup_task_depends_on (b, a);
+    fail_unless (n_startup_run (startup) == TRUE);
+    fail_unless (n_startup_task_succeeded (a) == FALSE);
+    fail_unless (n_startup_task_succeeded (b) == FALSE);
+    fail_unless (g_str_equal (startup_order->str, "A"));
+    n_startup_free (startup);
+
+    /* required task fails, rest of the startup is aborted */
+    g_string_truncate (startup_order, 0);
+    startup = n_startup_new (0);
+    a = n_startup_add_task (startup, "A", N_STARTUP_TASK_REQUIRED, startup_task_cb, "A");
+    b = n_startup_add_task (startup, "b", 0, startup_task_cb, "b");
+    fail_unless (n_startup_run (startup) == FALSE);
+    fail_unless (n_startup_task_succeeded (b) == FALSE);
+    fail_unless (g_str_equal (startup_order->str, "A"));
+    n_startup_free (startup);
+
+    /* dependency cycle does not hang the startup */
+    startup = n_startup_new (2);
+    a = n_startup_add_task (startup, "a", 0, startup_task_cb, "a");
+    b = n_startup_add_task (startup, "b", N_STARTUP_TASK_THREADED, startup_task_cb, "b");
+    n_startup_task_depends_on (a, b);
+    n_startup_task_depends_on (b, a);
+    (void) n_startup_run (startup);
+    fail_unless (n_startup_task_succeeded (a) == FALSE);
+    fail_unless (n_startup_task_succeeded (b) == FALSE);
+    n_startup_free (startup);
+
+    g_string_free (startup_order, TRUE);
+    startup_order = NULL;
+    g_mutex_clear (&startup_lock);
+}
+END_TEST
+
 static void callback (NHook *hook, void *data, void *userdata)
 {
     (void) hook;
@@ -167,6 +780,440 @@ START_TEST (test_connect)
 }
 END_TEST
 
+static void
+slow_hook_cb (NHook *hook, void *data, void *userdata)
+{
+    (void) hook;
+    (void) data;
+    (void) userdata;
+
+    g_usleep (2000);
+}
+
+static void
+collect_hook_stats_cb (NHook *hook, const NHookSlotStats *stats, void *userdata)
+{
+    (void) hook;
+
+    *((GList**) userdata) = g_list_append (*((GList**) userdata), (gpointer) stats);
+}
+
+START_TEST (test_hook_stats)
+{
+    NCore *core = n_core_new (NULL, NULL);
+    GList *stats = NULL;
+    const NHookSlotStats *slow = NULL;
+    const NHookSlotStats *fast = NULL;
+
+    /* core default budget applies to callbacks connected after it is set */
+    core->hook_budget = 1000;
+    n_core_connect (core, N_CORE_HOOK_TRANSFORM_PROPERTIES, 10, slow_hook_cb, NULL);
+    n_core_connect (core, N_CORE_HOOK_TRANSFORM_PROPERTIES, 0, callback, NULL);
+    fail_unless (n_hook_set_budget (&core->hooks[N_CORE_HOOK_TRANSFORM_PROPERTIES],
+        callback, NULL, 0) == TRUE);
+    fail_unless (n_hook_set_budget (&core->hooks[N_CORE_HOOK_TRANSFORM_PROPERTIES],
+        callback, core, 0) == FALSE);
+
+    n_hook_fire_full (&core->hooks[N_CORE_HOOK_TRANSFORM_PROPERTIES], NULL,
+        "sms", NULL, NULL);
+    n_core_fire_hook (core, N_CORE_HOOK_TRANSFORM_PROPERTIES, NULL);
+
+    n_core_foreach_hook_stats (core, collect_hook_stats_cb, &stats);
+    fail_unless (g_list_length (stats) == 2);
+    slow = (const NHookSlotStats*) g_list_nth_data (stats, 0);
+    fast = (const NHookSlotStats*) g_list_nth_data (stats, 1);
+
+    fail_unless (slow->callback == slow_hook_cb);
+    fail_unless (slow->owner == NULL);
+    fail_unless (slow->count == 2);
+    fail_unless (slow->budget == 1000);
+    fail_unless (slow->max_time >= 2000);
+    fail_unless (slow->total_time >= 4000);
+    fail_unless (slow->overruns == 2);
+
+    fail_unless (fast->callback == callback);
+    fail_unless (fast->count == 2);
+    fail_unless (fast->budget == 0);
+    fail_unless (fast->overruns == 0);
+
+    n_core_dump_hook_stats (core);
+
+    /* reset keeps the budget */
+    n_hook_reset_stats (&core->hooks[N_CORE_HOOK_TRANSFORM_PROPERTIES]);
+    fail_unless (slow->count == 0 && slow->total_time == 0 && slow->overruns == 0);
+    fail_unless (slow->budget == 1000);
+
+    g_list_free (stats);
+    n_core_disconnect (core, N_CORE_HOOK_TRANSFORM_PROPERTIES, slow_hook_cb, NULL);
+    n_core_disconnect (core, N_CORE_HOOK_TRANSFORM_PROPERTIES, callback, NULL);
+    n_core_free (core);
+}
+END_TEST
+
+#define PLAY_NONE  -2
+#define PLAY_ERROR -1
+
+static int play_status[16];
+
+static int
+play_sink_prepare (NSinkInterface *iface, NRequest *request)
+{
+    n_sink_interface_synchronize (iface, request);
+    return TRUE;
+}
+
+static int
+play_sink_play (NSinkInterface *iface, NRequest *request)
+{
+    /* keeps playing until stopped */
+    (void) iface;
+    (void) request;
+    return TRUE;
+}
+
+static void
+play_sink_stop (NSinkInterface *iface, NRequest *request)
+{
+    (void) iface;
+    (void) request;
+}
+
+static void
+play_send_reply (NInputInterface *iface, NRequest *request, int ret_code)
+{
+    (void) iface;
+    play_status[request->id] = ret_code;
+}
+
+static void
+play_send_error (NInputInterface *iface, NRequest *request, const char *err_msg)
+{
+    (void) iface;
+    (void) err_msg;
+    play_status[request->id] = PLAY_ERROR;
+}
+
+static NRequest*
+play_event (NCore *core, NInputInterface *input, const char *name,
+            const char *client, guint id, gint64 received)
+{
+    NRequest *request = n_request_new_with_event (name);
+    request->properties  = n_proplist_new ();
+    request->input_iface = input;
+    request->id          = id;
+    n_request_set_client (request, client);
+    if (received > 0)
+        request->received = received;
+
+    play_status[id] = PLAY_NONE;
+    n_core_play_request (core, request);
+    while (g_main_context_iteration (NULL, FALSE))
+        ;
+
+    return n_core_lookup_request (core, id);
+}
+
+START_TEST (test_admission)
+{
+    static const NSinkInterfaceDecl sink_decl = {
+        .name    = "admission",
+        .prepare = play_sink_prepare,
+        .play    = play_sink_play,
+        .stop    = play_sink_stop
+    };
+
+    static const NInputInterfaceDecl input_decl = {
+        .name       = "admission",
+        .send_reply = play_send_reply,
+        .send_error = play_send_error
+    };
+
+    NCore    *core    = n_core_new (NULL, NULL);
+    NEvent   *event   = NULL;
+    NRequest *first   = NULL;
+    gint64    now     = 0;
+
+    event = create_event ("tap", NULL, NULL, NULL, NULL);
+    n_proplist_set_int (event->properties, "core.max_in_flight", 1);
+    n_proplist_set_string (event->properties, "core.coalesce", "retrigger");
+    n_core_add_event (core, event);
+
+    event = create_event ("swipe", NULL, NULL, NULL, NULL);
+    n_proplist_set_int (event->properties, "core.max_in_flight", 1);
+    n_proplist_set_string (event->properties, "core.coalesce", "supersede");
+    n_core_add_event (core, event);
+
+    event = create_event ("knock", NULL, NULL, NULL, NULL);
+    n_proplist_set_int (event->properties, "core.min_interval", 10000);
+    n_core_add_event (core, event);
+
+    n_core_register_sink (core, &sink_decl);
+    NInputInterface *input = n_core_register_input (core, &input_decl);
+
+    /* retrigger, the second request is absorbed by the first one */
+    first = play_event (core, input, "tap", "a", 1, 0);
+    fail_unless (first != NULL);
+    fail_unless (play_status[1] == N_CORE_EVENT_PLAYING);
+    fail_unless (play_event (core, input, "tap", "b", 2, 0) == NULL);
+    fail_unless (play_status[2] == N_CORE_EVENT_COMPLETED);
+    fail_unless (n_core_lookup_request (core, 1) == first);
+    fail_unless (n_request_admission_get_coalesced (core->admission) == 1);
+
+    /* supersede, only the previous request of the same client */
+    fail_unless (play_event (core, input, "swipe", "a", 3, 0) != NULL);
+    fail_unless (play_event (core, input, "swipe", "a", 4, 0) != NULL);
+    fail_unless (play_status[3] == N_CORE_EVENT_COMPLETED);
+    fail_unless (n_core_lookup_request (core, 3) == NULL);
+    fail_unless (play_event (core, input, "swipe", "b", 5, 0) == NULL);
+    fail_unless (play_status[5] == PLAY_ERROR);
+    fail_unless (n_request_admission_get_coalesced (core->admission) == 2);
+    fail_unless (n_request_admission_get_dropped (core->admission) == 1);
+
+    /* minimum interval applies even when nothing is playing */
+    now = g_get_monotonic_time () * 1000;
+    fail_unless (play_event (core, input, "knock", "a", 6, now) != NULL);
+    n_core_stop_request (core, n_core_lookup_request (core, 6), 0);
+    while (g_main_context_iteration (NULL, FALSE))
+        ;
+    fail_unless (play_status[6] == N_CORE_EVENT_COMPLETED);
+    fail_unless (play_event (core, input, "knock", "a", 7, now + 1000000) == NULL);
+    fail_unless (play_status[7] == PLAY_ERROR);
+    fail_unless (play_event (core, input, "knock", "a", 8, now + G_GINT64_CONSTANT (10000000000)) != NULL);
+    fail_unless (n_request_admission_get_dropped (core->admission) == 2);
+
+    /* policies are read again once the events change */
+    n_proplist_set_int (event->properties, "core.min_interval", 0);
+    n_core_add_event (core, create_event ("ping", NULL, NULL, NULL, NULL));
+    fail_unless (play_event (core, input, "knock", "a", 9, now + G_GINT64_CONSTANT (10000000001)) != NULL);
+
+    n_core_free (core);
+}
+END_TEST
+
+START_TEST (test_scheduler)
+{
+    static const NSinkInterfaceDecl sink_decl = {
+        .name    = "limited",
+        .prepare = play_sink_prepare,
+        .play    = play_sink_play,
+        .stop    = play_sink_stop
+    };
+
+    static const NInputInterfaceDecl input_decl = {
+        .name       = "scheduler",
+        .send_reply = play_send_reply,
+        .send_error = play_send_error
+    };
+
+    NCore           *core   = n_core_new (NULL, NULL);
+    NEvent          *event  = NULL;
+    NRequest        *queued = NULL;
+    NSchedulerStats  stats;
+
+    event = create_event ("tap", NULL, NULL, NULL, NULL);
+    n_proplist_set_int (event->properties, "core.priority", 10);
+    n_core_add_event (core, event);
+
+    event = create_event ("ringtone", NULL, NULL, NULL, NULL);
+    n_proplist_set_int (event->properties, "core.priority", 40);
+    n_core_add_event (core, event);
+
+    event = create_event ("alarm", NULL, NULL, NULL, NULL);
+    n_proplist_set_int (event->properties, "core.priority", 20);
+    n_core_add_event (core, event);
+
+    n_request_scheduler_set_sink_limit (core->scheduler, "limited", 1);
+    n_request_scheduler_set_max_queued (core->scheduler, 1);
+    n_request_scheduler_set_queue_timeout (core->scheduler, 0);
+
+    n_core_register_sink (core, &sink_decl);
+    NInputInterface *input = n_core_register_input (core, &input_decl);
+
+    /* higher priority takes the sink from a lower one */
+    fail_unless (play_event (core, input, "tap", "a", 1, 0) != NULL);
+    fail_unless (play_status[1] == N_CORE_EVENT_PLAYING);
+    fail_unless (play_event (core, input, "ringtone", "a", 2, 0) != NULL);
+    fail_unless (play_status[2] == N_CORE_EVENT_PLAYING);
+    fail_unless (play_status[1] == N_CORE_EVENT_COMPLETED);
+
+    /* lower priority waits, until the queue is full */
+    queued = play_event (core, input, "tap", "a", 3, 0);
+    fail_unless (queued != NULL);
+    fail_unless (play_status[3] == PLAY_NONE);
+    fail_unless (n_request_scheduler_is_queued (queued));
+    fail_unless (n_core_pause_request (core, queued) == TRUE);
+    fail_unless (queued->is_paused == FALSE);
+    fail_unless (play_event (core, input, "tap", "a", 4, 0) == NULL);
+    fail_unless (play_status[4] == PLAY_ERROR);
+
+    n_request_scheduler_get_stats (core->scheduler, &stats);
+    fail_unless (stats.depth == 1);
+    fail_unless (stats.preempted == 1);
+    fail_unless (stats.shed == 1);
+
+    /* the waiting request starts once the sink is free */
+    n_core_stop_request (core, n_core_lookup_request (core, 2), 0);
+    while (g_main_context_iteration (NULL, FALSE))
+        ;
+    fail_unless (play_status[2] == N_CORE_EVENT_COMPLETED);
+    fail_unless (play_status[3] == N_CORE_EVENT_PLAYING);
+    fail_unless (!n_request_scheduler_is_queued (queued));
+
+    /* waiting requests time out */
+    n_request_scheduler_set_queue_timeout (core->scheduler, 1);
+    fail_unless (play_event (core, input, "tap", "a", 5, 0) != NULL);
+    while (play_status[5] == PLAY_NONE)
+        g_main_context_iteration (NULL, TRUE);
+    fail_unless (play_status[5] == PLAY_ERROR);
+
+    n_request_scheduler_get_stats (core->scheduler, &stats);
+    fail_unless (stats.depth == 0);
+    fail_unless (stats.max_depth == 1);
+    fail_unless (stats.queued == 2);
+    fail_unless (stats.waited == 1);
+    fail_unless (stats.expired == 1);
+    fail_unless (stats.max_wait >= 0 && stats.total_wait >= stats.max_wait);
+
+    /* a full queue pushes out a lower priority waiting request, the new
+       request is dropped only if it ranks lowest */
+    n_request_scheduler_set_queue_timeout (core->scheduler, 0);
+    fail_unless (play_event (core, input, "ringtone", "a", 6, 0) != NULL);
+    fail_unless (play_event (core, input, "tap", "a", 7, 0) != NULL);
+    queued = play_event (core, input, "alarm", "a", 8, 0);
+    fail_unless (queued != NULL);
+    fail_unless (n_request_scheduler_is_queued (queued));
+    fail_unless (play_status[7] == PLAY_ERROR);
+    fail_unless (n_core_lookup_request (core, 7) == NULL);
+    fail_unless (play_event (core, input, "tap", "a", 9, 0) == NULL);
+    fail_unless (play_status[9] == PLAY_ERROR);
+
+    n_request_scheduler_get_stats (core->scheduler, &stats);
+    fail_unless (stats.depth == 1);
+    fail_unless (stats.shed == 3);
+
+    /* a waiting request that is stopped is not started later */
+    n_core_stop_request (core, queued, 0);
+    fail_unless (!n_request_scheduler_is_queued (queued));
+    n_core_stop_request (core, n_core_lookup_request (core, 6), 0);
+    while (g_main_context_iteration (NULL, FALSE))
+        ;
+    fail_unless (play_status[6] == N_CORE_EVENT_COMPLETED);
+    fail_unless (play_status[8] != N_CORE_EVENT_PLAYING);
+    fail_unless (n_core_lookup_request (core, 8) == NULL);
+
+    n_request_scheduler_get_stats (core->scheduler, &stats);
+    fail_unless (stats.depth == 0);
+    fail_unless (stats.waited == 1);
+    n_core_dump_scheduler (core);
+
+    n_core_free (core);
+}
+END_TEST
+
+static NRequest *batch_held    = NULL;
+static GString  *batch_played  = NULL;
+
+static int
+batch_sink_prepare (NSinkInterface *iface, NRequest *request)
+{
+    /* "slow" requests are synchronized by the test */
+    if (g_strcmp0 (n_request_get_name (request), "slow") == 0)
+        batch_held = request;
+    else
+        n_sink_interface_synchronize (iface, request);
+    return TRUE;
+}
+
+static int
+batch_sink_play (NSinkInterface *iface, NRequest *request)
+{
+    (void) iface;
+    g_string_append_printf (batch_played, "%u;", request->id);
+    return TRUE;
+}
+
+START_TEST (test_play_batch)
+{
+    static const NSinkInterfaceDecl sink_decl = {
+        .name    = "batch",
+        .prepare = batch_sink_prepare,
+        .play    = batch_sink_play,
+        .stop    = play_sink_stop
+    };
+
+    static const NInputInterfaceDecl input_decl = {
+        .name       = "batch",
+        .send_reply = play_send_reply,
+        .send_error = play_send_error
+    };
+
+    NCore     *core     = n_core_new (NULL, NULL);
+    GList     *requests = NULL;
+    NRequest  *request  = NULL;
+    guint      i;
+
+    n_core_add_event (core, create_event ("fast", NULL, NULL, NULL, NULL));
+    n_core_add_event (core, create_event ("slow", NULL, NULL, NULL, NULL));
+    n_core_register_sink (core, &sink_decl);
+    NInputInterface *input = n_core_register_input (core, &input_decl);
+
+    batch_played = g_string_new (NULL);
+
+    /* the fast request waits until the slow one is synchronized, unknown
+       events fail without holding up the rest */
+    const char *names[] = { "fast", "slow", "unknown" };
+    for (i = 0; i < 3; ++i) {
+        request = n_request_new_with_event (names[i]);
+        request->properties  = n_proplist_new ();
+        request->input_iface = input;
+        request->id          = i + 1;
+        play_status[request->id] = PLAY_NONE;
+        requests = g_list_append (requests, request);
+    }
+
+    fail_unless (n_core_play_batch (core, requests) == TRUE);
+    g_list_free (requests);
+    while (g_main_context_iteration (NULL, FALSE))
+        ;
+
+    fail_unless (batch_held != NULL);
+    fail_unless (play_status[1] == N_CORE_EVENT_PLAYING);
+    fail_unless (play_status[3] == PLAY_ERROR);
+    fail_unless (batch_played->len == 0);
+
+    n_sink_interface_synchronize (core->sinks[0], batch_held);
+    while (g_main_context_iteration (NULL, FALSE))
+        ;
+    fail_unless (g_strcmp0 (batch_played->str, "1;2;") == 0);
+
+    /* stopping a waiting member releases the others */
+    g_string_truncate (batch_played, 0);
+    batch_held = NULL;
+    requests = NULL;
+    for (i = 0; i < 2; ++i) {
+        request = n_request_new_with_event (names[i]);
+        request->properties  = n_proplist_new ();
+        request->input_iface = input;
+        request->id          = i + 4;
+        requests = g_list_append (requests, request);
+    }
+
+    fail_unless (n_core_play_batch (core, requests) == TRUE);
+    g_list_free (requests);
+    while (g_main_context_iteration (NULL, FALSE))
+        ;
+    fail_unless (batch_played->len == 0);
+
+    n_core_stop_request (core, batch_held, 0);
+    while (g_main_context_iteration (NULL, FALSE))
+        ;
+    fail_unless (g_strcmp0 (batch_played->str, "4;") == 0);
+
+    g_string_free (batch_played, TRUE);
+    n_core_free (core);
+}
+END_TEST
+
 int
 main (int argc, char *argv[])
 {
@@ -196,9 +1243,49 @@ main (int argc, char *argv[])
     tcase_add_test (tc, test_add_get_events);
     suite_add_tcase (s, tc);
 
+    tc = tcase_create ("evaluate request");
+    tcase_add_test (tc, test_evaluate_request);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("configuration cache");
+    tcase_add_test (tc, test_config_cache);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("request cache");
+    tcase_add_test (tc, test_request_cache);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("event reload");
+    tcase_add_test (tc, test_event_reload);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("request trace");
+    tcase_add_test (tc, test_request_trace);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("startup scheduler");
+    tcase_add_test (tc, test_startup);
+    suite_add_tcase (s, tc);
+
     tc = tcase_create ("connect/disconnect callback to/from hook");
     tcase_add_test (tc, test_connect);
     suite_add_tcase (s, tc);
+
+    tc = tcase_create ("hook statistics");
+    tcase_add_test (tc, test_hook_stats);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("admission control");
+    tcase_add_test (tc, test_admission);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("sink scheduler");
+    tcase_add_test (tc, test_scheduler);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("play batch");
+    tcase_add_test (tc, test_play_batch);
+    suite_add_tcase (s, tc);
     
     sr = srunner_create (s);
     srunner_run_all (sr, CK_NORMAL);
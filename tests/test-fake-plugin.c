@@ -6,6 +6,32 @@ N_PLUGIN_NAME        ("test-fake")
 N_PLUGIN_VERSION     ("0.1")
 N_PLUGIN_DESCRIPTION ("Fake plugin for unit test purposes")
 
+static void
+fake_init_done_cb (NHook *hook, void *data, void *userdata)
+{
+    NCore  *core  = (NCore*) userdata;
+    NValue *value = NULL;
+
+    (void) hook;
+    (void) data;
+
+    value = n_value_new ();
+    n_value_set_bool (value, TRUE);
+    n_context_set_value (n_core_get_context (core), "fake.init_done", value);
+}
+
+static void
+fake_value_changed_cb (NContext *context, const char *key,
+                       const NValue *old_value, const NValue *new_value,
+                       void *userdata)
+{
+    (void) context;
+    (void) old_value;
+    (void) new_value;
+    (void) userdata;
+    N_DEBUG (LOG_CAT "value of '%s' changed", key);
+}
+
 static int
 fake_sink_initialize (NSinkInterface *iface)
 {
@@ -82,6 +108,11 @@ N_PLUGIN_LOAD (plugin)
     
     n_plugin_register_sink (plugin, &decl);
 
+    NCore *core = n_plugin_get_core (plugin);
+    (void) n_core_connect (core, N_CORE_HOOK_INIT_DONE, 0, fake_init_done_cb, core);
+    (void) n_context_subscribe_value_change (n_core_get_context (core),
+        "fake.value", fake_value_changed_cb, NULL);
+
     return TRUE;
 }
 
@@ -0,0 +1,281 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <check.h>
+
+#include "src/plugins/gst/audio-format.c"
+#include "src/plugins/gst/pcm-cache.c"
+
+static const guint8 wav_pcm[] = {
+    'R', 'I', 'F', 'F', 0x24, 0x00, 0x00, 0x00, 'W', 'A', 'V', 'E',
+    'f', 'm', 't', ' ', 0x10, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00
+};
+
+static const guint8 wav_mp3[] = {
+    'R', 'I', 'F', 'F', 0x24, 0x00, 0x00, 0x00, 'W', 'A', 'V', 'E',
+    'f', 'm', 't', ' ', 0x10, 0x00, 0x00, 0x00, 0x55, 0x00, 0x01, 0x00
+};
+
+static const guint8 wav_list[] = {
+    'R', 'I', 'F', 'F', 0x30, 0x00, 0x00, 0x00, 'W', 'A', 'V', 'E',
+    'L', 'I', 'S', 'T', 0x03, 0x00, 0x00, 0x00, 'a', 'b', 'c', 0x00,
+    'f', 'm', 't', ' ', 0x10, 0x00, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00
+};
+
+static const guint8 ogg_vorbis[] = {
+    'O', 'g', 'g', 'S', 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x01, 0x1e, 0x01, 'v', 'o', 'r', 'b', 'i', 's'
+};
+
+static const guint8 ogg_opus[] = {
+    'O', 'g', 'g', 'S', 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x01, 0x13, 'O', 'p', 'u', 's', 'H', 'e', 'a', 'd'
+};
+
+static const guint8 id3_tag[]   = { 'I', 'D', '3', 0x03, 0x00, 0x00 };
+static const guint8 mp3_frame[] = { 0xFF, 0xFB, 0x90, 0x64 };
+static const guint8 mp2_frame[] = { 0xFF, 0xFD, 0x90, 0x64 };
+static const guint8 adts[]      = { 0xFF, 0xF1, 0x50, 0x80 };
+static const guint8 garbage[]   = { 0x00, 0x01, 0x02, 0x03, 0x04 };
+
+static void
+write_file (const char *path, const guint8 *data, gsize size)
+{
+    FILE *fp = fopen (path, "w");
+    fail_unless (fp != NULL);
+    fail_unless (fwrite (data, 1, size, fp) == size);
+    fclose (fp);
+}
+
+START_TEST (test_sniff)
+{
+    fail_unless (audio_format_sniff (wav_pcm, sizeof (wav_pcm)) == AUDIO_FORMAT_WAV);
+    fail_unless (audio_format_sniff (wav_list, sizeof (wav_list)) == AUDIO_FORMAT_WAV);
+    fail_unless (audio_format_sniff (ogg_vorbis, sizeof (ogg_vorbis)) == AUDIO_FORMAT_VORBIS);
+    fail_unless (audio_format_sniff (id3_tag, sizeof (id3_tag)) == AUDIO_FORMAT_MP3);
+    fail_unless (audio_format_sniff (mp3_frame, sizeof (mp3_frame)) == AUDIO_FORMAT_MP3);
+    fail_unless (audio_format_sniff (adts, sizeof (adts)) == AUDIO_FORMAT_AAC);
+
+    /* compressed wav, other ogg codecs and other mpeg layers need the
+       autoplugger */
+    fail_unless (audio_format_sniff (wav_mp3, sizeof (wav_mp3)) == AUDIO_FORMAT_UNKNOWN);
+    fail_unless (audio_format_sniff (ogg_opus, sizeof (ogg_opus)) == AUDIO_FORMAT_UNKNOWN);
+    fail_unless (audio_format_sniff (mp2_frame, sizeof (mp2_frame)) == AUDIO_FORMAT_UNKNOWN);
+    fail_unless (audio_format_sniff (garbage, sizeof (garbage)) == AUDIO_FORMAT_UNKNOWN);
+
+    /* truncated headers */
+    fail_unless (audio_format_sniff (NULL, 0) == AUDIO_FORMAT_UNKNOWN);
+    fail_unless (audio_format_sniff (wav_pcm, 3) == AUDIO_FORMAT_UNKNOWN);
+    fail_unless (audio_format_sniff (wav_pcm, 18) == AUDIO_FORMAT_UNKNOWN);
+    fail_unless (audio_format_sniff (ogg_vorbis, 30) == AUDIO_FORMAT_UNKNOWN);
+
+    fail_unless (g_str_equal (audio_format_get_name (AUDIO_FORMAT_AAC), "aac"));
+    fail_unless (g_str_equal (audio_format_get_name (AUDIO_FORMAT_LAST), "unknown"));
+}
+END_TEST
+
+START_TEST (test_format_cache)
+{
+    gchar tmpdir[] = "/tmp/ngfd-test-XXXXXX";
+    fail_unless (mkdtemp (tmpdir) != NULL);
+    gchar *first = g_build_filename (tmpdir, "first.wav", NULL);
+    gchar *second = g_build_filename (tmpdir, "second.mp3", NULL);
+    gchar *third = g_build_filename (tmpdir, "third.aac", NULL);
+    FormatCacheStats stats;
+
+    write_file (first, wav_pcm, sizeof (wav_pcm));
+    write_file (second, mp3_frame, sizeof (mp3_frame));
+    write_file (third, adts, sizeof (adts));
+
+    FormatCache *cache = format_cache_new (2);
+
+    /* sniffed once, then known */
+    fail_unless (format_cache_lookup (cache, first) == AUDIO_FORMAT_WAV);
+    fail_unless (format_cache_lookup (cache, first) == AUDIO_FORMAT_WAV);
+    format_cache_get_stats (cache, &stats);
+    fail_unless (stats.misses == 1 && stats.hits == 1 && stats.entries == 1);
+
+    /* missing files are not remembered */
+    gchar *missing = g_build_filename (tmpdir, "missing.wav", NULL);
+    fail_unless (format_cache_lookup (cache, missing) == AUDIO_FORMAT_UNKNOWN);
+    format_cache_get_stats (cache, &stats);
+    fail_unless (stats.entries == 1);
+    g_free (missing);
+
+    /* a file replaced with another size is sniffed again */
+    write_file (first, id3_tag, sizeof (id3_tag));
+    fail_unless (format_cache_lookup (cache, first) == AUDIO_FORMAT_MP3);
+    format_cache_get_stats (cache, &stats);
+    fail_unless (stats.misses == 2 && stats.entries == 1);
+
+    /* a failed chain makes the file autoplugged until it changes */
+    format_cache_mark_failed (cache, first);
+    fail_unless (format_cache_lookup (cache, first) == AUDIO_FORMAT_UNKNOWN);
+    format_cache_get_stats (cache, &stats);
+    fail_unless (stats.failed == 1);
+
+    /* running over the limit starts over */
+    fail_unless (format_cache_lookup (cache, second) == AUDIO_FORMAT_MP3);
+    fail_unless (format_cache_lookup (cache, third) == AUDIO_FORMAT_AAC);
+    format_cache_get_stats (cache, &stats);
+    fail_unless (stats.entries == 1);
+
+    /* without a cache every lookup sniffs */
+    fail_unless (format_cache_lookup (NULL, third) == AUDIO_FORMAT_AAC);
+
+    format_cache_free (cache);
+
+    unlink (first);
+    unlink (second);
+    unlink (third);
+    rmdir (tmpdir);
+    g_free (first);
+    g_free (second);
+    g_free (third);
+}
+END_TEST
+
+static gchar*
+create_tone_file (const char *dir, const char *name, gsize size)
+{
+    gchar  *path = g_build_filename (dir, name, NULL);
+    guint8 *data = g_malloc0 (size);
+
+    write_file (path, data, size);
+    g_free (data);
+
+    return path;
+}
+
+static void
+store_tone (PcmCache *cache, const char *filename, gsize size)
+{
+    PcmCapture *capture = NULL;
+    GstBuffer  *buffer  = NULL;
+    GstCaps    *caps    = NULL;
+
+    capture = pcm_capture_new (cache, filename);
+    fail_unless (capture != NULL);
+
+    /* half in each buffer, as they would flow through the pad */
+    caps = gst_caps_new_simple ("audio/x-raw-int", NULL);
+
+    buffer = gst_buffer_new_and_alloc (size / 2);
+    gst_buffer_set_caps (buffer, caps);
+    pcm_capture_probe_cb (NULL, buffer, capture);
+    gst_buffer_unref (buffer);
+
+    buffer = gst_buffer_new_and_alloc (size - size / 2);
+    gst_buffer_set_caps (buffer, caps);
+    pcm_capture_probe_cb (NULL, buffer, capture);
+    gst_buffer_unref (buffer);
+
+    gst_caps_unref (caps);
+
+    pcm_cache_capture_finish (cache, capture, TRUE);
+}
+
+START_TEST (test_pcm_cache)
+{
+    gchar tmpdir[] = "/tmp/ngfd-test-XXXXXX";
+    fail_unless (mkdtemp (tmpdir) != NULL);
+    gchar *first = create_tone_file (tmpdir, "first.wav", 16);
+    gchar *second = create_tone_file (tmpdir, "second.wav", 16);
+    gchar *third = create_tone_file (tmpdir, "third.wav", 16);
+    gchar *large = create_tone_file (tmpdir, "large.wav", 2048);
+    PcmCacheStats stats;
+    PcmTone *tone = NULL;
+    PcmTone *held = NULL;
+
+    PcmCache *cache = pcm_cache_new (300, 1024, 2000);
+
+    /* nothing cached yet */
+    fail_unless (pcm_cache_lookup (cache, first) == NULL);
+
+    store_tone (cache, first, 100);
+    store_tone (cache, second, 100);
+    pcm_cache_get_stats (cache, &stats);
+    fail_unless (stats.stored == 2 && stats.entries == 2 && stats.size == 200);
+
+    /* buffers come back in play order */
+    tone = pcm_cache_lookup (cache, first);
+    fail_unless (tone != NULL);
+    fail_unless (pcm_tone_get_caps (tone) != NULL);
+    fail_unless (g_list_length (tone->buffers) == 2);
+    held = tone;
+
+    /* the least recently used tone makes room */
+    store_tone (cache, third, 150);
+    pcm_cache_get_stats (cache, &stats);
+    fail_unless (stats.evicted == 1 && stats.entries == 2 && stats.size == 250);
+    fail_unless (pcm_cache_lookup (cache, second) == NULL);
+    tone = pcm_cache_lookup (cache, third);
+    fail_unless (tone != NULL);
+    pcm_tone_unref (tone);
+
+    /* captures over the budget are rejected, files over the size limit
+       are not captured at all */
+    fail_unless (pcm_capture_new (cache, large) == NULL);
+    store_tone (cache, second, 400);
+    pcm_cache_get_stats (cache, &stats);
+    fail_unless (stats.rejected == 1 && stats.entries == 2);
+
+    /* a rewritten file drops its tone, players keep their reference */
+    g_free (create_tone_file (tmpdir, "first.wav", 32));
+    fail_unless (pcm_cache_lookup (cache, first) == NULL);
+    pcm_cache_get_stats (cache, &stats);
+    fail_unless (stats.entries == 1 && stats.size == 150);
+    fail_unless (pcm_tone_get_caps (held) != NULL);
+    pcm_tone_unref (held);
+
+    pcm_cache_get_stats (cache, &stats);
+    fail_unless (stats.hits == 2);
+
+    pcm_cache_free (cache);
+
+    unlink (first);
+    unlink (second);
+    unlink (third);
+    unlink (large);
+    rmdir (tmpdir);
+    g_free (first);
+    g_free (second);
+    g_free (third);
+    g_free (large);
+}
+END_TEST
+
+int
+main (int argc, char *argv[])
+{
+    int num_failed = 0;
+    Suite *s = NULL;
+    TCase *tc = NULL;
+    SRunner *sr = NULL;
+
+    gst_init (&argc, &argv);
+
+    s = suite_create ("\tGStreamer sink tests");
+
+    tc = tcase_create ("format sniffing");
+    tcase_add_test (tc, test_sniff);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("format cache");
+    tcase_add_test (tc, test_format_cache);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("pcm cache");
+    tcase_add_test (tc, test_pcm_cache);
+    suite_add_tcase (s, tc);
+
+    sr = srunner_create (s);
+    srunner_run_all (sr, CK_NORMAL);
+    num_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+
+    return num_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
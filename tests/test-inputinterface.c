@@ -116,6 +116,8 @@ START_TEST (test_play_pause_request)
     /* play */
     fail_unless (n_input_interface_play_request (NULL, request) == FALSE);
     fail_unless (n_input_interface_play_request (iface, NULL) == FALSE);
+    fail_unless (n_input_interface_play_batch (NULL, NULL) == FALSE);
+    fail_unless (n_input_interface_play_batch (iface, NULL) == FALSE);
     fail_unless (n_input_interface_play_request (iface, request) == TRUE);
     data = (Data*) n_request_get_data (request, DATA_KEY);
     fail_unless (data->state == PREPARED);
@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <check.h>
+
+#include "src/ngf/log.c"
+
+static const NLogRecord*
+last_record ()
+{
+    guint index = (guint) g_atomic_int_get (&_record_head) - 1;
+    return &_records[index & (N_LOG_RECORD_COUNT - 1)];
+}
+
+START_TEST (test_record)
+{
+    char  buf[N_LOG_LINE_SIZE];
+    char *str  = NULL;
+    guint head = 0;
+
+    n_log_set_target (N_LOG_TARGET_NONE);
+    n_log_set_level (N_LOG_LEVEL_NONE);
+    n_log_set_record_level (N_LOG_LEVEL_DEBUG);
+
+    /* messages below the record level are not recorded */
+    head = (guint) g_atomic_int_get (&_record_head);
+    N_ENTER ("enter");
+    fail_unless ((guint) g_atomic_int_get (&_record_head) == head);
+    fail_unless (n_log_enabled (N_LOG_LEVEL_DEBUG) == TRUE);
+    fail_unless (n_log_enabled (N_LOG_LEVEL_ENTER) == FALSE);
+
+    /* strings are copied, formatting is deferred */
+    str = g_strdup ("first");
+    N_DEBUG ("string %s, int %d, uint %u, %s", str, -5, 7, (const char*) NULL);
+    fail_unless (last_record ()->fmt != NULL);
+    str[0] = 'F';
+    n_log_format_record (last_record (), buf, sizeof (buf));
+    fail_unless (g_str_equal (buf, "string first, int -5, uint 7, (null)"));
+    g_free (str);
+
+    N_INFO ("%5.2f|%-4s|%*d|%lu|%lld|%x|%c|100%%", 1.5, "ab", 3, 7,
+        (unsigned long) 42, (long long) -1, 255, 'z');
+    n_log_format_record (last_record (), buf, sizeof (buf));
+    fail_unless (g_str_equal (buf, " 1.50|ab  |  7|42|-1|ff|z|100%"));
+
+    /* more arguments than fit in a record are formatted right away */
+    N_WARNING ("%d %d %d %d %d %d %d %d %d", 1, 2, 3, 4, 5, 6, 7, 8, 9);
+    fail_unless (last_record ()->fmt == NULL);
+    n_log_format_record (last_record (), buf, sizeof (buf));
+    fail_unless (g_str_equal (buf, "1 2 3 4 5 6 7 8 9"));
+
+    /* recorder disabled */
+    n_log_set_record_level (N_LOG_LEVEL_NONE);
+    head = (guint) g_atomic_int_get (&_record_head);
+    N_ERROR ("not recorded");
+    fail_unless ((guint) g_atomic_int_get (&_record_head) == head);
+    n_log_set_record_level (N_LOG_LEVEL_DEBUG);
+}
+END_TEST
+
+START_TEST (test_wrap)
+{
+    char  buf[N_LOG_LINE_SIZE];
+    guint i    = 0;
+    guint head = 0;
+
+    n_log_set_target (N_LOG_TARGET_NONE);
+    n_log_set_record_level (N_LOG_LEVEL_DEBUG);
+
+    for (i = 0; i < N_LOG_RECORD_COUNT + 10; ++i)
+        N_DEBUG ("message %u", i);
+
+    head = (guint) g_atomic_int_get (&_record_head);
+    n_log_format_record (last_record (), buf, sizeof (buf));
+    fail_unless (g_str_equal (buf, "message 521"));
+
+    /* the oldest records have been overwritten */
+    fail_unless (_records[head & (N_LOG_RECORD_COUNT - 1)].seq ==
+        (gint) (head - N_LOG_RECORD_COUNT + 1));
+
+    n_log_clear_recorder ();
+    fail_unless (last_record ()->seq == 0);
+}
+END_TEST
+
+static const char detach_fmt[] = "detached %d %s";
+
+START_TEST (test_detach)
+{
+    char  buf[N_LOG_LINE_SIZE];
+    const NLogRecord *kept = NULL;
+    const NLogRecord *detached = NULL;
+
+    n_log_set_target (N_LOG_TARGET_NONE);
+    n_log_set_record_level (N_LOG_LEVEL_DEBUG);
+
+    N_DEBUG ("kept %d", 1);
+    kept = last_record ();
+    n_log_message (N_LOG_LEVEL_DEBUG, __FUNCTION__, __LINE__, detach_fmt, 2, "two");
+    detached = last_record ();
+
+    /* only records with a format within the range are formatted, the rest
+       of the recorder stays as it is */
+    n_log_detach_records (detach_fmt, detach_fmt + sizeof (detach_fmt));
+    fail_unless (detached->fmt == NULL);
+    fail_unless (g_str_equal (detached->data, "detached 2 two"));
+    fail_unless (kept->fmt != NULL);
+    fail_unless (kept->seq != 0);
+    n_log_format_record (kept, buf, sizeof (buf));
+    fail_unless (g_str_equal (buf, "kept 1"));
+    fail_unless (_record_dumping == 0);
+}
+END_TEST
+
+int
+main (int argc, char *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    int num_failed = 0;
+    Suite *s = NULL;
+    TCase *tc = NULL;
+    SRunner *sr = NULL;
+
+    s = suite_create ("\tLog tests");
+
+    tc = tcase_create ("flight recorder");
+    tcase_add_test (tc, test_record);
+    tcase_add_test (tc, test_wrap);
+    tcase_add_test (tc, test_detach);
+    suite_add_tcase (s, tc);
+
+    sr = srunner_create (s);
+    srunner_run_all (sr, CK_NORMAL);
+    num_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+
+    return num_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
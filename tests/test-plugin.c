@@ -4,6 +4,7 @@
 #include "ngf/plugin.h"
 #include "src/ngf/plugin-internal.h"
 #include "src/ngf/core-internal.h"
+#include "src/ngf/request-internal.h"
 #include <stdio.h>
 
 START_TEST (test_get_core)
@@ -206,6 +207,60 @@ START_TEST (test_load_plugin)
 }
 END_TEST
 
+START_TEST (test_lazy_load_plugin)
+{
+    NCore *core = n_core_new (NULL, NULL);
+    fail_unless (core != NULL);
+
+    /* allow execution inside build tree */
+    if (g_file_test ("./.libs/libngfd_test_fake.so", G_FILE_TEST_EXISTS)) {
+        g_free (core->plugin_path);
+        core->plugin_path = g_strdup ("./.libs");
+    }
+
+    NLazyPlugin *lazy = n_lazy_plugin_new (core, "test_fake");
+    n_lazy_plugin_add_prefix (lazy, "fake.");
+    core->lazy_plugins = g_list_append (core->lazy_plugins, lazy);
+
+    /* request without matching properties does not load the plugin */
+    NRequest *request = n_request_new ();
+    request->name = g_strdup ("test");
+    request->properties = n_proplist_new ();
+    n_proplist_set_string (request->properties, "sound.filename", "test.wav");
+
+    n_core_load_lazy_plugins (core, request);
+    fail_unless (n_lazy_plugin_is_loaded (lazy) == FALSE);
+    fail_unless (core->num_sinks == 0);
+
+    /* matching request loads the plugin and registers its sink. the
+       plugin gets the init done hook it missed at startup. */
+    core->init_done = TRUE;
+    n_proplist_set_string (request->properties, "fake.effect", "short");
+    n_core_load_lazy_plugins (core, request);
+    fail_unless (n_lazy_plugin_is_loaded (lazy) == TRUE);
+    fail_unless (core->num_sinks == 1);
+    fail_unless (g_strcmp0 (core->sinks[0]->name, "fake") == 0);
+    fail_unless (g_list_length (core->plugins) == 1);
+    fail_unless (core->hooks[N_CORE_HOOK_INIT_DONE].slots != NULL);
+    fail_unless (n_context_get_value (core->context, "fake.init_done") != NULL);
+
+    /* unloading removes the sink, hooks and subscriptions again */
+    n_lazy_plugin_unload (lazy);
+    fail_unless (n_lazy_plugin_is_loaded (lazy) == FALSE);
+    fail_unless (core->num_sinks == 0);
+    fail_unless (core->sinks[0] == NULL);
+    fail_unless (core->plugins == NULL);
+    fail_unless (core->hooks[N_CORE_HOOK_INIT_DONE].slots == NULL);
+
+    NValue *value = n_value_new ();
+    n_value_set_int (value, 1);
+    n_context_set_value (core->context, "fake.value", value);
+
+    n_request_free (request);
+    n_core_free (core);
+}
+END_TEST
+
 int
 main (int argc, char *argv[])
 {
@@ -240,6 +295,10 @@ main (int argc, char *argv[])
     tcase_add_test (tc, test_load_plugin);
     suite_add_tcase (s, tc);
 
+    tc = tcase_create ("load plug-in on demand");
+    tcase_add_test (tc, test_lazy_load_plugin);
+    suite_add_tcase (s, tc);
+
     sr = srunner_create (s);
     srunner_run_all (sr, CK_NORMAL);
     num_failed = srunner_ntests_failed (sr);
@@ -3,6 +3,7 @@
 #include <check.h>
 
 #include "src/include/ngf/proplist.h"
+#include "src/ngf/proplist-internal.h"
 #define ARRAY_SIZE(array) (sizeof((array)) / sizeof((array)[0]))
 
 START_TEST (test_match_exact)
@@ -537,6 +538,267 @@ START_TEST (test_proplist_values)
 }
 END_TEST
 
+START_TEST (test_atoms)
+{
+    NProplist *proplist = NULL;
+    proplist = n_proplist_new ();
+    fail_unless (proplist != NULL);
+
+    /* lookup does not intern */
+    fail_unless (n_atom_lookup ("test.atom.never-set") == N_ATOM_NONE);
+    fail_unless (n_proplist_get (proplist, "test.atom.never-set") == NULL);
+    fail_unless (n_atom_lookup ("test.atom.never-set") == N_ATOM_NONE);
+
+    NAtom atom = n_atom_intern ("test.atom.key");
+    fail_unless (atom != N_ATOM_NONE);
+    fail_unless (n_atom_intern ("test.atom.key") == atom);
+    fail_unless (n_atom_lookup ("test.atom.key") == atom);
+    fail_unless (g_strcmp0 (n_atom_to_string (atom), "test.atom.key") == 0);
+    fail_unless (n_atom_to_string (N_ATOM_NONE) == NULL);
+
+    /* string and atom variants operate on the same keys */
+    n_proplist_set_uint_atom (proplist, atom, 42);
+    fail_unless (n_proplist_get_uint (proplist, "test.atom.key") == 42);
+    fail_unless (n_proplist_has_key (proplist, "test.atom.key") == TRUE);
+
+    n_proplist_set_string (proplist, "test.atom.string", "value");
+    fail_unless (g_strcmp0 (n_proplist_get_string_atom (proplist,
+        n_atom_lookup ("test.atom.string")), "value") == 0);
+
+    n_proplist_set_int_atom (proplist, atom, -1);
+    fail_unless (n_proplist_get_int (proplist, "test.atom.key") == -1);
+    fail_unless (n_proplist_get_uint_atom (proplist, atom) == 0);
+    n_proplist_set_bool_atom (proplist, atom, TRUE);
+    fail_unless (n_proplist_get_bool_atom (proplist, atom) == TRUE);
+
+    n_proplist_unset_atom (proplist, atom);
+    fail_unless (n_proplist_has_atom (proplist, atom) == FALSE);
+    fail_unless (n_proplist_get_atom (proplist, atom) == NULL);
+
+    /* invalid atom */
+    n_proplist_set_uint_atom (proplist, N_ATOM_NONE, 1);
+    fail_unless (n_proplist_size (proplist) == 1);
+    fail_unless (n_proplist_get_atom (proplist, N_ATOM_NONE) == NULL);
+
+    n_proplist_free (proplist);
+    proplist = NULL;
+}
+END_TEST
+
+START_TEST (test_set_take)
+{
+    NProplist *proplist = NULL;
+    NProplist *copy = NULL;
+    NValue *value = NULL;
+    NValue *boxed = NULL;
+    char key[32];
+    guint limit = n_proplist_get_array_limit ();
+    guint i;
+
+    proplist = n_proplist_new ();
+
+    /* set keeps the instance, take moves the contents */
+    boxed = n_value_new ();
+    n_value_set_string (boxed, "boxed");
+    n_proplist_set (proplist, "boxed", boxed);
+    fail_unless (n_proplist_get (proplist, "boxed") == boxed);
+
+    value = n_value_new ();
+    n_value_set_string (value, "taken");
+    n_proplist_set_take (proplist, "taken", value);
+    value = NULL;
+    fail_unless (g_strcmp0 (n_proplist_get_string (proplist, "taken"), "taken") == 0);
+
+    /* copies and merges hold values of their own */
+    copy = n_proplist_copy (proplist);
+    fail_unless (n_proplist_get (copy, "boxed") != boxed);
+    fail_unless (n_proplist_match_exact (proplist, copy) == TRUE);
+    n_proplist_free (copy);
+
+    /* the instance survives the move to the hash table */
+    for (i = 0; i < limit + 1; ++i) {
+        g_snprintf (key, sizeof (key), "key%u", i);
+        n_proplist_set_uint (proplist, key, i);
+    }
+    fail_unless (n_proplist_get (proplist, "boxed") == boxed);
+    fail_unless (g_strcmp0 (n_proplist_get_string (proplist, "boxed"), "boxed") == 0);
+
+    /* replacing the value frees the previous one */
+    value = n_value_new ();
+    n_value_set_int (value, 1);
+    n_proplist_set (proplist, "boxed", value);
+    fail_unless (n_proplist_get_int (proplist, "boxed") == 1);
+
+    n_proplist_free (proplist);
+}
+END_TEST
+
+START_TEST (test_storage_modes)
+{
+    NProplist *small = NULL;
+    NProplist *large = NULL;
+    NProplist *hash = NULL;
+    NProplist *copy = NULL;
+    char key[32];
+    guint limit = n_proplist_get_array_limit ();
+    guint i;
+
+    /* grows past the array limit */
+    large = n_proplist_new ();
+    for (i = 0; i < limit + 8; ++i) {
+        g_snprintf (key, sizeof (key), "key%u", i);
+        n_proplist_set_uint (large, key, i + 1);
+    }
+    fail_unless (n_proplist_size (large) == (int) (limit + 8));
+    for (i = 0; i < limit + 8; ++i) {
+        g_snprintf (key, sizeof (key), "key%u", i);
+        fail_unless (n_proplist_get_uint (large, key) == i + 1);
+    }
+    copy = n_proplist_copy (large);
+    fail_unless (n_proplist_match_exact (large, copy) == TRUE);
+    n_proplist_unset (copy, "key0");
+    fail_unless (n_proplist_size (copy) == (int) (limit + 7));
+    fail_unless (n_proplist_has_key (copy, "key0") == FALSE);
+    n_proplist_free (copy);
+
+    /* merge of two sorted arrays, source overrides target */
+    small = n_proplist_new ();
+    n_proplist_set_string (small, "key1", "replaced");
+    n_proplist_set_string (small, "zzz", "last");
+    n_proplist_set_string (small, "aaa", "first");
+    copy = n_proplist_new ();
+    n_proplist_set_int (copy, "key1", 1);
+    n_proplist_set_int (copy, "key2", 2);
+    n_proplist_merge (copy, small);
+    fail_unless (n_proplist_size (copy) == 4);
+    fail_unless (g_strcmp0 (n_proplist_get_string (copy, "key1"), "replaced") == 0);
+    fail_unless (g_strcmp0 (n_proplist_get_string (copy, "aaa"), "first") == 0);
+    fail_unless (g_strcmp0 (n_proplist_get_string (copy, "zzz"), "last") == 0);
+    fail_unless (n_proplist_get_int (copy, "key2") == 2);
+
+    /* merge array into a hash table */
+    n_proplist_merge (large, copy);
+    fail_unless (n_proplist_size (large) == (int) (limit + 8 + 2));
+    fail_unless (g_strcmp0 (n_proplist_get_string (large, "key1"), "replaced") == 0);
+
+    /* hash table only proplist matches one with the same contents */
+    n_proplist_set_array_limit (0);
+    hash = n_proplist_copy (copy);
+    n_proplist_set_array_limit (limit);
+    fail_unless (n_proplist_match_exact (hash, copy) == TRUE);
+    fail_unless (n_proplist_match_exact (copy, hash) == TRUE);
+    n_proplist_set_int (hash, "key2", 3);
+    fail_unless (n_proplist_match_exact (copy, hash) == FALSE);
+
+    n_proplist_free (small);
+    n_proplist_free (large);
+    n_proplist_free (hash);
+    n_proplist_free (copy);
+}
+END_TEST
+
+START_TEST (test_layers)
+{
+    NProplist *event   = NULL;
+    NProplist *client  = NULL;
+    NProplist *request = NULL;
+    NProplist *edit    = NULL;
+    NProplist *flat    = NULL;
+    NProplist *layered = NULL;
+    NProplist *extra[N_PROPLIST_MAX_LAYERS + 1];
+    char key[32];
+    guint i;
+
+    event = n_proplist_new ();
+    n_proplist_set_string (event, "sound.filename", "event.wav");
+    n_proplist_set_bool   (event, "sound.repeat", TRUE);
+    n_proplist_set_int    (event, "event.only", 1);
+
+    client = n_proplist_new ();
+    n_proplist_set_string (client, "sound.filename", "client.wav");
+    n_proplist_set_int    (client, "client.only", 2);
+
+    /* values of the upper layers take precedence */
+    request = n_proplist_new ();
+    n_proplist_add_layer (request, client);
+    n_proplist_add_layer (request, event);
+    fail_unless (n_proplist_size (request) == 4);
+    fail_unless (g_strcmp0 (n_proplist_get_string (request, "sound.filename"), "client.wav") == 0);
+    fail_unless (n_proplist_get_int (request, "event.only") == 1);
+    fail_unless (n_proplist_get_int (request, "client.only") == 2);
+
+    /* writes go to the top, the layers stay untouched */
+    n_proplist_set_string (request, "sound.filename", "request.wav");
+    n_proplist_set_int    (request, "request.only", 3);
+    n_proplist_unset      (request, "sound.repeat");
+    n_proplist_unset      (request, "client.only");
+    fail_unless (n_proplist_size (request) == 3);
+    fail_unless (g_strcmp0 (n_proplist_get_string (request, "sound.filename"), "request.wav") == 0);
+    fail_unless (n_proplist_has_key (request, "sound.repeat") == FALSE);
+    fail_unless (n_proplist_has_key (request, "client.only") == FALSE);
+    fail_unless (g_strcmp0 (n_proplist_get_string (client, "sound.filename"), "client.wav") == 0);
+    fail_unless (n_proplist_get_bool (event, "sound.repeat") == TRUE);
+    fail_unless (n_proplist_size (client) == 2);
+
+    /* unset value can be set again */
+    n_proplist_set_bool (request, "sound.repeat", FALSE);
+    fail_unless (n_proplist_has_key (request, "sound.repeat") == TRUE);
+    n_proplist_unset (request, "sound.repeat");
+
+    /* copies are flattened */
+    flat = n_proplist_copy (request);
+    fail_unless (n_proplist_size (flat) == 3);
+    fail_unless (n_proplist_match_exact (flat, request) == TRUE);
+    fail_unless (n_proplist_match_exact (request, flat) == TRUE);
+    fail_unless (n_proplist_has_key (flat, "sound.repeat") == FALSE);
+
+    /* a key unset within a layer does not hide the layers below it */
+    layered = n_proplist_new ();
+    n_proplist_add_layer (layered, request);
+    n_proplist_add_layer (layered, event);
+    fail_unless (n_proplist_get_bool (layered, "sound.repeat") == TRUE);
+    fail_unless (n_proplist_size (layered) == 4);
+    n_proplist_free (layered);
+
+    /* edits are applied only when committed */
+    edit = n_proplist_new ();
+    n_proplist_add_layer (edit, flat);
+    n_proplist_set_int (edit, "edit.only", 4);
+    n_proplist_unset (edit, "event.only");
+    fail_unless (n_proplist_has_key (edit, "event.only") == FALSE);
+    fail_unless (n_proplist_get_int (edit, "request.only") == 3);
+    fail_unless (n_proplist_has_key (flat, "edit.only") == FALSE);
+    fail_unless (n_proplist_get_int (flat, "event.only") == 1);
+    n_proplist_apply (flat, edit);
+    fail_unless (n_proplist_get_int (flat, "edit.only") == 4);
+    fail_unless (n_proplist_has_key (flat, "event.only") == FALSE);
+    fail_unless (n_proplist_size (flat) == 3);
+    n_proplist_free (edit);
+
+    /* once the layers run out the values are copied */
+    layered = n_proplist_new ();
+    for (i = 0; i < N_PROPLIST_MAX_LAYERS + 1; ++i) {
+        extra[i] = n_proplist_new ();
+        g_snprintf (key, sizeof (key), "layer%u", i);
+        n_proplist_set_uint (extra[i], key, i);
+        n_proplist_set_uint (extra[i], "shared", i);
+        n_proplist_add_layer (layered, extra[i]);
+    }
+    fail_unless (n_proplist_size (layered) == N_PROPLIST_MAX_LAYERS + 2);
+    fail_unless (n_proplist_get_uint (layered, "shared") == 0);
+    n_proplist_unset (extra[N_PROPLIST_MAX_LAYERS], "layer4");
+    fail_unless (n_proplist_get_uint (layered, "layer4") == 4);
+    n_proplist_free (layered);
+    for (i = 0; i < N_PROPLIST_MAX_LAYERS + 1; ++i)
+        n_proplist_free (extra[i]);
+
+    n_proplist_free (flat);
+    n_proplist_free (request);
+    n_proplist_free (client);
+    n_proplist_free (event);
+}
+END_TEST
+
 int
 main (int argc, char *argv[])
 {
@@ -594,6 +856,22 @@ main (int argc, char *argv[])
     tcase_add_test (tc, test_proplist_values);
     suite_add_tcase (s, tc);
 
+    tc = tcase_create ("atoms");
+    tcase_add_test (tc, test_atoms);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("set and take");
+    tcase_add_test (tc, test_set_take);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("array and hash storage");
+    tcase_add_test (tc, test_storage_modes);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("layered proplists");
+    tcase_add_test (tc, test_layers);
+    suite_add_tcase (s, tc);
+
     sr = srunner_create (s);
     srunner_run_all (sr, CK_NORMAL);
     num_failed = srunner_ntests_failed (sr);
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 
 #include "src/include/ngf/request.h"
@@ -123,6 +124,169 @@ START_TEST (test_data)
 }
 END_TEST
 
+START_TEST (test_alloc)
+{
+    NRequest  *request = NULL;
+    NProplist *props   = NULL;
+    NProplist *copy    = NULL;
+    gchar     *str     = NULL;
+    gchar     *large   = NULL;
+    gchar      key[32];
+    guint     *zero    = NULL;
+    guint      i;
+
+    fail_unless (n_request_alloc (NULL, 16) == NULL);
+    fail_unless (n_request_strdup (NULL, "string") == NULL);
+
+    request = n_request_new_with_event ("event");
+    fail_unless (request != NULL);
+
+    /* memory is aligned for pointers and zeroed on request */
+    for (i = 1; i < 64; ++i)
+        fail_unless (((gsize) n_request_alloc (request, i) % sizeof (gpointer)) == 0);
+
+    zero = n_request_alloc0 (request, 16 * sizeof (guint));
+    for (i = 0; i < 16; ++i)
+        fail_unless (zero[i] == 0);
+
+    str = n_request_strdup (request, "string");
+    fail_unless (g_strcmp0 (str, "string") == 0);
+    fail_unless (n_request_strdup (request, NULL) == NULL);
+
+    /* allocations larger than a block */
+    large = n_request_alloc (request, 64 * 1024);
+    fail_unless (large != NULL);
+    memset (large, 'x', 64 * 1024);
+    fail_unless (g_strcmp0 (str, "string") == 0);
+
+    /* request properties draw from the same memory and can still be
+       modified and copied out. */
+    props = n_proplist_new ();
+    n_proplist_set_string (props, "key", "value");
+    n_request_set_properties (request, props);
+    n_proplist_free (props);
+
+    props = (NProplist*) n_request_get_properties (request);
+    n_proplist_set_string (props, "key", "new value");
+    for (i = 0; i < 100; ++i) {
+        g_snprintf (key, sizeof (key), "key.%u", i);
+        n_proplist_set_uint (props, key, i);
+    }
+    n_proplist_unset (props, "key.50");
+    fail_unless (n_proplist_size (props) == 100);
+    fail_unless (g_strcmp0 (n_proplist_get_string (props, "key"), "new value") == 0);
+    fail_unless (n_proplist_get_uint (props, "key.99") == 99);
+
+    copy = n_proplist_copy (props);
+    n_request_free (request);
+
+    fail_unless (n_proplist_size (copy) == 100);
+    fail_unless (g_strcmp0 (n_proplist_get_string (copy, "key"), "new value") == 0);
+    fail_unless (n_proplist_has_key (copy, "key.50") == FALSE);
+    n_proplist_free (copy);
+}
+END_TEST
+
+START_TEST (test_edit_properties)
+{
+    NRequest  *request = NULL;
+    NProplist *props   = NULL;
+    NProplist *edit    = NULL;
+
+    fail_unless (n_request_edit_properties (NULL) == NULL);
+
+    props = n_proplist_new ();
+    n_proplist_set_string (props, "keep", "value");
+    n_proplist_set_string (props, "drop", "value");
+    request = n_request_new_with_event_and_properties ("event", props);
+    n_proplist_free (props);
+
+    /* discarded edit leaves the properties as they were */
+    edit = n_request_edit_properties (request);
+    fail_unless (edit != NULL);
+    fail_unless (g_strcmp0 (n_proplist_get_string (edit, "keep"), "value") == 0);
+    n_proplist_unset (edit, "keep");
+    n_proplist_set_int (edit, "new", 1);
+    n_request_discard_properties (request, edit);
+    props = (NProplist*) n_request_get_properties (request);
+    fail_unless (n_proplist_has_key (props, "keep") == TRUE);
+    fail_unless (n_proplist_has_key (props, "new") == FALSE);
+
+    /* changes are not visible before commit */
+    edit = n_request_edit_properties (request);
+    n_proplist_unset (edit, "drop");
+    n_proplist_set_string (edit, "keep", "changed");
+    n_proplist_set_int (edit, "new", 1);
+    fail_unless (n_proplist_has_key (props, "drop") == TRUE);
+    fail_unless (n_proplist_has_key (edit, "drop") == FALSE);
+    fail_unless (g_strcmp0 (n_proplist_get_string (props, "keep"), "value") == 0);
+
+    n_request_commit_properties (request, edit);
+    fail_unless (n_proplist_size (props) == 2);
+    fail_unless (n_proplist_has_key (props, "drop") == FALSE);
+    fail_unless (g_strcmp0 (n_proplist_get_string (props, "keep"), "changed") == 0);
+    fail_unless (n_proplist_get_int (props, "new") == 1);
+
+    n_request_free (request);
+
+    /* request without properties gets empty ones to edit */
+    request = n_request_new_with_event ("event");
+    edit = n_request_edit_properties (request);
+    n_proplist_set_int (edit, "new", 1);
+    n_request_commit_properties (request, edit);
+    fail_unless (n_proplist_get_int (n_request_get_properties (request), "new") == 1);
+    n_request_free (request);
+}
+END_TEST
+
+static void
+keep_release_cb (gpointer data)
+{
+    gchar *buffer = data;
+
+    /* borrowed values must stay readable until the request is gone. */
+    fail_unless (g_strcmp0 (buffer, "borrowed") == 0);
+    buffer[0] = '\0';
+}
+
+START_TEST (test_borrowed_properties)
+{
+    NRequest  *request = NULL;
+    NProplist *props   = NULL;
+    NProplist *copy    = NULL;
+    gchar     *buffer  = NULL;
+    NAtom      key     = n_atom_intern ("borrowed");
+
+    fail_unless (n_request_init_properties (NULL) == NULL);
+
+    request = n_request_new_with_event ("event");
+    props = n_request_init_properties (request);
+    fail_unless (props != NULL);
+    fail_unless (n_request_init_properties (request) == props);
+    fail_unless (n_request_get_properties (request) == props);
+
+    /* the value points to the kept buffer instead of a copy */
+    buffer = g_strdup ("borrowed");
+    n_request_keep (request, buffer, keep_release_cb);
+    n_proplist_set_string_borrowed_atom (props, key, buffer);
+    fail_unless (n_proplist_get_string_atom (props, key) == buffer);
+
+    /* copies out of the request own their strings */
+    copy = n_proplist_copy (props);
+    fail_unless (n_proplist_get_string_atom (copy, key) != buffer);
+
+    n_request_free (request);
+    fail_unless (buffer[0] == '\0');
+    fail_unless (g_strcmp0 (n_proplist_get_string_atom (copy, key), "borrowed") == 0);
+
+    /* proplists outside of an arena copy the value */
+    n_proplist_set_string_borrowed_atom (copy, key, buffer);
+    fail_unless (n_proplist_get_string_atom (copy, key) != buffer);
+    n_proplist_free (copy);
+    g_free (buffer);
+}
+END_TEST
+
 int
 main (int argc, char *argv[])
 {
@@ -148,6 +312,18 @@ main (int argc, char *argv[])
     tcase_add_test (tc, test_data);
     suite_add_tcase (s, tc);
 
+    tc = tcase_create ("request scoped allocations");
+    tcase_add_test (tc, test_alloc);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("edit properties");
+    tcase_add_test (tc, test_edit_properties);
+    suite_add_tcase (s, tc);
+
+    tc = tcase_create ("borrowed properties");
+    tcase_add_test (tc, test_borrowed_properties);
+    suite_add_tcase (s, tc);
+
     sr = srunner_create (s);
     srunner_run_all (sr, CK_NORMAL);
     num_failed = srunner_ntests_failed (sr);